@@ -0,0 +1,75 @@
+# Generates inc/loragw_reg_map.h from the loregs[] table of src/loragw_reg.c
+# usage: awk -f gen_reg_inline.awk src/loragw_reg.c > inc/loragw_reg_map.h
+#
+# Each register NAME gets a LGW_REGI_NAME macro expanding to the argument list
+# of the loragw_reg_inline.h accessors: id, page, addr, offs, sign, leng, rdon
+# LGW_REG_MAP_NAMES lists the register names, indexed by register ID
+
+BEGIN {
+	n = 0
+	intable = 0
+}
+
+/^const struct lgw_reg_s loregs\[/ {
+	intable = 1
+	next
+}
+
+intable && /^};/ {
+	intable = 0
+}
+
+intable && /^[ \t]*\{/ {
+	line = $0
+	name = line
+	sub(/^.*\/\*[ \t]*/, "", name)
+	sub(/[ \t]*\*\/.*$/, "", name)
+	sub(/^[ \t]*\{/, "", line)
+	sub(/\}.*$/, "", line)
+	split(line, f, ",")
+	names[n] = name
+	fields[n] = f[1] "," f[2] "," f[3] "," f[4] "," f[5] "," f[6]
+	++n
+}
+
+END {
+	print "/*"
+	print " / _____)             _              | |"
+	print "( (____  _____ ____ _| |_ _____  ____| |__"
+	print " \\____ \\| ___ |    (_   _) ___ |/ ___)  _ \\"
+	print " _____) ) ____| | | || |_| ____( (___| | | |"
+	print "(______/|_____)_|_|_| \\__)_____)\\____)_| |_|"
+	print "  (C)2013 Semtech-Cycleo"
+	print ""
+	print "Description:"
+	print "\tConstant register descriptors for the inline register accessors."
+	print "\tAuto generated from loregs[] by gen_reg_inline.awk, do not edit."
+	print ""
+	print "License: Revised BSD License, see LICENSE.TXT file include in the project"
+	print "Maintainer: Sylvain Miermont"
+	print "*/"
+	print ""
+	print ""
+	print "#ifndef _LORAGW_REG_MAP_H"
+	print "#define _LORAGW_REG_MAP_H"
+	print ""
+	print "/*"
+	print "auto generated register mapping for inline accessors"
+	print "id, page, addr, offs, sign, leng, rdon"
+	print n " registers are defined"
+	print "*/"
+	print ""
+	for (i = 0; i < n; ++i) {
+		printf "#define LGW_REGI_%s\tLGW_%s,%s\n", names[i], names[i], fields[i]
+	}
+	print ""
+	print "/* register names, indexed by register ID */"
+	print "#define LGW_REG_MAP_NAMES \\"
+	for (i = 0; i < n; ++i) {
+		printf "\t\"%s\"%s\n", names[i], (i < n - 1) ? ", \\" : ""
+	}
+	print ""
+	print "#endif"
+	print ""
+	print "/* --- EOF ------------------------------------------------------------------ */"
+}
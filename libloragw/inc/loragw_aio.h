@@ -0,0 +1,142 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	Asynchronous register access engine.
+	Application threads submit register and burst operations to a lock-free
+	submission ring, a dedicated I/O thread (optionally pinned, SCHED_FIFO and
+	memory-locked) executes them back-to-back on the SPI link and posts the
+	results to a completion ring, with an optional eventfd notification.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+#ifndef _LORAGW_AIO_H
+#define _LORAGW_AIO_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+
+#include "config.h"	/* library configuration options (dynamically generated) */
+#include "loragw_reg.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define LGW_AIO_SUCCESS	 0
+#define LGW_AIO_ERROR	-1
+
+#define LGW_AIO_RING_DEFAULT	256	/* default number of operations in flight */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@enum lgw_aio_op_e
+@brief Operations executed by the I/O thread
+*/
+enum lgw_aio_op_e {
+	LGW_AIO_REG_W,	/*!> lgw_reg_w of value */
+	LGW_AIO_REG_R,	/*!> lgw_reg_r, result in value */
+	LGW_AIO_REG_WB,	/*!> lgw_reg_wb of data[size] */
+	LGW_AIO_REG_RB,	/*!> lgw_reg_rb into data[size] */
+	LGW_AIO_CALL	/*!> fn(arg), to run a whole sequence (eg. lgw_receive) on the I/O thread */
+};
+
+/**
+@struct lgw_aio_req_s
+@brief Operation submitted to the I/O thread, returned as completion with its status
+*/
+struct lgw_aio_req_s {
+	enum lgw_aio_op_e	op;				/*!> operation */
+	uint16_t			register_id;	/*!> register of REG_* operations */
+	int32_t				value;			/*!> value to write (REG_W) or value read (REG_R) */
+	uint8_t				*data;			/*!> burst buffer, must stay valid until completion */
+	uint16_t			size;			/*!> burst size, in bytes */
+	int					(*fn)(void *arg); /*!> function called by CALL operations */
+	void				*arg;			/*!> argument of fn */
+	void				*user;			/*!> opaque tag returned untouched with the completion */
+	int					status;			/*!> result of the operation (LGW_REG_SUCCESS/LGW_REG_ERROR or fn return) */
+};
+
+/**
+@struct lgw_aio_conf_s
+@brief Configuration of the I/O thread, all fields are best-effort
+*/
+struct lgw_aio_conf_s {
+	uint32_t	ring_size;		/*!> max operations in flight, rounded up to a power of 2 (0 for default) */
+	int			cpu;			/*!> CPU the I/O thread is pinned to, -1 for no pinning */
+	int			rt_priority;	/*!> SCHED_FIFO priority of the I/O thread, 0 to keep the default policy */
+	bool		mlock;			/*!> lock all the process memory (mlockall) to avoid page faults */
+	bool		eventfd;		/*!> signal completions on an eventfd (see lgw_aio_get_fd) */
+};
+
+/**
+@brief Opaque handle of an I/O engine
+*/
+struct lgw_aio_s;
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Create an I/O engine and start its I/O thread
+@param reg register context the operations are executed on (NULL for the default context), must be connected
+@param conf pointer to the I/O thread configuration (NULL for defaults: no pinning, no RT, no eventfd)
+@return pointer to the engine, NULL if it could not be created
+*/
+struct lgw_aio_s *lgw_aio_create(struct lgw_reg_ctx_s *reg, const struct lgw_aio_conf_s *conf);
+
+/**
+@brief Stop the I/O thread, after it executed all submitted operations, and free the engine
+@param aio pointer to the engine
+*/
+void lgw_aio_destroy(struct lgw_aio_s *aio);
+
+/**
+@brief Submit an operation, thread-safe and lock-free
+@param aio pointer to the engine
+@param req pointer to the operation (copied)
+@return LGW_AIO_SUCCESS, or LGW_AIO_ERROR if ring_size operations are already in flight
+*/
+int lgw_aio_submit(struct lgw_aio_s *aio, const struct lgw_aio_req_s *req);
+
+/**
+@brief Fetch completed operations without blocking, thread-safe and lock-free
+@param aio pointer to the engine
+@param cpl array where to copy the completed operations
+@param max max number of completions to fetch
+@return number of completions fetched, LGW_AIO_ERROR if the engine is invalid
+*/
+int lgw_aio_reap(struct lgw_aio_s *aio, struct lgw_aio_req_s *cpl, int max);
+
+/**
+@brief Wait until at least one completion is available, several threads can wait at once
+@param aio pointer to the engine
+@param timeout_ms max time to wait, in ms (-1 to wait forever)
+@return LGW_AIO_SUCCESS if a completion is available, LGW_AIO_ERROR on timeout
+*/
+int lgw_aio_wait(struct lgw_aio_s *aio, int timeout_ms);
+
+/**
+@brief Get the eventfd signalled on completions, for use in poll/epoll loops
+The eventfd is readable while completions are pending and reset by
+lgw_aio_reap once they are all fetched: do not read it.
+@param aio pointer to the engine
+@return file descriptor, -1 if the engine was created without eventfd
+*/
+int lgw_aio_get_fd(struct lgw_aio_s *aio);
+
+#endif
+
+/* --- EOF ------------------------------------------------------------------ */
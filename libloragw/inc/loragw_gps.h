@@ -30,11 +30,21 @@ Maintainer: Sylvain Miermont
 #endif
 
 #include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+#include <stddef.h>		/* size_t */
 #include <time.h>		/* time library */
 #include <termios.h>	/* speed_t */
 
 #include "config.h"	/* library configuration options (dynamically generated) */
 
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define LGW_GPS_SUCCESS	 0
+#define LGW_GPS_ERROR	-1
+
+#define LGW_GPS_EST_SIZE	16	/* number of synchronization points fitted by the drift estimator */
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC TYPES --------------------------------------------------------- */
 
@@ -47,6 +57,47 @@ struct tref {
 	uint32_t	count_us; 	/*!> reference concentrator internal timestamp */
 	struct timespec utc; 	/*!> reference UTC time (from GPS) */
 	double		xtal_err;	/*!> raw clock error (eg. <1 'slow' XTAL) */
+	uint8_t		aber;		/*!> aberrant points history of lgw_gps_sync (internal) */
+};
+
+/**
+@struct tref_est_s
+@brief Clock drift estimator, fitting the latest synchronization points (zero-initialize before first use)
+*/
+struct tref_est_s {
+	uint32_t	cnt[LGW_GPS_EST_SIZE];	/*!> concentrator counter at each point */
+	struct timespec utc[LGW_GPS_EST_SIZE]; /*!> UTC time of each point */
+	int			nb;			/*!> number of points in the ring */
+	int			head;		/*!> index of the next point to write */
+	int			rejected;	/*!> consecutive points rejected as outliers */
+	double		xtal_err_sd;	/*!> standard deviation of the xtal_err estimate */
+	double		jitter_us;	/*!> standard deviation of the points around the fit, in us */
+	double		prior_sd;	/*!> uncertainty of the loaded clock error, used for the first point (lgw_gps_calib_load) */
+};
+
+/**
+@struct lgw_gps_service_conf_s
+@brief Configuration of the GPS service thread (all settings are best-effort)
+*/
+struct lgw_gps_service_conf_s {
+	int			cpu;			/*!> CPU the thread is pinned on, -1 for no affinity */
+	int			rt_priority;	/*!> SCHED_FIFO priority of the thread, 0 to keep the default policy */
+	const char	*calib_path;	/*!> clock calibration loaded at start and saved at stop, NULL for none */
+	double		temperature;	/*!> board temperature in degree C for the calibration, NAN if unknown */
+};
+
+/**
+@struct lgw_gps_service_stat_s
+@brief Counters and clock quality reported by the GPS service thread
+*/
+struct lgw_gps_service_stat_s {
+	bool		running;		/*!> false once the thread stopped (tty closed or lgw_gps_service_stop) */
+	uint32_t	nb_msg;			/*!> time messages received (RMC, ZDA, NAV-TIMEUTC) */
+	uint32_t	nb_sync;		/*!> synchronization points accepted and published */
+	uint32_t	nb_reject;		/*!> synchronization points rejected (no fix, outlier) */
+	double		xtal_err;		/*!> latest published clock error */
+	double		xtal_err_sd;	/*!> standard deviation of the xtal_err estimate */
+	double		jitter_us;		/*!> standard deviation of the points around the fit, in us */
 };
 
 /**
@@ -81,17 +132,12 @@ enum gps_msg {
 	NMEA_GLL,		/*!> Latitude and longitude, with time fix and status */
 	NMEA_TXT,		/*!> Text Transmission */
 	NMEA_VTG,		/*!> Course over ground and Ground speed */
-	/* uBlox proprietary NMEA messages of interest */
-	UBX_POSITION,	/*!>  */
-	UBX_TIME		/*!>  */
+	/* uBlox binary (UBX) messages of interest */
+	UBX_POSITION,	/*!> NAV-PVT, navigation solution (time + pos + alt, sat number) */
+	UBX_TIME,		/*!> NAV-TIMEUTC, UTC time with ns resolution */
+	UBX_TIMEPULSE	/*!> TIM-TP, UTC time of the next time pulse (PPS) */
 };
 
-/* -------------------------------------------------------------------------- */
-/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
-
-#define LGW_GPS_SUCCESS	 0
-#define LGW_GPS_ERROR	-1
-
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
@@ -99,13 +145,44 @@ enum gps_msg {
 @brief Configure a GPS module
 
 @param tty_path path to the TTY connected to the GPS
-@param gps_familly parameter (eg. ubx6 for uBlox gen.6)
-@param target_brate target baudrate for communication (0 keeps default target baudrate)
+@param gps_familly parameter (eg. ubx6 for uBlox gen.6, NULL for a generic NMEA receiver)
+@param target_brate target baudrate for communication, B4800 to B230400 (0 keeps default target baudrate)
 @param fd_ptr pointer to a variable to receive file descriptor on GPS tty
 @return success if the function was able to connect and configure a GPS module
+
+The tty is set in raw (non-canonical) mode, read() returns the bytes as soon
+as they are received: use lgw_gps_feed to parse them.
+With a target baudrate, a "ubx*" receiver is asked to switch its serial port
+to that baudrate (other receivers must already use it), then the tty is
+switched too and the function fails if no valid message is received within
+a few seconds (the tty is then back at the default baudrate).
+With a "ubx*" family, the receiver is also switched to UBX binary output:
+NMEA sentences are disabled and NAV-PVT, NAV-TIMEUTC and TIM-TP are sent once
+per navigation solution. The function fails if the receiver does not
+acknowledge the configuration.
 */
 int lgw_gps_enable(char* tty_path, char* gps_familly, speed_t target_brate, int* fd_ptr);
 
+/**
+@brief Parse the byte stream coming from the GPS system (or other GNSS)
+
+@param buff pointer to bytes read from the GPS tty, fragments of any size (no null char needed)
+@param size number of bytes in buff
+@param msg pointer to receive the type of the sentence completed by the consumed bytes (UNKNOWN if none)
+@return number of bytes consumed, LGW_GPS_ERROR if the parameters are invalid
+
+Sentences are parsed in a single pass as the bytes arrive, the checksum is
+verified on the fly and the parsed values are applied to the same global
+variables as lgw_parse_nmea once it matches. Parsing stops just after the end
+of a sentence, so the caller can act on each one (eg. synchronization on RMC):
+call again with the remaining bytes until all are consumed.
+RMC, GGA, GNS and ZDA sentences are parsed, as well as the NAV-PVT,
+NAV-TIMEUTC and TIM-TP UBX frames (Fletcher checksum verified), others
+return IGNORED.
+Same thread-safety rules as lgw_parse_nmea.
+*/
+int lgw_gps_feed(const char *buff, int size, enum gps_msg *msg);
+
 /**
 @brief Parse messages coming from the GPS system (or other GNSS)
 
@@ -136,6 +213,20 @@ lock must be acquired before calling either function.
 */
 int lgw_gps_get(struct timespec* utc, struct coord_s* loc, struct coord_s* err);
 
+/**
+@brief Get the UTC time of the next time pulse (PPS) announced by the GPS
+
+@param utc pointer to store UTC time of the pulse, with ns precision
+@param qerr pointer to store the quantization error of the pulse, in ps (NULL to ignore)
+@return success if a UBX TIM-TP frame aligned on UTC was received
+
+The time pulse is announced before it happens: once the pulse occurred (ie.
+the next navigation solution is received), the concentrator counter latched
+on it can be associated to that time with lgw_gps_sync.
+Same thread-safety rules as lgw_gps_get.
+*/
+int lgw_gps_get_pulse(struct timespec* utc, int32_t* qerr);
+
 /**
 @brief Take a timestamp and UTC time and refresh reference for time conversion
 
@@ -144,10 +235,129 @@ int lgw_gps_get(struct timespec* utc, struct coord_s* loc, struct coord_s* err);
 @param utc UTC time, with ns precision (leap seconds are ignored)
 @return success if timestamp was read and time reference could be refreshed
 
-Set systime to 0 in ref to trigger initial synchronization.
+Set systime to 0 in ref to trigger initial synchronization: the reference is
+then valid from the second point, or from the first one if the clock error was
+loaded with lgw_gps_calib_load.
+xtal_err is the slope between the previous and the new point, use
+lgw_gps_sync_est for a filtered estimate.
 */
 int lgw_gps_sync(struct tref* ref, uint32_t count_us, struct timespec utc);
 
+/**
+@brief Add a synchronization point to a drift estimator and refresh reference for time conversion
+
+@param est pointer to the drift estimator (zero-initialized before the first point)
+@param ref pointer to time reference structure, updated with the estimate
+@param count_us concentrator counter latched on the PPS pulse
+@param utc UTC time of the PPS pulse, with ns precision (leap seconds are ignored)
+@return success if the point was accepted and the time reference refreshed
+
+Slope and offset are fitted by least squares over the latest LGW_GPS_EST_SIZE
+points (within about 15 minutes), so the jitter of a single point is averaged
+out. The first point only starts the fit: the function returns an error and
+sets systime to 0 in ref until a second point gives the clock error (unless it
+was loaded with lgw_gps_calib_load). A point whose residual is too large for
+the current fit, or whose counter does not match the UTC time elapsed since
+the newest point, is rejected (the function returns an error, ref is
+unchanged); after 3 successive rejections the estimator restarts from the new
+point (eg. after a counter reset) and ref is invalid until the next point.
+The uncertainty of the estimate is available in est (xtal_err_sd, jitter_us).
+The estimator and the reference are not shared between calls, several
+estimators can run in parallel.
+*/
+int lgw_gps_sync_est(struct tref_est_s* est, struct tref* ref, uint32_t count_us, struct timespec utc);
+
+/**
+@brief Save the validated clock error of a time reference, for a fast lock after a restart
+
+@param path path of the calibration file (replaced atomically)
+@param ref pointer to the time reference
+@param est pointer to the drift estimator that produced it, NULL for lgw_gps_sync
+@param temperature board temperature in degree C, NAN if unknown
+@return success if the clock error was validated and saved
+
+Typically called on shutdown. The clock error is only saved once it was fitted
+over several PPS and its uncertainty is below 1 ppm.
+*/
+int lgw_gps_calib_save(const char* path, const struct tref* ref, const struct tref_est_s* est, double temperature);
+
+/**
+@brief Load a saved clock error as a starting point for the synchronization
+
+@param path path of the calibration file
+@param temperature current board temperature in degree C, NAN if unknown
+@param ref pointer to the time reference to initialize
+@param est pointer to the drift estimator to initialize, NULL for lgw_gps_sync
+@return success if the file was recent and precise enough to be used
+
+Typically called at start. The uncertainty of the saved clock error is widened
+with its age and the temperature change, the file is ignored beyond 1 ppm or
+30 days. Without calibration, lgw_gps_sync and lgw_gps_sync_est need two PPS
+to measure the clock error before returning a reference valid for
+conversions; with a loaded clock error, the first PPS is enough.
+*/
+int lgw_gps_calib_load(const char* path, double temperature, struct tref* ref, struct tref_est_s* est);
+
+/**
+@brief Publish a time reference for the threads converting timestamps
+
+@param ref pointer to the time reference to publish (copied)
+
+Typically called by the GPS thread after each successful lgw_gps_sync(_est).
+Writers are serialized, readers (lgw_gps_snapshot) are never blocked.
+*/
+void lgw_gps_publish(const struct tref* ref);
+
+/**
+@brief Get a copy of the latest published time reference, without locking
+
+@param ref pointer to store the time reference
+@return success if a time reference was published
+
+The reference is published with a sequence counter (seqlock): the copy is
+retried if the reference was updated during the copy, so no mutex is needed
+between the GPS thread and the threads converting timestamps.
+*/
+int lgw_gps_snapshot(struct tref* ref);
+
+/**
+@brief Start the GPS service thread on an open GPS tty
+
+@param fd file descriptor of the GPS tty (from lgw_gps_enable), not closed by the service
+@param conf pointer to the thread configuration, NULL for the defaults
+@return success if the thread was started
+
+The thread waits for data on the tty (epoll), parses it with lgw_gps_feed,
+reads the concentrator PPS counter (lgw_get_trigcnt) as soon as a time message
+is complete, feeds a drift estimator (lgw_gps_sync_est) and publishes every
+validated reference with lgw_gps_publish: without calibration file, from the
+second PPS; with one, the clock error saved by the previous
+lgw_gps_service_stop is used from the first PPS.
+The PPS counter read is serialized with the live counter reads of other
+threads (lgw_get_instcnt64, lgw_send_at), but a live counter read during the
+PPS edge drops that capture: the stale value is rejected by the estimator.
+While the service runs, the parser belongs to the thread: other threads must
+use lgw_gps_snapshot instead of lgw_gps_feed/lgw_gps_get.
+*/
+int lgw_gps_service_start(int fd, const struct lgw_gps_service_conf_s* conf);
+
+/**
+@brief Stop the GPS service thread and wait for its termination
+
+The clock error is saved to the calibration file, if any and if validated.
+
+@return success if the thread was running
+*/
+int lgw_gps_service_stop(void);
+
+/**
+@brief Get the counters and clock quality of the GPS service
+
+@param stat pointer to store the statistics
+@return success if the statistics were copied
+*/
+int lgw_gps_service_stat(struct lgw_gps_service_stat_s* stat);
+
 /**
 @brief Convert concentrator timestamp counter value to UTC time
 
@@ -176,6 +386,36 @@ transform an absolute UTC time into a matching internal concentrator timestamp.
 */
 int lgw_utc2cnt(struct tref ref,struct timespec utc, uint32_t* count_us);
 
+/**
+@brief Convert an array of concentrator timestamp counter values to UTC time
+
+@param ref pointer to the time reference structure required for time conversion
+@param count_us array of internal timestamp counter values
+@param n number of values to convert
+@param utc array to store the n UTC times, with ns precision (leap seconds ignored)
+@return success if the function was able to convert the timestamps to UTC
+
+The conversion factor is computed once in 64-bit fixed point, the conversions
+themselves only use integer arithmetic (results may differ by 1 ns from
+lgw_cnt2utc, because of the rounding). Use it to convert a batch of received
+packets with a single reference.
+*/
+int lgw_cnt2utc_batch(const struct tref* ref, const uint32_t* count_us, size_t n, struct timespec* utc);
+
+/**
+@brief Convert an array of UTC times to concentrator timestamp counter values
+
+@param ref pointer to the time reference structure required for time conversion
+@param utc array of UTC times, with ns precision (leap seconds are ignored)
+@param n number of values to convert
+@param count_us array to store the n internal timestamp counter values
+@return success if the function was able to convert the UTC times to timestamps
+
+Inverse of lgw_cnt2utc_batch, same fixed-point arithmetic (results may differ
+by 1 us from lgw_utc2cnt, because of the rounding).
+*/
+int lgw_utc2cnt_batch(const struct tref* ref, const struct timespec* utc, size_t n, uint32_t* count_us);
+
 #endif
 
 /* --- EOF ------------------------------------------------------------------ */
@@ -107,6 +107,9 @@ Maintainer: Sylvain Miermont
 	#define LGW_RF_TX_UPFREQ	{ 434790000, 434790000}
 #endif
 
+/* TX gain settings of the AGC firmware, selected by the TX power of each packet */
+#define LGW_TX_GAIN_LUT_SIZE	16
+
 /* type of if_chain + modem */
 #define IF_UNDEFINED		0
 #define IF_LORA_STD			0x10	/* if + standard single-SF LoRa modem */
@@ -266,6 +269,34 @@ struct lgw_conf_rxif_s {
 	uint32_t	datarate;	/*!> RX datarate, 0 for default */
 };
 
+/**
+@struct lgw_conf_fw_s
+@brief Firmware loading options of the concentrator MCUs
+*/
+struct lgw_conf_fw_s {
+	bool		skip_resident;	/*!> keep a firmware still resident in the MCU program RAM since the previous start (warm restart) */
+	bool		verify;			/*!> read back the whole program RAM after loading a firmware and fail on mismatch */
+};
+
+/**
+@struct lgw_tx_gain_s
+@brief One TX gain setting and the power it gives at the board connector
+*/
+struct lgw_tx_gain_s {
+	uint8_t		pa_gain;	/*!> 2 bits, control of the external PA (SX1301 I/O) */
+	uint8_t		dac_gain;	/*!> 2 bits, control of the radio DAC */
+	uint8_t		mix_gain;	/*!> 4 bits, control of the radio mixer */
+	int8_t		rf_power;	/*!> measured TX power at the board connector, in dBm */
+};
+
+/**
+@struct lgw_tx_gain_lut_s
+@brief TX gain table loaded in the AGC firmware, sorted by increasing rf_power
+*/
+struct lgw_tx_gain_lut_s {
+	struct lgw_tx_gain_s	lut[LGW_TX_GAIN_LUT_SIZE];	/*!> gain settings, indexed by the TX power index of the firmware */
+};
+
 /**
 @struct lgw_pkt_rx_s
 @brief Structure containing the metadata of a packet that was received and a pointer to the payload
@@ -275,6 +306,7 @@ struct lgw_pkt_rx_s {
 	uint8_t		if_chain;	/*!> by which IF chain was packet received */
 	uint8_t		status;		/*!> status of the received packet */
 	uint32_t	count_us;	/*!> internal concentrator counter for timestamping, 1 microsecond resolution */
+	uint64_t	count_us64;	/*!> count_us extended to 64 bits, never wraps (counts from before lgw_start) */
 	uint8_t		rf_chain;	/*!> through which RF chain the packet was received */
 	uint8_t		modulation; /*!> modulation used by the packet */
 	uint8_t		bandwidth;	/*!> modulation bandwidth (LoRa only) */
@@ -315,6 +347,20 @@ struct lgw_pkt_tx_s {
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
+/*
+Concurrency model:
+- lgw_receive and lgw_send/lgw_status can be called from different threads,
+  each direction is serialized by its own lock so RX polling never waits for a
+  TX to be composed, only for the few SPI accesses in progress.
+- lgw_get_trigcnt and the loragw_reg functions are safe from any thread, the
+  register layer serializes SPI accesses and page switches internally.
+  lgw_get_trigcnt waits for a live counter read (lgw_get_instcnt64, or
+  lgw_send_at when the counter must be read again) to complete.
+- lgw_start and lgw_stop wait for pending RX and TX calls to finish.
+- lgw_rxrf_setconf and lgw_rxif_setconf must be called from a single thread
+  while the concentrator is stopped.
+*/
+
 /**
 @brief Configure an RF chain (must configure before start)
 @param rf_chain number of the RF chain to configure [0, LGW_RF_CHAIN_NB - 1]
@@ -331,6 +377,57 @@ int lgw_rxrf_setconf(uint8_t rf_chain, struct lgw_conf_rxrf_s conf);
 */
 int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s conf);
 
+/**
+@brief Select the SPI device and clock of the concentrator (must configure before start)
+@param path SPI device path, NULL for the default (LGW_SPI_PATH environment variable or compiled-in)
+@param speed_hz SPI clock in Hz, 0 for the default (LGW_SPI_SPEED environment variable or compiled-in)
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_spi_setconf(const char *path, uint32_t speed_hz);
+
+/**
+@brief Find the fastest reliable SPI clock and keep it for start (must be called before start)
+@param min_hz first clock to try, in Hz
+@param max_hz last clock to try, in Hz
+@param step_hz clock increment between tries, in Hz
+@param speed_hz pointer to a variable where to write the selected clock, in Hz
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_spi_probe(uint32_t min_hz, uint32_t max_hz, uint32_t step_hz, uint32_t *speed_hz);
+
+/**
+@brief Configure the firmware loading of the next starts (default: always load, no verification)
+A resident firmware is detected by reading back a few windows of the program
+RAM (512 bytes instead of 8 kB), and only if this context loaded that same
+firmware before; a power cycle or another firmware forces the reload.
+The calibration firmware shares the AGC MCU, so only the ARB firmware and the
+AGC firmware of a start without calibration can actually be kept.
+@param conf structure containing the configuration parameters
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_fw_setconf(struct lgw_conf_fw_s conf);
+
+/**
+@brief Configure the TX gain table (default: table of the board selected at build time)
+When the concentrator is running, only the AGC MCU is restarted to load the
+new table (the AGC firmware accepts it only during its initialization): the
+radios and modems keep their configuration, but the RX gain control stops for
+a few ms. Fails if a packet is scheduled or being emitted.
+@param conf pointer to the table, rf_power must not decrease along the table
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_txgain_setconf(const struct lgw_tx_gain_lut_s *conf);
+
+/**
+@brief Read a TX gain table from a binary profile, to give to lgw_txgain_setconf
+The profile is "LGWTXG", a version byte (1), the number of entries (16), then
+for each entry: pa_gain, dac_gain, mix_gain, rf_power (signed, dBm).
+@param path path of the profile file
+@param conf pointer to the table to fill, checked like by lgw_txgain_setconf
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_txgain_load(const char *path, struct lgw_tx_gain_lut_s *conf);
+
 /**
 @brief Connect to the LoRa concentrator, reset it and configure it according to previously set parameters
 @return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
@@ -373,6 +470,37 @@ int lgw_status(uint8_t select, uint8_t *code);
 */
 int lgw_get_trigcnt(uint32_t* trig_cnt_us);
 
+/**
+@brief Same as lgw_get_trigcnt, extended to 64 bits like the count_us64 of RX packets
+The 32-bit counter wraps every 71.6 minutes. The HAL reads it at lgw_start and
+tracks its wraps with the host monotonic clock, so the extended value never
+wraps while the concentrator is running, without having to be polled.
+@param trig_cnt_us pointer to receive timestamp value
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_get_trigcnt64(uint64_t *trig_cnt_us);
+
+/**
+@brief Read the current value of the internal counter, extended to 64 bits
+The GPS event capture is disabled for the duration of the read, a PPS edge in
+that window (a few SPI transactions) is not captured: lgw_get_trigcnt then
+still returns the capture of the previous PPS for that second, which the
+synchronization (lgw_gps_sync_est) rejects as an outlier.
+@param inst_cnt_us pointer to receive the counter value
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_get_instcnt64(uint64_t *inst_cnt_us);
+
+/**
+@brief Schedule a packet at a 64-bit counter value (TIMESTAMPED mode)
+Unlike lgw_send with a 32-bit count_us, a time in the past is rejected instead
+of being reached again after a counter wrap.
+@param pkt_data structure containing the data and metadata for the packet to send (tx_mode and count_us are set)
+@param count_us64 time of emission, on the timeline of count_us64 and lgw_get_instcnt64
+@return LGW_HAL_ERROR id the operation failed or the time is in the past or more than 2^31 us ahead, LGW_HAL_SUCCESS else
+*/
+int lgw_send_at(struct lgw_pkt_tx_s pkt_data, uint64_t count_us64);
+
 /**
 @brief Allow user to check the version/options of the library once compiled
 @return pointer on a human-readable null terminated string
@@ -395,6 +523,54 @@ int lgw_auto_check(void);
 
 int lgw_freq_validate(uint8_t rf_chain, uint32_t freq);
 
+/* -------------------------------------------------------------------------- */
+/* --- MULTI-CONCENTRATOR API ----------------------------------------------- */
+
+/*
+A context holds the link, configuration, calibration and state of one
+concentrator. The functions above act on a default context that shares its
+link with the loragw_reg functions without _ctx suffix; each function has a
+_ctx variant acting on an explicitly created context, so that a single process
+can drive several concentrators (eg. the two SX1301 of a dual-chip board).
+*/
+struct lgw_ctx_s; /* opaque */
+
+/**
+@brief Allocate a new context, with default configuration and disconnected
+@return pointer to the context, NULL if the allocation failed
+*/
+struct lgw_ctx_s *lgw_ctx_create(void);
+
+/**
+@brief Stop the concentrator if needed and release a context (the default context is never released)
+@param ctx context returned by lgw_ctx_create
+*/
+void lgw_ctx_free(struct lgw_ctx_s *ctx);
+
+int lgw_spi_setconf_ctx(struct lgw_ctx_s *ctx, const char *path, uint32_t speed_hz);
+int lgw_spi_probe_ctx(struct lgw_ctx_s *ctx, uint32_t min_hz, uint32_t max_hz, uint32_t step_hz, uint32_t *speed_hz);
+int lgw_rxrf_setconf_ctx(struct lgw_ctx_s *ctx, uint8_t rf_chain, struct lgw_conf_rxrf_s conf);
+int lgw_rxif_setconf_ctx(struct lgw_ctx_s *ctx, uint8_t if_chain, struct lgw_conf_rxif_s conf);
+int lgw_fw_setconf_ctx(struct lgw_ctx_s *ctx, struct lgw_conf_fw_s conf);
+int lgw_txgain_setconf_ctx(struct lgw_ctx_s *ctx, const struct lgw_tx_gain_lut_s *conf);
+int lgw_start_ctx(struct lgw_ctx_s *ctx);
+int lgw_stop_ctx(struct lgw_ctx_s *ctx);
+int lgw_receive_ctx(struct lgw_ctx_s *ctx, uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data);
+int lgw_send_ctx(struct lgw_ctx_s *ctx, struct lgw_pkt_tx_s pkt_data);
+int lgw_status_ctx(struct lgw_ctx_s *ctx, uint8_t select, uint8_t *code);
+int lgw_get_trigcnt_ctx(struct lgw_ctx_s *ctx, uint32_t* trig_cnt_us);
+int lgw_get_trigcnt64_ctx(struct lgw_ctx_s *ctx, uint64_t *trig_cnt_us);
+int lgw_get_instcnt64_ctx(struct lgw_ctx_s *ctx, uint64_t *inst_cnt_us);
+int lgw_send_at_ctx(struct lgw_ctx_s *ctx, struct lgw_pkt_tx_s pkt_data, uint64_t count_us64);
+lgw_id_t lgw_get_radio_id_ctx(struct lgw_ctx_s *ctx, uint8_t rf_chain);
+int lgw_freq_validate_ctx(struct lgw_ctx_s *ctx, uint8_t rf_chain, uint32_t freq);
+
+#if (CFG_RADIO_AUTO == 1)
+int lgw_auto_check_ctx(struct lgw_ctx_s *ctx);
+#else
+#define lgw_auto_check_ctx(ctx)
+#endif
+
 #endif
 
 /* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,135 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	Correlation of the concentrator counter with the host monotonic clock.
+	Mainly for gateways without GPS: the live counter is sampled periodically between
+	two reads of CLOCK_MONOTONIC, and a regression over the latest samples
+	converts any counter value to host time (and back) with an error bound.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+#ifndef _LORAGW_HOSTCLK_H
+#define _LORAGW_HOSTCLK_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+	#define _XOPEN_SOURCE 600
+#else
+	#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+#include <time.h>		/* struct timespec */
+
+#include "config.h"	/* library configuration options (dynamically generated) */
+#include "loragw_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define LGW_HOSTCLK_SUCCESS	 0
+#define LGW_HOSTCLK_ERROR	-1
+
+#define LGW_HOSTCLK_SIZE	32	/* number of samples fitted by the correlator */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct lgw_hostclk_s
+@brief Counter to host clock correlator (zero-initialize before the first sample)
+*/
+struct lgw_hostclk_s {
+	uint64_t	cnt[LGW_HOSTCLK_SIZE];		/*!> counter of each sample, on the count_us64 timeline */
+	int64_t		host_ns[LGW_HOSTCLK_SIZE];	/*!> CLOCK_MONOTONIC time at the middle of each read, in ns */
+	uint32_t	win_ns[LGW_HOSTCLK_SIZE];	/*!> duration of each read, in ns */
+	int			nb;			/*!> number of samples in the ring */
+	int			head;		/*!> index of the next sample to write */
+	int			rejected;	/*!> consecutive samples rejected because the read was interrupted */
+	uint32_t	nb_rejected;	/*!> total of the rejected samples */
+	uint32_t	nb_restart;	/*!> restarts of the correlator (new counter timeline) */
+	/* regression host_ns = ref_host_ns + off_ns + slope * (cnt - ref_cnt) */
+	bool		valid;		/*!> true once enough samples were fitted */
+	uint64_t	ref_cnt;	/*!> counter of the newest fitted sample */
+	int64_t		ref_host_ns;	/*!> host time of the newest fitted sample */
+	double		off_ns;		/*!> fitted host time at ref_cnt, relative to ref_host_ns */
+	double		slope;		/*!> host ns per counter us (1000 for identical clocks) */
+	double		mean_us;	/*!> mean counter of the fitted samples, relative to ref_cnt */
+	double		sxx;		/*!> sum of the squared counter deviations, in us^2 */
+	double		jitter_ns;	/*!> standard deviation of the samples around the fit */
+	uint32_t	win_min_ns;	/*!> shortest read of the fitted samples */
+	int			nb_fit;		/*!> number of fitted samples */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Sample the live counter of a concentrator between two reads of the host clock
+
+@param hc pointer to the correlator
+@param ctx concentrator context, NULL for the default one (must be started)
+@return success if the sample was read and accepted
+
+Typically called once per second, it costs one live counter read (a few SPI
+transactions). The read is serialized with lgw_get_trigcnt, so it can run along
+with the GPS synchronization, but the PPS capture is disabled during that read:
+with GPS, sample away from the PPS edge, or the capture of that second is lost.
+*/
+int lgw_hostclk_sample(struct lgw_hostclk_s *hc, struct lgw_ctx_s *ctx);
+
+/**
+@brief Add a sample to the correlator (lgw_hostclk_sample without the counter read)
+
+@param hc pointer to the correlator
+@param count_us64 counter value, on the count_us64 timeline
+@param before CLOCK_MONOTONIC time just before the counter read
+@param after CLOCK_MONOTONIC time just after the counter read
+@return success if the sample was accepted
+
+A read much longer than the shortest one in the ring (eg. preempted) is
+rejected: the counter could have been latched anywhere in that window. After
+several rejections in a row the sample is kept anyway (slower SPI link).
+Counter or host time going backwards (concentrator restarted), or a sample
+too far from the fit, restarts the correlator from that sample.
+*/
+int lgw_hostclk_add(struct lgw_hostclk_s *hc, uint64_t count_us64, const struct timespec *before, const struct timespec *after);
+
+/**
+@brief Convert a concentrator counter value to host monotonic time
+
+@param hc pointer to the correlator
+@param count_us64 counter value (eg. count_us64 of a RX packet)
+@param host pointer to store the CLOCK_MONOTONIC time
+@param err_ns pointer to store the error bound in ns, NULL if not needed
+@return success if the correlator has enough samples
+*/
+int lgw_cnt2host(const struct lgw_hostclk_s *hc, uint64_t count_us64, struct timespec *host, uint32_t *err_ns);
+
+/**
+@brief Convert a host monotonic time to a concentrator counter value
+
+@param hc pointer to the correlator
+@param host CLOCK_MONOTONIC time
+@param count_us64 pointer to store the counter value (eg. for lgw_send_at)
+@param err_ns pointer to store the error bound in ns, NULL if not needed
+@return success if the correlator has enough samples
+*/
+int lgw_host2cnt(const struct lgw_hostclk_s *hc, struct timespec host, uint64_t *count_us64, uint32_t *err_ns);
+
+#endif
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -25,6 +25,8 @@ Maintainer: Sylvain Miermont
 
 #include <stdint.h>		/* C99 types */
 #include <stdbool.h>	/* bool type */
+#include <stdio.h>		/* FILE */
+#include <pthread.h>	/* mutex */
 
 #include "config.h"	/* library configuration options (dynamically generated) */
 
@@ -34,6 +36,8 @@ Maintainer: Sylvain Miermont
 #define LGW_REG_SUCCESS	 0
 #define LGW_REG_ERROR	-1
 
+#define LGW_REG_SPI_PATH_SIZE	64 /* max size of a SPI device path, including terminating null char */
+
 /*
 auto generated register mapping for C code : 11-Jul-2013 13:20:40
 this file contains autogenerated C struct used to access the LORA registers
@@ -369,27 +373,106 @@ this file is autogenerated from registers description
 
 #define LGW_TOTALREGS 325
 
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct lgw_reg_ctx_s
+@brief State of the link with one concentrator (one per SPI device)
+*/
+struct lgw_reg_ctx_s {
+	void			*spi_target;	/*!< generic pointer to the SPI device */
+	int				regpage;		/*!< register page currently selected, -1 if unconnected */
+	pthread_mutex_t	mx_bus;			/*!< serializes page switches and SPI accesses */
+	char			spi_path[LGW_REG_SPI_PATH_SIZE]; /*!< SPI device used by connect, empty for default */
+	uint32_t		spi_speed;		/*!< SPI clock used by connect in Hz, 0 for default */
+};
+
+/* static initializer, equivalent to lgw_reg_ctx_init */
+#define LGW_REG_CTX_INIT	{NULL, -1, PTHREAD_MUTEX_INITIALIZER, "", 0}
+
+/**
+@struct lgw_reg_radio_op_s
+@brief Access to a SX125x radio register, through the SPI master of the concentrator
+*/
+struct lgw_reg_radio_op_s {
+	uint8_t		radio;	/*!< radio A (0) or radio B (1) */
+	uint8_t		addr;	/*!< 7-bit radio register address */
+	uint8_t		data;	/*!< data byte to write, or data byte read */
+	bool		read;	/*!< true for a read, false for a write */
+};
+
+/**
+@enum lgw_reg_prof_e
+@brief Kinds of register access counted by the profiler
+*/
+enum lgw_reg_prof_e {
+	LGW_REG_PROF_R,		/*!> register read */
+	LGW_REG_PROF_W,		/*!> direct register write */
+	LGW_REG_PROF_RMW,	/*!> sub-byte register write, with a read-back of the byte */
+	LGW_REG_PROF_RB,	/*!> burst read */
+	LGW_REG_PROF_WB,	/*!> burst write */
+	LGW_REG_PROF_NB		/*!> number of kinds */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC VARIABLES ----------------------------------------------------- */
+
+/* context used by all the functions without _ctx suffix */
+extern struct lgw_reg_ctx_s lgw_reg_ctx_default;
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
+/**
+@brief Initialize a context for a concentrator that is not connected yet
+@param ctx pointer to the context to initialize
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+*/
+int lgw_reg_ctx_init(struct lgw_reg_ctx_s *ctx);
+
+/**
+@brief Select the SPI device and clock of a context (see LGW_SPI_ENV_* for the defaults)
+@param ctx pointer to the context
+@param path SPI device path used at next connection, NULL or empty to use the default
+@param speed_hz SPI clock in Hz, 0 to use the default, applied immediately if connected
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+*/
+int lgw_reg_spi_setconf_ctx(struct lgw_reg_ctx_s *ctx, const char *path, uint32_t speed_hz);
+
 /**
 @brief Connect LoRa concentrator by opening SPI link
 @return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
 */
 int lgw_connect(void);
 
+/**
+@brief Same as lgw_connect, on the concentrator of context ctx
+*/
+int lgw_connect_ctx(struct lgw_reg_ctx_s *ctx);
+
 /**
 @brief Disconnect LoRa concentrator by closing SPI link
 @return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
 */
 int lgw_disconnect(void);
 
+/**
+@brief Same as lgw_disconnect, on the concentrator of context ctx
+*/
+int lgw_disconnect_ctx(struct lgw_reg_ctx_s *ctx);
+
 /**
 @brief Use the soft-reset register to put the concentrator in initial state
 @return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
 */
 int lgw_soft_reset(void);
 
+/**
+@brief Same as lgw_soft_reset, on the concentrator of context ctx
+*/
+int lgw_soft_reset_ctx(struct lgw_reg_ctx_s *ctx);
+
 /**
 @brief Check if the registers are ok, send diagnostics to stdio/stderr/file
 @param f file descriptor to to which the check result will be written
@@ -397,6 +480,11 @@ int lgw_soft_reset(void);
 */
 int lgw_reg_check(FILE *f);
 
+/**
+@brief Same as lgw_reg_check, on the concentrator of context ctx
+*/
+int lgw_reg_check_ctx(struct lgw_reg_ctx_s *ctx, FILE *f);
+
 /**
 @brief LoRa concentrator register write
 @param register_id register number in the data structure describing registers
@@ -405,6 +493,11 @@ int lgw_reg_check(FILE *f);
 */
 int lgw_reg_w(uint16_t register_id, int32_t reg_value);
 
+/**
+@brief Same as lgw_reg_w, on the concentrator of context ctx
+*/
+int lgw_reg_w_ctx(struct lgw_reg_ctx_s *ctx, uint16_t register_id, int32_t reg_value);
+
 /**
 @brief LoRa concentrator register read
 @param register_id register number in the data structure describing registers
@@ -413,6 +506,11 @@ int lgw_reg_w(uint16_t register_id, int32_t reg_value);
 */
 int lgw_reg_r(uint16_t register_id, int32_t *reg_value);
 
+/**
+@brief Same as lgw_reg_r, on the concentrator of context ctx
+*/
+int lgw_reg_r_ctx(struct lgw_reg_ctx_s *ctx, uint16_t register_id, int32_t *reg_value);
+
 /**
 @brief LoRa concentrator register burst write
 @param register_id register number in the data structure describing registers
@@ -422,6 +520,11 @@ int lgw_reg_r(uint16_t register_id, int32_t *reg_value);
 */
 int lgw_reg_wb(uint16_t register_id, uint8_t *data, uint16_t size);
 
+/**
+@brief Same as lgw_reg_wb, on the concentrator of context ctx
+*/
+int lgw_reg_wb_ctx(struct lgw_reg_ctx_s *ctx, uint16_t register_id, uint8_t *data, uint16_t size);
+
 /**
 @brief LoRa concentrator register burst read
 @param register_id register number in the data structure describing registers
@@ -431,6 +534,82 @@ int lgw_reg_wb(uint16_t register_id, uint8_t *data, uint16_t size);
 */
 int lgw_reg_rb(uint16_t register_id, uint8_t *data, uint16_t size);
 
+/**
+@brief Same as lgw_reg_rb, on the concentrator of context ctx
+*/
+int lgw_reg_rb_ctx(struct lgw_reg_ctx_s *ctx, uint16_t register_id, uint8_t *data, uint16_t size);
+
+/**
+@brief Program SX125x radio registers in a batch
+The chip select/address/data sequence of every access is precomputed and sent
+as a few SPI batches, instead of five register writes (some read-modify-write)
+per radio byte. The radio data is read back only for read accesses.
+@param ops array of radio accesses, executed in order, read accesses get their data field updated
+@param nb number of accesses
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+*/
+int lgw_reg_radio_batch(struct lgw_reg_radio_op_s *ops, uint16_t nb);
+
+/**
+@brief Same as lgw_reg_radio_batch, on the concentrator of context ctx
+*/
+int lgw_reg_radio_batch_ctx(struct lgw_reg_ctx_s *ctx, struct lgw_reg_radio_op_s *ops, uint16_t nb);
+
+/**
+@brief Find the fastest reliable SPI clock of a connected concentrator
+Steps the clock up from min_hz to max_hz, running 8-bit, 32-bit and data buffer
+burst read/write patterns at each step, stops at the first error, then keeps
+the highest error-free clock minus a safety margin for the next connections.
+The RX data buffer is overwritten, do not use while the concentrator runs.
+@param min_hz first clock to try, in Hz
+@param max_hz last clock to try, in Hz
+@param step_hz clock increment between tries, in Hz
+@param speed_hz pointer to a variable where to write the selected clock, in Hz
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+*/
+int lgw_reg_spi_probe(uint32_t min_hz, uint32_t max_hz, uint32_t step_hz, uint32_t *speed_hz);
+
+/**
+@brief Same as lgw_reg_spi_probe, on the concentrator of context ctx
+*/
+int lgw_reg_spi_probe_ctx(struct lgw_reg_ctx_s *ctx, uint32_t min_hz, uint32_t max_hz, uint32_t step_hz, uint32_t *speed_hz);
+
+/**
+@brief Enable or disable the register access profiler (disabled by default)
+Counts accesses, read-backs, burst bytes and page switches per register and
+per calling site, for all contexts. Counters are kept when disabling.
+@param enable true to start counting, false to stop
+*/
+void lgw_reg_profile_enable(bool enable);
+
+/**
+@brief Clear all the counters of the register access profiler
+*/
+void lgw_reg_profile_reset(void);
+
+/**
+@brief Set the calling site the register accesses of the current thread are accounted to
+@param site name of the site (must stay valid, eg. a string literal), NULL for untagged accesses
+@return the previous site of the thread, to restore it when leaving the site
+*/
+const char *lgw_reg_profile_site(const char *site);
+
+/**
+@brief Write the profile report, sorted by number of SPI transactions
+@param f file where to write the report (eg. stdout)
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+*/
+int lgw_reg_profile_dump(FILE *f);
+
+/**
+@brief Account one register access in the profiler (for use by the register accessors)
+@param register_id register accessed
+@param kind kind of access
+@param size number of bytes of a burst, ignored for other kinds
+@param page_switch true if the access required a page switch
+*/
+void lgw_reg_profile_hit(uint16_t register_id, enum lgw_reg_prof_e kind, uint16_t size, bool page_switch);
+
 
 #endif
 
@@ -0,0 +1,216 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	Inline register accessors for hot paths.
+	Same behaviour as lgw_reg_w_ctx/lgw_reg_r_ctx/lgw_reg_wb_ctx/lgw_reg_rb_ctx,
+	but the register descriptor comes from the generated loragw_reg_map.h as
+	compile-time constants instead of a copy of loregs[], so the compiler folds
+	the address, page, mask and shift and drops the unused branches.
+	Use with a register name without LGW_ prefix, eg.:
+		lgw_reg_wi(ctx, RX_PACKET_DATA_FIFO_NUM_STORED, 0);
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+#ifndef _LORAGW_REG_INLINE_H
+#define _LORAGW_REG_INLINE_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+#include <pthread.h>	/* pthread_mutex_lock */
+
+#include "loragw_reg.h"
+#include "loragw_spi.h"
+#include "loragw_reg_map.h"	/* generated register descriptors */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC MACROS -------------------------------------------------------- */
+
+#define lgw_reg_wi(ctx, name, value)		lgw_reg_w_inl((ctx), LGW_REGI_##name, (value))
+#define lgw_reg_ri(ctx, name, value)		lgw_reg_r_inl((ctx), LGW_REGI_##name, (value))
+#define lgw_reg_wbi(ctx, name, data, size)	lgw_reg_wb_inl((ctx), LGW_REGI_##name, (data), (size))
+#define lgw_reg_rbi(ctx, name, data, size)	lgw_reg_rb_inl((ctx), LGW_REGI_##name, (data), (size))
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Select a register page (for the inline accessors, must be called with the bus mutex held)
+@param ctx pointer to the register context
+@param target page to select
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+*/
+int lgw_reg_page_switch(struct lgw_reg_ctx_s *ctx, uint8_t target);
+
+/* -------------------------------------------------------------------------- */
+/* --- INLINE FUNCTIONS DEFINITION ------------------------------------------ */
+
+/* Write to a register, descriptor given as constants (use lgw_reg_wi) */
+static inline int lgw_reg_w_inl(struct lgw_reg_ctx_s *ctx, uint16_t id, int8_t page, uint8_t addr, uint8_t offs, bool sign, uint8_t leng, bool rdon, int32_t value) {
+	int spi_stat = LGW_SPI_SUCCESS;
+	uint8_t buf[4];
+	uint8_t mask;
+	int i, size_byte;
+	enum lgw_reg_prof_e kind = LGW_REG_PROF_W;
+	bool pg = false;
+	
+	(void)sign;
+	/* cases outside of the fast path keep the generic checks and error reporting */
+	if (rdon || (id == LGW_PAGE_REG) || (((offs + leng) > 8) && ((offs != 0) || (leng > 32)))) {
+		return lgw_reg_w_ctx(ctx, id, value);
+	}
+	
+	pthread_mutex_lock(&ctx->mx_bus);
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
+		return LGW_REG_ERROR;
+	}
+	if ((page != -1) && (page != ctx->regpage)) {
+		spi_stat += lgw_reg_page_switch(ctx, page);
+		pg = true;
+	}
+	if ((leng == 8) && (offs == 0)) {
+		/* direct write */
+		spi_stat += lgw_spi_w(ctx->spi_target, addr, (uint8_t)value);
+	} else if ((offs + leng) <= 8) {
+		/* single-byte read-modify-write */
+		kind = LGW_REG_PROF_RMW;
+		mask = (uint8_t)(((1 << leng) - 1) << offs);
+		spi_stat += lgw_spi_r(ctx->spi_target, addr, &buf[0]);
+		spi_stat += lgw_spi_w(ctx->spi_target, addr, (uint8_t)((buf[0] & ~mask) | (((uint8_t)value << offs) & mask)));
+	} else {
+		/* multi-byte direct write, little endian in a single burst */
+		size_byte = (leng + 7) / 8;
+		for (i = 0; i < size_byte; ++i) {
+			buf[i] = (uint8_t)(0x000000FF & value);
+			value = (value >> 8);
+		}
+		spi_stat += lgw_spi_wb(ctx->spi_target, addr, buf, size_byte);
+	}
+	pthread_mutex_unlock(&ctx->mx_bus);
+	lgw_reg_profile_hit(id, kind, 0, pg);
+	
+	return (spi_stat != LGW_SPI_SUCCESS) ? LGW_REG_ERROR : LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Read a register, descriptor given as constants (use lgw_reg_ri) */
+static inline int lgw_reg_r_inl(struct lgw_reg_ctx_s *ctx, uint16_t id, int8_t page, uint8_t addr, uint8_t offs, bool sign, uint8_t leng, bool rdon, int32_t *value) {
+	int spi_stat = LGW_SPI_SUCCESS;
+	uint8_t buf[4] = {0, 0, 0, 0};
+	uint32_t u = 0;
+	int i, size_byte;
+	bool pg = false;
+	
+	(void)rdon;
+	if ((value == NULL) || (((offs + leng) > 8) && ((offs != 0) || (leng > 32)))) {
+		return lgw_reg_r_ctx(ctx, id, value);
+	}
+	
+	pthread_mutex_lock(&ctx->mx_bus);
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
+		return LGW_REG_ERROR;
+	}
+	if ((page != -1) && (page != ctx->regpage)) {
+		spi_stat += lgw_reg_page_switch(ctx, page);
+		pg = true;
+	}
+	if ((offs + leng) <= 8) {
+		/* read one byte, left-align the field on 32 bits, then right-align it with sign extension if needed */
+		spi_stat += lgw_spi_r(ctx->spi_target, addr, &buf[0]);
+		u = (uint32_t)buf[0] << (32 - leng - offs);
+		*value = sign ? ((int32_t)u >> (32 - leng)) : (int32_t)(u >> (32 - leng));
+	} else {
+		/* multi-byte read, little endian in a single burst */
+		size_byte = (leng + 7) / 8;
+		spi_stat += lgw_spi_rb(ctx->spi_target, addr, buf, size_byte);
+		for (i = (size_byte - 1); i >= 0; --i) {
+			u = (uint32_t)buf[i] + (u << 8);
+		}
+		*value = sign ? ((int32_t)(u << (32 - leng)) >> (32 - leng)) : (int32_t)u;
+	}
+	pthread_mutex_unlock(&ctx->mx_bus);
+	lgw_reg_profile_hit(id, LGW_REG_PROF_R, 0, pg);
+	
+	return (spi_stat != LGW_SPI_SUCCESS) ? LGW_REG_ERROR : LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Burst write to a register, descriptor given as constants (use lgw_reg_wbi) */
+static inline int lgw_reg_wb_inl(struct lgw_reg_ctx_s *ctx, uint16_t id, int8_t page, uint8_t addr, uint8_t offs, bool sign, uint8_t leng, bool rdon, uint8_t *data, uint16_t size) {
+	int spi_stat;
+	bool pg = false;
+	
+	(void)offs;
+	(void)sign;
+	(void)leng;
+	if (rdon || (data == NULL) || (size == 0)) {
+		return lgw_reg_wb_ctx(ctx, id, data, size);
+	}
+	
+	pthread_mutex_lock(&ctx->mx_bus);
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
+		return LGW_REG_ERROR;
+	}
+	spi_stat = LGW_SPI_SUCCESS;
+	if ((page != -1) && (page != ctx->regpage)) {
+		spi_stat += lgw_reg_page_switch(ctx, page);
+		pg = true;
+	}
+	spi_stat += lgw_spi_wb(ctx->spi_target, addr, data, size);
+	pthread_mutex_unlock(&ctx->mx_bus);
+	lgw_reg_profile_hit(id, LGW_REG_PROF_WB, size, pg);
+	
+	return (spi_stat != LGW_SPI_SUCCESS) ? LGW_REG_ERROR : LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Burst read of a register, descriptor given as constants (use lgw_reg_rbi) */
+static inline int lgw_reg_rb_inl(struct lgw_reg_ctx_s *ctx, uint16_t id, int8_t page, uint8_t addr, uint8_t offs, bool sign, uint8_t leng, bool rdon, uint8_t *data, uint16_t size) {
+	int spi_stat;
+	bool pg = false;
+	
+	(void)offs;
+	(void)sign;
+	(void)leng;
+	(void)rdon;
+	if ((data == NULL) || (size == 0)) {
+		return lgw_reg_rb_ctx(ctx, id, data, size);
+	}
+	
+	pthread_mutex_lock(&ctx->mx_bus);
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
+		return LGW_REG_ERROR;
+	}
+	spi_stat = LGW_SPI_SUCCESS;
+	if ((page != -1) && (page != ctx->regpage)) {
+		spi_stat += lgw_reg_page_switch(ctx, page);
+		pg = true;
+	}
+	spi_stat += lgw_spi_rb(ctx->spi_target, addr, data, size);
+	pthread_mutex_unlock(&ctx->mx_bus);
+	lgw_reg_profile_hit(id, LGW_REG_PROF_RB, size, pg);
+	
+	return (spi_stat != LGW_SPI_SUCCESS) ? LGW_REG_ERROR : LGW_REG_SUCCESS;
+}
+
+#endif
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,683 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	Constant register descriptors for the inline register accessors.
+	Auto generated from loregs[] by gen_reg_inline.awk, do not edit.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+#ifndef _LORAGW_REG_MAP_H
+#define _LORAGW_REG_MAP_H
+
+/*
+auto generated register mapping for inline accessors
+id, page, addr, offs, sign, leng, rdon
+325 registers are defined
+*/
+
+#define LGW_REGI_PAGE_REG	LGW_PAGE_REG,-1,0,0,0,2,0
+#define LGW_REGI_SOFT_RESET	LGW_SOFT_RESET,-1,0,7,0,1,0
+#define LGW_REGI_VERSION	LGW_VERSION,-1,1,0,0,8,1
+#define LGW_REGI_RX_DATA_BUF_ADDR	LGW_RX_DATA_BUF_ADDR,-1,2,0,0,16,0
+#define LGW_REGI_RX_DATA_BUF_DATA	LGW_RX_DATA_BUF_DATA,-1,4,0,0,8,0
+#define LGW_REGI_TX_DATA_BUF_ADDR	LGW_TX_DATA_BUF_ADDR,-1,5,0,0,8,0
+#define LGW_REGI_TX_DATA_BUF_DATA	LGW_TX_DATA_BUF_DATA,-1,6,0,0,8,0
+#define LGW_REGI_CAPTURE_RAM_ADDR	LGW_CAPTURE_RAM_ADDR,-1,7,0,0,8,0
+#define LGW_REGI_CAPTURE_RAM_DATA	LGW_CAPTURE_RAM_DATA,-1,8,0,0,8,1
+#define LGW_REGI_MCU_PROM_ADDR	LGW_MCU_PROM_ADDR,-1,9,0,0,8,0
+#define LGW_REGI_MCU_PROM_DATA	LGW_MCU_PROM_DATA,-1,10,0,0,8,0
+#define LGW_REGI_RX_PACKET_DATA_FIFO_NUM_STORED	LGW_RX_PACKET_DATA_FIFO_NUM_STORED,-1,11,0,0,8,0
+#define LGW_REGI_RX_PACKET_DATA_FIFO_ADDR_POINTER	LGW_RX_PACKET_DATA_FIFO_ADDR_POINTER,-1,12,0,0,16,1
+#define LGW_REGI_RX_PACKET_DATA_FIFO_STATUS	LGW_RX_PACKET_DATA_FIFO_STATUS,-1,14,0,0,8,1
+#define LGW_REGI_RX_PACKET_DATA_FIFO_PAYLOAD_SIZE	LGW_RX_PACKET_DATA_FIFO_PAYLOAD_SIZE,-1,15,0,0,8,1
+#define LGW_REGI_MBWSSF_MODEM_ENABLE	LGW_MBWSSF_MODEM_ENABLE,-1,16,0,0,1,0
+#define LGW_REGI_CONCENTRATOR_MODEM_ENABLE	LGW_CONCENTRATOR_MODEM_ENABLE,-1,16,1,0,1,0
+#define LGW_REGI_FSK_MODEM_ENABLE	LGW_FSK_MODEM_ENABLE,-1,16,2,0,1,0
+#define LGW_REGI_GLOBAL_EN	LGW_GLOBAL_EN,-1,16,3,0,1,0
+#define LGW_REGI_CLK32M_EN	LGW_CLK32M_EN,-1,17,0,0,1,0
+#define LGW_REGI_CLKHS_EN	LGW_CLKHS_EN,-1,17,1,0,1,0
+#define LGW_REGI_START_BIST0	LGW_START_BIST0,-1,18,0,0,1,0
+#define LGW_REGI_START_BIST1	LGW_START_BIST1,-1,18,1,0,1,0
+#define LGW_REGI_CLEAR_BIST0	LGW_CLEAR_BIST0,-1,18,2,0,1,0
+#define LGW_REGI_CLEAR_BIST1	LGW_CLEAR_BIST1,-1,18,3,0,1,0
+#define LGW_REGI_BIST0_FINISHED	LGW_BIST0_FINISHED,-1,19,0,0,1,1
+#define LGW_REGI_BIST1_FINISHED	LGW_BIST1_FINISHED,-1,19,1,0,1,1
+#define LGW_REGI_MCU_AGC_PROG_RAM_BIST_STATUS	LGW_MCU_AGC_PROG_RAM_BIST_STATUS,-1,20,0,0,1,1
+#define LGW_REGI_MCU_ARB_PROG_RAM_BIST_STATUS	LGW_MCU_ARB_PROG_RAM_BIST_STATUS,-1,20,1,0,1,1
+#define LGW_REGI_CAPTURE_RAM_BIST_STATUS	LGW_CAPTURE_RAM_BIST_STATUS,-1,20,2,0,1,1
+#define LGW_REGI_CHAN_FIR_RAM0_BIST_STATUS	LGW_CHAN_FIR_RAM0_BIST_STATUS,-1,20,3,0,1,1
+#define LGW_REGI_CHAN_FIR_RAM1_BIST_STATUS	LGW_CHAN_FIR_RAM1_BIST_STATUS,-1,20,4,0,1,1
+#define LGW_REGI_CORR0_RAM_BIST_STATUS	LGW_CORR0_RAM_BIST_STATUS,-1,21,0,0,1,1
+#define LGW_REGI_CORR1_RAM_BIST_STATUS	LGW_CORR1_RAM_BIST_STATUS,-1,21,1,0,1,1
+#define LGW_REGI_CORR2_RAM_BIST_STATUS	LGW_CORR2_RAM_BIST_STATUS,-1,21,2,0,1,1
+#define LGW_REGI_CORR3_RAM_BIST_STATUS	LGW_CORR3_RAM_BIST_STATUS,-1,21,3,0,1,1
+#define LGW_REGI_CORR4_RAM_BIST_STATUS	LGW_CORR4_RAM_BIST_STATUS,-1,21,4,0,1,1
+#define LGW_REGI_CORR5_RAM_BIST_STATUS	LGW_CORR5_RAM_BIST_STATUS,-1,21,5,0,1,1
+#define LGW_REGI_CORR6_RAM_BIST_STATUS	LGW_CORR6_RAM_BIST_STATUS,-1,21,6,0,1,1
+#define LGW_REGI_CORR7_RAM_BIST_STATUS	LGW_CORR7_RAM_BIST_STATUS,-1,21,7,0,1,1
+#define LGW_REGI_MODEM0_RAM0_BIST_STATUS	LGW_MODEM0_RAM0_BIST_STATUS,-1,22,0,0,1,1
+#define LGW_REGI_MODEM1_RAM0_BIST_STATUS	LGW_MODEM1_RAM0_BIST_STATUS,-1,22,1,0,1,1
+#define LGW_REGI_MODEM2_RAM0_BIST_STATUS	LGW_MODEM2_RAM0_BIST_STATUS,-1,22,2,0,1,1
+#define LGW_REGI_MODEM3_RAM0_BIST_STATUS	LGW_MODEM3_RAM0_BIST_STATUS,-1,22,3,0,1,1
+#define LGW_REGI_MODEM4_RAM0_BIST_STATUS	LGW_MODEM4_RAM0_BIST_STATUS,-1,22,4,0,1,1
+#define LGW_REGI_MODEM5_RAM0_BIST_STATUS	LGW_MODEM5_RAM0_BIST_STATUS,-1,22,5,0,1,1
+#define LGW_REGI_MODEM6_RAM0_BIST_STATUS	LGW_MODEM6_RAM0_BIST_STATUS,-1,22,6,0,1,1
+#define LGW_REGI_MODEM7_RAM0_BIST_STATUS	LGW_MODEM7_RAM0_BIST_STATUS,-1,22,7,0,1,1
+#define LGW_REGI_MODEM0_RAM1_BIST_STATUS	LGW_MODEM0_RAM1_BIST_STATUS,-1,23,0,0,1,1
+#define LGW_REGI_MODEM1_RAM1_BIST_STATUS	LGW_MODEM1_RAM1_BIST_STATUS,-1,23,1,0,1,1
+#define LGW_REGI_MODEM2_RAM1_BIST_STATUS	LGW_MODEM2_RAM1_BIST_STATUS,-1,23,2,0,1,1
+#define LGW_REGI_MODEM3_RAM1_BIST_STATUS	LGW_MODEM3_RAM1_BIST_STATUS,-1,23,3,0,1,1
+#define LGW_REGI_MODEM4_RAM1_BIST_STATUS	LGW_MODEM4_RAM1_BIST_STATUS,-1,23,4,0,1,1
+#define LGW_REGI_MODEM5_RAM1_BIST_STATUS	LGW_MODEM5_RAM1_BIST_STATUS,-1,23,5,0,1,1
+#define LGW_REGI_MODEM6_RAM1_BIST_STATUS	LGW_MODEM6_RAM1_BIST_STATUS,-1,23,6,0,1,1
+#define LGW_REGI_MODEM7_RAM1_BIST_STATUS	LGW_MODEM7_RAM1_BIST_STATUS,-1,23,7,0,1,1
+#define LGW_REGI_MODEM0_RAM2_BIST_STATUS	LGW_MODEM0_RAM2_BIST_STATUS,-1,24,0,0,1,1
+#define LGW_REGI_MODEM1_RAM2_BIST_STATUS	LGW_MODEM1_RAM2_BIST_STATUS,-1,24,1,0,1,1
+#define LGW_REGI_MODEM2_RAM2_BIST_STATUS	LGW_MODEM2_RAM2_BIST_STATUS,-1,24,2,0,1,1
+#define LGW_REGI_MODEM3_RAM2_BIST_STATUS	LGW_MODEM3_RAM2_BIST_STATUS,-1,24,3,0,1,1
+#define LGW_REGI_MODEM4_RAM2_BIST_STATUS	LGW_MODEM4_RAM2_BIST_STATUS,-1,24,4,0,1,1
+#define LGW_REGI_MODEM5_RAM2_BIST_STATUS	LGW_MODEM5_RAM2_BIST_STATUS,-1,24,5,0,1,1
+#define LGW_REGI_MODEM6_RAM2_BIST_STATUS	LGW_MODEM6_RAM2_BIST_STATUS,-1,24,6,0,1,1
+#define LGW_REGI_MODEM7_RAM2_BIST_STATUS	LGW_MODEM7_RAM2_BIST_STATUS,-1,24,7,0,1,1
+#define LGW_REGI_MODEM_MBWSSF_RAM0_BIST_STATUS	LGW_MODEM_MBWSSF_RAM0_BIST_STATUS,-1,25,0,0,1,1
+#define LGW_REGI_MODEM_MBWSSF_RAM1_BIST_STATUS	LGW_MODEM_MBWSSF_RAM1_BIST_STATUS,-1,25,1,0,1,1
+#define LGW_REGI_MODEM_MBWSSF_RAM2_BIST_STATUS	LGW_MODEM_MBWSSF_RAM2_BIST_STATUS,-1,25,2,0,1,1
+#define LGW_REGI_MCU_AGC_DATA_RAM_BIST0_STATUS	LGW_MCU_AGC_DATA_RAM_BIST0_STATUS,-1,26,0,0,1,1
+#define LGW_REGI_MCU_AGC_DATA_RAM_BIST1_STATUS	LGW_MCU_AGC_DATA_RAM_BIST1_STATUS,-1,26,1,0,1,1
+#define LGW_REGI_MCU_ARB_DATA_RAM_BIST0_STATUS	LGW_MCU_ARB_DATA_RAM_BIST0_STATUS,-1,26,2,0,1,1
+#define LGW_REGI_MCU_ARB_DATA_RAM_BIST1_STATUS	LGW_MCU_ARB_DATA_RAM_BIST1_STATUS,-1,26,3,0,1,1
+#define LGW_REGI_TX_TOP_RAM_BIST0_STATUS	LGW_TX_TOP_RAM_BIST0_STATUS,-1,26,4,0,1,1
+#define LGW_REGI_TX_TOP_RAM_BIST1_STATUS	LGW_TX_TOP_RAM_BIST1_STATUS,-1,26,5,0,1,1
+#define LGW_REGI_DATA_MNGT_RAM_BIST0_STATUS	LGW_DATA_MNGT_RAM_BIST0_STATUS,-1,26,6,0,1,1
+#define LGW_REGI_DATA_MNGT_RAM_BIST1_STATUS	LGW_DATA_MNGT_RAM_BIST1_STATUS,-1,26,7,0,1,1
+#define LGW_REGI_GPIO_SELECT_INPUT	LGW_GPIO_SELECT_INPUT,-1,27,0,0,4,0
+#define LGW_REGI_GPIO_SELECT_OUTPUT	LGW_GPIO_SELECT_OUTPUT,-1,28,0,0,4,0
+#define LGW_REGI_GPIO_MODE	LGW_GPIO_MODE,-1,29,0,0,5,0
+#define LGW_REGI_GPIO_PIN_REG_IN	LGW_GPIO_PIN_REG_IN,-1,30,0,0,5,1
+#define LGW_REGI_GPIO_PIN_REG_OUT	LGW_GPIO_PIN_REG_OUT,-1,31,0,0,5,0
+#define LGW_REGI_MCU_AGC_STATUS	LGW_MCU_AGC_STATUS,-1,32,0,0,8,1
+#define LGW_REGI_MCU_ARB_STATUS	LGW_MCU_ARB_STATUS,-1,125,0,0,8,1
+#define LGW_REGI_CHIP_ID	LGW_CHIP_ID,-1,126,0,0,8,1
+#define LGW_REGI_EMERGENCY_FORCE_HOST_CTRL	LGW_EMERGENCY_FORCE_HOST_CTRL,-1,127,0,0,1,0
+#define LGW_REGI_RX_INVERT_IQ	LGW_RX_INVERT_IQ,0,33,0,0,1,0
+#define LGW_REGI_MODEM_INVERT_IQ	LGW_MODEM_INVERT_IQ,0,33,1,0,1,0
+#define LGW_REGI_MBWSSF_MODEM_INVERT_IQ	LGW_MBWSSF_MODEM_INVERT_IQ,0,33,2,0,1,0
+#define LGW_REGI_RX_EDGE_SELECT	LGW_RX_EDGE_SELECT,0,33,3,0,1,0
+#define LGW_REGI_MISC_RADIO_EN	LGW_MISC_RADIO_EN,0,33,4,0,1,0
+#define LGW_REGI_FSK_MODEM_INVERT_IQ	LGW_FSK_MODEM_INVERT_IQ,0,33,5,0,1,0
+#define LGW_REGI_FILTER_GAIN	LGW_FILTER_GAIN,0,34,0,0,4,0
+#define LGW_REGI_RADIO_SELECT	LGW_RADIO_SELECT,0,35,0,0,8,0
+#define LGW_REGI_IF_FREQ_0	LGW_IF_FREQ_0,0,36,0,1,13,0
+#define LGW_REGI_IF_FREQ_1	LGW_IF_FREQ_1,0,38,0,1,13,0
+#define LGW_REGI_IF_FREQ_2	LGW_IF_FREQ_2,0,40,0,1,13,0
+#define LGW_REGI_IF_FREQ_3	LGW_IF_FREQ_3,0,42,0,1,13,0
+#define LGW_REGI_IF_FREQ_4	LGW_IF_FREQ_4,0,44,0,1,13,0
+#define LGW_REGI_IF_FREQ_5	LGW_IF_FREQ_5,0,46,0,1,13,0
+#define LGW_REGI_IF_FREQ_6	LGW_IF_FREQ_6,0,48,0,1,13,0
+#define LGW_REGI_IF_FREQ_7	LGW_IF_FREQ_7,0,50,0,1,13,0
+#define LGW_REGI_IF_FREQ_8	LGW_IF_FREQ_8,0,52,0,1,13,0
+#define LGW_REGI_IF_FREQ_9	LGW_IF_FREQ_9,0,54,0,1,13,0
+#define LGW_REGI_CHANN_OVERRIDE_AGC_GAIN	LGW_CHANN_OVERRIDE_AGC_GAIN,0,64,0,0,1,0
+#define LGW_REGI_CHANN_AGC_GAIN	LGW_CHANN_AGC_GAIN,0,64,1,0,4,0
+#define LGW_REGI_CORR0_DETECT_EN	LGW_CORR0_DETECT_EN,0,65,0,0,7,0
+#define LGW_REGI_CORR1_DETECT_EN	LGW_CORR1_DETECT_EN,0,66,0,0,7,0
+#define LGW_REGI_CORR2_DETECT_EN	LGW_CORR2_DETECT_EN,0,67,0,0,7,0
+#define LGW_REGI_CORR3_DETECT_EN	LGW_CORR3_DETECT_EN,0,68,0,0,7,0
+#define LGW_REGI_CORR4_DETECT_EN	LGW_CORR4_DETECT_EN,0,69,0,0,7,0
+#define LGW_REGI_CORR5_DETECT_EN	LGW_CORR5_DETECT_EN,0,70,0,0,7,0
+#define LGW_REGI_CORR6_DETECT_EN	LGW_CORR6_DETECT_EN,0,71,0,0,7,0
+#define LGW_REGI_CORR7_DETECT_EN	LGW_CORR7_DETECT_EN,0,72,0,0,7,0
+#define LGW_REGI_CORR_SAME_PEAKS_OPTION_SF6	LGW_CORR_SAME_PEAKS_OPTION_SF6,0,73,0,0,1,0
+#define LGW_REGI_CORR_SAME_PEAKS_OPTION_SF7	LGW_CORR_SAME_PEAKS_OPTION_SF7,0,73,1,0,1,0
+#define LGW_REGI_CORR_SAME_PEAKS_OPTION_SF8	LGW_CORR_SAME_PEAKS_OPTION_SF8,0,73,2,0,1,0
+#define LGW_REGI_CORR_SAME_PEAKS_OPTION_SF9	LGW_CORR_SAME_PEAKS_OPTION_SF9,0,73,3,0,1,0
+#define LGW_REGI_CORR_SAME_PEAKS_OPTION_SF10	LGW_CORR_SAME_PEAKS_OPTION_SF10,0,73,4,0,1,0
+#define LGW_REGI_CORR_SAME_PEAKS_OPTION_SF11	LGW_CORR_SAME_PEAKS_OPTION_SF11,0,73,5,0,1,0
+#define LGW_REGI_CORR_SAME_PEAKS_OPTION_SF12	LGW_CORR_SAME_PEAKS_OPTION_SF12,0,73,6,0,1,0
+#define LGW_REGI_CORR_SIG_NOISE_RATIO_SF6	LGW_CORR_SIG_NOISE_RATIO_SF6,0,74,0,0,4,0
+#define LGW_REGI_CORR_SIG_NOISE_RATIO_SF7	LGW_CORR_SIG_NOISE_RATIO_SF7,0,74,4,0,4,0
+#define LGW_REGI_CORR_SIG_NOISE_RATIO_SF8	LGW_CORR_SIG_NOISE_RATIO_SF8,0,75,0,0,4,0
+#define LGW_REGI_CORR_SIG_NOISE_RATIO_SF9	LGW_CORR_SIG_NOISE_RATIO_SF9,0,75,4,0,4,0
+#define LGW_REGI_CORR_SIG_NOISE_RATIO_SF10	LGW_CORR_SIG_NOISE_RATIO_SF10,0,76,0,0,4,0
+#define LGW_REGI_CORR_SIG_NOISE_RATIO_SF11	LGW_CORR_SIG_NOISE_RATIO_SF11,0,76,4,0,4,0
+#define LGW_REGI_CORR_SIG_NOISE_RATIO_SF12	LGW_CORR_SIG_NOISE_RATIO_SF12,0,77,0,0,4,0
+#define LGW_REGI_CORR_NUM_SAME_PEAK	LGW_CORR_NUM_SAME_PEAK,0,78,0,0,4,0
+#define LGW_REGI_CORR_MAC_GAIN	LGW_CORR_MAC_GAIN,0,78,4,0,3,0
+#define LGW_REGI_ADJUST_MODEM_START_OFFSET_RDX4	LGW_ADJUST_MODEM_START_OFFSET_RDX4,0,81,0,0,12,0
+#define LGW_REGI_ADJUST_MODEM_START_OFFSET_SF12_RDX4	LGW_ADJUST_MODEM_START_OFFSET_SF12_RDX4,0,83,0,0,12,0
+#define LGW_REGI_DBG_CORR_SELECT_SF	LGW_DBG_CORR_SELECT_SF,0,85,0,0,8,0
+#define LGW_REGI_DBG_CORR_SELECT_CHANNEL	LGW_DBG_CORR_SELECT_CHANNEL,0,86,0,0,8,0
+#define LGW_REGI_DBG_DETECT_CPT	LGW_DBG_DETECT_CPT,0,87,0,0,8,1
+#define LGW_REGI_DBG_SYMB_CPT	LGW_DBG_SYMB_CPT,0,88,0,0,8,1
+#define LGW_REGI_CHIRP_INVERT_RX	LGW_CHIRP_INVERT_RX,0,89,0,0,1,0
+#define LGW_REGI_DC_NOTCH_EN	LGW_DC_NOTCH_EN,0,89,1,0,1,0
+#define LGW_REGI_IMPLICIT_CRC_EN	LGW_IMPLICIT_CRC_EN,0,90,0,0,1,0
+#define LGW_REGI_IMPLICIT_CODING_RATE	LGW_IMPLICIT_CODING_RATE,0,90,1,0,3,0
+#define LGW_REGI_IMPLICIT_PAYLOAD_LENGHT	LGW_IMPLICIT_PAYLOAD_LENGHT,0,91,0,0,8,0
+#define LGW_REGI_FREQ_TO_TIME_INVERT	LGW_FREQ_TO_TIME_INVERT,0,92,0,0,8,0
+#define LGW_REGI_FREQ_TO_TIME_DRIFT	LGW_FREQ_TO_TIME_DRIFT,0,93,0,0,6,0
+#define LGW_REGI_PAYLOAD_FINE_TIMING_GAIN	LGW_PAYLOAD_FINE_TIMING_GAIN,0,94,0,0,2,0
+#define LGW_REGI_PREAMBLE_FINE_TIMING_GAIN	LGW_PREAMBLE_FINE_TIMING_GAIN,0,94,2,0,2,0
+#define LGW_REGI_TRACKING_INTEGRAL	LGW_TRACKING_INTEGRAL,0,94,4,0,2,0
+#define LGW_REGI_FRAME_SYNCH_PEAK1_POS	LGW_FRAME_SYNCH_PEAK1_POS,0,95,0,0,4,0
+#define LGW_REGI_FRAME_SYNCH_PEAK2_POS	LGW_FRAME_SYNCH_PEAK2_POS,0,95,4,0,4,0
+#define LGW_REGI_PREAMBLE_SYMB1_NB	LGW_PREAMBLE_SYMB1_NB,0,96,0,0,16,0
+#define LGW_REGI_FRAME_SYNCH_GAIN	LGW_FRAME_SYNCH_GAIN,0,98,0,0,1,0
+#define LGW_REGI_SYNCH_DETECT_TH	LGW_SYNCH_DETECT_TH,0,98,1,0,1,0
+#define LGW_REGI_LLR_SCALE	LGW_LLR_SCALE,0,99,0,0,4,0
+#define LGW_REGI_SNR_AVG_CST	LGW_SNR_AVG_CST,0,99,4,0,2,0
+#define LGW_REGI_PPM_OFFSET	LGW_PPM_OFFSET,0,100,0,0,7,0
+#define LGW_REGI_MAX_PAYLOAD_LEN	LGW_MAX_PAYLOAD_LEN,0,101,0,0,8,0
+#define LGW_REGI_ONLY_CRC_EN	LGW_ONLY_CRC_EN,0,102,0,0,1,0
+#define LGW_REGI_ZERO_PAD	LGW_ZERO_PAD,0,103,0,0,8,0
+#define LGW_REGI_DEC_GAIN_OFFSET	LGW_DEC_GAIN_OFFSET,0,104,0,0,4,0
+#define LGW_REGI_CHAN_GAIN_OFFSET	LGW_CHAN_GAIN_OFFSET,0,104,4,0,4,0
+#define LGW_REGI_FORCE_HOST_RADIO_CTRL	LGW_FORCE_HOST_RADIO_CTRL,0,105,1,0,1,0
+#define LGW_REGI_FORCE_HOST_FE_CTRL	LGW_FORCE_HOST_FE_CTRL,0,105,2,0,1,0
+#define LGW_REGI_FORCE_DEC_FILTER_GAIN	LGW_FORCE_DEC_FILTER_GAIN,0,105,3,0,1,0
+#define LGW_REGI_MCU_RST_0	LGW_MCU_RST_0,0,106,0,0,1,0
+#define LGW_REGI_MCU_RST_1	LGW_MCU_RST_1,0,106,1,0,1,0
+#define LGW_REGI_MCU_SELECT_MUX_0	LGW_MCU_SELECT_MUX_0,0,106,2,0,1,0
+#define LGW_REGI_MCU_SELECT_MUX_1	LGW_MCU_SELECT_MUX_1,0,106,3,0,1,0
+#define LGW_REGI_MCU_CORRUPTION_DETECTED_0	LGW_MCU_CORRUPTION_DETECTED_0,0,106,4,0,1,1
+#define LGW_REGI_MCU_CORRUPTION_DETECTED_1	LGW_MCU_CORRUPTION_DETECTED_1,0,106,5,0,1,1
+#define LGW_REGI_MCU_SELECT_EDGE_0	LGW_MCU_SELECT_EDGE_0,0,106,6,0,1,0
+#define LGW_REGI_MCU_SELECT_EDGE_1	LGW_MCU_SELECT_EDGE_1,0,106,7,0,1,0
+#define LGW_REGI_CHANN_SELECT_RSSI	LGW_CHANN_SELECT_RSSI,0,107,0,0,8,0
+#define LGW_REGI_RSSI_BB_DEFAULT_VALUE	LGW_RSSI_BB_DEFAULT_VALUE,0,108,0,0,8,0
+#define LGW_REGI_RSSI_DEC_DEFAULT_VALUE	LGW_RSSI_DEC_DEFAULT_VALUE,0,109,0,0,8,0
+#define LGW_REGI_RSSI_CHANN_DEFAULT_VALUE	LGW_RSSI_CHANN_DEFAULT_VALUE,0,110,0,0,8,0
+#define LGW_REGI_RSSI_BB_FILTER_ALPHA	LGW_RSSI_BB_FILTER_ALPHA,0,111,0,0,5,0
+#define LGW_REGI_RSSI_DEC_FILTER_ALPHA	LGW_RSSI_DEC_FILTER_ALPHA,0,112,0,0,5,0
+#define LGW_REGI_RSSI_CHANN_FILTER_ALPHA	LGW_RSSI_CHANN_FILTER_ALPHA,0,113,0,0,5,0
+#define LGW_REGI_IQ_MISMATCH_A_AMP_COEFF	LGW_IQ_MISMATCH_A_AMP_COEFF,0,114,0,0,6,0
+#define LGW_REGI_IQ_MISMATCH_A_PHI_COEFF	LGW_IQ_MISMATCH_A_PHI_COEFF,0,115,0,0,6,0
+#define LGW_REGI_IQ_MISMATCH_B_AMP_COEFF	LGW_IQ_MISMATCH_B_AMP_COEFF,0,116,0,0,6,0
+#define LGW_REGI_IQ_MISMATCH_B_SEL_I	LGW_IQ_MISMATCH_B_SEL_I,0,116,6,0,1,0
+#define LGW_REGI_IQ_MISMATCH_B_PHI_COEFF	LGW_IQ_MISMATCH_B_PHI_COEFF,0,117,0,0,6,0
+#define LGW_REGI_TX_TRIG_IMMEDIATE	LGW_TX_TRIG_IMMEDIATE,1,33,0,0,1,0
+#define LGW_REGI_TX_TRIG_DELAYED	LGW_TX_TRIG_DELAYED,1,33,1,0,1,0
+#define LGW_REGI_TX_TRIG_GPS	LGW_TX_TRIG_GPS,1,33,2,0,1,0
+#define LGW_REGI_TX_START_DELAY	LGW_TX_START_DELAY,1,34,0,0,16,0
+#define LGW_REGI_TX_FRAME_SYNCH_PEAK1_POS	LGW_TX_FRAME_SYNCH_PEAK1_POS,1,36,0,0,4,0
+#define LGW_REGI_TX_FRAME_SYNCH_PEAK2_POS	LGW_TX_FRAME_SYNCH_PEAK2_POS,1,36,4,0,4,0
+#define LGW_REGI_TX_RAMP_DURATION	LGW_TX_RAMP_DURATION,1,37,0,0,3,0
+#define LGW_REGI_TX_OFFSET_I	LGW_TX_OFFSET_I,1,39,0,1,8,0
+#define LGW_REGI_TX_OFFSET_Q	LGW_TX_OFFSET_Q,1,40,0,1,8,0
+#define LGW_REGI_TX_MODE	LGW_TX_MODE,1,41,0,0,1,0
+#define LGW_REGI_TX_ZERO_PAD	LGW_TX_ZERO_PAD,1,41,1,0,4,0
+#define LGW_REGI_TX_EDGE_SELECT	LGW_TX_EDGE_SELECT,1,41,5,0,1,0
+#define LGW_REGI_TX_EDGE_SELECT_TOP	LGW_TX_EDGE_SELECT_TOP,1,41,6,0,1,0
+#define LGW_REGI_TX_GAIN	LGW_TX_GAIN,1,42,0,0,2,0
+#define LGW_REGI_TX_CHIRP_LOW_PASS	LGW_TX_CHIRP_LOW_PASS,1,42,2,0,3,0
+#define LGW_REGI_TX_FCC_WIDEBAND	LGW_TX_FCC_WIDEBAND,1,42,5,0,2,0
+#define LGW_REGI_TX_SWAP_IQ	LGW_TX_SWAP_IQ,1,42,7,0,1,0
+#define LGW_REGI_MBWSSF_IMPLICIT_HEADER	LGW_MBWSSF_IMPLICIT_HEADER,1,43,0,0,1,0
+#define LGW_REGI_MBWSSF_IMPLICIT_CRC_EN	LGW_MBWSSF_IMPLICIT_CRC_EN,1,43,1,0,1,0
+#define LGW_REGI_MBWSSF_IMPLICIT_CODING_RATE	LGW_MBWSSF_IMPLICIT_CODING_RATE,1,43,2,0,3,0
+#define LGW_REGI_MBWSSF_IMPLICIT_PAYLOAD_LENGHT	LGW_MBWSSF_IMPLICIT_PAYLOAD_LENGHT,1,44,0,0,8,0
+#define LGW_REGI_MBWSSF_AGC_FREEZE_ON_DETECT	LGW_MBWSSF_AGC_FREEZE_ON_DETECT,1,45,0,0,1,0
+#define LGW_REGI_MBWSSF_FRAME_SYNCH_PEAK1_POS	LGW_MBWSSF_FRAME_SYNCH_PEAK1_POS,1,46,0,0,4,0
+#define LGW_REGI_MBWSSF_FRAME_SYNCH_PEAK2_POS	LGW_MBWSSF_FRAME_SYNCH_PEAK2_POS,1,46,4,0,4,0
+#define LGW_REGI_MBWSSF_PREAMBLE_SYMB1_NB	LGW_MBWSSF_PREAMBLE_SYMB1_NB,1,47,0,0,16,0
+#define LGW_REGI_MBWSSF_FRAME_SYNCH_GAIN	LGW_MBWSSF_FRAME_SYNCH_GAIN,1,49,0,0,1,0
+#define LGW_REGI_MBWSSF_SYNCH_DETECT_TH	LGW_MBWSSF_SYNCH_DETECT_TH,1,49,1,0,1,0
+#define LGW_REGI_MBWSSF_DETECT_MIN_SINGLE_PEAK	LGW_MBWSSF_DETECT_MIN_SINGLE_PEAK,1,50,0,0,8,0
+#define LGW_REGI_MBWSSF_DETECT_TRIG_SAME_PEAK_NB	LGW_MBWSSF_DETECT_TRIG_SAME_PEAK_NB,1,51,0,0,3,0
+#define LGW_REGI_MBWSSF_FREQ_TO_TIME_INVERT	LGW_MBWSSF_FREQ_TO_TIME_INVERT,1,52,0,0,8,0
+#define LGW_REGI_MBWSSF_FREQ_TO_TIME_DRIFT	LGW_MBWSSF_FREQ_TO_TIME_DRIFT,1,53,0,0,6,0
+#define LGW_REGI_MBWSSF_PPM_CORRECTION	LGW_MBWSSF_PPM_CORRECTION,1,54,0,0,12,0
+#define LGW_REGI_MBWSSF_PAYLOAD_FINE_TIMING_GAIN	LGW_MBWSSF_PAYLOAD_FINE_TIMING_GAIN,1,56,0,0,2,0
+#define LGW_REGI_MBWSSF_PREAMBLE_FINE_TIMING_GAIN	LGW_MBWSSF_PREAMBLE_FINE_TIMING_GAIN,1,56,2,0,2,0
+#define LGW_REGI_MBWSSF_TRACKING_INTEGRAL	LGW_MBWSSF_TRACKING_INTEGRAL,1,56,4,0,2,0
+#define LGW_REGI_MBWSSF_ZERO_PAD	LGW_MBWSSF_ZERO_PAD,1,57,0,0,8,0
+#define LGW_REGI_MBWSSF_MODEM_BW	LGW_MBWSSF_MODEM_BW,1,58,0,0,2,0
+#define LGW_REGI_MBWSSF_RADIO_SELECT	LGW_MBWSSF_RADIO_SELECT,1,58,2,0,1,0
+#define LGW_REGI_MBWSSF_RX_CHIRP_INVERT	LGW_MBWSSF_RX_CHIRP_INVERT,1,58,3,0,1,0
+#define LGW_REGI_MBWSSF_LLR_SCALE	LGW_MBWSSF_LLR_SCALE,1,59,0,0,4,0
+#define LGW_REGI_MBWSSF_SNR_AVG_CST	LGW_MBWSSF_SNR_AVG_CST,1,59,4,0,2,0
+#define LGW_REGI_MBWSSF_PPM_OFFSET	LGW_MBWSSF_PPM_OFFSET,1,59,6,0,1,0
+#define LGW_REGI_MBWSSF_RATE_SF	LGW_MBWSSF_RATE_SF,1,60,0,0,4,0
+#define LGW_REGI_MBWSSF_ONLY_CRC_EN	LGW_MBWSSF_ONLY_CRC_EN,1,60,4,0,1,0
+#define LGW_REGI_MBWSSF_MAX_PAYLOAD_LEN	LGW_MBWSSF_MAX_PAYLOAD_LEN,1,61,0,0,8,0
+#define LGW_REGI_TX_STATUS	LGW_TX_STATUS,1,62,0,0,8,1
+#define LGW_REGI_FSK_CH_BW_EXPO	LGW_FSK_CH_BW_EXPO,1,63,0,0,3,0
+#define LGW_REGI_FSK_RSSI_LENGTH	LGW_FSK_RSSI_LENGTH,1,63,3,0,3,0
+#define LGW_REGI_FSK_RX_INVERT	LGW_FSK_RX_INVERT,1,63,6,0,1,0
+#define LGW_REGI_FSK_PKT_MODE	LGW_FSK_PKT_MODE,1,63,7,0,1,0
+#define LGW_REGI_FSK_PSIZE	LGW_FSK_PSIZE,1,64,0,0,3,0
+#define LGW_REGI_FSK_CRC_EN	LGW_FSK_CRC_EN,1,64,3,0,1,0
+#define LGW_REGI_FSK_DCFREE_ENC	LGW_FSK_DCFREE_ENC,1,64,4,0,2,0
+#define LGW_REGI_FSK_CRC_IBM	LGW_FSK_CRC_IBM,1,64,6,0,1,0
+#define LGW_REGI_FSK_ERROR_OSR_TOL	LGW_FSK_ERROR_OSR_TOL,1,65,0,0,5,0
+#define LGW_REGI_FSK_RADIO_SELECT	LGW_FSK_RADIO_SELECT,1,65,7,0,1,0
+#define LGW_REGI_FSK_BR_RATIO	LGW_FSK_BR_RATIO,1,66,0,0,16,0
+#define LGW_REGI_FSK_REF_PATTERN_LSB	LGW_FSK_REF_PATTERN_LSB,1,68,0,0,32,0
+#define LGW_REGI_FSK_REF_PATTERN_MSB	LGW_FSK_REF_PATTERN_MSB,1,72,0,0,32,0
+#define LGW_REGI_FSK_PKT_LENGTH	LGW_FSK_PKT_LENGTH,1,76,0,0,8,0
+#define LGW_REGI_FSK_TX_GAUSSIAN_EN	LGW_FSK_TX_GAUSSIAN_EN,1,77,0,0,1,0
+#define LGW_REGI_FSK_TX_GAUSSIAN_SELECT_BT	LGW_FSK_TX_GAUSSIAN_SELECT_BT,1,77,1,0,2,0
+#define LGW_REGI_FSK_TX_PATTERN_EN	LGW_FSK_TX_PATTERN_EN,1,77,3,0,1,0
+#define LGW_REGI_FSK_TX_PREAMBLE_SEQ	LGW_FSK_TX_PREAMBLE_SEQ,1,77,4,0,1,0
+#define LGW_REGI_FSK_TX_PSIZE	LGW_FSK_TX_PSIZE,1,77,5,0,3,0
+#define LGW_REGI_FSK_NODE_ADRS	LGW_FSK_NODE_ADRS,1,80,0,0,8,0
+#define LGW_REGI_FSK_BROADCAST	LGW_FSK_BROADCAST,1,81,0,0,8,0
+#define LGW_REGI_FSK_AUTO_AFC_ON	LGW_FSK_AUTO_AFC_ON,1,82,0,0,1,0
+#define LGW_REGI_FSK_PATTERN_TIMEOUT_CFG	LGW_FSK_PATTERN_TIMEOUT_CFG,1,83,0,0,10,0
+#define LGW_REGI_SPI_RADIO_A__DATA	LGW_SPI_RADIO_A__DATA,2,33,0,0,8,0
+#define LGW_REGI_SPI_RADIO_A__DATA_READBACK	LGW_SPI_RADIO_A__DATA_READBACK,2,34,0,0,8,1
+#define LGW_REGI_SPI_RADIO_A__ADDR	LGW_SPI_RADIO_A__ADDR,2,35,0,0,8,0
+#define LGW_REGI_SPI_RADIO_A__CS	LGW_SPI_RADIO_A__CS,2,37,0,0,1,0
+#define LGW_REGI_SPI_RADIO_B__DATA	LGW_SPI_RADIO_B__DATA,2,38,0,0,8,0
+#define LGW_REGI_SPI_RADIO_B__DATA_READBACK	LGW_SPI_RADIO_B__DATA_READBACK,2,39,0,0,8,1
+#define LGW_REGI_SPI_RADIO_B__ADDR	LGW_SPI_RADIO_B__ADDR,2,40,0,0,8,0
+#define LGW_REGI_SPI_RADIO_B__CS	LGW_SPI_RADIO_B__CS,2,42,0,0,1,0
+#define LGW_REGI_RADIO_A_EN	LGW_RADIO_A_EN,2,43,0,0,1,0
+#define LGW_REGI_RADIO_B_EN	LGW_RADIO_B_EN,2,43,1,0,1,0
+#define LGW_REGI_RADIO_RST	LGW_RADIO_RST,2,43,2,0,1,0
+#define LGW_REGI_LNA_A_EN	LGW_LNA_A_EN,2,43,3,0,1,0
+#define LGW_REGI_PA_A_EN	LGW_PA_A_EN,2,43,4,0,1,0
+#define LGW_REGI_LNA_B_EN	LGW_LNA_B_EN,2,43,5,0,1,0
+#define LGW_REGI_PA_B_EN	LGW_PA_B_EN,2,43,6,0,1,0
+#define LGW_REGI_PA_GAIN	LGW_PA_GAIN,2,44,0,0,2,0
+#define LGW_REGI_LNA_A_CTRL_LUT	LGW_LNA_A_CTRL_LUT,2,45,0,0,4,0
+#define LGW_REGI_PA_A_CTRL_LUT	LGW_PA_A_CTRL_LUT,2,45,4,0,4,0
+#define LGW_REGI_LNA_B_CTRL_LUT	LGW_LNA_B_CTRL_LUT,2,46,0,0,4,0
+#define LGW_REGI_PA_B_CTRL_LUT	LGW_PA_B_CTRL_LUT,2,46,4,0,4,0
+#define LGW_REGI_CAPTURE_SOURCE	LGW_CAPTURE_SOURCE,2,47,0,0,5,0
+#define LGW_REGI_CAPTURE_START	LGW_CAPTURE_START,2,47,5,0,1,0
+#define LGW_REGI_CAPTURE_FORCE_TRIGGER	LGW_CAPTURE_FORCE_TRIGGER,2,47,6,0,1,0
+#define LGW_REGI_CAPTURE_WRAP	LGW_CAPTURE_WRAP,2,47,7,0,1,0
+#define LGW_REGI_CAPTURE_PERIOD	LGW_CAPTURE_PERIOD,2,48,0,0,16,0
+#define LGW_REGI_MODEM_STATUS	LGW_MODEM_STATUS,2,51,0,0,8,1
+#define LGW_REGI_VALID_HEADER_COUNTER_0	LGW_VALID_HEADER_COUNTER_0,2,52,0,0,8,1
+#define LGW_REGI_VALID_PACKET_COUNTER_0	LGW_VALID_PACKET_COUNTER_0,2,54,0,0,8,1
+#define LGW_REGI_VALID_HEADER_COUNTER_MBWSSF	LGW_VALID_HEADER_COUNTER_MBWSSF,2,56,0,0,8,1
+#define LGW_REGI_VALID_HEADER_COUNTER_FSK	LGW_VALID_HEADER_COUNTER_FSK,2,57,0,0,8,1
+#define LGW_REGI_VALID_PACKET_COUNTER_MBWSSF	LGW_VALID_PACKET_COUNTER_MBWSSF,2,58,0,0,8,1
+#define LGW_REGI_VALID_PACKET_COUNTER_FSK	LGW_VALID_PACKET_COUNTER_FSK,2,59,0,0,8,1
+#define LGW_REGI_CHANN_RSSI	LGW_CHANN_RSSI,2,60,0,0,8,1
+#define LGW_REGI_BB_RSSI	LGW_BB_RSSI,2,61,0,0,8,1
+#define LGW_REGI_DEC_RSSI	LGW_DEC_RSSI,2,62,0,0,8,1
+#define LGW_REGI_DBG_MCU_DATA	LGW_DBG_MCU_DATA,2,63,0,0,8,1
+#define LGW_REGI_DBG_ARB_MCU_RAM_DATA	LGW_DBG_ARB_MCU_RAM_DATA,2,64,0,0,8,1
+#define LGW_REGI_DBG_AGC_MCU_RAM_DATA	LGW_DBG_AGC_MCU_RAM_DATA,2,65,0,0,8,1
+#define LGW_REGI_NEXT_PACKET_CNT	LGW_NEXT_PACKET_CNT,2,66,0,0,16,1
+#define LGW_REGI_ADDR_CAPTURE_COUNT	LGW_ADDR_CAPTURE_COUNT,2,68,0,0,16,1
+#define LGW_REGI_TIMESTAMP	LGW_TIMESTAMP,2,70,0,0,32,1
+#define LGW_REGI_DBG_CHANN0_GAIN	LGW_DBG_CHANN0_GAIN,2,74,0,0,4,1
+#define LGW_REGI_DBG_CHANN1_GAIN	LGW_DBG_CHANN1_GAIN,2,74,4,0,4,1
+#define LGW_REGI_DBG_CHANN2_GAIN	LGW_DBG_CHANN2_GAIN,2,75,0,0,4,1
+#define LGW_REGI_DBG_CHANN3_GAIN	LGW_DBG_CHANN3_GAIN,2,75,4,0,4,1
+#define LGW_REGI_DBG_CHANN4_GAIN	LGW_DBG_CHANN4_GAIN,2,76,0,0,4,1
+#define LGW_REGI_DBG_CHANN5_GAIN	LGW_DBG_CHANN5_GAIN,2,76,4,0,4,1
+#define LGW_REGI_DBG_CHANN6_GAIN	LGW_DBG_CHANN6_GAIN,2,77,0,0,4,1
+#define LGW_REGI_DBG_CHANN7_GAIN	LGW_DBG_CHANN7_GAIN,2,77,4,0,4,1
+#define LGW_REGI_DBG_DEC_FILT_GAIN	LGW_DBG_DEC_FILT_GAIN,2,78,0,0,4,1
+#define LGW_REGI_SPI_DATA_FIFO_PTR	LGW_SPI_DATA_FIFO_PTR,2,79,0,0,3,1
+#define LGW_REGI_PACKET_DATA_FIFO_PTR	LGW_PACKET_DATA_FIFO_PTR,2,79,3,0,3,1
+#define LGW_REGI_DBG_ARB_MCU_RAM_ADDR	LGW_DBG_ARB_MCU_RAM_ADDR,2,80,0,0,8,0
+#define LGW_REGI_DBG_AGC_MCU_RAM_ADDR	LGW_DBG_AGC_MCU_RAM_ADDR,2,81,0,0,8,0
+#define LGW_REGI_SPI_MASTER_CHIP_SELECT_POLARITY	LGW_SPI_MASTER_CHIP_SELECT_POLARITY,2,82,0,0,1,0
+#define LGW_REGI_SPI_MASTER_CPOL	LGW_SPI_MASTER_CPOL,2,82,1,0,1,0
+#define LGW_REGI_SPI_MASTER_CPHA	LGW_SPI_MASTER_CPHA,2,82,2,0,1,0
+#define LGW_REGI_SIG_GEN_ANALYSER_MUX_SEL	LGW_SIG_GEN_ANALYSER_MUX_SEL,2,83,0,0,1,0
+#define LGW_REGI_SIG_GEN_EN	LGW_SIG_GEN_EN,2,84,0,0,1,0
+#define LGW_REGI_SIG_ANALYSER_EN	LGW_SIG_ANALYSER_EN,2,84,1,0,1,0
+#define LGW_REGI_SIG_ANALYSER_AVG_LEN	LGW_SIG_ANALYSER_AVG_LEN,2,84,2,0,2,0
+#define LGW_REGI_SIG_ANALYSER_PRECISION	LGW_SIG_ANALYSER_PRECISION,2,84,4,0,3,0
+#define LGW_REGI_SIG_ANALYSER_VALID_OUT	LGW_SIG_ANALYSER_VALID_OUT,2,84,7,0,1,1
+#define LGW_REGI_SIG_GEN_FREQ	LGW_SIG_GEN_FREQ,2,85,0,0,8,0
+#define LGW_REGI_SIG_ANALYSER_FREQ	LGW_SIG_ANALYSER_FREQ,2,86,0,0,8,0
+#define LGW_REGI_SIG_ANALYSER_I_OUT	LGW_SIG_ANALYSER_I_OUT,2,87,0,0,8,1
+#define LGW_REGI_SIG_ANALYSER_Q_OUT	LGW_SIG_ANALYSER_Q_OUT,2,88,0,0,8,1
+#define LGW_REGI_GPS_EN	LGW_GPS_EN,2,89,0,0,1,0
+#define LGW_REGI_GPS_POL	LGW_GPS_POL,2,89,1,0,1,0
+#define LGW_REGI_SW_TEST_REG1	LGW_SW_TEST_REG1,2,90,0,1,8,0
+#define LGW_REGI_SW_TEST_REG2	LGW_SW_TEST_REG2,2,91,2,1,6,0
+#define LGW_REGI_SW_TEST_REG3	LGW_SW_TEST_REG3,2,92,0,1,16,0
+#define LGW_REGI_DATA_MNGT_STATUS	LGW_DATA_MNGT_STATUS,2,94,0,0,4,1
+#define LGW_REGI_DATA_MNGT_CPT_FRAME_ALLOCATED	LGW_DATA_MNGT_CPT_FRAME_ALLOCATED,2,95,0,0,5,1
+#define LGW_REGI_DATA_MNGT_CPT_FRAME_FINISHED	LGW_DATA_MNGT_CPT_FRAME_FINISHED,2,96,0,0,5,1
+#define LGW_REGI_DATA_MNGT_CPT_FRAME_READEN	LGW_DATA_MNGT_CPT_FRAME_READEN,2,97,0,0,5,1
+
+/* register names, indexed by register ID */
+#define LGW_REG_MAP_NAMES \
+	"PAGE_REG", \
+	"SOFT_RESET", \
+	"VERSION", \
+	"RX_DATA_BUF_ADDR", \
+	"RX_DATA_BUF_DATA", \
+	"TX_DATA_BUF_ADDR", \
+	"TX_DATA_BUF_DATA", \
+	"CAPTURE_RAM_ADDR", \
+	"CAPTURE_RAM_DATA", \
+	"MCU_PROM_ADDR", \
+	"MCU_PROM_DATA", \
+	"RX_PACKET_DATA_FIFO_NUM_STORED", \
+	"RX_PACKET_DATA_FIFO_ADDR_POINTER", \
+	"RX_PACKET_DATA_FIFO_STATUS", \
+	"RX_PACKET_DATA_FIFO_PAYLOAD_SIZE", \
+	"MBWSSF_MODEM_ENABLE", \
+	"CONCENTRATOR_MODEM_ENABLE", \
+	"FSK_MODEM_ENABLE", \
+	"GLOBAL_EN", \
+	"CLK32M_EN", \
+	"CLKHS_EN", \
+	"START_BIST0", \
+	"START_BIST1", \
+	"CLEAR_BIST0", \
+	"CLEAR_BIST1", \
+	"BIST0_FINISHED", \
+	"BIST1_FINISHED", \
+	"MCU_AGC_PROG_RAM_BIST_STATUS", \
+	"MCU_ARB_PROG_RAM_BIST_STATUS", \
+	"CAPTURE_RAM_BIST_STATUS", \
+	"CHAN_FIR_RAM0_BIST_STATUS", \
+	"CHAN_FIR_RAM1_BIST_STATUS", \
+	"CORR0_RAM_BIST_STATUS", \
+	"CORR1_RAM_BIST_STATUS", \
+	"CORR2_RAM_BIST_STATUS", \
+	"CORR3_RAM_BIST_STATUS", \
+	"CORR4_RAM_BIST_STATUS", \
+	"CORR5_RAM_BIST_STATUS", \
+	"CORR6_RAM_BIST_STATUS", \
+	"CORR7_RAM_BIST_STATUS", \
+	"MODEM0_RAM0_BIST_STATUS", \
+	"MODEM1_RAM0_BIST_STATUS", \
+	"MODEM2_RAM0_BIST_STATUS", \
+	"MODEM3_RAM0_BIST_STATUS", \
+	"MODEM4_RAM0_BIST_STATUS", \
+	"MODEM5_RAM0_BIST_STATUS", \
+	"MODEM6_RAM0_BIST_STATUS", \
+	"MODEM7_RAM0_BIST_STATUS", \
+	"MODEM0_RAM1_BIST_STATUS", \
+	"MODEM1_RAM1_BIST_STATUS", \
+	"MODEM2_RAM1_BIST_STATUS", \
+	"MODEM3_RAM1_BIST_STATUS", \
+	"MODEM4_RAM1_BIST_STATUS", \
+	"MODEM5_RAM1_BIST_STATUS", \
+	"MODEM6_RAM1_BIST_STATUS", \
+	"MODEM7_RAM1_BIST_STATUS", \
+	"MODEM0_RAM2_BIST_STATUS", \
+	"MODEM1_RAM2_BIST_STATUS", \
+	"MODEM2_RAM2_BIST_STATUS", \
+	"MODEM3_RAM2_BIST_STATUS", \
+	"MODEM4_RAM2_BIST_STATUS", \
+	"MODEM5_RAM2_BIST_STATUS", \
+	"MODEM6_RAM2_BIST_STATUS", \
+	"MODEM7_RAM2_BIST_STATUS", \
+	"MODEM_MBWSSF_RAM0_BIST_STATUS", \
+	"MODEM_MBWSSF_RAM1_BIST_STATUS", \
+	"MODEM_MBWSSF_RAM2_BIST_STATUS", \
+	"MCU_AGC_DATA_RAM_BIST0_STATUS", \
+	"MCU_AGC_DATA_RAM_BIST1_STATUS", \
+	"MCU_ARB_DATA_RAM_BIST0_STATUS", \
+	"MCU_ARB_DATA_RAM_BIST1_STATUS", \
+	"TX_TOP_RAM_BIST0_STATUS", \
+	"TX_TOP_RAM_BIST1_STATUS", \
+	"DATA_MNGT_RAM_BIST0_STATUS", \
+	"DATA_MNGT_RAM_BIST1_STATUS", \
+	"GPIO_SELECT_INPUT", \
+	"GPIO_SELECT_OUTPUT", \
+	"GPIO_MODE", \
+	"GPIO_PIN_REG_IN", \
+	"GPIO_PIN_REG_OUT", \
+	"MCU_AGC_STATUS", \
+	"MCU_ARB_STATUS", \
+	"CHIP_ID", \
+	"EMERGENCY_FORCE_HOST_CTRL", \
+	"RX_INVERT_IQ", \
+	"MODEM_INVERT_IQ", \
+	"MBWSSF_MODEM_INVERT_IQ", \
+	"RX_EDGE_SELECT", \
+	"MISC_RADIO_EN", \
+	"FSK_MODEM_INVERT_IQ", \
+	"FILTER_GAIN", \
+	"RADIO_SELECT", \
+	"IF_FREQ_0", \
+	"IF_FREQ_1", \
+	"IF_FREQ_2", \
+	"IF_FREQ_3", \
+	"IF_FREQ_4", \
+	"IF_FREQ_5", \
+	"IF_FREQ_6", \
+	"IF_FREQ_7", \
+	"IF_FREQ_8", \
+	"IF_FREQ_9", \
+	"CHANN_OVERRIDE_AGC_GAIN", \
+	"CHANN_AGC_GAIN", \
+	"CORR0_DETECT_EN", \
+	"CORR1_DETECT_EN", \
+	"CORR2_DETECT_EN", \
+	"CORR3_DETECT_EN", \
+	"CORR4_DETECT_EN", \
+	"CORR5_DETECT_EN", \
+	"CORR6_DETECT_EN", \
+	"CORR7_DETECT_EN", \
+	"CORR_SAME_PEAKS_OPTION_SF6", \
+	"CORR_SAME_PEAKS_OPTION_SF7", \
+	"CORR_SAME_PEAKS_OPTION_SF8", \
+	"CORR_SAME_PEAKS_OPTION_SF9", \
+	"CORR_SAME_PEAKS_OPTION_SF10", \
+	"CORR_SAME_PEAKS_OPTION_SF11", \
+	"CORR_SAME_PEAKS_OPTION_SF12", \
+	"CORR_SIG_NOISE_RATIO_SF6", \
+	"CORR_SIG_NOISE_RATIO_SF7", \
+	"CORR_SIG_NOISE_RATIO_SF8", \
+	"CORR_SIG_NOISE_RATIO_SF9", \
+	"CORR_SIG_NOISE_RATIO_SF10", \
+	"CORR_SIG_NOISE_RATIO_SF11", \
+	"CORR_SIG_NOISE_RATIO_SF12", \
+	"CORR_NUM_SAME_PEAK", \
+	"CORR_MAC_GAIN", \
+	"ADJUST_MODEM_START_OFFSET_RDX4", \
+	"ADJUST_MODEM_START_OFFSET_SF12_RDX4", \
+	"DBG_CORR_SELECT_SF", \
+	"DBG_CORR_SELECT_CHANNEL", \
+	"DBG_DETECT_CPT", \
+	"DBG_SYMB_CPT", \
+	"CHIRP_INVERT_RX", \
+	"DC_NOTCH_EN", \
+	"IMPLICIT_CRC_EN", \
+	"IMPLICIT_CODING_RATE", \
+	"IMPLICIT_PAYLOAD_LENGHT", \
+	"FREQ_TO_TIME_INVERT", \
+	"FREQ_TO_TIME_DRIFT", \
+	"PAYLOAD_FINE_TIMING_GAIN", \
+	"PREAMBLE_FINE_TIMING_GAIN", \
+	"TRACKING_INTEGRAL", \
+	"FRAME_SYNCH_PEAK1_POS", \
+	"FRAME_SYNCH_PEAK2_POS", \
+	"PREAMBLE_SYMB1_NB", \
+	"FRAME_SYNCH_GAIN", \
+	"SYNCH_DETECT_TH", \
+	"LLR_SCALE", \
+	"SNR_AVG_CST", \
+	"PPM_OFFSET", \
+	"MAX_PAYLOAD_LEN", \
+	"ONLY_CRC_EN", \
+	"ZERO_PAD", \
+	"DEC_GAIN_OFFSET", \
+	"CHAN_GAIN_OFFSET", \
+	"FORCE_HOST_RADIO_CTRL", \
+	"FORCE_HOST_FE_CTRL", \
+	"FORCE_DEC_FILTER_GAIN", \
+	"MCU_RST_0", \
+	"MCU_RST_1", \
+	"MCU_SELECT_MUX_0", \
+	"MCU_SELECT_MUX_1", \
+	"MCU_CORRUPTION_DETECTED_0", \
+	"MCU_CORRUPTION_DETECTED_1", \
+	"MCU_SELECT_EDGE_0", \
+	"MCU_SELECT_EDGE_1", \
+	"CHANN_SELECT_RSSI", \
+	"RSSI_BB_DEFAULT_VALUE", \
+	"RSSI_DEC_DEFAULT_VALUE", \
+	"RSSI_CHANN_DEFAULT_VALUE", \
+	"RSSI_BB_FILTER_ALPHA", \
+	"RSSI_DEC_FILTER_ALPHA", \
+	"RSSI_CHANN_FILTER_ALPHA", \
+	"IQ_MISMATCH_A_AMP_COEFF", \
+	"IQ_MISMATCH_A_PHI_COEFF", \
+	"IQ_MISMATCH_B_AMP_COEFF", \
+	"IQ_MISMATCH_B_SEL_I", \
+	"IQ_MISMATCH_B_PHI_COEFF", \
+	"TX_TRIG_IMMEDIATE", \
+	"TX_TRIG_DELAYED", \
+	"TX_TRIG_GPS", \
+	"TX_START_DELAY", \
+	"TX_FRAME_SYNCH_PEAK1_POS", \
+	"TX_FRAME_SYNCH_PEAK2_POS", \
+	"TX_RAMP_DURATION", \
+	"TX_OFFSET_I", \
+	"TX_OFFSET_Q", \
+	"TX_MODE", \
+	"TX_ZERO_PAD", \
+	"TX_EDGE_SELECT", \
+	"TX_EDGE_SELECT_TOP", \
+	"TX_GAIN", \
+	"TX_CHIRP_LOW_PASS", \
+	"TX_FCC_WIDEBAND", \
+	"TX_SWAP_IQ", \
+	"MBWSSF_IMPLICIT_HEADER", \
+	"MBWSSF_IMPLICIT_CRC_EN", \
+	"MBWSSF_IMPLICIT_CODING_RATE", \
+	"MBWSSF_IMPLICIT_PAYLOAD_LENGHT", \
+	"MBWSSF_AGC_FREEZE_ON_DETECT", \
+	"MBWSSF_FRAME_SYNCH_PEAK1_POS", \
+	"MBWSSF_FRAME_SYNCH_PEAK2_POS", \
+	"MBWSSF_PREAMBLE_SYMB1_NB", \
+	"MBWSSF_FRAME_SYNCH_GAIN", \
+	"MBWSSF_SYNCH_DETECT_TH", \
+	"MBWSSF_DETECT_MIN_SINGLE_PEAK", \
+	"MBWSSF_DETECT_TRIG_SAME_PEAK_NB", \
+	"MBWSSF_FREQ_TO_TIME_INVERT", \
+	"MBWSSF_FREQ_TO_TIME_DRIFT", \
+	"MBWSSF_PPM_CORRECTION", \
+	"MBWSSF_PAYLOAD_FINE_TIMING_GAIN", \
+	"MBWSSF_PREAMBLE_FINE_TIMING_GAIN", \
+	"MBWSSF_TRACKING_INTEGRAL", \
+	"MBWSSF_ZERO_PAD", \
+	"MBWSSF_MODEM_BW", \
+	"MBWSSF_RADIO_SELECT", \
+	"MBWSSF_RX_CHIRP_INVERT", \
+	"MBWSSF_LLR_SCALE", \
+	"MBWSSF_SNR_AVG_CST", \
+	"MBWSSF_PPM_OFFSET", \
+	"MBWSSF_RATE_SF", \
+	"MBWSSF_ONLY_CRC_EN", \
+	"MBWSSF_MAX_PAYLOAD_LEN", \
+	"TX_STATUS", \
+	"FSK_CH_BW_EXPO", \
+	"FSK_RSSI_LENGTH", \
+	"FSK_RX_INVERT", \
+	"FSK_PKT_MODE", \
+	"FSK_PSIZE", \
+	"FSK_CRC_EN", \
+	"FSK_DCFREE_ENC", \
+	"FSK_CRC_IBM", \
+	"FSK_ERROR_OSR_TOL", \
+	"FSK_RADIO_SELECT", \
+	"FSK_BR_RATIO", \
+	"FSK_REF_PATTERN_LSB", \
+	"FSK_REF_PATTERN_MSB", \
+	"FSK_PKT_LENGTH", \
+	"FSK_TX_GAUSSIAN_EN", \
+	"FSK_TX_GAUSSIAN_SELECT_BT", \
+	"FSK_TX_PATTERN_EN", \
+	"FSK_TX_PREAMBLE_SEQ", \
+	"FSK_TX_PSIZE", \
+	"FSK_NODE_ADRS", \
+	"FSK_BROADCAST", \
+	"FSK_AUTO_AFC_ON", \
+	"FSK_PATTERN_TIMEOUT_CFG", \
+	"SPI_RADIO_A__DATA", \
+	"SPI_RADIO_A__DATA_READBACK", \
+	"SPI_RADIO_A__ADDR", \
+	"SPI_RADIO_A__CS", \
+	"SPI_RADIO_B__DATA", \
+	"SPI_RADIO_B__DATA_READBACK", \
+	"SPI_RADIO_B__ADDR", \
+	"SPI_RADIO_B__CS", \
+	"RADIO_A_EN", \
+	"RADIO_B_EN", \
+	"RADIO_RST", \
+	"LNA_A_EN", \
+	"PA_A_EN", \
+	"LNA_B_EN", \
+	"PA_B_EN", \
+	"PA_GAIN", \
+	"LNA_A_CTRL_LUT", \
+	"PA_A_CTRL_LUT", \
+	"LNA_B_CTRL_LUT", \
+	"PA_B_CTRL_LUT", \
+	"CAPTURE_SOURCE", \
+	"CAPTURE_START", \
+	"CAPTURE_FORCE_TRIGGER", \
+	"CAPTURE_WRAP", \
+	"CAPTURE_PERIOD", \
+	"MODEM_STATUS", \
+	"VALID_HEADER_COUNTER_0", \
+	"VALID_PACKET_COUNTER_0", \
+	"VALID_HEADER_COUNTER_MBWSSF", \
+	"VALID_HEADER_COUNTER_FSK", \
+	"VALID_PACKET_COUNTER_MBWSSF", \
+	"VALID_PACKET_COUNTER_FSK", \
+	"CHANN_RSSI", \
+	"BB_RSSI", \
+	"DEC_RSSI", \
+	"DBG_MCU_DATA", \
+	"DBG_ARB_MCU_RAM_DATA", \
+	"DBG_AGC_MCU_RAM_DATA", \
+	"NEXT_PACKET_CNT", \
+	"ADDR_CAPTURE_COUNT", \
+	"TIMESTAMP", \
+	"DBG_CHANN0_GAIN", \
+	"DBG_CHANN1_GAIN", \
+	"DBG_CHANN2_GAIN", \
+	"DBG_CHANN3_GAIN", \
+	"DBG_CHANN4_GAIN", \
+	"DBG_CHANN5_GAIN", \
+	"DBG_CHANN6_GAIN", \
+	"DBG_CHANN7_GAIN", \
+	"DBG_DEC_FILT_GAIN", \
+	"SPI_DATA_FIFO_PTR", \
+	"PACKET_DATA_FIFO_PTR", \
+	"DBG_ARB_MCU_RAM_ADDR", \
+	"DBG_AGC_MCU_RAM_ADDR", \
+	"SPI_MASTER_CHIP_SELECT_POLARITY", \
+	"SPI_MASTER_CPOL", \
+	"SPI_MASTER_CPHA", \
+	"SIG_GEN_ANALYSER_MUX_SEL", \
+	"SIG_GEN_EN", \
+	"SIG_ANALYSER_EN", \
+	"SIG_ANALYSER_AVG_LEN", \
+	"SIG_ANALYSER_PRECISION", \
+	"SIG_ANALYSER_VALID_OUT", \
+	"SIG_GEN_FREQ", \
+	"SIG_ANALYSER_FREQ", \
+	"SIG_ANALYSER_I_OUT", \
+	"SIG_ANALYSER_Q_OUT", \
+	"GPS_EN", \
+	"GPS_POL", \
+	"SW_TEST_REG1", \
+	"SW_TEST_REG2", \
+	"SW_TEST_REG3", \
+	"DATA_MNGT_STATUS", \
+	"DATA_MNGT_CPT_FRAME_ALLOCATED", \
+	"DATA_MNGT_CPT_FRAME_FINISHED", \
+	"DATA_MNGT_CPT_FRAME_READEN"
+
+#endif
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -25,6 +25,7 @@ Maintainer: Sylvain Miermont
 /* --- DEPENDANCIES --------------------------------------------------------- */
 
 #include <stdint.h>		/* C99 types*/
+#include <stdbool.h>	/* bool type */
 
 #include "config.h"	/* library configuration options (dynamically generated) */
 
@@ -33,19 +34,104 @@ Maintainer: Sylvain Miermont
 
 #define LGW_SPI_SUCCESS	 0
 #define LGW_SPI_ERROR	-1
-#define LGW_BURST_CHUNK	 1024
+#define LGW_BURST_CHUNK	 1024 /* default burst fragmentation, the native backend uses the spidev buffer size */
+#define LGW_SPI_BATCH_CHUNK	 256 /* max single-byte accesses of a batch sent in one SPI message */
+
+#define LGW_SPI_ENV_PATH	"LGW_SPI_PATH"	/* environment variable overriding the default SPI device */
+#define LGW_SPI_ENV_SPEED	"LGW_SPI_SPEED"	/* environment variable overriding the default SPI clock, in Hz */
+
+#define LGW_SPI_STAT_HIST_SIZE	32	/* number of log2 latency buckets, the last one also counts all slower transactions */
+
+/*
+SPI trace file format (all fields little-endian):
+	header: 8-byte magic LGW_SPI_TRACE_MAGIC, uint32 version
+	record: uint8 type (lgw_spi_stat_type_e, bit 7 set if the transaction failed),
+		uint8 address, uint16 data length, uint32 time since the start of the
+		previous record (us), uint32 transaction duration (ns), data bytes
+		(written data for writes, read data for reads)
+*/
+#define LGW_SPI_ENV_TRACE		"LGW_SPI_TRACE"	/* environment variable, path of a trace file to record at start-up */
+#define LGW_SPI_TRACE_MAGIC		"LGWTRACE"
+#define LGW_SPI_TRACE_VERSION	1
+#define LGW_SPI_TRACE_HDR_SIZE	12	/* size of the file header, in bytes */
+#define LGW_SPI_TRACE_REC_SIZE	12	/* size of a record without its data, in bytes */
+#define LGW_SPI_TRACE_ERR_FLAG	0x80
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@enum lgw_spi_stat_type_e
+@brief Kinds of SPI transactions counted by the statistics
+*/
+enum lgw_spi_stat_type_e {
+	LGW_SPI_STAT_W = 0,	/*!> single-byte write */
+	LGW_SPI_STAT_R,		/*!> single-byte read */
+	LGW_SPI_STAT_WB,	/*!> burst write */
+	LGW_SPI_STAT_RB,	/*!> burst read */
+	LGW_SPI_STAT_NB		/*!> number of transaction kinds */
+};
+
+/**
+@struct lgw_spi_stat_s
+@brief Counters of one kind of SPI transaction
+*/
+struct lgw_spi_stat_s {
+	uint64_t	count;		/*!> number of transactions (including failed ones) */
+	uint64_t	errors;		/*!> number of failed transactions */
+	uint64_t	bytes;		/*!> number of data bytes transferred (command bytes excluded) */
+	uint64_t	lat_sum_ns;	/*!> sum of the latencies, in ns */
+	uint64_t	lat_max_ns;	/*!> worst latency, in ns */
+	uint64_t	hist[LGW_SPI_STAT_HIST_SIZE]; /*!> bucket i counts latencies in [2^i, 2^(i+1)[ ns */
+};
+
+/**
+@struct lgw_spi_stats_s
+@brief Snapshot of the SPI statistics, one set of counters per transaction kind
+*/
+struct lgw_spi_stats_s {
+	bool					enabled;	/*!> statistics collection was enabled at snapshot time */
+	struct lgw_spi_stat_s	type[LGW_SPI_STAT_NB]; /*!> counters, indexed by lgw_spi_stat_type_e */
+};
+
+/**
+@struct lgw_spi_op_s
+@brief Single-byte access of a SPI batch
+*/
+struct lgw_spi_op_s {
+	uint8_t		address;	/*!> 7-bit register address */
+	uint8_t		data;		/*!> data byte to write, or data byte read */
+	bool		read;		/*!> true for a read, false for a write */
+};
+
+/**
+@struct lgw_spi_opt_s
+@brief Options of the SPI link, a NULL/0 field falls back on the environment, then on the compiled-in default
+*/
+struct lgw_spi_opt_s {
+	const char	*path;		/*!> SPI device path (ignored by the FTDI backend) */
+	uint32_t	speed_hz;	/*!> SPI clock frequency, in Hz */
+};
 
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
 /**
-@brief LoRa concentrator SPI setup (configure I/O and peripherals)
+@brief LoRa concentrator SPI setup (configure I/O and peripherals), with default options
 @param spi_target_ptr pointer on a generic pointer to SPI target (implementation dependant)
 @return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
 */
 
 int lgw_spi_open(void **spi_target_ptr);
 
+/**
+@brief LoRa concentrator SPI setup (configure I/O and peripherals)
+@param spi_target_ptr pointer on a generic pointer to SPI target (implementation dependant)
+@param opt pointer to the SPI options, NULL to use the environment or the defaults
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+*/
+int lgw_spi_open_opt(void **spi_target_ptr, const struct lgw_spi_opt_s *opt);
+
 /**
 @brief LoRa concentrator SPI close
 @param spi_target generic pointer to SPI target (implementation dependant)
@@ -54,6 +140,22 @@ int lgw_spi_open(void **spi_target_ptr);
 
 int lgw_spi_close(void *spi_target);
 
+/**
+@brief Change the SPI clock frequency of an open link
+@param spi_target generic pointer to SPI target (implementation dependant)
+@param speed_hz new SPI clock frequency, in Hz
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+*/
+int lgw_spi_set_speed(void *spi_target, uint32_t speed_hz);
+
+/**
+@brief Get the SPI clock frequency of an open link
+@param spi_target generic pointer to SPI target (implementation dependant)
+@param speed_hz pointer to a variable where to write the SPI clock frequency, in Hz
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+*/
+int lgw_spi_get_speed(void *spi_target, uint32_t *speed_hz);
+
 /**
 @brief LoRa concentrator SPI single-byte write
 @param spi_target generic pointer to SPI target (implementation dependant)
@@ -92,6 +194,90 @@ int lgw_spi_wb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size);
 */
 int lgw_spi_rb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size);
 
+/**
+@brief LoRa concentrator SPI batch of single-byte accesses, executed in order
+Each access is a separate 2-byte SPI frame, but the whole batch is sent to the
+driver at once when the backend supports it (native: one spidev message per
+LGW_SPI_BATCH_CHUNK accesses). Accesses are accounted as individual
+single-byte transactions by the statistics and the trace.
+@param spi_target generic pointer to SPI target (implementation dependant)
+@param ops array of accesses, read accesses get their data field updated
+@param nb number of accesses
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+*/
+int lgw_spi_batch(void *spi_target, struct lgw_spi_op_s *ops, uint16_t nb);
+
+/**
+@brief Enable or disable the collection of SPI statistics (disabled by default)
+@param enable true to start counting the transactions, false to stop
+*/
+void lgw_spi_stats_enable(bool enable);
+
+/**
+@brief Get a snapshot of the SPI statistics of all the links of the process
+@param stats pointer to the structure where to copy the statistics
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+*/
+int lgw_spi_get_stats(struct lgw_spi_stats_s *stats);
+
+/**
+@brief Clear all the SPI statistics counters
+*/
+void lgw_spi_reset_stats(void);
+
+/**
+@brief Estimate a latency percentile from the histogram of a transaction kind
+@param stat pointer to the counters of one transaction kind
+@param pct percentile to estimate, between 0 and 100 (eg. 99 for p99)
+@return upper bound of the histogram bucket containing the percentile, in ns (0 if no transaction)
+*/
+uint64_t lgw_spi_stats_percentile(const struct lgw_spi_stat_s *stat, double pct);
+
+/**
+@brief Start recording all SPI transactions of the process to a trace file
+@param path path of the trace file, truncated if it exists
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+*/
+int lgw_spi_trace_start(const char *path);
+
+/**
+@brief Stop recording SPI transactions, flush and close the trace file
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+*/
+int lgw_spi_trace_stop(void);
+
+/**
+@brief Start timing a SPI transaction (for use by the SPI backends)
+@return start timestamp in ns, 0 if neither statistics nor trace are enabled
+*/
+uint64_t lgw_spi_stats_begin(void);
+
+/**
+@brief Account a finished SPI transaction in the statistics and the trace (for use by the SPI backends)
+@param type kind of transaction
+@param address 7-bit register address
+@param data pointer to the data written or read (can be NULL if the transaction failed)
+@param size number of data bytes transferred
+@param t0 timestamp returned by lgw_spi_stats_begin
+@param status status of the transaction (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+*/
+void lgw_spi_stats_end(enum lgw_spi_stat_type_e type, uint8_t address, const uint8_t *data, uint16_t size, uint64_t t0, int status);
+
+/**
+@brief Same as lgw_spi_stats_end with an explicit latency (for use by the SPI backends)
+@param type kind of transaction
+@param address 7-bit register address
+@param data pointer to the data written or read (can be NULL if the transaction failed)
+@param size number of data bytes transferred
+@param t0 start of the transaction, on the lgw_spi_stats_begin clock (0 to ignore it)
+@param lat_ns duration of the transaction in ns
+@param status status of the transaction (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+
+Used when several transactions are sent in a single system call (lgw_spi_batch):
+the duration of the call is split between them.
+*/
+void lgw_spi_stats_end_lat(enum lgw_spi_stat_type_e type, uint8_t address, const uint8_t *data, uint16_t size, uint64_t t0, uint64_t lat_ns, int status);
+
 #endif
 
 /* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,477 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	Asynchronous register access engine: lock-free submission and completion
+	rings served by a dedicated I/O thread.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* CPU affinity and eventfd are Linux extensions */
+#define _GNU_SOURCE
+
+#include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+#include <stdio.h>		/* printf fprintf */
+#include <stdlib.h>		/* malloc free */
+#include <string.h>		/* memset */
+#include <unistd.h>		/* read write close */
+#include <errno.h>		/* EINTR */
+#include <pthread.h>	/* pthread_create pthread_setaffinity_np */
+#include <sched.h>		/* SCHED_FIFO CPU_SET sched_yield */
+#include <poll.h>		/* poll */
+#include <time.h>		/* clock_gettime */
+#include <sys/mman.h>	/* mlockall */
+#include <sys/eventfd.h>	/* eventfd */
+
+#include "loragw_aio.h"
+#include "loragw_aux.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#if DEBUG_REG == 1
+	#define DEBUG_MSG(str)				fprintf(stderr, str)
+	#define DEBUG_PRINTF(fmt, args...)	fprintf(stderr,"%s:%d: "fmt, __FUNCTION__, __LINE__, args)
+	#define CHECK_NULL(a)				if(a==NULL){fprintf(stderr,"%s:%d: ERROR: NULL POINTER AS ARGUMENT\n", __FUNCTION__, __LINE__);return LGW_AIO_ERROR;}
+#else
+	#define DEBUG_MSG(str)
+	#define DEBUG_PRINTF(fmt, args...)
+	#define CHECK_NULL(a)				if(a==NULL){return LGW_AIO_ERROR;}
+#endif
+
+#define ATOMIC_LOAD(p)		__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define CACHE_LINE		64
+#define RING_MAX		65536	/* max ring size, keeps the sequence arithmetic far from wrapping issues */
+#define WAIT_POLL_MS	1		/* polling period of lgw_aio_wait without eventfd */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+/* bounded multi-producer multi-consumer ring (D. Vyukov's algorithm): each
+cell carries a sequence number telling whether it is free for the producer of
+a given position or filled for the consumer of that position */
+struct ring_cell_s {
+	uint32_t				seq;
+	struct lgw_aio_req_s	req;
+};
+
+struct ring_s {
+	struct ring_cell_s	*cells;
+	uint32_t			mask;
+	uint32_t			head __attribute__((aligned(CACHE_LINE)));	/* next position to enqueue */
+	uint32_t			tail __attribute__((aligned(CACHE_LINE)));	/* next position to dequeue */
+};
+
+struct lgw_aio_s {
+	struct lgw_reg_ctx_s	*reg;
+	struct ring_s			sq;			/* submission ring, application threads -> I/O thread */
+	struct ring_s			cq;			/* completion ring, I/O thread -> application threads */
+	uint32_t				in_flight;	/* submitted and not yet reaped, bounds the completion ring */
+	int						sq_efd;		/* doorbell of the I/O thread when it sleeps */
+	int						cq_efd;		/* completion notification, -1 if disabled */
+	int						idle;		/* the I/O thread is (about to be) waiting on sq_efd */
+	int						stop;
+	pthread_t				thread;
+	struct lgw_aio_conf_s	conf;
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static int ring_init(struct ring_s *r, uint32_t size) {
+	uint32_t i;
+	
+	r->cells = malloc(size * sizeof(struct ring_cell_s));
+	if (r->cells == NULL) {
+		return -1;
+	}
+	for (i = 0; i < size; ++i) {
+		r->cells[i].seq = i;
+	}
+	r->mask = size - 1;
+	r->head = 0;
+	r->tail = 0;
+	return 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool ring_push(struct ring_s *r, const struct lgw_aio_req_s *req) {
+	struct ring_cell_s *c;
+	uint32_t pos, seq;
+	int32_t dif;
+	
+	pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+	for (;;) {
+		c = &r->cells[pos & r->mask];
+		seq = ATOMIC_LOAD(&c->seq);
+		dif = (int32_t)(seq - pos);
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&r->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (dif < 0) {
+			return false; /* full */
+		} else {
+			pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+		}
+	}
+	c->req = *req;
+	ATOMIC_STORE(&c->seq, pos + 1);
+	return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool ring_pop(struct ring_s *r, struct lgw_aio_req_s *req) {
+	struct ring_cell_s *c;
+	uint32_t pos, seq;
+	int32_t dif;
+	
+	pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+	for (;;) {
+		c = &r->cells[pos & r->mask];
+		seq = ATOMIC_LOAD(&c->seq);
+		dif = (int32_t)(seq - (pos + 1));
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&r->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (dif < 0) {
+			return false; /* empty */
+		} else {
+			pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+		}
+	}
+	*req = c->req;
+	ATOMIC_STORE(&c->seq, pos + r->mask + 1);
+	return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* true if ring_pop would return an element: the head is advanced before the element is written, only the cell sequence tells */
+static bool ring_ready(struct ring_s *r) {
+	uint32_t pos, seq;
+	int32_t dif;
+	
+	pos = ATOMIC_LOAD(&r->tail);
+	for (;;) {
+		seq = ATOMIC_LOAD(&r->cells[pos & r->mask].seq);
+		dif = (int32_t)(seq - (pos + 1));
+		if (dif <= 0) {
+			return (dif == 0);
+		}
+		pos = ATOMIC_LOAD(&r->tail); /* popped meanwhile, check the new tail */
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int64_t monotonic_ms(void) {
+	struct timespec now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((int64_t)now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void efd_signal(int fd) {
+	uint64_t one = 1;
+	
+	if (fd >= 0) {
+		while ((write(fd, &one, sizeof one) < 0) && (errno == EINTR));
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void efd_drain(int fd) {
+	uint64_t cnt;
+	
+	while ((read(fd, &cnt, sizeof cnt) < 0) && (errno == EINTR));
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void execute(struct lgw_aio_s *aio, struct lgw_aio_req_s *req) {
+	switch (req->op) {
+		case LGW_AIO_REG_W:
+			req->status = lgw_reg_w_ctx(aio->reg, req->register_id, req->value);
+			break;
+		case LGW_AIO_REG_R:
+			req->status = lgw_reg_r_ctx(aio->reg, req->register_id, &req->value);
+			break;
+		case LGW_AIO_REG_WB:
+			req->status = lgw_reg_wb_ctx(aio->reg, req->register_id, req->data, req->size);
+			break;
+		case LGW_AIO_REG_RB:
+			req->status = lgw_reg_rb_ctx(aio->reg, req->register_id, req->data, req->size);
+			break;
+		case LGW_AIO_CALL:
+			req->status = (req->fn != NULL) ? req->fn(req->arg) : LGW_REG_ERROR;
+			break;
+		default:
+			DEBUG_PRINTF("ERROR: UNKNOWN AIO OPERATION %d\n", req->op);
+			req->status = LGW_REG_ERROR;
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void setup_thread(struct lgw_aio_s *aio) {
+	struct sched_param param;
+	cpu_set_t cpus;
+	
+	/* all real-time settings are best-effort, the engine works without them */
+	if (aio->conf.cpu >= 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(aio->conf.cpu, &cpus);
+		if (pthread_setaffinity_np(pthread_self(), sizeof cpus, &cpus) != 0) {
+			DEBUG_PRINTF("WARNING: FAIL TO PIN AIO THREAD ON CPU %d\n", aio->conf.cpu);
+		}
+	}
+	if (aio->conf.rt_priority > 0) {
+		memset(&param, 0, sizeof param);
+		param.sched_priority = aio->conf.rt_priority;
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+			DEBUG_PRINTF("WARNING: FAIL TO SET SCHED_FIFO PRIORITY %d\n", aio->conf.rt_priority);
+		}
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* I/O thread: run the submitted operations back-to-back, sleep when there is none */
+static void *aio_thread(void *arg) {
+	struct lgw_aio_s *aio = arg;
+	struct lgw_aio_req_s req;
+	int done;
+	
+	setup_thread(aio);
+	for (;;) {
+		/* drain the submission ring, one notification per batch */
+		done = 0;
+		while (ring_pop(&aio->sq, &req)) {
+			execute(aio, &req);
+			ring_push(&aio->cq, &req); /* cannot fail, in_flight bounds the completions */
+			++done;
+		}
+		if (done > 0) {
+			efd_signal(aio->cq_efd);
+			continue;
+		}
+		if (ATOMIC_LOAD(&aio->stop) != 0) {
+			break;
+		}
+	
+		/* announce the sleep, then re-check the ring so that a submission
+		racing with the announcement is not missed */
+		__atomic_store_n(&aio->idle, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&aio->sq.head, __ATOMIC_SEQ_CST) == __atomic_load_n(&aio->sq.tail, __ATOMIC_SEQ_CST) && (ATOMIC_LOAD(&aio->stop) == 0)) {
+			efd_drain(aio->sq_efd);
+		}
+		__atomic_store_n(&aio->idle, 0, __ATOMIC_SEQ_CST);
+	}
+	return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+struct lgw_aio_s *lgw_aio_create(struct lgw_reg_ctx_s *reg, const struct lgw_aio_conf_s *conf) {
+	struct lgw_aio_s *aio;
+	uint32_t size;
+	
+	aio = malloc(sizeof(struct lgw_aio_s));
+	if (aio == NULL) {
+		DEBUG_MSG("ERROR: MALLOC FAIL\n");
+		return NULL;
+	}
+	memset(aio, 0, sizeof(struct lgw_aio_s));
+	aio->reg = (reg != NULL) ? reg : &lgw_reg_ctx_default;
+	aio->sq_efd = -1;
+	aio->cq_efd = -1;
+	if (conf != NULL) {
+		aio->conf = *conf;
+	} else {
+		aio->conf.cpu = -1;
+	}
+	
+	/* round the ring size up to a power of 2 */
+	size = (aio->conf.ring_size != 0) ? aio->conf.ring_size : LGW_AIO_RING_DEFAULT;
+	size = (size < RING_MAX) ? size : RING_MAX;
+	for (aio->conf.ring_size = 2; aio->conf.ring_size < size; aio->conf.ring_size <<= 1);
+	
+	if ((ring_init(&aio->sq, aio->conf.ring_size) != 0) || (ring_init(&aio->cq, aio->conf.ring_size) != 0)) {
+		DEBUG_MSG("ERROR: MALLOC FAIL\n");
+		goto fail;
+	}
+	aio->sq_efd = eventfd(0, EFD_CLOEXEC);
+	if (aio->sq_efd < 0) {
+		DEBUG_MSG("ERROR: FAIL TO CREATE AIO DOORBELL\n");
+		goto fail;
+	}
+	if (aio->conf.eventfd) {
+		aio->cq_efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (aio->cq_efd < 0) {
+			DEBUG_MSG("ERROR: FAIL TO CREATE AIO COMPLETION EVENTFD\n");
+			goto fail;
+		}
+	}
+	if (aio->conf.mlock && (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)) {
+		DEBUG_MSG("WARNING: FAIL TO LOCK PROCESS MEMORY\n");
+	}
+	if (pthread_create(&aio->thread, NULL, aio_thread, aio) != 0) {
+		DEBUG_MSG("ERROR: FAIL TO CREATE AIO THREAD\n");
+		goto fail;
+	}
+	DEBUG_PRINTF("Note: AIO engine started, %u operations in flight max\n", aio->conf.ring_size);
+	return aio;
+	
+fail:
+	if (aio->cq_efd >= 0) {
+		close(aio->cq_efd);
+	}
+	if (aio->sq_efd >= 0) {
+		close(aio->sq_efd);
+	}
+	free(aio->sq.cells);
+	free(aio->cq.cells);
+	free(aio);
+	return NULL;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_aio_destroy(struct lgw_aio_s *aio) {
+	if (aio == NULL) {
+		return;
+	}
+	ATOMIC_STORE(&aio->stop, 1);
+	efd_signal(aio->sq_efd);
+	pthread_join(aio->thread, NULL);
+	
+	close(aio->sq_efd);
+	if (aio->cq_efd >= 0) {
+		close(aio->cq_efd);
+	}
+	free(aio->sq.cells);
+	free(aio->cq.cells);
+	free(aio);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_aio_submit(struct lgw_aio_s *aio, const struct lgw_aio_req_s *req) {
+	/* check input variables */
+	CHECK_NULL(aio);
+	CHECK_NULL(req);
+	
+	/* reserve a completion slot first, so the I/O thread never blocks on a full completion ring */
+	if (__atomic_add_fetch(&aio->in_flight, 1, __ATOMIC_ACQ_REL) > aio->conf.ring_size) {
+		__atomic_sub_fetch(&aio->in_flight, 1, __ATOMIC_ACQ_REL);
+		DEBUG_MSG("WARNING: AIO RING FULL\n");
+		return LGW_AIO_ERROR;
+	}
+	if (!ring_push(&aio->sq, req)) {
+		__atomic_sub_fetch(&aio->in_flight, 1, __ATOMIC_ACQ_REL);
+		return LGW_AIO_ERROR;
+	}
+	
+	/* ring the doorbell only if the I/O thread sleeps, no syscall while it is busy
+	(the fence pairs with the idle announcement of the I/O thread) */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&aio->idle, __ATOMIC_SEQ_CST) != 0) {
+		efd_signal(aio->sq_efd);
+	}
+	return LGW_AIO_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_aio_reap(struct lgw_aio_s *aio, struct lgw_aio_req_s *cpl, int max) {
+	int n;
+	
+	/* check input variables */
+	CHECK_NULL(aio);
+	CHECK_NULL(cpl);
+	
+	for (n = 0; (n < max) && ring_pop(&aio->cq, &cpl[n]); ++n);
+	if (n > 0) {
+		__atomic_sub_fetch(&aio->in_flight, n, __ATOMIC_ACQ_REL);
+	}
+	
+	/* the eventfd stays readable while completions are pending: reset it once the ring is empty, */
+	/* and set it again if a completion was posted meanwhile, so that no waiter misses it */
+	if ((aio->cq_efd >= 0) && !ring_ready(&aio->cq)) {
+		efd_drain(aio->cq_efd);
+		if (ring_ready(&aio->cq)) {
+			efd_signal(aio->cq_efd);
+		}
+	}
+	return n;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_aio_wait(struct lgw_aio_s *aio, int timeout_ms) {
+	struct pollfd pfd;
+	int64_t deadline = 0;
+	int remaining = -1; /* infinite */
+	
+	/* check input variables */
+	CHECK_NULL(aio);
+	
+	if (timeout_ms >= 0) {
+		deadline = monotonic_ms() + timeout_ms;
+	}
+	for (;;) {
+		if (ring_ready(&aio->cq)) {
+			return LGW_AIO_SUCCESS;
+		}
+		if (timeout_ms >= 0) {
+			/* spurious wakeups must not extend the wait */
+			remaining = (int)(deadline - monotonic_ms());
+			if (remaining <= 0) {
+				return LGW_AIO_ERROR;
+			}
+		}
+		if (aio->cq_efd >= 0) {
+			/* not drained here: with several waiters, one would consume the wake-up of the others */
+			pfd.fd = aio->cq_efd;
+			pfd.events = POLLIN;
+			if ((poll(&pfd, 1, remaining) > 0) && !ring_ready(&aio->cq)) {
+				sched_yield(); /* completion being reaped by another thread, which resets the eventfd */
+			}
+		} else {
+			wait_ms(((remaining >= 0) && (remaining < WAIT_POLL_MS)) ? remaining : WAIT_POLL_MS);
+		}
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_aio_get_fd(struct lgw_aio_s *aio) {
+	return (aio != NULL) ? aio->cq_efd : -1;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -9,7 +9,8 @@
 Description:
 	Library of functions to manage a GNSS module (typically GPS) for accurate 
 	timestamping of packets and synchronisation of gateways.
-	A limited set of module brands/models are supported.
+	A limited set of module brands/models are supported: any receiver sending
+	NMEA sentences, and u-blox receivers with their UBX binary protocol.
 
 License: Revised BSD License, see LICENSE.TXT file include in the project
 Maintainer: Sylvain Miermont
@@ -31,10 +32,12 @@ Maintainer: Sylvain Miermont
 #include <stdio.h>		/* printf fprintf */
 #include <string.h>		/* memcpy */
 
-#include <time.h>		/* struct timespec */
+#include <time.h>		/* struct timespec clock_gettime */
 #include <fcntl.h>		/* open */
+#include <unistd.h>		/* read write */
+#include <sys/select.h>	/* select */
 #include <termios.h>	/* tcflush */
-#include <math.h>       /* modf */
+#include <math.h>       /* modf sqrt fabs fmax fmin lround llround isnan */
 
 #include <stdlib.h> // DEBUG
 
@@ -61,8 +64,142 @@ Maintainer: Sylvain Miermont
 #define		TS_CPS				1E6 /* count-per-second of the timestamp counter */
 #define		PLUS_10PPM			1.00001
 #define		MINUS_10PPM			0.99999
+#define		EST_MAX_AGE			900.0	/* max age of the points fitted by the drift estimator, in s (counter wraps in 4295s) */
+#define		EST_REJECT_MIN_US	3.0		/* residual always accepted by the drift estimator, in us */
+#define		EST_REJECT_SIGMA	5.0		/* residual rejected above that many standard deviations */
+#define		EST_MAX_REJECTED	3		/* successive rejected points that reset the drift estimator */
+#define		CALIB_MIN_POINTS	3		/* points fitted before a clock error is saved */
+#define		CALIB_MAX_SD		1E-6	/* max uncertainty of a saved or loaded clock error */
+#define		CALIB_DEFAULT_SD	0.5E-6	/* uncertainty saved without estimator (lgw_gps_sync) */
+#define		CALIB_MIN_SD		1E-9	/* floor of a loaded uncertainty (a perfect fit is not a perfect clock) */
+#define		CALIB_AGING			0.05E-6	/* assumed clock drift per day since the save */
+#define		CALIB_TEMPCO		0.1E-6	/* assumed clock drift per degree C since the save */
+#define		CALIB_MAX_DAYS		30.0	/* calibration files older than that are ignored */
+#define		CALIB_FILE_MAGIC	"LGWCLK"
+#define		CALIB_FILE_VERSION	1
+#define		CALIB_FILE_SIZE		26
+#define		CALIB_LOADED		0x80	/* bit of tref.aber: clock error loaded, not measured yet (lgw_gps_sync) */
 #define		DEFAULT_BAUDRATE	B9600
 
+#define		NMEA_MAX_LEN		82	/* max length of a NMEA sentence, from '$' to the checksum */
+#define		NMEA_MAX_DIGITS		18	/* digits of a numeric field that fit in the mantissa */
+
+#define		UBX_SYNC1			0xB5
+#define		UBX_SYNC2			0x62
+#define		UBX_MAX_PAYLOAD		92	/* largest payload parsed (NAV-PVT), longer frames are only checked */
+#define		UBX_MAX_LEN			2048 /* longer frames are considered as noise */
+#define		UBX_MAX_CFG			20	/* largest configuration payload sent (CFG-PRT) */
+#define		UBX_ACK_TIMEOUT_MS	1000 /* max time for the receiver to acknowledge a configuration message */
+#define		UBX_BAUD_SETTLE_MS	200	/* time for the receiver to switch to a new baudrate */
+#define		GPS_VERIFY_MS		2500 /* max time to receive a valid message after a baudrate change (> 1 epoch) */
+
+#define		UBX_NAV				0x01
+#define		UBX_NAV_PVT			0x07
+#define		UBX_NAV_TIMEUTC		0x21
+#define		UBX_ACK				0x05
+#define		UBX_ACK_NAK			0x00
+#define		UBX_ACK_ACK			0x01
+#define		UBX_CFG				0x06
+#define		UBX_CFG_PRT			0x00
+#define		UBX_CFG_MSG			0x01
+#define		UBX_PORT_UART1		1
+#define		UBX_PORT_UART2		2
+#define		UBX_TIM				0x0D
+#define		UBX_TIM_TP			0x01
+#define		NMEA_STD			0xF0	/* class of the standard NMEA sentences, for CFG-MSG */
+
+#define		TREF_WORDS			((int)((sizeof(struct tref) + 7) / 8)) /* struct tref, in 64-bit words */
+
+#define		GPS_EPOCH			315964800 /* 1980-01-06T00:00:00Z, as a Unix time */
+#define		SEC_PER_WEEK		604800
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+/* time reference in fixed point, for integer conversions */
+struct tref_fix_s {
+	uint32_t	count_us;
+	time_t		utc_sec;
+	uint64_t	utc_nsec;
+	uint64_t	ns_int;		/* ns per counter tick, integer part */
+	uint64_t	ns_frac;	/* ns per counter tick, fractional part (Q32) */
+	int64_t		cps_q24;	/* counter ticks per second (Q24) */
+	int64_t		cpns_q40;	/* counter ticks per ns (Q40) */
+};
+
+/* state of the streaming parser (NMEA sentences and UBX frames) */
+enum nmea_state_e {
+	NMEA_IDLE,		/* waiting for '$' or the UBX sync characters */
+	NMEA_FIELD,		/* in the sentence, before '*' */
+	NMEA_CHECK_HI,	/* first checksum character */
+	NMEA_CHECK_LO,	/* second checksum character */
+	UBX_SYNC,		/* first UBX sync character received */
+	UBX_HEADER,		/* class, ID and length */
+	UBX_PAYLOAD,	/* payload */
+	UBX_CHECK		/* Fletcher checksum */
+};
+
+/* value of the current field, accumulated character by character */
+struct nmea_num_s {
+	uint64_t	mant;	/* all the digits, as an integer */
+	int			ndig;	/* digits before the decimal point */
+	int			nfrac;	/* digits after the decimal point */
+	bool		point;	/* decimal point seen */
+	bool		neg;	/* leading '-' */
+	bool		valid;	/* only a number (optional sign, digits, one point) */
+	char		c;		/* first character */
+	char		fix;	/* first 'A' or 'D' character (mode fields) */
+	int			len;	/* number of characters */
+};
+
+/* values of the current sentence, applied to the GPS state once the checksum is verified */
+struct nmea_sentence_s {
+	enum gps_msg type;
+	int		nb_fields;
+	bool	time_ok;
+	short	hou, min, sec;
+	int32_t	nsec;
+	bool	date_ok;
+	short	yea, mon, day;
+	bool	lat_ok;
+	short	dla;
+	double	mla;
+	char	ola;
+	bool	lon_ok;
+	short	dlo;
+	double	mlo;
+	char	olo;
+	bool	alt_ok;
+	short	alt;
+	bool	sat_ok;
+	short	sat;
+	char	mod;
+};
+
+struct nmea_parser_s {
+	enum nmea_state_e state;
+	int		len;		/* characters of the sentence so far */
+	uint8_t	check;		/* running checksum (XOR of the characters between '$' and '*') */
+	uint8_t	check_rx;	/* checksum received */
+	int		field;		/* index of the current field (0 is the address) */
+	char	addr[5];	/* address field (talker + sentence formatter) */
+	int		addr_len;
+	struct nmea_num_s num;
+	struct nmea_sentence_s st;
+	/* UBX frame */
+	uint8_t	ubx_hdr[4];	/* class, ID, length (little endian) */
+	uint8_t	ubx_pl[UBX_MAX_PAYLOAD];
+	int		ubx_len;	/* payload length */
+	int		ubx_idx;	/* bytes of the current part (header, payload, checksum) received */
+	uint8_t	ubx_ck_a, ubx_ck_b; /* running Fletcher checksum */
+	/* latest UBX acknowledge received */
+	uint8_t	ack_cls, ack_id;
+	int		ack;		/* 0 none, 1 ACK, -1 NAK */
+	/* latest UBX port configuration received */
+	uint8_t	prt[20];
+	bool	prt_ok;
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
@@ -74,7 +211,7 @@ static short gps_day = 0; /* day of the month (1-31) */
 static short gps_hou = 0; /* hours (0-23) */
 static short gps_min = 0; /* minutes (0-59) */
 static short gps_sec = 0; /* seconds (0-60)(60 is for leap second) */
-static float gps_fra = 0.0; /* fractions of seconds (<1) */
+static int32_t gps_nsec = 0; /* fractions of seconds, in ns (can be negative with UBX) */
 static bool gps_time_ok = false;
 
 static short gps_dla = 0; /* degrees of latitude */
@@ -89,162 +226,714 @@ static bool gps_pos_ok = false;
 static char gps_mod = 'N'; /* GPS mode (N no fix, A autonomous, D differential) */
 static short gps_sat = 0; /* number of satellites used for fix */
 
+static struct timespec gps_tp_utc = {0, 0}; /* UTC time of the next time pulse (UBX only) */
+static int32_t gps_tp_qerr = 0; /* quantization error of that pulse, in ps */
+static bool gps_tp_ok = false;
+
+static const uint64_t pow10_u64[NMEA_MAX_DIGITS + 1] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+	1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+	1000000000000000000ULL
+};
+
+/* streaming NMEA/UBX parser, see lgw_gps_feed */
+static struct nmea_parser_s nmea = { .state = NMEA_IDLE };
+
+/* published time reference, see lgw_gps_publish (seqlock, the sequence is odd while it is written) */
+static uint32_t tref_seq = 0;
+static uint64_t tref_pub[TREF_WORDS];
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
 
-int nmea_checksum(char *nmea_string, int buff_size, char *checksum);
+static void nmea_num_reset(struct nmea_num_s *n);
+
+static void nmea_num_push(struct nmea_num_s *n, char c);
+
+static int hexchar_to_nibble(char c);
+
+static void nmea_field_end(struct nmea_parser_s *p);
+
+static enum gps_msg nmea_commit(struct nmea_sentence_s *st);
+
+static uint16_t ubx_u16(const uint8_t *b);
+
+static uint32_t ubx_u32(const uint8_t *b);
+
+static void ubx_set_deg(int32_t val, short *deg, double *min);
+
+static enum gps_msg ubx_commit(struct nmea_parser_s *p);
+
+static enum gps_msg ubx_push(struct nmea_parser_s *p, uint8_t b);
+
+static int ubx_write(int fd, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len);
+
+static int tty_wait(int fd, int timeout_ms, bool ack, uint8_t cls, uint8_t id);
 
-char nibble_to_hexchar(uint8_t a);
+static int ubx_send(int fd, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len);
 
-bool validate_nmea_checksum(char *serial_buff, int buff_size);
+static int ubx_set_baudrate(int fd, uint32_t baud);
 
-bool match_label(char *s, char *label, int size, char wildcard);
+static int tty_set_baudrate(int fd, struct termios *ttyopt, speed_t speed);
 
-int str_chop(char *s, int buff_size, char separator, int *idx_ary, int max_idx);
+static uint32_t speed_to_baud(speed_t speed);
+
+static int ubx_configure(int fd);
+
+static int tref_fix(const struct tref *ref, struct tref_fix_s *fix);
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
+static void nmea_num_reset(struct nmea_num_s *n) {
+	memset(n, 0, sizeof *n);
+	n->valid = true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 /*
-Calculate the checksum for a NMEA string
-Skip the first '$' if necessary and calculate checksum until '*' character is
-reached (or buff_size exceeded).
-Checksum must point to a 2-byte (or more) char array.
-Return position of the checksum in the string
+Accumulate one character of a field: digits go in a fixed-point mantissa
+(number of digits before and after the decimal point are counted), the first
+character and the first fix indicator (A or D) are kept for letter fields.
 */
-int nmea_checksum(char *nmea_string, int buff_size, char *checksum) {
-	int i = 0;
-	uint8_t check_num = 0;
-	
-	/* check input parameters */
-	if ((nmea_string == NULL) ||  (checksum == NULL) || (buff_size <= 1)) {
-		DEBUG_MSG("Invalid parameters for nmea_checksum\n");
+static void nmea_num_push(struct nmea_num_s *n, char c) {
+	if (n->len == 0) {
+		n->c = c;
+	}
+	if ((n->fix == 0) && ((c == 'A') || (c == 'D'))) {
+		n->fix = c;
+	}
+	if ((c >= '0') && (c <= '9')) {
+		if ((n->ndig + n->nfrac) < NMEA_MAX_DIGITS) {
+			n->mant = (n->mant * 10) + (uint64_t)(c - '0');
+			if (n->point) {
+				n->nfrac += 1;
+			} else {
+				n->ndig += 1;
+			}
+		} else if (!n->point) {
+			n->valid = false; /* integer part does not fit, extra fractional digits are just dropped */
+		}
+	} else if ((c == '.') && !n->point) {
+		n->point = true;
+	} else if ((c == '-') && (n->len == 0)) {
+		n->neg = true;
+	} else {
+		n->valid = false;
+	}
+	n->len += 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int hexchar_to_nibble(char c) {
+	if ((c >= '0') && (c <= '9')) {
+		return c - '0';
+	} else if ((c >= 'A') && (c <= 'F')) {
+		return 10 + (c - 'A');
+	} else if ((c >= 'a') && (c <= 'f')) {
+		return 10 + (c - 'a');
+	} else {
 		return -1;
 	}
-	
-	/* skip the first '$' if necessary */
-	if (nmea_string[i] == '$') {
-		i += 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Convert the field that just ended, according to the sentence type and field index */
+static void nmea_field_end(struct nmea_parser_s *p) {
+	struct nmea_sentence_s *st = &p->st;
+	const struct nmea_num_s *n = &p->num;
+	uint64_t ip; /* integer part */
+	uint64_t fp; /* fractional part, in units of 10^-nfrac */
+	enum { F_NONE, F_TIME, F_DATE, F_DAY, F_MON, F_YEA, F_LAT, F_NS, F_LON, F_EW, F_SAT, F_ALT, F_MODE } f = F_NONE;
+
+	if (p->field == 0) {
+		/* address field: talker G? and sentence formatter */
+		st->type = IGNORED;
+		if ((p->addr_len == 5) && (p->addr[0] == 'G')) {
+			if (memcmp(p->addr + 2, "RMC", 3) == 0) {
+				st->type = NMEA_RMC;
+			} else if (memcmp(p->addr + 2, "GGA", 3) == 0) {
+				st->type = NMEA_GGA;
+			} else if (memcmp(p->addr + 2, "GNS", 3) == 0) {
+				st->type = NMEA_GNS;
+			} else if (memcmp(p->addr + 2, "ZDA", 3) == 0) {
+				st->type = NMEA_ZDA;
+			}
+		}
+		return;
 	}
-	
-	/* xor until '*' or max length is reached */
-	while (nmea_string[i] != '*') {
-		check_num ^= nmea_string[i];
-		i += 1;
-		if (i >= buff_size) {
-			DEBUG_MSG("Maximum length reached for nmea_checksum\n");
-			return -1;
+
+	/* field of interest of each sentence */
+	switch (st->type) {
+		case NMEA_RMC: /* $xxRMC,time,status,lat,NS,long,EW,spd,cog,date,mv,mvEW,posMode*cs */
+			switch (p->field) {
+				case 1: f = F_TIME; break;
+				case 3: f = F_LAT; break;
+				case 4: f = F_NS; break;
+				case 5: f = F_LON; break;
+				case 6: f = F_EW; break;
+				case 9: f = F_DATE; break;
+				case 12: f = F_MODE; break;
+			}
+			break;
+		case NMEA_GGA: /* $xxGGA,time,lat,NS,long,EW,quality,numSV,HDOP,alt,M,sep,M,diffAge,diffStation*cs */
+		case NMEA_GNS: /* $xxGNS,time,lat,NS,long,EW,posMode,numSV,HDOP,alt,sep,diffAge,diffStation[,navStatus]*cs */
+			switch (p->field) {
+				case 2: f = F_LAT; break;
+				case 3: f = F_NS; break;
+				case 4: f = F_LON; break;
+				case 5: f = F_EW; break;
+				case 6: f = (st->type == NMEA_GNS) ? F_MODE : F_NONE; break;
+				case 7: f = F_SAT; break;
+				case 9: f = F_ALT; break;
+			}
+			break;
+		case NMEA_ZDA: /* $xxZDA,time,day,month,year,ltzh,ltzn*cs */
+			switch (p->field) {
+				case 1: f = F_TIME; break;
+				case 2: f = F_DAY; break;
+				case 3: f = F_MON; break;
+				case 4: f = F_YEA; break;
+			}
+			break;
+		default:
+			return;
+	}
+
+	ip = n->mant / pow10_u64[n->nfrac];
+	fp = n->mant % pow10_u64[n->nfrac];
+	switch (f) {
+		case F_TIME: /* hhmmss[.sss] */
+			if (n->valid && (n->ndig == 6)) {
+				st->hou = (short)(ip / 10000);
+				st->min = (short)((ip / 100) % 100);
+				st->sec = (short)(ip % 100);
+				st->nsec = (n->nfrac <= 9) ? (int32_t)(fp * pow10_u64[9 - n->nfrac]) : (int32_t)(fp / pow10_u64[n->nfrac - 9]);
+				st->time_ok = true;
+			}
+			break;
+		case F_DATE: /* ddmmyy */
+			if (n->valid && (n->ndig == 6) && (n->nfrac == 0)) {
+				st->day = (short)(ip / 10000);
+				st->mon = (short)((ip / 100) % 100);
+				st->yea = (short)(ip % 100);
+				st->date_ok = true;
+			}
+			break;
+		case F_DAY:
+			st->day = (short)ip;
+			st->date_ok = n->valid && (n->ndig == 2);
+			break;
+		case F_MON:
+			st->mon = (short)ip;
+			st->date_ok = st->date_ok && n->valid && (n->ndig == 2);
+			break;
+		case F_YEA:
+			st->yea = (short)ip;
+			st->date_ok = st->date_ok && n->valid && (n->ndig == 4);
+			break;
+		case F_LAT: /* ddmm.mmmm */
+			if (n->valid && (n->ndig == 4)) {
+				st->dla = (short)(ip / 100);
+				st->mla = (double)(ip % 100) + ((double)fp / (double)pow10_u64[n->nfrac]);
+				st->lat_ok = true;
+			}
+			break;
+		case F_LON: /* dddmm.mmmm */
+			if (n->valid && (n->ndig == 5)) {
+				st->dlo = (short)(ip / 100);
+				st->mlo = (double)(ip % 100) + ((double)fp / (double)pow10_u64[n->nfrac]);
+				st->lon_ok = true;
+			}
+			break;
+		case F_NS:
+			st->ola = (n->len == 1) ? n->c : 0;
+			break;
+		case F_EW:
+			st->olo = (n->len == 1) ? n->c : 0;
+			break;
+		case F_SAT:
+			if (n->valid && (n->ndig > 0) && (n->nfrac == 0)) {
+				st->sat = (short)ip;
+				st->sat_ok = true;
+			}
+			break;
+		case F_ALT: /* truncated to the meter */
+			if (n->valid && (n->ndig > 0)) {
+				st->alt = n->neg ? -(short)ip : (short)ip;
+				st->alt_ok = true;
+			}
+			break;
+		case F_MODE: /* RMC: one character, GNS: one character per constellation */
+			st->mod = (n->fix != 0) ? n->fix : 'N';
+			break;
+		default:
+			break;
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Apply a sentence with a valid checksum to the global GPS state */
+static enum gps_msg nmea_commit(struct nmea_sentence_s *st) {
+	bool pos_ok;
+
+	switch (st->type) {
+		case NMEA_RMC:
+			if (st->nb_fields != 13) {
+				DEBUG_MSG("Warning: invalid RMC sentence (number of fields)\n");
+				return INVALID;
+			}
+			gps_mod = st->mod;
+			if (st->time_ok && st->date_ok) {
+				gps_hou = st->hou; gps_min = st->min; gps_sec = st->sec; gps_nsec = st->nsec;
+				gps_day = st->day; gps_mon = st->mon; gps_yea = st->yea;
+				gps_time_ok = (gps_mod == 'A') || (gps_mod == 'D');
+				DEBUG_MSG("Note: Valid RMC sentence, %s, date: 20%02d-%02d-%02dT%02d:%02d:%06.3fZ\n", gps_time_ok ? "GPS locked" : "no satellite fix", gps_yea, gps_mon, gps_day, gps_hou, gps_min, (float)gps_sec + (1E-9 * gps_nsec));
+			} else {
+				/* could not get a valid hour AND date */
+				gps_time_ok = false;
+				DEBUG_MSG("Note: Valid RMC sentence, mode %c, no date\n", gps_mod);
+			}
+			return NMEA_RMC;
+
+		case NMEA_GGA:
+		case NMEA_GNS:
+			if (((st->type == NMEA_GGA) && (st->nb_fields != 15)) || ((st->type == NMEA_GNS) && (st->nb_fields != 13) && (st->nb_fields != 14))) {
+				DEBUG_MSG("Warning: invalid GGA/GNS sentence (number of fields)\n");
+				return INVALID;
+			}
+			if (st->type == NMEA_GNS) {
+				gps_mod = st->mod;
+			}
+			if (st->sat_ok) {
+				gps_sat = st->sat;
+			}
+			pos_ok = st->lat_ok && st->lon_ok && st->alt_ok && ((st->ola == 'N') || (st->ola == 'S')) && ((st->olo == 'E') || (st->olo == 'W'));
+			if (pos_ok) {
+				gps_dla = st->dla; gps_mla = st->mla; gps_ola = st->ola;
+				gps_dlo = st->dlo; gps_mlo = st->mlo; gps_olo = st->olo;
+				gps_alt = st->alt;
+				DEBUG_MSG("Note: Valid GGA/GNS sentence, %d sat, lat %02ddeg %06.3fmin %c, lon %03ddeg%06.3fmin %c, alt %d\n", gps_sat, gps_dla, gps_mla, gps_ola, gps_dlo, gps_mlo, gps_olo, gps_alt);
+			} else {
+				/* could not get a valid latitude, longitude AND altitude */
+				DEBUG_MSG("Note: Valid GGA/GNS sentence, %d sat, no coordinates\n", gps_sat);
+			}
+			gps_pos_ok = pos_ok;
+			return st->type;
+
+		case NMEA_ZDA:
+			if (st->nb_fields != 7) {
+				DEBUG_MSG("Warning: invalid ZDA sentence (number of fields)\n");
+				return INVALID;
+			}
+			if (st->time_ok && st->date_ok) {
+				gps_hou = st->hou; gps_min = st->min; gps_sec = st->sec; gps_nsec = st->nsec;
+				gps_day = st->day; gps_mon = st->mon; gps_yea = st->yea;
+				gps_time_ok = (gps_mod == 'A') || (gps_mod == 'D'); /* ZDA has no fix status, use the latest one */
+				DEBUG_MSG("Note: Valid ZDA sentence, date: %04d-%02d-%02dT%02d:%02d:%06.3fZ\n", gps_yea, gps_mon, gps_day, gps_hou, gps_min, (float)gps_sec + (1E-9 * gps_nsec));
+			} else {
+				gps_time_ok = false;
+				DEBUG_MSG("Note: Valid ZDA sentence, no date\n");
+			}
+			return NMEA_ZDA;
+
+		default:
+			DEBUG_MSG("Note: ignored NMEA sentence\n"); /* quite verbose */
+			return IGNORED;
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint16_t ubx_u16(const uint8_t *b) {
+	return (uint16_t)b[0] | ((uint16_t)b[1] << 8);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint32_t ubx_u32(const uint8_t *b) {
+	return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Split a UBX coordinate (1e-7 deg) into degrees and minutes, as parsed from NMEA */
+static void ubx_set_deg(int32_t val, short *deg, double *min) {
+	uint32_t a = (val < 0) ? -(uint32_t)val : (uint32_t)val;
+
+	*deg = (short)(a / 10000000);
+	*min = (double)(a % 10000000) * 60E-7;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Apply a UBX frame with a valid checksum to the global GPS state */
+static enum gps_msg ubx_commit(struct nmea_parser_s *p) {
+	const uint8_t *pl = p->ubx_pl;
+	uint8_t cls = p->ubx_hdr[0];
+	uint8_t id = p->ubx_hdr[1];
+	uint32_t tow_ms;
+	uint8_t valid, flags, fix;
+	int32_t lat, lon;
+
+	if ((cls == UBX_ACK) && (p->ubx_len == 2)) {
+		/* ACK-ACK / ACK-NAK: class and ID of the acknowledged message */
+		p->ack_cls = pl[0];
+		p->ack_id = pl[1];
+		p->ack = (id == UBX_ACK_ACK) ? 1 : -1;
+		return IGNORED;
+
+	} else if ((cls == UBX_CFG) && (id == UBX_CFG_PRT) && (p->ubx_len == 20)) {
+		/* answer to a port configuration poll */
+		memcpy(p->prt, pl, sizeof p->prt);
+		p->prt_ok = true;
+		return IGNORED;
+
+	} else if ((cls == UBX_NAV) && (id == UBX_NAV_TIMEUTC) && (p->ubx_len == 20)) {
+		/* iTOW U4, tAcc U4, nano I4, year U2, month, day, hour, min, sec, valid */
+		valid = pl[19];
+		if ((valid & 0x07) != 0x07) { /* validTOW, validWKN, validUTC */
+			gps_time_ok = false;
+			DEBUG_MSG("Note: Valid NAV-TIMEUTC frame, UTC not resolved\n");
+			return UBX_TIME;
+		}
+		gps_yea = (short)ubx_u16(pl + 12);
+		gps_mon = pl[14];
+		gps_day = pl[15];
+		gps_hou = pl[16];
+		gps_min = pl[17];
+		gps_sec = pl[18];
+		gps_nsec = (int32_t)ubx_u32(pl + 8);
+		gps_time_ok = true;
+		DEBUG_MSG("Note: Valid NAV-TIMEUTC frame, date: %04d-%02d-%02dT%02d:%02d:%02d %+dns\n", gps_yea, gps_mon, gps_day, gps_hou, gps_min, gps_sec, gps_nsec);
+		return UBX_TIME;
+
+	} else if ((cls == UBX_NAV) && (id == UBX_NAV_PVT) && (p->ubx_len == 92)) {
+		/* iTOW U4, year U2, month, day, hour, min, sec, valid, tAcc U4, nano I4, fixType, flags, flags2, numSV, lon I4, lat I4, height I4, hMSL I4, ... */
+		valid = pl[11];
+		fix = pl[20];
+		flags = pl[21];
+		if (((flags & 0x01) != 0) && (fix >= 2) && (fix <= 4)) { /* gnssFixOK, 2D, 3D or GNSS + dead reckoning */
+			gps_mod = ((flags & 0x02) != 0) ? 'D' : 'A'; /* diffSoln */
+		} else {
+			gps_mod = 'N';
 		}
+		gps_sat = pl[23];
+		if ((valid & 0x07) == 0x07) { /* validDate, validTime, fullyResolved */
+			gps_yea = (short)ubx_u16(pl + 4);
+			gps_mon = pl[6];
+			gps_day = pl[7];
+			gps_hou = pl[8];
+			gps_min = pl[9];
+			gps_sec = pl[10];
+			gps_nsec = (int32_t)ubx_u32(pl + 16);
+			gps_time_ok = (gps_mod != 'N');
+		} else {
+			gps_time_ok = false;
+		}
+		gps_pos_ok = (gps_mod != 'N');
+		if (gps_pos_ok) {
+			lon = (int32_t)ubx_u32(pl + 24);
+			lat = (int32_t)ubx_u32(pl + 28);
+			ubx_set_deg(lat, &gps_dla, &gps_mla);
+			gps_ola = (lat < 0) ? 'S' : 'N';
+			ubx_set_deg(lon, &gps_dlo, &gps_mlo);
+			gps_olo = (lon < 0) ? 'W' : 'E';
+			gps_alt = (short)((int32_t)ubx_u32(pl + 36) / 1000);
+		}
+		DEBUG_MSG("Note: Valid NAV-PVT frame, fix %u, %d sat, %s\n", fix, gps_sat, gps_time_ok ? "time valid" : "no time");
+		return UBX_POSITION;
+
+	} else if ((cls == UBX_TIM) && (id == UBX_TIM_TP) && (p->ubx_len == 16)) {
+		/* towMS U4, towSubMS U4 (2^-32 ms), qErr I4 (ps), week U2, flags, refInfo */
+		flags = pl[14];
+		if ((flags & 0x03) != 0x03) { /* timeBase is UTC, UTC available */
+			gps_tp_ok = false;
+			DEBUG_MSG("Note: Valid TIM-TP frame, not aligned on UTC\n");
+			return UBX_TIMEPULSE;
+		}
+		tow_ms = ubx_u32(pl);
+		gps_tp_utc.tv_sec = (time_t)GPS_EPOCH + ((time_t)ubx_u16(pl + 12) * SEC_PER_WEEK) + (time_t)(tow_ms / 1000);
+		gps_tp_utc.tv_nsec = (long)((tow_ms % 1000) * 1000000) + (long)(((uint64_t)ubx_u32(pl + 4) * 1000000) >> 32);
+		gps_tp_qerr = (int32_t)ubx_u32(pl + 8);
+		gps_tp_ok = true;
+		DEBUG_MSG("Note: Valid TIM-TP frame, next pulse at %ld.%09ld, qErr %dps\n", (long)gps_tp_utc.tv_sec, gps_tp_utc.tv_nsec, gps_tp_qerr);
+		return UBX_TIMEPULSE;
+
+	} else {
+		DEBUG_MSG("Note: ignored UBX frame %02X-%02X\n", cls, id); /* quite verbose */
+		return IGNORED;
 	}
-	
-	/* Convert checksum value to 2 hexadecimal characters */
-	checksum[0] = nibble_to_hexchar(check_num / 16); /* upper nibble */
-	checksum[1] = nibble_to_hexchar(check_num % 16); /* lower nibble */
-	
-	return i + 1;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-char nibble_to_hexchar(uint8_t a) {
-	if (a < 10) {
-		return '0' + a;
-	} else if (a < 16) {
-		return 'A' + (a-10);
+/* Process one byte of a UBX frame (after the first sync character) */
+static enum gps_msg ubx_push(struct nmea_parser_s *p, uint8_t b) {
+	if (p->state == UBX_CHECK) {
+		if (p->ubx_idx == 0) {
+			if (b != p->ubx_ck_a) {
+				DEBUG_MSG("Warning: UBX checksum doesn't match\n");
+				p->state = NMEA_IDLE;
+				return INVALID;
+			}
+			p->ubx_idx = 1;
+			return UNKNOWN;
+		}
+		p->state = NMEA_IDLE;
+		if (b != p->ubx_ck_b) {
+			DEBUG_MSG("Warning: UBX checksum doesn't match\n");
+			return INVALID;
+		}
+		return ubx_commit(p);
+	}
+
+	/* header and payload are covered by the checksum */
+	p->ubx_ck_a += b;
+	p->ubx_ck_b += p->ubx_ck_a;
+	if (p->state == UBX_HEADER) {
+		p->ubx_hdr[p->ubx_idx++] = b;
+		if (p->ubx_idx == 4) {
+			p->ubx_len = ubx_u16(p->ubx_hdr + 2);
+			p->ubx_idx = 0;
+			if (p->ubx_len > UBX_MAX_LEN) {
+				DEBUG_MSG("Warning: UBX frame too long\n");
+				p->state = NMEA_IDLE;
+				return INVALID;
+			}
+			p->state = (p->ubx_len > 0) ? UBX_PAYLOAD : UBX_CHECK;
+		}
 	} else {
-		return '?';
+		if (p->ubx_idx < UBX_MAX_PAYLOAD) {
+			p->ubx_pl[p->ubx_idx] = b;
+		}
+		if (++p->ubx_idx == p->ubx_len) {
+			p->ubx_idx = 0;
+			p->state = UBX_CHECK;
+		}
+	}
+	return UNKNOWN;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Send a UBX frame */
+static int ubx_write(int fd, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len) {
+	uint8_t frame[8 + UBX_MAX_CFG];
+	uint8_t ck_a = 0, ck_b = 0;
+	int i;
+
+	if (len > UBX_MAX_CFG) {
+		return LGW_GPS_ERROR;
+	}
+	frame[0] = UBX_SYNC1;
+	frame[1] = UBX_SYNC2;
+	frame[2] = cls;
+	frame[3] = id;
+	frame[4] = (uint8_t)(len & 0xFF);
+	frame[5] = (uint8_t)(len >> 8);
+	if (len > 0) {
+		memcpy(frame + 6, payload, len);
+	}
+	for (i = 2; i < (6 + len); ++i) {
+		ck_a += frame[i];
+		ck_b += ck_a;
+	}
+	frame[6 + len] = ck_a;
+	frame[7 + len] = ck_b;
+
+	nmea.ack = 0;
+	if (write(fd, frame, 8 + len) != (8 + len)) {
+		DEBUG_MSG("ERROR: FAILED TO WRITE UBX FRAME TO TTY\n");
+		return LGW_GPS_ERROR;
 	}
+	return LGW_GPS_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 /*
-Calculate the checksum of a NMEA frame and compare it to the checksum that is
-present at the end of it.
-Return true if it matches
+Read and parse the GPS data until the UBX frame cls-id is acknowledged (ack
+true), or until any valid message is received (ack false), or timeout.
 */
-bool validate_nmea_checksum(char *serial_buff, int buff_size) {
-	int checksum_index;
-	char checksum[2]; /* 2 characters to calculate NMEA checksum */
-	
-	checksum_index = nmea_checksum(serial_buff, buff_size, checksum);
-	
-	/* could we calculate a verification checksum ? */
-	if (checksum_index < 0) {
-		DEBUG_MSG("ERROR: IMPOSSIBLE TO PARSE NMEA SENTENCE\n");
-		return false;
+static int tty_wait(int fd, int timeout_ms, bool ack, uint8_t cls, uint8_t id) {
+	char buff[128];
+	struct timespec now, end;
+	struct timeval tv;
+	fd_set fds;
+	enum gps_msg msg;
+	ssize_t nb;
+	int i, n;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += timeout_ms / 1000;
+	end.tv_nsec += (timeout_ms % 1000) * 1000000;
+	if (end.tv_nsec >= 1000000000) {
+		end.tv_sec += 1;
+		end.tv_nsec -= 1000000000;
 	}
-	
-	/* check if there are enough char in the serial buffer to read checksum */
-	if (checksum_index >= (buff_size - 2)) {
-		DEBUG_MSG("ERROR: IMPOSSIBLE TO READ NMEA SENTENCE CHECKSUM\n");
-		return false;
+	for (;;) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if ((now.tv_sec > end.tv_sec) || ((now.tv_sec == end.tv_sec) && (now.tv_nsec >= end.tv_nsec))) {
+			return LGW_GPS_ERROR;
+		}
+		tv.tv_sec = 0;
+		tv.tv_usec = 100000;
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+		if (select(fd + 1, &fds, NULL, NULL, &tv) <= 0) {
+			continue;
+		}
+		nb = read(fd, buff, sizeof buff);
+		for (i = 0; i < nb; i += n) {
+			n = lgw_gps_feed(buff + i, (int)nb - i, &msg);
+			if (ack && (nmea.ack != 0) && (nmea.ack_cls == cls) && (nmea.ack_id == id)) {
+				return (nmea.ack > 0) ? LGW_GPS_SUCCESS : LGW_GPS_ERROR;
+			} else if (!ack && (msg != UNKNOWN) && (msg != INVALID)) {
+				return LGW_GPS_SUCCESS;
+			}
+		}
 	}
-	
-	/* check the checksum per se */
-	if ((serial_buff[checksum_index] == checksum[0]) && (serial_buff[checksum_index+1] == checksum[1])) {
-		return true;
-	} else {
-		DEBUG_MSG("ERROR: NMEA CHECKSUM %c%c DOESN'T MATCH VERIFICATION CHECKSUM %c%c\n", serial_buff[checksum_index], serial_buff[checksum_index+1], checksum[0], checksum[1]);
-		return false;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Send a UBX frame, then wait for the receiver to acknowledge it (the received data is parsed meanwhile) */
+static int ubx_send(int fd, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len) {
+	if (ubx_write(fd, cls, id, payload, len) != LGW_GPS_SUCCESS) {
+		return LGW_GPS_ERROR;
+	}
+	if (tty_wait(fd, UBX_ACK_TIMEOUT_MS, true, cls, id) != LGW_GPS_SUCCESS) {
+		DEBUG_MSG("ERROR: NO ACKNOWLEDGE FOR UBX FRAME %02X-%02X\n", cls, id);
+		return LGW_GPS_ERROR;
 	}
+	return LGW_GPS_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 /*
-Return true if the "label" string (can contain wildcard characters) matches
-the begining of the "s" string
+Ask a u-blox receiver to switch the serial port it is connected through to a
+new baudrate: the port configuration is polled, then written back with the new
+baudrate. Nothing is sent when connected through USB (no baudrate).
 */
-bool match_label(char *s, char *label, int size, char wildcard) {
+static int ubx_set_baudrate(int fd, uint32_t baud) {
+	uint8_t prt[20];
+
+	nmea.prt_ok = false;
+	if ((ubx_send(fd, UBX_CFG, UBX_CFG_PRT, NULL, 0) != LGW_GPS_SUCCESS) || !nmea.prt_ok) {
+		DEBUG_MSG("WARNING: NO UBX PORT CONFIGURATION, RECEIVER MAY ALREADY USE THE TARGET BAUDRATE\n");
+		return LGW_GPS_ERROR;
+	}
+	if ((nmea.prt[0] != UBX_PORT_UART1) && (nmea.prt[0] != UBX_PORT_UART2)) {
+		return LGW_GPS_SUCCESS;
+	}
+	memcpy(prt, nmea.prt, sizeof prt);
+	prt[8] = (uint8_t)(baud & 0xFF);
+	prt[9] = (uint8_t)((baud >> 8) & 0xFF);
+	prt[10] = (uint8_t)((baud >> 16) & 0xFF);
+	prt[11] = (uint8_t)((baud >> 24) & 0xFF);
+	if (ubx_write(fd, UBX_CFG, UBX_CFG_PRT, prt, sizeof prt) != LGW_GPS_SUCCESS) {
+		return LGW_GPS_ERROR;
+	}
+	/* the receiver switches once its output is sent, the acknowledge may be sent at either baudrate */
+	tcdrain(fd);
+	tty_wait(fd, UBX_BAUD_SETTLE_MS, true, UBX_CFG, UBX_CFG_PRT);
+	return LGW_GPS_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Set the tty baudrate, and drop the data received at the previous one */
+static int tty_set_baudrate(int fd, struct termios *ttyopt, speed_t speed) {
+	cfsetispeed(ttyopt, speed);
+	cfsetospeed(ttyopt, speed);
+	if (tcsetattr(fd, TCSANOW, ttyopt) != 0) {
+		DEBUG_MSG("ERROR: IMPOSSIBLE TO UPDATE TTY PORT CONFIGURATION\n");
+		return LGW_GPS_ERROR;
+	}
+	tcflush(fd, TCIOFLUSH);
+	nmea.state = NMEA_IDLE;
+	return LGW_GPS_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Baudrate matching a termios speed constant, 0 if not supported */
+static uint32_t speed_to_baud(speed_t speed) {
+	static const struct { speed_t speed; uint32_t baud; } speeds[] = {
+		{B4800, 4800}, {B9600, 9600}, {B19200, 19200}, {B38400, 38400},
+		{B57600, 57600}, {B115200, 115200}, {B230400, 230400}
+	};
 	int i;
-	
-	for (i=0; i < size; i++) {
-		if (label[i] == wildcard) continue;
-		if (label[i] != s[i]) return false;
+
+	for (i = 0; i < (int)ARRAY_SIZE(speeds); ++i) {
+		if (speeds[i].speed == speed) {
+			return speeds[i].baud;
+		}
 	}
-	return true;
+	return 0;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 /*
-Chop a string into smaller strings
-Replace every separator in the input character buffer by a null character so
-that all s[index] are valid strings.
-Populate an array of integer 'idx_ary' representing indexes of token in the
-string.
-buff_size and max_idx are there to prevent segfaults.
-Return the number of token found (number of idx_ary filled).
+Switch a u-blox receiver to binary output on the port it is connected through:
+the standard NMEA sentences are disabled and NAV-PVT, NAV-TIMEUTC and TIM-TP
+are sent once per navigation solution.
 */
-int str_chop(char *s, int buff_size, char separator, int *idx_ary, int max_idx) {
-	int i = 0; /* index in the string */
-	int j = 0; /* index in the result array */
-	
-	if ((s == NULL) || (buff_size < 0) || (separator == 0) || (idx_ary == NULL) || (max_idx < 0)) {
-		/* unsafe to do anything */
-		return -1;
+static int ubx_configure(int fd) {
+	static const uint8_t nmea_off[] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x08 }; /* GGA GLL GSA GSV RMC VTG ZDA */
+	static const uint8_t ubx_on[][2] = { {UBX_NAV, UBX_NAV_PVT}, {UBX_NAV, UBX_NAV_TIMEUTC}, {UBX_TIM, UBX_TIM_TP} };
+	uint8_t cfg[3];
+	int i;
+
+	/* enable the binary messages first, so time information never stops */
+	for (i = 0; i < (int)ARRAY_SIZE(ubx_on); ++i) {
+		cfg[0] = ubx_on[i][0];
+		cfg[1] = ubx_on[i][1];
+		cfg[2] = 1; /* one message per navigation solution */
+		if (ubx_send(fd, UBX_CFG, UBX_CFG_MSG, cfg, sizeof cfg) != LGW_GPS_SUCCESS) {
+			return LGW_GPS_ERROR;
+		}
 	}
-	if ((buff_size == 0) || (max_idx == 0)) {
-		/* nothing to do */
-		return 0;
-	}
-	s[buff_size - 1] = 0; /* add string terminator at the end of the buffer, just to be sure */
-	idx_ary[j] = 0;
-	j += 1;
-	/* loop until string terminator is reached */
-	while (s[i] != 0) {
-		if (s[i] == separator) {
-			s[i] = 0; /* replace separator by string terminator */
-			if (j >= max_idx) { /* no more room in the index array */
-				return j;
-			}
-			idx_ary[j] = i+1; /* next token start after replaced separator */
-			++j;
+	for (i = 0; i < (int)ARRAY_SIZE(nmea_off); ++i) {
+		cfg[0] = NMEA_STD;
+		cfg[1] = nmea_off[i];
+		cfg[2] = 0;
+		if (ubx_send(fd, UBX_CFG, UBX_CFG_MSG, cfg, sizeof cfg) != LGW_GPS_SUCCESS) {
+			return LGW_GPS_ERROR;
 		}
-		++i;
 	}
-	return j;
+	return LGW_GPS_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Check a time reference and compute its fixed-point conversion factors */
+static int tref_fix(const struct tref *ref, struct tref_fix_s *fix) {
+	uint64_t q;
+	
+	if ((ref->systime == 0) || (ref->xtal_err > PLUS_10PPM) || (ref->xtal_err < MINUS_10PPM)) {
+		return LGW_GPS_ERROR;
+	}
+	if ((ref->utc.tv_nsec < 0) || (ref->utc.tv_nsec >= 1000000000)) {
+		return LGW_GPS_ERROR;
+	}
+	fix->count_us = ref->count_us;
+	fix->utc_sec = ref->utc.tv_sec;
+	fix->utc_nsec = (uint64_t)ref->utc.tv_nsec;
+	q = (uint64_t)llround((1E9 / (TS_CPS * ref->xtal_err)) * 4294967296.0);
+	fix->ns_int = q >> 32;
+	fix->ns_frac = q & 0xFFFFFFFF;
+	fix->cps_q24 = llround(TS_CPS * ref->xtal_err * 16777216.0);
+	fix->cpns_q40 = llround((TS_CPS * ref->xtal_err / 1E9) * 1099511627776.0);
+	return LGW_GPS_SUCCESS;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -254,6 +943,7 @@ int lgw_gps_enable(char *tty_path, char *gps_familly, speed_t target_brate, int
 	int i;
 	struct termios ttyopt; /* serial port options */
 	int gps_tty_dev; /* file descriptor to the serial port of the GNSS module */
+	bool ubx = false; /* u-blox receiver, switched to UBX binary output */
 	
 	/* check input parameters */
 	CHECK_NULL(tty_path);
@@ -269,12 +959,17 @@ int lgw_gps_enable(char *tty_path, char *gps_familly, speed_t target_brate, int
 	
 	/* manage the different GPS modules families */
 	if (gps_familly != NULL) {
-		DEBUG_MSG("WARNING: gps_familly parameter ignored for now\n"); // TODO
+		if (strncmp(gps_familly, "ubx", 3) == 0) {
+			ubx = true;
+		} else {
+			DEBUG_MSG("WARNING: unknown gps_familly %s, NMEA only\n", gps_familly);
+		}
 	}
 	
 	/* manage the target bitrate */
-	if (target_brate != 0) {
-		DEBUG_MSG("WARNING: target_brate parameter ignored for now\n"); // TODO
+	if ((target_brate != 0) && (speed_to_baud(target_brate) == 0)) {
+		DEBUG_MSG("ERROR: UNSUPPORTED TARGET BAUDRATE\n");
+		return LGW_GPS_ERROR;
 	}
 	
 	/* get actual serial port configuration */
@@ -295,9 +990,11 @@ int lgw_gps_enable(char *tty_path, char *gps_familly, speed_t target_brate, int
 	ttyopt.c_cflag &= ~PARENB; /* no parity */
 	ttyopt.c_cflag &= ~CSTOPB; /* one stop bit */
 	ttyopt.c_iflag |= IGNPAR; /* ignore bytes with parity errors */
-	ttyopt.c_iflag |= ICRNL; /* map CR to NL */
-	ttyopt.c_iflag |= IGNCR; /* Ignore carriage return on input */
-	ttyopt.c_lflag |= ICANON; /* enable canonical input */
+	ttyopt.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON); /* raw input, bytes are not altered */
+	ttyopt.c_oflag &= ~OPOST; /* raw output */
+	ttyopt.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN); /* non-canonical, bytes are available as soon as received */
+	ttyopt.c_cc[VMIN] = 1; /* read() blocks until at least one byte is received */
+	ttyopt.c_cc[VTIME] = 0;
 	
 	/* set new serial ports parameters */
 	i = tcsetattr(gps_tty_dev, TCSANOW, &ttyopt);
@@ -313,102 +1010,174 @@ int lgw_gps_enable(char *tty_path, char *gps_familly, speed_t target_brate, int
 	/* initialize global variables */
 	gps_time_ok = false;
 	gps_pos_ok = false;
+	gps_tp_ok = false;
 	gps_mod = 'N';
+	nmea.state = NMEA_IDLE;
+	
+	/* switch the receiver and the tty to the target baudrate, check that messages are received */
+	if ((target_brate != 0) && (target_brate != DEFAULT_BAUDRATE)) {
+		if (ubx) {
+			ubx_set_baudrate(gps_tty_dev, speed_to_baud(target_brate));
+		}
+		i = tty_set_baudrate(gps_tty_dev, &ttyopt, target_brate);
+		if (i == LGW_GPS_SUCCESS) {
+			i = tty_wait(gps_tty_dev, GPS_VERIFY_MS, false, 0, 0);
+		}
+		if (i != LGW_GPS_SUCCESS) {
+			DEBUG_MSG("ERROR: NO VALID GPS MESSAGE AT TARGET BAUDRATE, BACK TO DEFAULT BAUDRATE\n");
+			tty_set_baudrate(gps_tty_dev, &ttyopt, DEFAULT_BAUDRATE);
+			return LGW_GPS_ERROR;
+		}
+	}
+	
+	/* switch u-blox receivers to binary output */
+	if (ubx) {
+		i = ubx_configure(gps_tty_dev);
+		if (i != LGW_GPS_SUCCESS) {
+			DEBUG_MSG("ERROR: FAILED TO CONFIGURE UBX OUTPUT\n");
+			return LGW_GPS_ERROR;
+		}
+	}
 	
 	return LGW_GPS_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-enum gps_msg lgw_parse_nmea(char *serial_buff, int buff_size) {
-	int i, j, k;
-	int str_index[30]; /* string index from the string chopping */
-	int nb_fields; /* number of strings detected by string chopping */
-	
-	/* check input parameters */
-	if (serial_buff == NULL) {
-		return UNKNOWN;
+int lgw_gps_feed(const char *buff, int size, enum gps_msg *msg) {
+	struct nmea_parser_s *p = &nmea;
+	enum gps_msg result = UNKNOWN;
+	int nib;
+	int i;
+	char c;
+
+	if ((buff == NULL) || (msg == NULL) || (size < 0)) {
+		return LGW_GPS_ERROR;
 	}
-	
-	/* display received serial data and checksum */
-	DEBUG_MSG("Note: parsing NMEA frame> %s", serial_buff);
-	
-	/* look for some NMEA sentences in particular */
-	if (buff_size < 8) {
-		DEBUG_MSG("ERROR: TOO SHORT TO BE A VALID NMEA SENTENCE\n");
-		return UNKNOWN;
-	} else if (match_label(serial_buff, "$G?RMC", 6, '?')) {
-		/*
-		NMEA sentence format: $xxRMC,time,status,lat,NS,long,EW,spd,cog,date,mv,mvEW,posMode*cs<CR><LF>
-		Valid fix: $GPRMC,083559.34,A,4717.11437,N,00833.91522,E,0.004,77.52,091202,,,A*00
-		No fix: $GPRMC,,V,,,,,,,,,,N*00
-		*/
-		if (!validate_nmea_checksum(serial_buff, buff_size)) {
-			DEBUG_MSG("Warning: invalid RMC sentence (bad checksum)\n");
-			return INVALID;
+
+	for (i = 0; (i < size) && (result == UNKNOWN); ++i) {
+		c = buff[i];
+
+		/* UBX frames are binary, only the sync characters and the length delimit them */
+		if (p->state == UBX_SYNC) {
+			if ((uint8_t)c == UBX_SYNC2) {
+				p->state = UBX_HEADER;
+				p->ubx_idx = 0;
+				p->ubx_ck_a = 0;
+				p->ubx_ck_b = 0;
+				continue;
+			}
+			p->state = NMEA_IDLE; /* not a UBX frame, process the character as NMEA */
+		} else if (p->state >= UBX_HEADER) {
+			result = ubx_push(p, (uint8_t)c);
+			continue;
 		}
-		nb_fields = str_chop(serial_buff, buff_size, ',', str_index, ARRAY_SIZE(str_index));
-		if (nb_fields != 13) {
-			DEBUG_MSG("Warning: invalid RMC sentence (number of fields)\n");
-			return INVALID;
+		if ((uint8_t)c == UBX_SYNC1) {
+			p->state = UBX_SYNC;
+			continue;
 		}
-		/* parse GPS status */
-		gps_mod = *(serial_buff + str_index[12]); /* get first character, no need to bother with sscanf */
-		if ((gps_mod != 'N') && (gps_mod != 'A') && (gps_mod != 'D')) {
-			gps_mod = 'N';
+
+		/* a '$' always starts a new sentence, to resynchronize on truncated ones */
+		if (c == '$') {
+			p->state = NMEA_FIELD;
+			p->len = 1;
+			p->check = 0;
+			p->field = 0;
+			p->addr_len = 0;
+			memset(&p->st, 0, sizeof p->st);
+			nmea_num_reset(&p->num);
+			continue;
 		}
-		/* parse complete time */
-		i = sscanf(serial_buff + str_index[1], "%2hd%2hd%2hd%4f", &gps_hou, &gps_min, &gps_sec, &gps_fra);
-		j = sscanf(serial_buff + str_index[9], "%2hd%2hd%2hd", &gps_day, &gps_mon, &gps_yea);
-		if ((i == 4) && (j == 3)) {
-			if ((gps_mod == 'A') || (gps_mod == 'D')) {
-				gps_time_ok = true;
-				DEBUG_MSG("Note: Valid RMC sentence, GPS locked, date: 20%02d-%02d-%02dT%02d:%02d:%06.3fZ\n", gps_yea, gps_mon, gps_day, gps_hou, gps_min, gps_fra + (float)gps_sec);
-			} else {
-				gps_time_ok = false;
-				DEBUG_MSG("Note: Valid RMC sentence, no satellite fix, estimated date: 20%02d-%02d-%02dT%02d:%02d:%06.3fZ\n", gps_yea, gps_mon, gps_day, gps_hou, gps_min, gps_fra + (float)gps_sec);
-			}
-		} else {
-			/* could not get a valid hour AND date */
-			gps_time_ok = false;
-			DEBUG_MSG("Note: Valid RMC sentence, mode %c, no date\n", gps_mod);
-		}
-		return NMEA_RMC;
-	} else if (match_label(serial_buff, "$G?GGA", 6, '?')) {
-		/*
-		NMEA sentence format: $xxGGA,time,lat,NS,long,EW,quality,numSV,HDOP,alt,M,sep,M,diffAge,diffStation*cs<CR><LF>
-		Valid fix: $GPGGA,092725.00,4717.11399,N,00833.91590,E,1,08,1.01,499.6,M,48.0,M,,*5B
-		*/
-		if (!validate_nmea_checksum(serial_buff, buff_size)) {
-			DEBUG_MSG("Warning: invalid GGA sentence (bad checksum)\n");
-			return INVALID;
+		if (p->state == NMEA_IDLE) {
+			continue;
 		}
-		nb_fields = str_chop(serial_buff, buff_size, ',', str_index, ARRAY_SIZE(str_index));
-		if (nb_fields != 15) {
-			DEBUG_MSG("Warning: invalid GGA sentence (number of fields)\n");
-			return INVALID;
+		if (++p->len > NMEA_MAX_LEN) {
+			DEBUG_MSG("Warning: NMEA sentence too long\n");
+			p->state = NMEA_IDLE;
+			result = INVALID;
+			continue;
 		}
-		/* parse number of satellites used for fix */
-		sscanf(serial_buff + str_index[7], "%hd", &gps_sat);
-		/* parse 3D coordinates */
-		i = sscanf(serial_buff + str_index[2], "%2hd%10lf", &gps_dla, &gps_mla);
-		gps_ola = *(serial_buff + str_index[3]);
-		j = sscanf(serial_buff + str_index[4], "%3hd%10lf", &gps_dlo, &gps_mlo);
-		gps_olo = *(serial_buff + str_index[5]);
-		k = sscanf(serial_buff + str_index[9], "%hd", &gps_alt);
-		if ((i == 2) && (j == 2) && (k == 1) && ((gps_ola=='N')||(gps_ola=='S')) && ((gps_olo=='E')||(gps_olo=='W'))) {
-			gps_pos_ok = true;
-			DEBUG_MSG("Note: Valid GGA sentence, %d sat, lat %02ddeg %06.3fmin %c, lon %03ddeg%06.3fmin %c, alt %d\n", gps_sat, gps_dla, gps_mla, gps_ola, gps_dlo, gps_mlo, gps_olo, gps_alt);
-		} else {
-			/* could not get a valid latitude, longitude AND altitude */
-			gps_pos_ok = false;
-			DEBUG_MSG("Note: Valid GGA sentence, %d sat, no coordinates\n", gps_sat);
+
+		switch (p->state) {
+			case NMEA_FIELD:
+				if ((c == '\r') || (c == '\n')) {
+					DEBUG_MSG("Warning: NMEA sentence without checksum\n");
+					p->state = NMEA_IDLE;
+					result = INVALID;
+				} else if (c == '*') {
+					nmea_field_end(p);
+					p->st.nb_fields = p->field + 1;
+					p->state = NMEA_CHECK_HI;
+				} else {
+					p->check ^= (uint8_t)c;
+					if (c == ',') {
+						nmea_field_end(p);
+						p->field += 1;
+						nmea_num_reset(&p->num);
+					} else if (p->field == 0) {
+						if (p->addr_len < (int)sizeof p->addr) {
+							p->addr[p->addr_len] = c;
+						}
+						p->addr_len += 1;
+					} else if (p->st.type != IGNORED) {
+						nmea_num_push(&p->num, c);
+					}
+				}
+				break;
+
+			case NMEA_CHECK_HI:
+			case NMEA_CHECK_LO:
+				nib = hexchar_to_nibble(c);
+				if (nib < 0) {
+					DEBUG_MSG("Warning: invalid NMEA checksum character\n");
+					p->state = NMEA_IDLE;
+					result = INVALID;
+				} else if (p->state == NMEA_CHECK_HI) {
+					p->check_rx = (uint8_t)(nib << 4);
+					p->state = NMEA_CHECK_LO;
+				} else {
+					p->check_rx |= (uint8_t)nib;
+					p->state = NMEA_IDLE;
+					if (p->check_rx != p->check) {
+						DEBUG_MSG("Warning: NMEA checksum %02X doesn't match verification checksum %02X\n", p->check_rx, p->check);
+						result = INVALID;
+					} else {
+						result = nmea_commit(&p->st);
+					}
+				}
+				break;
+
+			default:
+				p->state = NMEA_IDLE;
+				break;
 		}
-		return NMEA_GGA;
-	} else {
-		DEBUG_MSG("Note: ignored NMEA sentence\n"); /* quite verbose */
-		return INVALID;
 	}
+
+	*msg = result;
+	return i;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+enum gps_msg lgw_parse_nmea(char *serial_buff, int buff_size) {
+	enum gps_msg msg = UNKNOWN;
+	int len;
+
+	/* check input parameters */
+	if ((serial_buff == NULL) || (buff_size < 8)) {
+		return UNKNOWN;
+	}
+
+	/* display received serial data and checksum */
+	DEBUG_MSG("Note: parsing NMEA frame> %s", serial_buff);
+
+	/* one whole sentence per call: drop any partial sentence left by lgw_gps_feed */
+	nmea.state = NMEA_IDLE;
+	for (len = 0; (len < buff_size) && (serial_buff[len] != 0); ++len);
+	lgw_gps_feed(serial_buff, len, &msg);
+	nmea.state = NMEA_IDLE;
+
+	return (msg == UNKNOWN) ? INVALID : msg;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -439,7 +1208,11 @@ int lgw_gps_get(struct timespec *utc, struct coord_s *loc, struct coord_s *err)
 			return LGW_GPS_ERROR;
 		}
 		utc->tv_sec = y;
-		utc->tv_nsec = (int32_t)(gps_fra * 1e9);
+		utc->tv_nsec = gps_nsec;
+		if (gps_nsec < 0) { /* UBX time is rounded to the nearest second */
+			utc->tv_sec -= 1;
+			utc->tv_nsec += 1000000000;
+		}
 	}
 	if (loc != NULL) {
 		if (!gps_pos_ok) {
@@ -462,17 +1235,40 @@ int lgw_gps_get(struct timespec *utc, struct coord_s *loc, struct coord_s *err)
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+int lgw_gps_get_pulse(struct timespec *utc, int32_t *qerr) {
+	CHECK_NULL(utc);
+	if (!gps_tp_ok) {
+		DEBUG_MSG("ERROR: NO VALID TIME PULSE TO RETURN\n");
+		return LGW_GPS_ERROR;
+	}
+	*utc = gps_tp_utc;
+	if (qerr != NULL) {
+		*qerr = gps_tp_qerr;
+	}
+	return LGW_GPS_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int lgw_gps_sync(struct tref *ref, uint32_t count_us, struct timespec utc) {
 	double cnt_diff; /* internal concentrator time difference (in seconds) */
 	double utc_diff; /* UTC time difference (in seconds) */
 	double slope; /* time slope between new reference and old reference (for sanity check) */
 	
 	bool aber_n0; /* is the update value for synchronization aberrant or not ? */
-	static bool aber_min1 = false; /* keep track of whether value at sync N-1 was aberrant or not  */
-	static bool aber_min2 = false; /* keep track of whether value at sync N-2 was aberrant or not  */
+	/* ref->aber keeps track of whether values at sync N-1 (bit 0) and N-2 (bit 1) were aberrant or not */
 	
 	CHECK_NULL(ref);
 	
+	/* first point with a clock error loaded by lgw_gps_calib_load: usable right away */
+	if ((ref->systime == 0) && ((ref->aber & CALIB_LOADED) != 0) && (ref->xtal_err <= PLUS_10PPM) && (ref->xtal_err >= MINUS_10PPM)) {
+		ref->systime = time(NULL);
+		ref->count_us = count_us;
+		ref->utc = utc;
+		ref->aber = 0;
+		return LGW_GPS_SUCCESS;
+	}
+	
 	/* calculate the slope */
 	cnt_diff = (double)(count_us - ref->count_us) / (double)(TS_CPS); /* uncorrected by xtal_err */
 	utc_diff = (double)(utc.tv_sec - (ref->utc).tv_sec) + (1E-9 * (double)(utc.tv_nsec - (ref->utc).tv_nsec));
@@ -498,10 +1294,9 @@ int lgw_gps_sync(struct tref *ref, uint32_t count_us, struct timespec utc) {
 		ref->count_us = count_us;
 		ref->utc = utc;
 		ref->xtal_err = slope;
-		aber_min2 = aber_min1;
-		aber_min1 = aber_n0;
+		ref->aber = (uint8_t)(((ref->aber << 1) | (aber_n0 ? 1 : 0)) & 0x03);
 		return LGW_GPS_SUCCESS;
-	} else if (aber_n0 && aber_min1 && aber_min2) {
+	} else if (aber_n0 && ((ref->aber & 0x03) == 0x03)) {
 		/* 3 successive aberrant values -> sync reset (keep xtal_err) */
 		ref->systime = time(NULL);
 		ref->count_us = count_us;
@@ -511,16 +1306,349 @@ int lgw_gps_sync(struct tref *ref, uint32_t count_us, struct timespec utc) {
 			ref->xtal_err = 1.0;
 		}
 		DEBUG_MSG("Warning: 3 successive aberrant sync attempts, sync reset\n");
-		aber_min2 = aber_min1;
-		aber_min1 = aber_n0;
+		ref->aber = (uint8_t)(((ref->aber << 1) | (aber_n0 ? 1 : 0)) & 0x03);
 		return LGW_GPS_SUCCESS;
 	} else {
 		/* only 1 or 2 successive aberrant values -> ignore and return an error */
-		aber_min2 = aber_min1;
-		aber_min1 = aber_n0;
+		ref->aber = (uint8_t)(((ref->aber << 1) | (aber_n0 ? 1 : 0)) & 0x03);
+		return LGW_GPS_ERROR;
+	}
+	
+	return LGW_GPS_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_gps_sync_est(struct tref_est_s *est, struct tref *ref, uint32_t count_us, struct timespec utc) {
+	double x[LGW_GPS_EST_SIZE]; /* UTC time of each point, relative to the new one (in seconds) */
+	double y[LGW_GPS_EST_SIZE]; /* counter of each point, relative to the new one (in us) */
+	double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+	double mx, my, a, b, r, ssr, lim;
+	double pred_sd = 0.0; /* standard deviation of the prediction at the new point */
+	double gap, xtal;
+	bool outlier = false;
+	uint32_t cnt_ref;
+	int i, k, n;
+
+	CHECK_NULL(est);
+	CHECK_NULL(ref);
+	if ((est->nb < 0) || (est->nb > LGW_GPS_EST_SIZE) || (est->head < 0) || (est->head >= LGW_GPS_EST_SIZE)) {
+		memset(est, 0, sizeof *est);
+	}
+
+	/* points of the ring that can still be used, relative to the new point */
+	for (i = 0, n = 0; i < est->nb; ++i) {
+		k = (est->head - 1 - i + LGW_GPS_EST_SIZE) % LGW_GPS_EST_SIZE; /* newest first */
+		x[n] = (double)(est->utc[k].tv_sec - utc.tv_sec) + (1E-9 * (double)(est->utc[k].tv_nsec - utc.tv_nsec));
+		if (x[n] >= 0.0) {
+			outlier = (i == 0); /* UTC time does not increase */
+			break;
+		} else if (x[n] < -EST_MAX_AGE) {
+			if (i == 0) {
+				/* gap since the newest point: the counter must have advanced by the same time (modulo its wrap) */
+				gap = -x[0];
+				xtal = ((ref->xtal_err > PLUS_10PPM) || (ref->xtal_err < MINUS_10PPM)) ? 1.0 : ref->xtal_err;
+				r = fmod(gap * xtal * TS_CPS, 4294967296.0) - (double)(count_us - est->cnt[k]);
+				if (r > 2147483648.0) {
+					r -= 4294967296.0;
+				} else if (r < -2147483648.0) {
+					r += 4294967296.0;
+				}
+				lim = EST_REJECT_MIN_US + (gap * (PLUS_10PPM - MINUS_10PPM) * TS_CPS);
+				outlier = (fabs(r) > lim) || (lim >= 2147483648.0);
+			}
+			break; /* the older points are not usable either */
+		}
+		y[n] = (double)(int32_t)(est->cnt[k] - count_us);
+		++n;
+	}
+
+	/* check the new point against the current estimate */
+	if (n == 1) {
+		/* no fit yet, only check the slope */
+		b = y[0] / x[0];
+		outlier = ((b / TS_CPS) > PLUS_10PPM) || ((b / TS_CPS) < MINUS_10PPM);
+	} else if (n >= 2) {
+		for (i = 0; i < n; ++i) {
+			sx += x[i];
+			sy += y[i];
+		}
+		mx = sx / n;
+		my = sy / n;
+		for (i = 0; i < n; ++i) {
+			sxx += (x[i] - mx) * (x[i] - mx);
+			sxy += (x[i] - mx) * (y[i] - my);
+		}
+		b = sxy / sxx;
+		a = my - (b * mx); /* counter predicted at the new point */
+		if (n > 2) {
+			pred_sd = est->jitter_us * sqrt((1.0 / n) + ((mx * mx) / sxx));
+		}
+		lim = fmax(EST_REJECT_MIN_US, EST_REJECT_SIGMA * sqrt((est->jitter_us * est->jitter_us) + (pred_sd * pred_sd)));
+		outlier = (fabs(a) > lim);
+	}
+	if (outlier) {
+		est->rejected += 1;
+		if (est->rejected < EST_MAX_REJECTED) {
+			DEBUG_MSG("Warning: sync point rejected\n");
+			return LGW_GPS_ERROR;
+		}
+		/* successive outliers, the counter or the time source changed: restart from the new point */
+		DEBUG_MSG("Warning: %d successive sync points rejected, estimator reset\n", est->rejected);
+		est->nb = 0;
+		n = 0;
+		ref->systime = 0; /* the previous reference does not apply to the new points */
+	}
+	est->rejected = 0;
+
+	/* add the new point, drop the unusable ones */
+	est->cnt[est->head] = count_us;
+	est->utc[est->head] = utc;
+	est->head = (est->head + 1) % LGW_GPS_EST_SIZE;
+	est->nb = (n < LGW_GPS_EST_SIZE) ? n + 1 : LGW_GPS_EST_SIZE;
+	n = est->nb - 1; /* old points kept, x[0..n-1] */
+	x[n] = 0.0;
+	y[n] = 0.0;
+	n += 1;
+
+	/* least squares fit of the counter against UTC time */
+	if (n == 1) {
+		est->jitter_us = 0.0;
+		if (!(est->prior_sd > 0.0) || (ref->xtal_err > PLUS_10PPM) || (ref->xtal_err < MINUS_10PPM)) {
+			/* a single point gives no clock error: the reference is only valid from the second one */
+			est->xtal_err_sd = PLUS_10PPM - 1.0;
+			ref->systime = 0;
+			return LGW_GPS_ERROR;
+		}
+		/* clock error loaded by lgw_gps_calib_load */
+		a = 0.0;
+		b = ref->xtal_err * TS_CPS;
+		est->xtal_err_sd = est->prior_sd;
+		est->prior_sd = 0.0; /* only for the first point, not after a reset */
+	} else {
+		sx = sy = sxx = sxy = 0.0;
+		for (i = 0; i < n; ++i) {
+			sx += x[i];
+			sy += y[i];
+		}
+		mx = sx / n;
+		my = sy / n;
+		for (i = 0; i < n; ++i) {
+			sxx += (x[i] - mx) * (x[i] - mx);
+			sxy += (x[i] - mx) * (y[i] - my);
+		}
+		b = sxy / sxx;
+		a = my - (b * mx);
+		if (n > 2) {
+			for (i = 0, ssr = 0.0; i < n; ++i) {
+				r = y[i] - (a + (b * x[i]));
+				ssr += r * r;
+			}
+			est->jitter_us = sqrt(ssr / (n - 2));
+			est->xtal_err_sd = est->jitter_us / sqrt(sxx) / TS_CPS;
+		} else {
+			est->jitter_us = 0.0;
+			est->xtal_err_sd = EST_REJECT_MIN_US / sqrt(sxx) / TS_CPS;
+		}
+	}
+
+	/* reference on the fitted line: integer counter value, UTC time adjusted by the rounding */
+	cnt_ref = count_us + (uint32_t)(int32_t)lround(a);
+	r = ((double)(int32_t)(cnt_ref - count_us) - a) / b; /* in seconds */
+	ref->systime = time(NULL);
+	ref->count_us = cnt_ref;
+	ref->utc.tv_sec = utc.tv_sec;
+	ref->utc.tv_nsec = utc.tv_nsec + lround(r * 1E9);
+	if (ref->utc.tv_nsec < 0) {
+		ref->utc.tv_sec -= 1;
+		ref->utc.tv_nsec += 1000000000;
+	} else if (ref->utc.tv_nsec >= 1000000000) {
+		ref->utc.tv_sec += 1;
+		ref->utc.tv_nsec -= 1000000000;
+	}
+	ref->xtal_err = b / TS_CPS;
+
+	return LGW_GPS_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_gps_publish(const struct tref *ref) {
+	uint64_t w[TREF_WORDS];
+	uint32_t seq;
+	int i;
+	
+	if (ref == NULL) {
+		return;
+	}
+	memset(w, 0, sizeof w);
+	memcpy(w, ref, sizeof *ref);
+	
+	/* take the write side: make the sequence odd (serializes concurrent writers) */
+	do {
+		seq = __atomic_load_n(&tref_seq, __ATOMIC_RELAXED);
+	} while (((seq & 1) != 0) || !__atomic_compare_exchange_n(&tref_seq, &seq, seq + 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	for (i = 0; i < TREF_WORDS; ++i) {
+		__atomic_store_n(&tref_pub[i], w[i], __ATOMIC_RELAXED);
+	}
+	/* even again: the new snapshot is complete */
+	__atomic_store_n(&tref_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_gps_snapshot(struct tref *ref) {
+	uint64_t w[TREF_WORDS];
+	uint32_t seq1, seq2;
+	int i;
+	
+	CHECK_NULL(ref);
+	do {
+		seq1 = __atomic_load_n(&tref_seq, __ATOMIC_ACQUIRE);
+		for (i = 0; i < TREF_WORDS; ++i) {
+			w[i] = __atomic_load_n(&tref_pub[i], __ATOMIC_RELAXED);
+		}
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n(&tref_seq, __ATOMIC_RELAXED);
+	} while (((seq1 & 1) != 0) || (seq1 != seq2)); /* being written, or torn read: retry */
+	
+	if (seq1 == 0) {
+		DEBUG_MSG("ERROR: NO TIME REFERENCE PUBLISHED\n");
+		return LGW_GPS_ERROR;
+	}
+	memcpy(ref, w, sizeof *ref);
+	return LGW_GPS_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_gps_calib_save(const char *path, const struct tref *ref, const struct tref_est_s *est, double temperature) {
+	uint8_t buff[CALIB_FILE_SIZE];
+	char tmp_path[256];
+	double sd;
+	int64_t t;
+	int32_t err_ppt;
+	uint32_t sd_ppt;
+	int16_t temp_c;
+	FILE *f;
+	int i;
+	
+	CHECK_NULL(path);
+	CHECK_NULL(ref);
+	
+	/* only save a clock error that was validated against several PPS */
+	if ((ref->systime == 0) || (ref->xtal_err > PLUS_10PPM) || (ref->xtal_err < MINUS_10PPM)) {
+		DEBUG_MSG("ERROR: NO VALID CLOCK ERROR TO SAVE\n");
+		return LGW_GPS_ERROR;
+	}
+	if (est != NULL) {
+		if (est->nb < CALIB_MIN_POINTS) {
+			DEBUG_MSG("ERROR: CLOCK ERROR ESTIMATED ON TOO FEW POINTS TO BE SAVED\n");
+			return LGW_GPS_ERROR;
+		}
+		sd = est->xtal_err_sd;
+	} else {
+		if (ref->aber != 0) {
+			return LGW_GPS_ERROR;
+		}
+		sd = CALIB_DEFAULT_SD;
+	}
+	if (!(sd <= CALIB_MAX_SD)) {
+		DEBUG_MSG("ERROR: CLOCK ERROR TOO UNCERTAIN TO BE SAVED\n");
+		return LGW_GPS_ERROR;
+	}
+	
+	/* magic, version, flags (bit 0: temperature known); save time, clock error and its uncertainty in 1E-12, temperature in 0.01 C, all little endian */
+	t = (int64_t)time(NULL);
+	err_ppt = (int32_t)lround((ref->xtal_err - 1.0) * 1E12);
+	sd_ppt = (uint32_t)lround(sd * 1E12);
+	temp_c = isnan(temperature) ? 0 : (int16_t)lround(fmax(-300.0, fmin(300.0, temperature)) * 100.0);
+	memcpy(buff, CALIB_FILE_MAGIC, 6);
+	buff[6] = CALIB_FILE_VERSION;
+	buff[7] = isnan(temperature) ? 0 : 1;
+	for (i = 0; i < 8; ++i) {
+		buff[8 + i] = (uint8_t)((uint64_t)t >> (8 * i));
+	}
+	for (i = 0; i < 4; ++i) {
+		buff[16 + i] = (uint8_t)((uint32_t)err_ppt >> (8 * i));
+		buff[20 + i] = (uint8_t)(sd_ppt >> (8 * i));
+	}
+	buff[24] = (uint8_t)(uint16_t)temp_c;
+	buff[25] = (uint8_t)((uint16_t)temp_c >> 8);
+	
+	/* write a temporary file and rename it, a shutdown during the write keeps the previous file */
+	if (snprintf(tmp_path, sizeof tmp_path, "%s.tmp", path) >= (int)sizeof tmp_path) {
+		DEBUG_MSG("ERROR: CALIBRATION FILE PATH TOO LONG\n");
+		return LGW_GPS_ERROR;
+	}
+	f = fopen(tmp_path, "wb");
+	if (f == NULL) {
+		DEBUG_MSG("ERROR: CANNOT OPEN CALIBRATION FILE %s\n", tmp_path);
+		return LGW_GPS_ERROR;
+	}
+	i = (fwrite(buff, sizeof buff, 1, f) == 1) ? 0 : -1;
+	i |= fclose(f);
+	if ((i != 0) || (rename(tmp_path, path) != 0)) {
+		DEBUG_MSG("ERROR: FAIL TO WRITE CALIBRATION FILE %s\n", path);
+		remove(tmp_path);
+		return LGW_GPS_ERROR;
+	}
+	return LGW_GPS_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_gps_calib_load(const char *path, double temperature, struct tref *ref, struct tref_est_s *est) {
+	uint8_t buff[CALIB_FILE_SIZE];
+	uint64_t t = 0;
+	double age_days, temp_diff, xtal_err, sd;
+	size_t n;
+	FILE *f;
+	int i;
+	
+	CHECK_NULL(path);
+	CHECK_NULL(ref);
+	
+	f = fopen(path, "rb");
+	if (f == NULL) {
+		DEBUG_MSG("Note: no calibration file %s\n", path);
 		return LGW_GPS_ERROR;
 	}
+	n = fread(buff, 1, sizeof buff, f);
+	fclose(f);
+	if ((n != sizeof buff) || (memcmp(buff, CALIB_FILE_MAGIC, 6) != 0) || (buff[6] != CALIB_FILE_VERSION)) {
+		DEBUG_MSG("ERROR: %s IS NOT A VALID CALIBRATION FILE\n", path);
+		return LGW_GPS_ERROR;
+	}
+	for (i = 7; i >= 0; --i) {
+		t = (t << 8) | buff[8 + i];
+	}
+	xtal_err = 1.0 + (1E-12 * (double)(int32_t)ubx_u32(&buff[16]));
+	sd = 1E-12 * (double)ubx_u32(&buff[20]);
 	
+	/* widen the uncertainty with the age of the calibration and the temperature change */
+	age_days = difftime(time(NULL), (time_t)(int64_t)t) / 86400.0;
+	if ((age_days < 0.0) || (age_days > CALIB_MAX_DAYS)) {
+		DEBUG_MSG("Warning: calibration file %s out of date\n", path);
+		return LGW_GPS_ERROR;
+	}
+	temp_diff = (((buff[7] & 0x01) != 0) && !isnan(temperature)) ? temperature - (0.01 * (double)(int16_t)ubx_u16(&buff[24])) : 0.0;
+	sd = fmax(CALIB_MIN_SD, sqrt((sd * sd) + (CALIB_AGING * age_days * CALIB_AGING * age_days) + (CALIB_TEMPCO * temp_diff * CALIB_TEMPCO * temp_diff)));
+	if ((xtal_err > PLUS_10PPM) || (xtal_err < MINUS_10PPM) || !(sd <= CALIB_MAX_SD)) {
+		DEBUG_MSG("Warning: calibration file %s not usable (clock error %.9f +/- %.3f ppm)\n", path, xtal_err, 1E6 * sd);
+		return LGW_GPS_ERROR;
+	}
+	
+	/* clock error known, UTC reference still needed: the first PPS will make it valid */
+	memset(ref, 0, sizeof *ref);
+	ref->xtal_err = xtal_err;
+	ref->aber = CALIB_LOADED;
+	if (est != NULL) {
+		memset(est, 0, sizeof *est);
+		est->prior_sd = sd;
+	}
+	DEBUG_MSG("Note: clock error %.9f +/- %.3f ppm loaded from %s (%.1f days old)\n", xtal_err, 1E6 * sd, path, age_days);
 	return LGW_GPS_SUCCESS;
 }
 
@@ -575,4 +1703,63 @@ int lgw_utc2cnt(struct tref ref, struct timespec utc, uint32_t *count_us) {
 	return LGW_GPS_SUCCESS;
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_cnt2utc_batch(const struct tref *ref, const uint32_t *count_us, size_t n, struct timespec *utc) {
+	struct tref_fix_s fix;
+	uint64_t d, ns;
+	size_t i;
+	
+	CHECK_NULL(ref);
+	if (tref_fix(ref, &fix) != LGW_GPS_SUCCESS) {
+		DEBUG_MSG("ERROR: INVALID REFERENCE FOR CNT -> UTC CONVERSION\n");
+		return LGW_GPS_ERROR;
+	}
+	if (n == 0) {
+		return LGW_GPS_SUCCESS;
+	}
+	CHECK_NULL(count_us);
+	CHECK_NULL(utc);
+	
+	/* counter delta since the reference (modulo 2^32, like the counter) converted to ns, then added to the reference UTC time */
+	for (i = 0; i < n; ++i) {
+		d = (uint64_t)(count_us[i] - fix.count_us);
+		ns = fix.utc_nsec + (d * fix.ns_int) + ((d * fix.ns_frac) >> 32);
+		utc[i].tv_sec = fix.utc_sec + (time_t)(ns / 1000000000);
+		utc[i].tv_nsec = (long)(ns % 1000000000);
+	}
+	
+	return LGW_GPS_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_utc2cnt_batch(const struct tref *ref, const struct timespec *utc, size_t n, uint32_t *count_us) {
+	struct tref_fix_s fix;
+	int64_t ds, dns;
+	uint64_t t;
+	size_t i;
+	
+	CHECK_NULL(ref);
+	if (tref_fix(ref, &fix) != LGW_GPS_SUCCESS) {
+		DEBUG_MSG("ERROR: INVALID REFERENCE FOR UTC -> CNT CONVERSION\n");
+		return LGW_GPS_ERROR;
+	}
+	if (n == 0) {
+		return LGW_GPS_SUCCESS;
+	}
+	CHECK_NULL(utc);
+	CHECK_NULL(count_us);
+	
+	/* UTC delta since the reference converted to counter ticks (Q24, modulo 2^64), rounded down and added to the reference counter */
+	for (i = 0; i < n; ++i) {
+		ds = (int64_t)(utc[i].tv_sec - fix.utc_sec);
+		dns = (int64_t)utc[i].tv_nsec - (int64_t)fix.utc_nsec;
+		t = ((uint64_t)ds * (uint64_t)fix.cps_q24) + (uint64_t)((dns * fix.cpns_q40) / 65536);
+		count_us[i] = fix.count_us + (uint32_t)(t >> 24);
+	}
+	
+	return LGW_GPS_SUCCESS;
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,305 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	GPS service thread.
+	Waits on the GPS tty with epoll, parses the data as it arrives, latches the
+	concentrator PPS counter as soon as a time message (RMC, ZDA, NAV-TIMEUTC)
+	is complete, feeds the drift estimator and publishes the new time reference
+	for lgw_gps_snapshot.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* CPU affinity is a Linux extension */
+#define _GNU_SOURCE
+
+/* loragw_gps.h sets _XOPEN_SOURCE, it must come before the first system header */
+#include "loragw_gps.h"
+#include "loragw_hal.h"
+
+#include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+#include <stdio.h>		/* fprintf */
+#include <string.h>		/* memset */
+#include <unistd.h>		/* read write close */
+#include <errno.h>		/* EINTR EAGAIN */
+#include <pthread.h>	/* pthread_create pthread_setaffinity_np */
+#include <sched.h>		/* SCHED_FIFO CPU_SET */
+#include <math.h>		/* NAN */
+#include <sys/epoll.h>	/* epoll */
+#include <sys/eventfd.h>	/* eventfd */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#if DEBUG_GPS == 1
+	#define DEBUG_MSG(args...)			fprintf(stderr, args)
+	#define CHECK_NULL(a)				if(a==NULL){fprintf(stderr,"%s:%d: ERROR: NULL POINTER AS ARGUMENT\n", __FUNCTION__, __LINE__);return LGW_GPS_ERROR;}
+#else
+	#define DEBUG_MSG(args...)
+	#define CHECK_NULL(a)				if(a==NULL){return LGW_GPS_ERROR;}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define READ_SIZE		256	/* max bytes read from the tty at once */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct gps_service_s {
+	bool			running;	/* thread started and not joined yet */
+	pthread_t		thread;
+	int				tty_fd;		/* GPS tty, owned by the caller */
+	int				stop_efd;	/* eventfd signalled to stop the thread */
+	int				epfd;
+	struct lgw_gps_service_conf_s conf;
+	struct tref_est_s est;		/* drift estimator, only used by the thread */
+	struct tref		ref;		/* latest reference, only used by the thread */
+	struct timespec	last_utc;	/* UTC time of the latest synchronization attempt */
+	pthread_mutex_t	mx_stat;	/* protects stat */
+	struct lgw_gps_service_stat_s stat;
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static struct gps_service_s svc = { .running = false, .tty_fd = -1, .stop_efd = -1, .epfd = -1, .mx_stat = PTHREAD_MUTEX_INITIALIZER };
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void setup_thread(void) {
+	struct sched_param param;
+	cpu_set_t cpus;
+
+	/* all real-time settings are best-effort, the service works without them */
+	if (svc.conf.cpu >= 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(svc.conf.cpu, &cpus);
+		if (pthread_setaffinity_np(pthread_self(), sizeof cpus, &cpus) != 0) {
+			DEBUG_MSG("WARNING: FAIL TO PIN GPS THREAD ON CPU %d\n", svc.conf.cpu);
+		}
+	}
+	if (svc.conf.rt_priority > 0) {
+		memset(&param, 0, sizeof param);
+		param.sched_priority = svc.conf.rt_priority;
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+			DEBUG_MSG("WARNING: FAIL TO SET SCHED_FIFO PRIORITY %d\n", svc.conf.rt_priority);
+		}
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* A time message was just completed: pair it with the PPS counter, refresh and publish the reference */
+static void service_sync(void) {
+	uint32_t cnt;
+	struct timespec utc;
+	bool accepted = false;
+
+	/* latch the counter first, as close as possible to the end of the message */
+	if (lgw_get_trigcnt(&cnt) != LGW_HAL_SUCCESS) {
+		DEBUG_MSG("WARNING: FAIL TO READ PPS COUNTER\n");
+		return;
+	}
+	if (lgw_gps_get(&utc, NULL, NULL) != LGW_GPS_SUCCESS) {
+		pthread_mutex_lock(&svc.mx_stat);
+		svc.stat.nb_reject += 1; /* no fix */
+		pthread_mutex_unlock(&svc.mx_stat);
+		return;
+	}
+	if ((utc.tv_sec == svc.last_utc.tv_sec) && (utc.tv_nsec == svc.last_utc.tv_nsec)) {
+		return; /* several time messages for the same epoch (eg. RMC and ZDA) */
+	}
+	svc.last_utc = utc;
+
+	/* only a validated fit is published: the first point of a fit leaves systime to 0 */
+	if ((lgw_gps_sync_est(&svc.est, &svc.ref, cnt, utc) == LGW_GPS_SUCCESS) && (svc.ref.systime != 0)) {
+		lgw_gps_publish(&svc.ref);
+		accepted = true;
+	}
+
+	pthread_mutex_lock(&svc.mx_stat);
+	if (accepted) {
+		svc.stat.nb_sync += 1;
+		svc.stat.xtal_err = svc.ref.xtal_err;
+		svc.stat.xtal_err_sd = svc.est.xtal_err_sd;
+		svc.stat.jitter_us = svc.est.jitter_us;
+	} else {
+		svc.stat.nb_reject += 1;
+	}
+	pthread_mutex_unlock(&svc.mx_stat);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* GPS thread: sleep until the tty has data, parse it message by message */
+static void *gps_thread(void *arg) {
+	struct epoll_event ev[2];
+	char buff[READ_SIZE];
+	enum gps_msg msg;
+	ssize_t nb;
+	int n, i, j, k;
+	bool stop = false;
+
+	(void)arg;
+	setup_thread();
+	while (!stop) {
+		n = epoll_wait(svc.epfd, ev, 2, -1);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			DEBUG_MSG("ERROR: EPOLL_WAIT FAILED\n");
+			break;
+		}
+		for (i = 0; i < n; ++i) {
+			if (ev[i].data.fd == svc.stop_efd) {
+				stop = true;
+				break;
+			}
+			nb = read(svc.tty_fd, buff, sizeof buff);
+			if (nb <= 0) {
+				if ((nb < 0) && ((errno == EINTR) || (errno == EAGAIN))) {
+					continue;
+				}
+				DEBUG_MSG("ERROR: GPS TTY CLOSED\n");
+				stop = true;
+				break;
+			}
+			for (j = 0; j < nb; j += k) {
+				k = lgw_gps_feed(buff + j, (int)nb - j, &msg);
+				if ((msg == NMEA_RMC) || (msg == NMEA_ZDA) || (msg == UBX_TIME)) {
+					pthread_mutex_lock(&svc.mx_stat);
+					svc.stat.nb_msg += 1;
+					pthread_mutex_unlock(&svc.mx_stat);
+					service_sync();
+				}
+			}
+		}
+	}
+
+	pthread_mutex_lock(&svc.mx_stat);
+	svc.stat.running = false;
+	pthread_mutex_unlock(&svc.mx_stat);
+	return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int lgw_gps_service_start(int fd, const struct lgw_gps_service_conf_s *conf) {
+	struct epoll_event ev;
+
+	if (svc.running) {
+		DEBUG_MSG("ERROR: GPS SERVICE ALREADY RUNNING\n");
+		return LGW_GPS_ERROR;
+	}
+	if (fd < 0) {
+		return LGW_GPS_ERROR;
+	}
+
+	svc.tty_fd = fd;
+	if (conf != NULL) {
+		svc.conf = *conf;
+	} else {
+		svc.conf.cpu = -1;
+		svc.conf.rt_priority = 0;
+		svc.conf.calib_path = NULL;
+		svc.conf.temperature = NAN;
+	}
+	memset(&svc.est, 0, sizeof svc.est);
+	memset(&svc.ref, 0, sizeof svc.ref);
+	if ((svc.conf.calib_path != NULL) && (lgw_gps_calib_load(svc.conf.calib_path, svc.conf.temperature, &svc.ref, &svc.est) != LGW_GPS_SUCCESS)) {
+		DEBUG_MSG("Note: no usable clock calibration, full synchronization needed\n");
+	}
+	memset(&svc.last_utc, 0, sizeof svc.last_utc);
+	memset(&svc.stat, 0, sizeof svc.stat);
+	svc.stat.running = true;
+
+	svc.stop_efd = eventfd(0, EFD_CLOEXEC);
+	svc.epfd = epoll_create1(EPOLL_CLOEXEC);
+	if ((svc.stop_efd < 0) || (svc.epfd < 0)) {
+		DEBUG_MSG("ERROR: FAIL TO CREATE EVENTFD/EPOLL\n");
+		goto fail;
+	}
+	memset(&ev, 0, sizeof ev);
+	ev.events = EPOLLIN;
+	ev.data.fd = svc.stop_efd;
+	if (epoll_ctl(svc.epfd, EPOLL_CTL_ADD, svc.stop_efd, &ev) != 0) {
+		goto fail;
+	}
+	ev.data.fd = fd;
+	if (epoll_ctl(svc.epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+		DEBUG_MSG("ERROR: GPS TTY CANNOT BE WAITED ON\n");
+		goto fail;
+	}
+	if (pthread_create(&svc.thread, NULL, gps_thread, NULL) != 0) {
+		DEBUG_MSG("ERROR: FAIL TO CREATE GPS THREAD\n");
+		goto fail;
+	}
+	svc.running = true;
+	return LGW_GPS_SUCCESS;
+
+fail:
+	if (svc.epfd >= 0) {
+		close(svc.epfd);
+	}
+	if (svc.stop_efd >= 0) {
+		close(svc.stop_efd);
+	}
+	svc.epfd = -1;
+	svc.stop_efd = -1;
+	svc.stat.running = false;
+	return LGW_GPS_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_gps_service_stop(void) {
+	uint64_t one = 1;
+
+	if (!svc.running) {
+		return LGW_GPS_ERROR;
+	}
+	if (write(svc.stop_efd, &one, sizeof one) != sizeof one) {
+		DEBUG_MSG("ERROR: FAIL TO SIGNAL GPS THREAD\n");
+		return LGW_GPS_ERROR;
+	}
+	pthread_join(svc.thread, NULL);
+	if ((svc.conf.calib_path != NULL) && (lgw_gps_calib_save(svc.conf.calib_path, &svc.ref, &svc.est, svc.conf.temperature) != LGW_GPS_SUCCESS)) {
+		DEBUG_MSG("WARNING: CLOCK CALIBRATION NOT SAVED\n");
+	}
+	close(svc.epfd);
+	close(svc.stop_efd);
+	svc.epfd = -1;
+	svc.stop_efd = -1;
+	svc.tty_fd = -1;
+	svc.running = false;
+	return LGW_GPS_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_gps_service_stat(struct lgw_gps_service_stat_s *stat) {
+	CHECK_NULL(stat);
+	pthread_mutex_lock(&svc.mx_stat);
+	*stat = svc.stat;
+	pthread_mutex_unlock(&svc.mx_stat);
+	return LGW_GPS_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -17,12 +17,23 @@ Maintainer: Sylvain Miermont
 /* -------------------------------------------------------------------------- */
 /* --- DEPENDANCIES --------------------------------------------------------- */
 
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+	#define _XOPEN_SOURCE 600
+#else
+	#define _XOPEN_SOURCE 500
+#endif
+
 #include <stdint.h>		/* C99 types */
 #include <stdbool.h>	/* bool type */
 #include <stdio.h>		/* printf fprintf */
 #include <string.h>		/* memcpy */
+#include <stdlib.h>		/* malloc free */
+#include <pthread.h>	/* mutex */
+#include <time.h>		/* clock_gettime */
 
 #include "loragw_reg.h"
+#include "loragw_reg_inline.h"
 #include "loragw_hal.h"
 #include "loragw_aux.h"
 
@@ -54,21 +65,33 @@ Maintainer: Sylvain Miermont
 
 #define		MCU_ARB_FW_BYTE		8192 /* size of the firmware IN BYTES (= twice the number of 14b words) */
 #define		MCU_AGC_FW_BYTE		8192 /* size of the firmware IN BYTES (= twice the number of 14b words) */
+#define		MCU_NB				2
+
+#define		FW_SAMPLE_NB		16	/* windows of the program RAM read back to check a resident firmware */
+#define		FW_SAMPLE_SIZE		32	/* size of each window, in bytes */
 
 #define		TX_METADATA_NB		16
 #define		RX_METADATA_NB		16
 
 #define		AGC_CMD_WAIT		16
 #define		AGC_CMD_ABORT		17
+#define		AGC_CMD_SETTLE_US	100	/* time for the AGC firmware to see a WAIT command before the value (value checked by status poll) */
+#define		AGC_CMD_NOACK_US	1000	/* same, around a command without status (timing of the reference HAL) */
+#define		AGC_STATUS_POLL_US	10	/* interval between two AGC status polls */
+#define		AGC_STATUS_POLL_NB	100	/* max polls of the AGC status after a command (1 ms) */
 
 #define		MIN_LORA_PREAMBLE		4
 #define		STD_LORA_PREAMBLE		6
 #define		MIN_FSK_PREAMBLE		3
 #define		STD_FSK_PREAMBLE		5
 #define		PLL_LOCK_MAX_ATTEMPTS	5
+#define		PLL_LOCK_POLL_US		100	/* interval between two PLL lock status polls */
+#define		PLL_LOCK_POLL_NB		10	/* polls per PLL start attempt (1 ms) */
 
 #define		TX_START_DELAY		1500
 
+#define		TS_ANCHOR_MAX_AGE	60	/* s, max age of the live counter read the 64-bit timeline is predicted from when scheduling a TX */
+
 /*
 SX1257 frequency setting :
 F_register(24bit) = F_rf (Hz) / F_step(Hz)
@@ -130,24 +153,28 @@ F_register(24bit) = F_rf (Hz) / F_step(Hz)
 
 const uint8_t ifmod_config[LGW_IF_CHAIN_NB] = LGW_IFMODEM_CONFIG;
 
-uint32_t rf_rx_lowfreq[LGW_RF_CHAIN_NB] = LGW_RF_RX_LOWFREQ;
-uint32_t rf_rx_upfreq[LGW_RF_CHAIN_NB] = LGW_RF_RX_UPFREQ;
 uint32_t rf_rx_bandwidth[LGW_RF_CHAIN_NB] = LGW_RF_RX_BANDWIDTH;
-uint32_t rf_tx_lowfreq[LGW_RF_CHAIN_NB] = LGW_RF_TX_LOWFREQ;
-uint32_t rf_tx_upfreq[LGW_RF_CHAIN_NB] = LGW_RF_TX_UPFREQ;
 bool rf_tx_enable[LGW_RF_CHAIN_NB] = LGW_RF_TX_ENABLE;
-bool rf_clkout[LGW_RF_CHAIN_NB] = LGW_RF_CLKOUT;
-lgw_id_t rf_radio_chip_id[LGW_RF_CHAIN_NB] = { 0 };
+
 /* TX power management */
 
-#define	TX_POW_LUT_SIZE	16
+#define	TX_POW_LUT_SIZE	LGW_TX_GAIN_LUT_SIZE
+
+typedef struct lgw_tx_gain_s tx_pow_t; /* PA, DAC and mixer gains, measured TX power */
 
-typedef struct {
-	uint8_t	pa_gain;	/* 2 bits, control of the external PA (SX1301 I/O) */
-	uint8_t	dac_gain;	/* 2 bits, control of the radio DAC */
-	uint8_t	mix_gain;	/* 4 bits, control of the radio mixer */
-	int8_t	rf_power;	/* measured TX power at the board connector, in dBm */
-} tx_pow_t;
+/* TX settings of a requested power, resolved when the table or the calibration changes */
+#define	TX_POW_MAP_MIN	-10	/* lowest power with a direct lookup, in dBm */
+#define	TX_POW_MAP_MAX	30	/* highest power with a direct lookup, in dBm */
+#define	TX_POW_MAP_NB	(TX_POW_MAP_MAX - TX_POW_MAP_MIN + 1)
+
+struct tx_pow_map_s {
+	uint8_t	pow_index;					/* 4-bit value to set the firmware TX power */
+	int8_t	offset_i[LGW_RF_CHAIN_NB];	/* TX I/Q imbalance correction of each radio */
+	int8_t	offset_q[LGW_RF_CHAIN_NB];
+};
+
+#define	TXGAIN_FILE_MAGIC	"LGWTXG"
+#define	TXGAIN_FILE_VERSION	1
 
 /* Default table (TX power associated to each value is board-dependant)
 	+-------+------+------+------+------+
@@ -305,6 +332,8 @@ typedef struct {
 	#define		CFG_SPI_STR		"native"
 #elif (CFG_SPI_FTDI == 1)
 	#define		CFG_SPI_STR		"ftdi"
+#elif (CFG_SPI_REPLAY == 1)
+	#define		CFG_SPI_STR		"replay"
 #else
 	#define		CFG_SPI_STR		"spi?"
 #endif
@@ -383,58 +412,201 @@ const char lgw_version_string[] = "Version: " LIBLORAGW_VERSION "; Options: " CF
 #include "cal_fw.var" /* external definition of the variable */
 
 /*
-The following static variables are the configuration set that the user can
-modify using rxrf_setconf and rxif_setconf functions.
+A context holds everything related to one concentrator: the link (SPI target,
+page cache, bus lock), the configuration set that the user can modify using
+rxrf_setconf and rxif_setconf functions, and the state of the hardware.
 The function _start then use that set to configure the hardware.
 
 Parameters validity and coherency is verified by the _setconf functions and
 the _start function assumes
 */
 
-static bool lgw_is_started;
+struct lgw_ctx_s {
+	struct lgw_reg_ctx_s *reg; /* points to reg_own, or to the register layer default context */
+	struct lgw_reg_ctx_s reg_own;
+
+	bool is_started;
+
+	/* RF limits, default from board config, updated by radio auto-detection */
+	uint32_t rf_rx_lowfreq[LGW_RF_CHAIN_NB];
+	uint32_t rf_rx_upfreq[LGW_RF_CHAIN_NB];
+	uint32_t rf_tx_lowfreq[LGW_RF_CHAIN_NB];
+	uint32_t rf_tx_upfreq[LGW_RF_CHAIN_NB];
+	bool rf_clkout[LGW_RF_CHAIN_NB];
+	lgw_id_t rf_radio_chip_id[LGW_RF_CHAIN_NB];
+
+	bool rf_enable[LGW_RF_CHAIN_NB];
+	uint32_t rf_rx_freq[LGW_RF_CHAIN_NB]; /* absolute, in Hz */
+
+	bool if_enable[LGW_IF_CHAIN_NB];
+	bool if_rf_chain[LGW_IF_CHAIN_NB]; /* for each IF, 0 -> radio A, 1 -> radio B */
+	int32_t if_freq[LGW_IF_CHAIN_NB]; /* relative to radio frequency, +/- in Hz */
+
+	uint8_t lora_multi_sfmask[LGW_MULTI_NB]; /* enables SF for LoRa 'multi' modems */
 
-static bool rf_enable[LGW_RF_CHAIN_NB];
-static uint32_t rf_rx_freq[LGW_RF_CHAIN_NB]; /* absolute, in Hz */
+	uint8_t lora_rx_bw; /* bandwidth setting for LoRa standalone modem */
+	uint8_t lora_rx_sf; /* spreading factor setting for LoRa standalone modem */
+	bool lora_rx_ppm_offset;
 
-static bool if_enable[LGW_IF_CHAIN_NB];
-static bool if_rf_chain[LGW_IF_CHAIN_NB]; /* for each IF, 0 -> radio A, 1 -> radio B */
-static int32_t if_freq[LGW_IF_CHAIN_NB]; /* relative to radio frequency, +/- in Hz */
+	uint8_t fsk_rx_bw; /* bandwidth setting of FSK modem */
+	uint32_t fsk_rx_dr; /* FSK modem datarate in bauds */
 
-static uint8_t lora_multi_sfmask[LGW_MULTI_NB]; /* enables SF for LoRa 'multi' modems */
+	/* TX I/Q imbalance coefficients for mixer gain = 8 to 15 */
+	int8_t cal_offset_a_i[8]; /* TX I offset for radio A */
+	int8_t cal_offset_a_q[8]; /* TX Q offset for radio A */
+	int8_t cal_offset_b_i[8]; /* TX I offset for radio B */
+	int8_t cal_offset_b_q[8]; /* TX Q offset for radio B */
 
-static uint8_t lora_rx_bw; /* bandwidth setting for LoRa standalone modem */
-static uint8_t lora_rx_sf; /* spreading factor setting for LoRa standalone modem */
-static bool lora_rx_ppm_offset;
+	/* TX gain table, board table unless set by lgw_txgain_setconf (then points to tx_lut_own) */
+	const tx_pow_t *tx_lut;
+	tx_pow_t tx_lut_own[TX_POW_LUT_SIZE];
+	bool tx_lut_custom; /* table must be loaded in the AGC firmware */
+	uint8_t agc_radio_select; /* value given to the AGC firmware at the end of its initialization */
+	struct tx_pow_map_s tx_pow_map[TX_POW_MAP_NB]; /* TX settings for TX_POW_MAP_MIN to TX_POW_MAP_MAX dBm */
 
-static uint8_t fsk_rx_bw; /* bandwidth setting of FSK modem */
-static uint32_t fsk_rx_dr; /* FSK modem datarate in bauds */
+	/* firmware loading options, and hash of the firmware last loaded in each MCU (0 if unknown) */
+	struct lgw_conf_fw_s fw_conf;
+	uint32_t fw_resident[MCU_NB];
 
-/* TX I/Q imbalance coefficients for mixer gain = 8 to 15 */
-static int8_t cal_offset_a_i[8]; /* TX I offset for radio A */
-static int8_t cal_offset_a_q[8]; /* TX Q offset for radio A */
-static int8_t cal_offset_b_i[8]; /* TX I offset for radio B */
-static int8_t cal_offset_b_q[8]; /* TX Q offset for radio B */
+	/*
+	64-bit extension of the concentrator counter: extended value of the latest
+	live counter read, and host monotonic time of that read. Any counter value
+	is extended to the value with the same 32 LSBs closest to the counter
+	predicted from host time, so wraps need no observation.
+	*/
+	pthread_mutex_t mx_ts;
+	bool ts_valid;
+	uint64_t ts_ext;
+	struct timespec ts_host;
+
+	/*
+	TIMESTAMP gives the PPS capture only while GPS_EN is set: the live counter
+	read (GPS_EN cleared, TIMESTAMP read, GPS_EN set) and the PPS capture read
+	are serialized, so that a capture read never returns the live counter.
+	*/
+	pthread_mutex_t mx_pps;
+
+	/*
+	Direction locks, so that one thread can fetch packets while another one is
+	programming a TX. Each one covers the multi-register sequence of its path
+	(FIFO fetch + FIFO advance for RX, offsets + buffer + trigger for TX).
+	Start and stop take both, always in the order RX then TX, and the bus mutex
+	of the register layer is always the innermost lock.
+	*/
+	pthread_mutex_t mx_rx;
+	pthread_mutex_t mx_tx;
+};
+
+#define CTX_DEFAULTS \
+	.rf_rx_lowfreq = LGW_RF_RX_LOWFREQ, \
+	.rf_rx_upfreq = LGW_RF_RX_UPFREQ, \
+	.rf_tx_lowfreq = LGW_RF_TX_LOWFREQ, \
+	.rf_tx_upfreq = LGW_RF_TX_UPFREQ, \
+	.rf_clkout = LGW_RF_CLKOUT, \
+	.tx_lut = tx_pow_table, \
+	.tx_lut_custom = (CUSTOM_TX_POW_TABLE == 1), \
+	.mx_ts = PTHREAD_MUTEX_INITIALIZER, \
+	.mx_pps = PTHREAD_MUTEX_INITIALIZER, \
+	.mx_rx = PTHREAD_MUTEX_INITIALIZER, \
+	.mx_tx = PTHREAD_MUTEX_INITIALIZER
+
+/* template for the contexts allocated by lgw_ctx_create */
+static const struct lgw_ctx_s ctx_template = { CTX_DEFAULTS };
+
+/* context used by all the functions without _ctx suffix, shares the link with
+the register layer functions without _ctx suffix */
+static struct lgw_ctx_s ctx_default = { .reg = &lgw_reg_ctx_default, CTX_DEFAULTS };
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
 
-int load_firmware(uint8_t target, uint8_t *firmware, uint16_t size);
+int load_firmware(struct lgw_ctx_s *ctx, uint8_t target, uint8_t *firmware, uint16_t size);
+
+void sx125x_write(struct lgw_ctx_s *ctx, uint8_t channel, uint8_t addr, uint8_t data);
+
+uint8_t sx125x_read(struct lgw_ctx_s *ctx, uint8_t channel, uint8_t addr);
+
+int setup_sx125x(struct lgw_ctx_s *ctx, const bool setup[LGW_RF_CHAIN_NB]);
+
+void lgw_constant_adjust(struct lgw_ctx_s *ctx);
+
+int agc_init(struct lgw_ctx_s *ctx);
+
+void tx_pow_resolve(const struct lgw_ctx_s *ctx, int8_t rf_power, struct tx_pow_map_s *map);
 
-void sx125x_write(uint8_t channel, uint8_t addr, uint8_t data);
+void tx_pow_map_build(struct lgw_ctx_s *ctx);
 
-uint8_t sx125x_read(uint8_t channel, uint8_t addr);
+uint64_t ts_extend(struct lgw_ctx_s *ctx, uint32_t count_us);
 
-int setup_sx125x(uint8_t rf_chain, uint32_t freq_hz);
+void ts_anchor(struct lgw_ctx_s *ctx, uint32_t count_us, bool restart);
 
-void lgw_constant_adjust(void);
+int read_instcnt(struct lgw_ctx_s *ctx, uint32_t *count_us);
+
+int start_concentrator(struct lgw_ctx_s *ctx);
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
+/* check a TX gain table against the AGC firmware format */
+static int txgain_check(const struct lgw_tx_gain_lut_s *conf) {
+	int i;
+
+	for (i = 0; i < TX_POW_LUT_SIZE; ++i) {
+		if ((conf->lut[i].pa_gain > 3) || (conf->lut[i].dac_gain > 3) || (conf->lut[i].mix_gain > 15)) {
+			DEBUG_PRINTF("ERROR: TX GAIN %d OUT OF RANGE\n", i);
+			return -1;
+		}
+		if ((i > 0) && (conf->lut[i].rf_power < conf->lut[i-1].rf_power)) {
+			DEBUG_PRINTF("ERROR: TX GAIN %d, RF POWER LOWER THAN PREVIOUS ONE\n", i);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* FNV-1a hash of a firmware image */
+static uint32_t fw_hash(const uint8_t *firmware, uint16_t size) {
+	uint32_t h = 2166136261u;
+	uint16_t i;
+
+	for (i = 0; i < size; ++i) {
+		h = (h ^ firmware[i]) * 16777619u;
+	}
+	return (h != 0) ? h : 1; /* 0 means unknown */
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* read back windows spread over the program RAM of an MCU (in reset, RAM muxed to the host), true if they match firmware */
+static bool fw_sample_match(struct lgw_ctx_s *ctx, const uint8_t *firmware, uint16_t size) {
+	uint8_t buff[FW_SAMPLE_SIZE];
+	int32_t dummy;
+	uint16_t offset;
+	int i;
+
+	for (i = 0; i < FW_SAMPLE_NB; ++i) {
+		offset = (uint16_t)(((uint32_t)i * (size - FW_SAMPLE_SIZE)) / (FW_SAMPLE_NB - 1));
+		lgw_reg_w_ctx(ctx->reg, LGW_MCU_PROM_ADDR, offset);
+		lgw_reg_r_ctx(ctx->reg, LGW_MCU_PROM_DATA, &dummy); /* first read after an address change is not valid */
+		if ((lgw_reg_rb_ctx(ctx->reg, LGW_MCU_PROM_DATA, buff, FW_SAMPLE_SIZE) != LGW_REG_SUCCESS) || (memcmp(buff, firmware + offset, FW_SAMPLE_SIZE) != 0)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 /* size is the firmware size in bytes (not 14b words) */
-int load_firmware(uint8_t target, uint8_t *firmware, uint16_t size) {
+int load_firmware(struct lgw_ctx_s *ctx, uint8_t target, uint8_t *firmware, uint16_t size) {
 	int reg_rst;
 	int reg_sel;
+	uint32_t hash;
+	uint8_t *fw_check;
+	int32_t dummy;
+	int cmp;
 
 	/* check parameters */
 	CHECK_NULL(firmware);
@@ -456,27 +628,57 @@ int load_firmware(uint8_t target, uint8_t *firmware, uint16_t size) {
 		DEBUG_MSG("ERROR: NOT A VALID TARGET FOR LOADING FIRMWARE\n");
 		return -1;
 	}
+	hash = fw_hash(firmware, size);
 
 	/* reset the targeted MCU */
-	lgw_reg_w(reg_rst, 1);
+	lgw_reg_w_ctx(ctx->reg, reg_rst, 1);
 
-	/* set mux to access MCU program RAM and set address to 0 */
-	lgw_reg_w(reg_sel, 0);
-	lgw_reg_w(LGW_MCU_PROM_ADDR, 0);
+	/* set mux to access MCU program RAM */
+	lgw_reg_w_ctx(ctx->reg, reg_sel, 0);
 
-	/* write the program in one burst */
-	lgw_reg_wb(LGW_MCU_PROM_DATA, firmware, size);
+	/* keep the program if this context loaded it and the RAM still holds it (no power cycle) */
+	if (ctx->fw_conf.skip_resident && (ctx->fw_resident[target] == hash) && fw_sample_match(ctx, firmware, size)) {
+		lgw_reg_w_ctx(ctx->reg, reg_sel, 1);
+		DEBUG_PRINTF("Note: MCU %d firmware already resident, not reloaded\n", target);
+		return 0;
+	}
+	ctx->fw_resident[target] = 0;
+
+	/* write the program in one burst, from address 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_MCU_PROM_ADDR, 0);
+	lgw_reg_wb_ctx(ctx->reg, LGW_MCU_PROM_DATA, firmware, size);
+
+	/* read back the whole program to catch SPI corruption */
+	if (ctx->fw_conf.verify) {
+		fw_check = malloc(size);
+		if (fw_check == NULL) {
+			lgw_reg_w_ctx(ctx->reg, reg_sel, 1);
+			DEBUG_MSG("ERROR: FAILED TO ALLOCATE FIRMWARE CHECK BUFFER\n");
+			return -1;
+		}
+		lgw_reg_w_ctx(ctx->reg, LGW_MCU_PROM_ADDR, 0);
+		lgw_reg_r_ctx(ctx->reg, LGW_MCU_PROM_DATA, &dummy); /* first read after an address change is not valid */
+		lgw_reg_rb_ctx(ctx->reg, LGW_MCU_PROM_DATA, fw_check, size);
+		cmp = memcmp(firmware, fw_check, size);
+		free(fw_check);
+		if (cmp != 0) {
+			lgw_reg_w_ctx(ctx->reg, reg_sel, 1);
+			DEBUG_PRINTF("ERROR: MCU %d FIRMWARE READ BACK DIFFERS FROM LOADED FIRMWARE\n", target);
+			return -1;
+		}
+	}
 
 	/* give back control of the MCU program ram to the MCU */
-	lgw_reg_w(reg_sel, 1);
+	lgw_reg_w_ctx(ctx->reg, reg_sel, 1);
+	ctx->fw_resident[target] = hash;
 
 	return 0;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-void sx125x_write(uint8_t channel, uint8_t addr, uint8_t data) {
-	int reg_add, reg_dat, reg_cs;
+void sx125x_write(struct lgw_ctx_s *ctx, uint8_t channel, uint8_t addr, uint8_t data) {
+	struct lgw_reg_radio_op_s op = {channel, addr, data, false};
 
 	/* checking input parameters */
 	if (channel >= LGW_RF_CHAIN_NB) {
@@ -488,40 +690,16 @@ void sx125x_write(uint8_t channel, uint8_t addr, uint8_t data) {
 		return;
 	}
 
-	/* selecting the target radio */
-	switch (channel) {
-		case 0:
-			reg_add = LGW_SPI_RADIO_A__ADDR;
-			reg_dat = LGW_SPI_RADIO_A__DATA;
-			reg_cs	= LGW_SPI_RADIO_A__CS;
-			break;
-
-		case 1:
-			reg_add = LGW_SPI_RADIO_B__ADDR;
-			reg_dat = LGW_SPI_RADIO_B__DATA;
-			reg_cs	= LGW_SPI_RADIO_B__CS;
-			break;
-
-		default:
-			DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d IN SWITCH STATEMENT\n", channel);
-			return;
-	}
-
-	/* SPI master data write procedure */
-	lgw_reg_w(reg_cs, 0);
-	lgw_reg_w(reg_add, 0x80 | addr); /* MSB at 1 for write operation */
-	lgw_reg_w(reg_dat, data);
-	lgw_reg_w(reg_cs, 1);
-	lgw_reg_w(reg_cs, 0);
+	/* SPI master data write procedure, as a single SPI batch */
+	lgw_reg_radio_batch_ctx(ctx->reg, &op, 1);
 
 	return;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-uint8_t sx125x_read(uint8_t channel, uint8_t addr) {
-	int reg_add, reg_dat, reg_cs, reg_rb;
-	int32_t read_value;
+uint8_t sx125x_read(struct lgw_ctx_s *ctx, uint8_t channel, uint8_t addr) {
+	struct lgw_reg_radio_op_s op = {channel, addr, 0, true};
 
 	/* checking input parameters */
 	if (channel >= LGW_RF_CHAIN_NB) {
@@ -533,103 +711,85 @@ uint8_t sx125x_read(uint8_t channel, uint8_t addr) {
 		return 0;
 	}
 
-	/* selecting the target radio */
-	switch (channel) {
-		case 0:
-			reg_add = LGW_SPI_RADIO_A__ADDR;
-			reg_dat = LGW_SPI_RADIO_A__DATA;
-			reg_cs	= LGW_SPI_RADIO_A__CS;
-			reg_rb	= LGW_SPI_RADIO_A__DATA_READBACK;
-			break;
+	/* SPI master data read procedure, as a single SPI batch */
+	lgw_reg_radio_batch_ctx(ctx->reg, &op, 1);
 
-		case 1:
-			reg_add = LGW_SPI_RADIO_B__ADDR;
-			reg_dat = LGW_SPI_RADIO_B__DATA;
-			reg_cs	= LGW_SPI_RADIO_B__CS;
-			reg_rb	= LGW_SPI_RADIO_B__DATA_READBACK;
-			break;
-
-		default:
-			DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d IN SWITCH STATEMENT\n", channel);
-			return 0;
-	}
+	return op.data;
+}
 
-	/* SPI master data read procedure */
-	lgw_reg_w(reg_cs, 0);
-	lgw_reg_w(reg_add, addr); /* MSB at 0 for read operation */
-	lgw_reg_w(reg_dat, 0);
-	lgw_reg_w(reg_cs, 1);
-	lgw_reg_w(reg_cs, 0);
-	lgw_reg_r(reg_rb, &read_value);
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-	return (uint8_t)read_value;
+/* append a radio register write to a batch, returns the new size of the batch */
+static int sx125x_batch_w(struct lgw_reg_radio_op_s *ops, int nb, uint8_t channel, uint8_t addr, uint8_t data) {
+	ops[nb].radio = channel;
+	ops[nb].addr = addr;
+	ops[nb].data = data;
+	ops[nb].read = false;
+	return nb + 1;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int setup_sx125x(uint8_t rf_chain, uint32_t freq_hz) {
+/* append the setup of a radio (general setup, gains and RX PLL frequency) to a batch */
+static int sx125x_setup_ops(struct lgw_ctx_s *ctx, uint8_t rf_chain, uint32_t freq_hz, struct lgw_reg_radio_op_s *ops, int *nb) {
 	uint32_t part_int;
 	uint32_t part_frac;
-	int cpt_attempts = 0;
-
-	if (rf_chain >= LGW_RF_CHAIN_NB) {
-		DEBUG_MSG("ERROR: INVALID RF_CHAIN\n");
-		return -1;
-	}
+	int nb_ops = *nb;
 
 	/* Get version to identify SX1255/57 silicon revision */
-	DEBUG_PRINTF("Note: SX125x #%d version register returned 0x%02x\n", rf_chain, sx125x_read(rf_chain, 0x07));
+	DEBUG_PRINTF("Note: SX125x #%d version register returned 0x%02x\n", rf_chain, sx125x_read(ctx, rf_chain, 0x07));
 
 	/* General radio setup */
-	if (rf_clkout[rf_chain] == true) {
-		sx125x_write(rf_chain, 0x10, SX125x_TX_DAC_CLK_SEL + 2);
+	if (ctx->rf_clkout[rf_chain] == true) {
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x10, SX125x_TX_DAC_CLK_SEL + 2);
 		DEBUG_PRINTF("Note: SX125x #%d clock output enabled\n", rf_chain);
 	} else {
-		sx125x_write(rf_chain, 0x10, SX125x_TX_DAC_CLK_SEL);
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x10, SX125x_TX_DAC_CLK_SEL);
 		DEBUG_PRINTF("Note: SX125x #%d clock output disabled\n", rf_chain);
 	}
 
 #if (CFG_RADIO_AUTO == 1)
-	if(rf_radio_chip_id[rf_chain] == ID_SX1255){
+	if(ctx->rf_radio_chip_id[rf_chain] == ID_SX1255){
 		DEBUG_PRINTF("CHAIN %c SX1255\n", (rf_chain == 0? 'A' :'B'));
-		sx125x_write(rf_chain, 0x28, SX125x_XOSC_GM_STARTUP + SX125x_XOSC_DISABLE*16);
-	}else if(rf_radio_chip_id[rf_chain] == ID_SX1257){
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x28, SX125x_XOSC_GM_STARTUP + SX125x_XOSC_DISABLE*16);
+	}else if(ctx->rf_radio_chip_id[rf_chain] == ID_SX1257){
 		DEBUG_PRINTF("CHAIN %c SX1257\n", (rf_chain == 0? 'A' :'B'));
-		sx125x_write(rf_chain, 0x26, SX125x_XOSC_GM_STARTUP + SX125x_XOSC_DISABLE*16);
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x26, SX125x_XOSC_GM_STARTUP + SX125x_XOSC_DISABLE*16);
 	}else{
 		DEBUG_PRINTF("CHAIN %c UNKNOWN\n", (rf_chain == 0? 'A' :'B'));
 	}
 #else
 	#if (CFG_RADIO_1257 == 1)
-	sx125x_write(rf_chain, 0x26, SX125x_XOSC_GM_STARTUP + SX125x_XOSC_DISABLE*16);
+	nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x26, SX125x_XOSC_GM_STARTUP + SX125x_XOSC_DISABLE*16);
 	#elif (CFG_RADIO_1255 == 1)
-	sx125x_write(rf_chain, 0x28, SX125x_XOSC_GM_STARTUP + SX125x_XOSC_DISABLE*16);
+	nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x28, SX125x_XOSC_GM_STARTUP + SX125x_XOSC_DISABLE*16);
 	#endif
 #endif
 
-	if (rf_enable[rf_chain] == true) {
+	if (ctx->rf_enable[rf_chain] == true) {
 		/* Tx gain and trim */
-		sx125x_write(rf_chain, 0x08, SX125x_TX_MIX_GAIN + SX125x_TX_DAC_GAIN*16);
-		sx125x_write(rf_chain, 0x0A, SX125x_TX_ANA_BW + SX125x_TX_PLL_BW*32);
-		sx125x_write(rf_chain, 0x0B, SX125x_TX_DAC_BW);
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x08, SX125x_TX_MIX_GAIN + SX125x_TX_DAC_GAIN*16);
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x0A, SX125x_TX_ANA_BW + SX125x_TX_PLL_BW*32);
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x0B, SX125x_TX_DAC_BW);
 
 		/* Rx gain and trim */
-		sx125x_write(rf_chain, 0x0C, SX125x_LNA_ZIN + SX125x_RX_BB_GAIN*2 + SX125x_RX_LNA_GAIN*32);
-		sx125x_write(rf_chain, 0x0D, SX125x_RX_BB_BW + SX125x_RX_ADC_TRIM*4 + SX125x_RX_ADC_BW*32);
-		sx125x_write(rf_chain, 0x0E, SX125x_ADC_TEMP + SX125x_RX_PLL_BW*2);
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x0C, SX125x_LNA_ZIN + SX125x_RX_BB_GAIN*2 + SX125x_RX_LNA_GAIN*32);
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x0D, SX125x_RX_BB_BW + SX125x_RX_ADC_TRIM*4 + SX125x_RX_ADC_BW*32);
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x0E, SX125x_ADC_TEMP + SX125x_RX_PLL_BW*2);
 
 		/* set RX PLL frequency */
 #if (CFG_RADIO_AUTO == 1)
-		if(rf_radio_chip_id[rf_chain] == ID_SX1255){
+		if(ctx->rf_radio_chip_id[rf_chain] == ID_SX1255){
 			DEBUG_PRINTF("CHAIN %c SX1255\n", (rf_chain == 0? 'A' :'B'));
 			part_int = freq_hz / (SX125x_32MHz_FRAC << 7); /* integer part, gives the MSB */
 			part_frac = ((freq_hz % (SX125x_32MHz_FRAC << 7)) << 9) / SX125x_32MHz_FRAC; /* fractional part, gives middle part and LSB */
-		}else if(rf_radio_chip_id[rf_chain] == ID_SX1257){
+		}else if(ctx->rf_radio_chip_id[rf_chain] == ID_SX1257){
 			DEBUG_PRINTF("CHAIN %c SX1257\n", (rf_chain == 0? 'A' :'B'));
 			part_int = freq_hz / (SX125x_32MHz_FRAC << 8); /* integer part, gives the MSB */
 			part_frac = ((freq_hz % (SX125x_32MHz_FRAC << 8)) << 8) / SX125x_32MHz_FRAC; /* fractional part, gives middle part and LSB */
 		}else{
 			DEBUG_PRINTF("CHAIN %c UNKNOWN\n", (rf_chain == 0? 'A' :'B'));
+			*nb = nb_ops;
 			return -1;
 		}
 #else
@@ -641,149 +801,203 @@ int setup_sx125x(uint8_t rf_chain, uint32_t freq_hz) {
 		part_frac = ((freq_hz % (SX125x_32MHz_FRAC << 7)) << 9) / SX125x_32MHz_FRAC; /* fractional part, gives middle part and LSB */
 		#endif
 #endif
-		sx125x_write(rf_chain, 0x01,0xFF & part_int); /* Most Significant Byte */
-		sx125x_write(rf_chain, 0x02,0xFF & (part_frac >> 8)); /* middle byte */
-		sx125x_write(rf_chain, 0x03,0xFF & part_frac); /* Least Significant Byte */
-
-		/* start and PLL lock */
-		do {
-			if (cpt_attempts >= PLL_LOCK_MAX_ATTEMPTS) {
-				DEBUG_MSG("ERROR: FAIL TO LOCK PLL\n");
-				return -1;
-			}
-			sx125x_write(rf_chain, 0x00, 1); /* enable Xtal oscillator */
-			sx125x_write(rf_chain, 0x00, 3); /* Enable RX (PLL+FE) */
-			++cpt_attempts;
-			DEBUG_PRINTF("Note: SX125x #%d PLL start (attempt %d)\n", rf_chain, cpt_attempts);
-			wait_ms(1);
-		} while((sx125x_read(rf_chain, 0x11) & 0x02) == 0);
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x01, 0xFF & part_int); /* Most Significant Byte */
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x02, 0xFF & (part_frac >> 8)); /* middle byte */
+		nb_ops = sx125x_batch_w(ops, nb_ops, rf_chain, 0x03, 0xFF & part_frac); /* Least Significant Byte */
 	} else {
 		DEBUG_PRINTF("Note: SX125x #%d kept in standby mode\n", rf_chain);
 	}
 
+	*nb = nb_ops;
 	return 0;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-void lgw_constant_adjust(void) {
+/* set up the selected radios, then start their PLLs together and poll the lock of both */
+int setup_sx125x(struct lgw_ctx_s *ctx, const bool setup[LGW_RF_CHAIN_NB]) {
+	struct lgw_reg_radio_op_s ops[32]; /* setup of both radios, programmed as a single batch */
+	int nb_ops = 0;
+	bool pll_wait[LGW_RF_CHAIN_NB]; /* PLL of the radio started and not locked yet */
+	int cpt_attempts, cpt_polls;
+	int i, err = 0;
+
+	/* general setup, gains and frequency of both radios */
+	for (i = 0; i < LGW_RF_CHAIN_NB; ++i) {
+		pll_wait[i] = false;
+		if (setup[i] == false) {
+			continue;
+		}
+		if (sx125x_setup_ops(ctx, i, ctx->rf_rx_freq[i], ops, &nb_ops) != 0) {
+			err = -1;
+			continue;
+		}
+		pll_wait[i] = ctx->rf_enable[i];
+	}
+	lgw_reg_radio_batch_ctx(ctx->reg, ops, nb_ops);
+
+	/* start and PLL lock */
+	for (cpt_attempts = 0; pll_wait[0] || pll_wait[1]; ++cpt_attempts) {
+		if (cpt_attempts >= PLL_LOCK_MAX_ATTEMPTS) {
+			DEBUG_MSG("ERROR: FAIL TO LOCK PLL\n");
+			return -1;
+		}
+		/* (re)start the PLLs that are not locked */
+		nb_ops = 0;
+		for (i = 0; i < LGW_RF_CHAIN_NB; ++i) {
+			if (pll_wait[i]) {
+				nb_ops = sx125x_batch_w(ops, nb_ops, i, 0x00, 1); /* enable Xtal oscillator */
+				nb_ops = sx125x_batch_w(ops, nb_ops, i, 0x00, 3); /* Enable RX (PLL+FE) */
+				DEBUG_PRINTF("Note: SX125x #%d PLL start (attempt %d)\n", i, cpt_attempts + 1);
+			}
+		}
+		lgw_reg_radio_batch_ctx(ctx->reg, ops, nb_ops);
+
+		/* poll the lock status of both radios in the same batch */
+		for (cpt_polls = 0; (cpt_polls < PLL_LOCK_POLL_NB) && (pll_wait[0] || pll_wait[1]); ++cpt_polls) {
+			wait_us(PLL_LOCK_POLL_US);
+			nb_ops = 0;
+			for (i = 0; i < LGW_RF_CHAIN_NB; ++i) {
+				if (pll_wait[i]) {
+					ops[nb_ops].radio = i;
+					ops[nb_ops].addr = 0x11;
+					ops[nb_ops].data = 0;
+					ops[nb_ops++].read = true;
+				}
+			}
+			lgw_reg_radio_batch_ctx(ctx->reg, ops, nb_ops);
+			for (i = 0; i < nb_ops; ++i) {
+				if ((ops[i].data & 0x02) != 0) {
+					pll_wait[ops[i].radio] = false;
+					DEBUG_PRINTF("Note: SX125x #%d PLL locked after %d us\n", ops[i].radio, (cpt_attempts * PLL_LOCK_POLL_NB + cpt_polls + 1) * PLL_LOCK_POLL_US);
+				}
+			}
+		}
+	}
+
+	return err;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_constant_adjust(struct lgw_ctx_s *ctx) {
 
 	/* I/Q path setup */
-	// lgw_reg_w(LGW_RX_INVERT_IQ,0); /* default 0 */
-	// lgw_reg_w(LGW_MODEM_INVERT_IQ,1); /* default 1 */
-	// lgw_reg_w(LGW_CHIRP_INVERT_RX,1); /* default 1 */
-	// lgw_reg_w(LGW_RX_EDGE_SELECT,0); /* default 0 */
-	// lgw_reg_w(LGW_MBWSSF_MODEM_INVERT_IQ,0); /* default 0 */
-	// lgw_reg_w(LGW_DC_NOTCH_EN,1); /* default 1 */
-	lgw_reg_w(LGW_RSSI_BB_FILTER_ALPHA,6); /* default 7 */
-	lgw_reg_w(LGW_RSSI_DEC_FILTER_ALPHA,7); /* default 5 */
-	lgw_reg_w(LGW_RSSI_CHANN_FILTER_ALPHA,7); /* default 8 */
-	lgw_reg_w(LGW_RSSI_BB_DEFAULT_VALUE,23); /* default 32 */
-	lgw_reg_w(LGW_RSSI_CHANN_DEFAULT_VALUE,85); /* default 100 */
-	lgw_reg_w(LGW_RSSI_DEC_DEFAULT_VALUE,66); /* default 100 */
-	lgw_reg_w(LGW_DEC_GAIN_OFFSET,7); /* default 8 */
-	lgw_reg_w(LGW_CHAN_GAIN_OFFSET,6); /* default 7 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_RX_INVERT_IQ,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MODEM_INVERT_IQ,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CHIRP_INVERT_RX,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_RX_EDGE_SELECT,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_MODEM_INVERT_IQ,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_DC_NOTCH_EN,1); /* default 1 */
+	lgw_reg_w_ctx(ctx->reg, LGW_RSSI_BB_FILTER_ALPHA,6); /* default 7 */
+	lgw_reg_w_ctx(ctx->reg, LGW_RSSI_DEC_FILTER_ALPHA,7); /* default 5 */
+	lgw_reg_w_ctx(ctx->reg, LGW_RSSI_CHANN_FILTER_ALPHA,7); /* default 8 */
+	lgw_reg_w_ctx(ctx->reg, LGW_RSSI_BB_DEFAULT_VALUE,23); /* default 32 */
+	lgw_reg_w_ctx(ctx->reg, LGW_RSSI_CHANN_DEFAULT_VALUE,85); /* default 100 */
+	lgw_reg_w_ctx(ctx->reg, LGW_RSSI_DEC_DEFAULT_VALUE,66); /* default 100 */
+	lgw_reg_w_ctx(ctx->reg, LGW_DEC_GAIN_OFFSET,7); /* default 8 */
+	lgw_reg_w_ctx(ctx->reg, LGW_CHAN_GAIN_OFFSET,6); /* default 7 */
 
 	/* Correlator setup */
-	// lgw_reg_w(LGW_CORR_DETECT_EN,126); /* default 126 */
-	// lgw_reg_w(LGW_CORR_NUM_SAME_PEAK,4); /* default 4 */
-	// lgw_reg_w(LGW_CORR_MAC_GAIN,5); /* default 5 */
-	// lgw_reg_w(LGW_CORR_SAME_PEAKS_OPTION_SF6,0); /* default 0 */
-	// lgw_reg_w(LGW_CORR_SAME_PEAKS_OPTION_SF7,1); /* default 1 */
-	// lgw_reg_w(LGW_CORR_SAME_PEAKS_OPTION_SF8,1); /* default 1 */
-	// lgw_reg_w(LGW_CORR_SAME_PEAKS_OPTION_SF9,1); /* default 1 */
-	// lgw_reg_w(LGW_CORR_SAME_PEAKS_OPTION_SF10,1); /* default 1 */
-	// lgw_reg_w(LGW_CORR_SAME_PEAKS_OPTION_SF11,1); /* default 1 */
-	// lgw_reg_w(LGW_CORR_SAME_PEAKS_OPTION_SF12,1); /* default 1 */
-	// lgw_reg_w(LGW_CORR_SIG_NOISE_RATIO_SF6,4); /* default 4 */
-	// lgw_reg_w(LGW_CORR_SIG_NOISE_RATIO_SF7,4); /* default 4 */
-	// lgw_reg_w(LGW_CORR_SIG_NOISE_RATIO_SF8,4); /* default 4 */
-	// lgw_reg_w(LGW_CORR_SIG_NOISE_RATIO_SF9,4); /* default 4 */
-	// lgw_reg_w(LGW_CORR_SIG_NOISE_RATIO_SF10,4); /* default 4 */
-	// lgw_reg_w(LGW_CORR_SIG_NOISE_RATIO_SF11,4); /* default 4 */
-	// lgw_reg_w(LGW_CORR_SIG_NOISE_RATIO_SF12,4); /* default 4 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_DETECT_EN,126); /* default 126 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_NUM_SAME_PEAK,4); /* default 4 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_MAC_GAIN,5); /* default 5 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SAME_PEAKS_OPTION_SF6,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SAME_PEAKS_OPTION_SF7,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SAME_PEAKS_OPTION_SF8,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SAME_PEAKS_OPTION_SF9,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SAME_PEAKS_OPTION_SF10,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SAME_PEAKS_OPTION_SF11,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SAME_PEAKS_OPTION_SF12,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SIG_NOISE_RATIO_SF6,4); /* default 4 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SIG_NOISE_RATIO_SF7,4); /* default 4 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SIG_NOISE_RATIO_SF8,4); /* default 4 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SIG_NOISE_RATIO_SF9,4); /* default 4 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SIG_NOISE_RATIO_SF10,4); /* default 4 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SIG_NOISE_RATIO_SF11,4); /* default 4 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_CORR_SIG_NOISE_RATIO_SF12,4); /* default 4 */
 
 	/* LoRa 'multi' demodulators setup */
-	// lgw_reg_w(LGW_PREAMBLE_SYMB1_NB,10); /* default 10 */
-	// lgw_reg_w(LGW_FREQ_TO_TIME_INVERT,29); /* default 29 */
-	// lgw_reg_w(LGW_FRAME_SYNCH_GAIN,1); /* default 1 */
-	// lgw_reg_w(LGW_SYNCH_DETECT_TH,1); /* default 1 */
-	// lgw_reg_w(LGW_ZERO_PAD,0); /* default 0 */
-	lgw_reg_w(LGW_SNR_AVG_CST,3); /* default 2 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_PREAMBLE_SYMB1_NB,10); /* default 10 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_FREQ_TO_TIME_INVERT,29); /* default 29 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_FRAME_SYNCH_GAIN,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_SYNCH_DETECT_TH,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_ZERO_PAD,0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_SNR_AVG_CST,3); /* default 2 */
 	#if (CFG_NET_LORAMAC == 1)
-	lgw_reg_w(LGW_FRAME_SYNCH_PEAK1_POS,3); /* default 1 */
-	lgw_reg_w(LGW_FRAME_SYNCH_PEAK2_POS,4); /* default 2 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FRAME_SYNCH_PEAK1_POS,3); /* default 1 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FRAME_SYNCH_PEAK2_POS,4); /* default 2 */
 	#elif (CFG_NET_PRIVATE == 1)
-	lgw_reg_w(LGW_FRAME_SYNCH_PEAK1_POS,1); /* default 1 */
-	lgw_reg_w(LGW_FRAME_SYNCH_PEAK2_POS,2); /* default 2 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FRAME_SYNCH_PEAK1_POS,1); /* default 1 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FRAME_SYNCH_PEAK2_POS,2); /* default 2 */
 	#endif
-	// lgw_reg_w(LGW_PREAMBLE_FINE_TIMING_GAIN,1); /* default 1 */
-	// lgw_reg_w(LGW_ONLY_CRC_EN,1); /* default 1 */
-	// lgw_reg_w(LGW_PAYLOAD_FINE_TIMING_GAIN,2); /* default 2 */
-	// lgw_reg_w(LGW_TRACKING_INTEGRAL,0); /* default 0 */
-	// lgw_reg_w(LGW_ADJUST_MODEM_START_OFFSET_RDX8,0); /* default 0 */
-	// lgw_reg_w(LGW_ADJUST_MODEM_START_OFFSET_SF12_RDX4,4092); /* default 4092 */
-	// lgw_reg_w(LGW_MAX_PAYLOAD_LEN,255); /* default 255 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_PREAMBLE_FINE_TIMING_GAIN,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_ONLY_CRC_EN,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_PAYLOAD_FINE_TIMING_GAIN,2); /* default 2 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_TRACKING_INTEGRAL,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_ADJUST_MODEM_START_OFFSET_RDX8,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_ADJUST_MODEM_START_OFFSET_SF12_RDX4,4092); /* default 4092 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MAX_PAYLOAD_LEN,255); /* default 255 */
 
 	/* LoRa standalone 'MBWSSF' demodulator setup */
-	// lgw_reg_w(LGW_MBWSSF_PREAMBLE_SYMB1_NB,10); /* default 10 */
-	// lgw_reg_w(LGW_MBWSSF_FREQ_TO_TIME_INVERT,29); /* default 29 */
-	// lgw_reg_w(LGW_MBWSSF_FRAME_SYNCH_GAIN,1); /* default 1 */
-	// lgw_reg_w(LGW_MBWSSF_SYNCH_DETECT_TH,1); /* default 1 */
-	// lgw_reg_w(LGW_MBWSSF_ZERO_PAD,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_PREAMBLE_SYMB1_NB,10); /* default 10 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_FREQ_TO_TIME_INVERT,29); /* default 29 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_FRAME_SYNCH_GAIN,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_SYNCH_DETECT_TH,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_ZERO_PAD,0); /* default 0 */
 	#if (CFG_NET_LORAMAC == 1)
-	lgw_reg_w(LGW_MBWSSF_FRAME_SYNCH_PEAK1_POS,3); /* default 1 */
-	lgw_reg_w(LGW_MBWSSF_FRAME_SYNCH_PEAK2_POS,4); /* default 2 */
+	lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_FRAME_SYNCH_PEAK1_POS,3); /* default 1 */
+	lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_FRAME_SYNCH_PEAK2_POS,4); /* default 2 */
 	#elif (CFG_NET_PRIVATE == 1)
-	lgw_reg_w(LGW_MBWSSF_FRAME_SYNCH_PEAK1_POS,1); /* default 1 */
-	lgw_reg_w(LGW_MBWSSF_FRAME_SYNCH_PEAK2_POS,2); /* default 2 */
+	lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_FRAME_SYNCH_PEAK1_POS,1); /* default 1 */
+	lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_FRAME_SYNCH_PEAK2_POS,2); /* default 2 */
 	#endif
-	// lgw_reg_w(LGW_MBWSSF_ONLY_CRC_EN,1); /* default 1 */
-	// lgw_reg_w(LGW_MBWSSF_PAYLOAD_FINE_TIMING_GAIN,2); /* default 2 */
-	// lgw_reg_w(LGW_MBWSSF_PREAMBLE_FINE_TIMING_GAIN,1); /* default 1 */
-	// lgw_reg_w(LGW_MBWSSF_TRACKING_INTEGRAL,0); /* default 0 */
-	// lgw_reg_w(LGW_MBWSSF_AGC_FREEZE_ON_DETECT,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_ONLY_CRC_EN,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_PAYLOAD_FINE_TIMING_GAIN,2); /* default 2 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_PREAMBLE_FINE_TIMING_GAIN,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_TRACKING_INTEGRAL,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_AGC_FREEZE_ON_DETECT,1); /* default 1 */
 
 	/* FSK datapath setup */
-	lgw_reg_w(LGW_FSK_RX_INVERT,1); /* default 0 */
-	lgw_reg_w(LGW_FSK_MODEM_INVERT_IQ,1); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_RX_INVERT,1); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_MODEM_INVERT_IQ,1); /* default 0 */
 
 	/* FSK demodulator setup */
-	lgw_reg_w(LGW_FSK_RSSI_LENGTH,4); /* default 0 */
-	lgw_reg_w(LGW_FSK_PKT_MODE,1); /* variable length, default 0 */
-	lgw_reg_w(LGW_FSK_PSIZE,2); /* pattern size-1, default 0 */
-	lgw_reg_w(LGW_FSK_CRC_EN,1); /* default 0 */
-	lgw_reg_w(LGW_FSK_DCFREE_ENC,2); /* default 0 */
-	// lgw_reg_w(LGW_FSK_CRC_IBM,0); /* default 0 */
-	lgw_reg_w(LGW_FSK_ERROR_OSR_TOL,10); /* default 0 */
-	lgw_reg_w(LGW_FSK_REF_PATTERN_LSB,0x01010101); /* default 0 */
-	lgw_reg_w(LGW_FSK_REF_PATTERN_MSB,0xC194C101); /* default 0 */
-	lgw_reg_w(LGW_FSK_PKT_LENGTH,255); /* max packet length in variable length mode */
-	// lgw_reg_w(LGW_FSK_NODE_ADRS,0); /* default 0 */
-	// lgw_reg_w(LGW_FSK_BROADCAST,0); /* default 0 */
-	// lgw_reg_w(LGW_FSK_AUTO_AFC_ON,0); /* default 0 */
-	lgw_reg_w(LGW_FSK_PATTERN_TIMEOUT_CFG,128); /* sync timeout (allow 8 bytes preamble + 8 bytes sync word, default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_RSSI_LENGTH,4); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_PKT_MODE,1); /* variable length, default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_PSIZE,2); /* pattern size-1, default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_CRC_EN,1); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_DCFREE_ENC,2); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_FSK_CRC_IBM,0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_ERROR_OSR_TOL,10); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_REF_PATTERN_LSB,0x01010101); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_REF_PATTERN_MSB,0xC194C101); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_PKT_LENGTH,255); /* max packet length in variable length mode */
+	// lgw_reg_w_ctx(ctx->reg, LGW_FSK_NODE_ADRS,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_FSK_BROADCAST,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_FSK_AUTO_AFC_ON,0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_PATTERN_TIMEOUT_CFG,128); /* sync timeout (allow 8 bytes preamble + 8 bytes sync word, default 0 */
 
 	/* TX general parameters */
-	lgw_reg_w(LGW_TX_START_DELAY, TX_START_DELAY); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_TX_START_DELAY, TX_START_DELAY); /* default 0 */
 
 	/* TX LoRa */
-	// lgw_reg_w(LGW_TX_MODE,0); /* default 0 */
-	lgw_reg_w(LGW_TX_SWAP_IQ,1); /* "normal" polarity; default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_TX_MODE,0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_TX_SWAP_IQ,1); /* "normal" polarity; default 0 */
 	#if (CFG_NET_LORAMAC == 1)
-	lgw_reg_w(LGW_TX_FRAME_SYNCH_PEAK1_POS,3); /* default 1 */
-	lgw_reg_w(LGW_TX_FRAME_SYNCH_PEAK2_POS,4); /* default 2 */
+	lgw_reg_w_ctx(ctx->reg, LGW_TX_FRAME_SYNCH_PEAK1_POS,3); /* default 1 */
+	lgw_reg_w_ctx(ctx->reg, LGW_TX_FRAME_SYNCH_PEAK2_POS,4); /* default 2 */
 	#elif (CFG_NET_PRIVATE == 1)
-	//lgw_reg_w(LGW_TX_FRAME_SYNCH_PEAK1_POS,1); /* default 1 */
-	//lgw_reg_w(LGW_TX_FRAME_SYNCH_PEAK2_POS,2); /* default 2 */
+	//lgw_reg_w_ctx(ctx->reg, LGW_TX_FRAME_SYNCH_PEAK1_POS,1); /* default 1 */
+	//lgw_reg_w_ctx(ctx->reg, LGW_TX_FRAME_SYNCH_PEAK2_POS,2); /* default 2 */
 	#endif
 
 	/* TX FSK */
-	// lgw_reg_w(LGW_FSK_TX_GAUSSIAN_EN,1); /* default 1 */
-	lgw_reg_w(LGW_FSK_TX_GAUSSIAN_SELECT_BT,2); /* Gaussian filter always on TX, default 0 */
-	lgw_reg_w(LGW_FSK_TX_PSIZE,2); /* default 0 */
-	// lgw_reg_w(LGW_FSK_TX_PATTERN_EN,1); /* default 1 */
-	// lgw_reg_w(LGW_FSK_TX_PREAMBLE_SEQ,0); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_FSK_TX_GAUSSIAN_EN,1); /* default 1 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_TX_GAUSSIAN_SELECT_BT,2); /* Gaussian filter always on TX, default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_FSK_TX_PSIZE,2); /* default 0 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_FSK_TX_PATTERN_EN,1); /* default 1 */
+	// lgw_reg_w_ctx(ctx->reg, LGW_FSK_TX_PREAMBLE_SEQ,0); /* default 0 */
 
 	return;
 }
@@ -791,10 +1005,188 @@ void lgw_constant_adjust(void) {
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
-int lgw_rxrf_setconf(uint8_t rf_chain, struct lgw_conf_rxrf_s conf) {
+struct lgw_ctx_s *lgw_ctx_create(void) {
+	struct lgw_ctx_s *ctx;
+
+	ctx = malloc(sizeof(struct lgw_ctx_s));
+	if (ctx == NULL) {
+		DEBUG_MSG("ERROR: MALLOC FAIL\n");
+		return NULL;
+	}
+	*ctx = ctx_template;
+	ctx->reg = &ctx->reg_own;
+	if ((lgw_reg_ctx_init(ctx->reg) != LGW_REG_SUCCESS) || (pthread_mutex_init(&ctx->mx_ts, NULL) != 0) || (pthread_mutex_init(&ctx->mx_pps, NULL) != 0) || (pthread_mutex_init(&ctx->mx_rx, NULL) != 0) || (pthread_mutex_init(&ctx->mx_tx, NULL) != 0)) {
+		DEBUG_MSG("ERROR: FAILED TO INITIALIZE CONTEXT\n");
+		free(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_ctx_free(struct lgw_ctx_s *ctx) {
+	if ((ctx == NULL) || (ctx == &ctx_default)) {
+		return;
+	}
+	if (ctx->is_started == true) {
+		lgw_stop_ctx(ctx);
+	}
+	pthread_mutex_destroy(&ctx->mx_tx);
+	pthread_mutex_destroy(&ctx->mx_rx);
+	pthread_mutex_destroy(&ctx->mx_pps);
+	pthread_mutex_destroy(&ctx->mx_ts);
+	pthread_mutex_destroy(&ctx->reg_own.mx_bus);
+	free(ctx);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_spi_setconf_ctx(struct lgw_ctx_s *ctx, const char *path, uint32_t speed_hz) {
+	CHECK_NULL(ctx);
+
+	/* check if the concentrator is running */
+	if (ctx->is_started == true) {
+		DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE TOUCHING CONFIGURATION\n");
+		return LGW_HAL_ERROR;
+	}
+
+	if (lgw_reg_spi_setconf_ctx(ctx->reg, path, speed_hz) != LGW_REG_SUCCESS) {
+		DEBUG_MSG("ERROR: INVALID SPI CONFIGURATION\n");
+		return LGW_HAL_ERROR;
+	}
+	memset(ctx->fw_resident, 0, sizeof ctx->fw_resident); /* may be another concentrator */
+	return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_fw_setconf_ctx(struct lgw_ctx_s *ctx, struct lgw_conf_fw_s conf) {
+	CHECK_NULL(ctx);
 
 	/* check if the concentrator is running */
-	if (lgw_is_started == true) {
+	if (ctx->is_started == true) {
+		DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE TOUCHING CONFIGURATION\n");
+		return LGW_HAL_ERROR;
+	}
+
+	ctx->fw_conf = conf;
+	DEBUG_PRINTF("Note: firmware loading, skip resident %d, verify %d\n", conf.skip_resident, conf.verify);
+	return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_txgain_load(const char *path, struct lgw_tx_gain_lut_s *conf) {
+	FILE *f;
+	uint8_t buff[8 + (4 * TX_POW_LUT_SIZE)];
+	size_t n;
+	int i;
+
+	CHECK_NULL(path);
+	CHECK_NULL(conf);
+
+	f = fopen(path, "rb");
+	if (f == NULL) {
+		DEBUG_PRINTF("ERROR: CANNOT OPEN TX GAIN PROFILE %s\n", path);
+		return LGW_HAL_ERROR;
+	}
+	n = fread(buff, 1, sizeof buff, f);
+	fclose(f);
+
+	/* header: magic, version, number of entries; then pa_gain, dac_gain, mix_gain, rf_power of each entry */
+	if ((n != sizeof buff) || (memcmp(buff, TXGAIN_FILE_MAGIC, 6) != 0) || (buff[6] != TXGAIN_FILE_VERSION) || (buff[7] != TX_POW_LUT_SIZE)) {
+		DEBUG_PRINTF("ERROR: %s IS NOT A VALID TX GAIN PROFILE\n", path);
+		return LGW_HAL_ERROR;
+	}
+	for (i = 0; i < TX_POW_LUT_SIZE; ++i) {
+		conf->lut[i].pa_gain = buff[8 + (4 * i)];
+		conf->lut[i].dac_gain = buff[9 + (4 * i)];
+		conf->lut[i].mix_gain = buff[10 + (4 * i)];
+		conf->lut[i].rf_power = (int8_t)buff[11 + (4 * i)];
+	}
+	return (txgain_check(conf) == 0) ? LGW_HAL_SUCCESS : LGW_HAL_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_txgain_setconf_ctx(struct lgw_ctx_s *ctx, const struct lgw_tx_gain_lut_s *conf) {
+	int32_t read_val = 0;
+	const char *site; /* register profiler site of the caller */
+	int stat = LGW_HAL_SUCCESS;
+
+	CHECK_NULL(ctx);
+	CHECK_NULL(conf);
+	if (txgain_check(conf) != 0) {
+		return LGW_HAL_ERROR;
+	}
+
+	pthread_mutex_lock(&ctx->mx_rx);
+	pthread_mutex_lock(&ctx->mx_tx);
+	if (ctx->is_started) {
+		/* the AGC firmware can only be restarted when no TX is programmed */
+		lgw_reg_ri(ctx->reg, TX_STATUS, &read_val);
+		if ((read_val & 0x10) != 0) {
+			pthread_mutex_unlock(&ctx->mx_tx);
+			pthread_mutex_unlock(&ctx->mx_rx);
+			DEBUG_MSG("ERROR: TX IN PROGRESS, CANNOT UPDATE TX GAIN TABLE\n");
+			return LGW_HAL_ERROR;
+		}
+	}
+	memcpy(ctx->tx_lut_own, conf->lut, sizeof ctx->tx_lut_own);
+	ctx->tx_lut = ctx->tx_lut_own;
+	ctx->tx_lut_custom = true;
+	tx_pow_map_build(ctx);
+
+	/* restart the AGC MCU on its resident firmware to load the table */
+	if (ctx->is_started) {
+		site = lgw_reg_profile_site("lgw_txgain_setconf");
+		lgw_reg_w_ctx(ctx->reg, LGW_MCU_RST_1, 1);
+		if (agc_init(ctx) != 0) {
+			DEBUG_MSG("ERROR: FAILED TO RESTART AGC FIRMWARE, CONCENTRATOR MUST BE RESTARTED\n");
+			stat = LGW_HAL_ERROR;
+		}
+		lgw_reg_profile_site(site);
+	}
+	pthread_mutex_unlock(&ctx->mx_tx);
+	pthread_mutex_unlock(&ctx->mx_rx);
+
+	return stat;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_spi_probe_ctx(struct lgw_ctx_s *ctx, uint32_t min_hz, uint32_t max_hz, uint32_t step_hz, uint32_t *speed_hz) {
+	int reg_stat;
+
+	CHECK_NULL(ctx);
+	CHECK_NULL(speed_hz);
+
+	/* the probe overwrites the RX data buffer */
+	if (ctx->is_started == true) {
+		DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE PROBING SPI CLOCK\n");
+		return LGW_HAL_ERROR;
+	}
+
+	reg_stat = lgw_connect_ctx(ctx->reg);
+	if (reg_stat == LGW_REG_ERROR) {
+		DEBUG_MSG("ERROR: FAIL TO CONNECT BOARD\n");
+		return LGW_HAL_ERROR;
+	}
+	reg_stat = lgw_reg_spi_probe_ctx(ctx->reg, min_hz, max_hz, step_hz, speed_hz);
+	lgw_disconnect_ctx(ctx->reg);
+
+	return (reg_stat == LGW_REG_SUCCESS) ? LGW_HAL_SUCCESS : LGW_HAL_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_rxrf_setconf_ctx(struct lgw_ctx_s *ctx, uint8_t rf_chain, struct lgw_conf_rxrf_s conf) {
+	CHECK_NULL(ctx);
+
+	/* check if the concentrator is running */
+	if (ctx->is_started == true) {
 		DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE TOUCHING CONFIGURATION\n");
 		return LGW_HAL_ERROR;
 	}
@@ -806,28 +1198,30 @@ int lgw_rxrf_setconf(uint8_t rf_chain, struct lgw_conf_rxrf_s conf) {
 	}
 
 	/* check input parameters */
-	if (conf.freq_hz > rf_rx_upfreq[rf_chain]) {
+	if (conf.freq_hz > ctx->rf_rx_upfreq[rf_chain]) {
 		DEBUG_MSG("ERROR: FREQUENCY TOO HIGH FOR THAT RF_CHAIN\n");
 		return LGW_HAL_ERROR;
-	} else if (conf.freq_hz < rf_rx_lowfreq[rf_chain]) {
+	} else if (conf.freq_hz < ctx->rf_rx_lowfreq[rf_chain]) {
 		DEBUG_MSG("ERROR: FREQUENCY TOO LOW FOR THAT RF_CHAIN\n");
 		return LGW_HAL_ERROR;
 	}
 
 	/* set internal config according to parameters */
-	rf_enable[rf_chain] = conf.enable;
-	rf_rx_freq[rf_chain] = conf.freq_hz;
+	ctx->rf_enable[rf_chain] = conf.enable;
+	ctx->rf_rx_freq[rf_chain] = conf.freq_hz;
 
-	DEBUG_PRINTF("Note: rf_chain %d configuration; en:%d freq:%d\n", rf_chain, rf_enable[rf_chain], rf_rx_freq[rf_chain]);
+	DEBUG_PRINTF("Note: rf_chain %d configuration; en:%d freq:%d\n", rf_chain, ctx->rf_enable[rf_chain], ctx->rf_rx_freq[rf_chain]);
 
 	return LGW_HAL_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s conf) {
+int lgw_rxif_setconf_ctx(struct lgw_ctx_s *ctx, uint8_t if_chain, struct lgw_conf_rxif_s conf) {
+	CHECK_NULL(ctx);
+
 	/* check if the concentrator is running */
-	if (lgw_is_started == true) {
+	if (ctx->is_started == true) {
 		DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE TOUCHING CONFIGURATION\n");
 		return LGW_HAL_ERROR;
 	}
@@ -840,8 +1234,8 @@ int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s conf) {
 
 	/* if chain is disabled, don't care about most parameters */
 	if (conf.enable == false) {
-		if_enable[if_chain] = false;
-		if_freq[if_chain] = 0;
+		ctx->if_enable[if_chain] = false;
+		ctx->if_freq[if_chain] = 0;
 		DEBUG_PRINTF("Note: if_chain %d disabled\n", if_chain);
 		return LGW_HAL_SUCCESS;
 	}
@@ -884,18 +1278,18 @@ int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s conf) {
 				return LGW_HAL_ERROR;
 			}
 			/* set internal configuration  */
-			if_enable[if_chain] = conf.enable;
-			if_rf_chain[if_chain] = conf.rf_chain;
-			if_freq[if_chain] = conf.freq_hz;
-			lora_rx_bw = conf.bandwidth;
-			lora_rx_sf = (uint8_t)(DR_LORA_MULTI & conf.datarate); /* filter SF out of the 7-12 range */
+			ctx->if_enable[if_chain] = conf.enable;
+			ctx->if_rf_chain[if_chain] = conf.rf_chain;
+			ctx->if_freq[if_chain] = conf.freq_hz;
+			ctx->lora_rx_bw = conf.bandwidth;
+			ctx->lora_rx_sf = (uint8_t)(DR_LORA_MULTI & conf.datarate); /* filter SF out of the 7-12 range */
 			if (SET_PPM_ON(conf.bandwidth, conf.datarate)) {
-				lora_rx_ppm_offset = true;
+				ctx->lora_rx_ppm_offset = true;
 			} else {
-				lora_rx_ppm_offset = false;
+				ctx->lora_rx_ppm_offset = false;
 			}
 
-			DEBUG_PRINTF("Note: LoRa 'std' if_chain %d configuration; en:%d freq:%d bw:%d dr:%d\n", if_chain, if_enable[if_chain], if_freq[if_chain], lora_rx_bw, lora_rx_sf);
+			DEBUG_PRINTF("Note: LoRa 'std' if_chain %d configuration; en:%d freq:%d bw:%d dr:%d\n", if_chain, ctx->if_enable[if_chain], ctx->if_freq[if_chain], ctx->lora_rx_bw, ctx->lora_rx_sf);
 			break;
 
 		case IF_LORA_MULTI:
@@ -916,12 +1310,12 @@ int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s conf) {
 				return LGW_HAL_ERROR;
 			}
 			/* set internal configuration  */
-			if_enable[if_chain] = conf.enable;
-			if_rf_chain[if_chain] = conf.rf_chain;
-			if_freq[if_chain] = conf.freq_hz;
-			lora_multi_sfmask[if_chain] = (uint8_t)(DR_LORA_MULTI & conf.datarate); /* filter SF out of the 7-12 range */
+			ctx->if_enable[if_chain] = conf.enable;
+			ctx->if_rf_chain[if_chain] = conf.rf_chain;
+			ctx->if_freq[if_chain] = conf.freq_hz;
+			ctx->lora_multi_sfmask[if_chain] = (uint8_t)(DR_LORA_MULTI & conf.datarate); /* filter SF out of the 7-12 range */
 
-			DEBUG_PRINTF("Note: LoRa 'multi' if_chain %d configuration; en:%d freq:%d SF_mask:0x%02x\n", if_chain, if_enable[if_chain], if_freq[if_chain], lora_multi_sfmask[if_chain]);
+			DEBUG_PRINTF("Note: LoRa 'multi' if_chain %d configuration; en:%d freq:%d SF_mask:0x%02x\n", if_chain, ctx->if_enable[if_chain], ctx->if_freq[if_chain], ctx->lora_multi_sfmask[if_chain]);
 			break;
 
 		case IF_FSK_STD:
@@ -942,12 +1336,12 @@ int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s conf) {
 				return LGW_HAL_ERROR;
 			}
 			/* set internal configuration  */
-			if_enable[if_chain] = conf.enable;
-			if_rf_chain[if_chain] = conf.rf_chain;
-			if_freq[if_chain] = conf.freq_hz;
-			fsk_rx_bw = conf.bandwidth;
-			fsk_rx_dr = conf.datarate;
-			DEBUG_PRINTF("Note: FSK if_chain %d configuration; en:%d freq:%d bw:%d dr:%d (%d real dr)\n", if_chain, if_enable[if_chain], if_freq[if_chain], fsk_rx_bw, fsk_rx_dr, LGW_XTAL_FREQU/(LGW_XTAL_FREQU/fsk_rx_dr));
+			ctx->if_enable[if_chain] = conf.enable;
+			ctx->if_rf_chain[if_chain] = conf.rf_chain;
+			ctx->if_freq[if_chain] = conf.freq_hz;
+			ctx->fsk_rx_bw = conf.bandwidth;
+			ctx->fsk_rx_dr = conf.datarate;
+			DEBUG_PRINTF("Note: FSK if_chain %d configuration; en:%d freq:%d bw:%d dr:%d (%d real dr)\n", if_chain, ctx->if_enable[if_chain], ctx->if_freq[if_chain], ctx->fsk_rx_bw, ctx->fsk_rx_dr, LGW_XTAL_FREQU/(LGW_XTAL_FREQU/ctx->fsk_rx_dr));
 			break;
 
 		default:
@@ -960,101 +1354,306 @@ int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s conf) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_start(void) {
+/* poll the AGC firmware status until it reaches the expected value */
+static int agc_wait_status(struct lgw_ctx_s *ctx, uint8_t expected) {
+	int32_t read_val = 0;
+	int i;
+
+	for (i = 0; i < AGC_STATUS_POLL_NB; ++i) {
+		lgw_reg_ri(ctx->reg, MCU_AGC_STATUS, &read_val);
+		if (read_val == expected) {
+			return 0;
+		}
+		wait_us(AGC_STATUS_POLL_US);
+	}
+	DEBUG_PRINTF("ERROR: AGC FIRMWARE INITIALIZATION FAILURE, STATUS 0x%02X INSTEAD OF 0x%02X\n", (uint8_t)read_val, expected);
+	return -1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* give a value to the AGC firmware during its initialization (WAIT transaction) */
+static void agc_cmd(struct lgw_ctx_s *ctx, uint8_t value) {
+	lgw_reg_wi(ctx->reg, RADIO_SELECT, AGC_CMD_WAIT); /* start a transaction */
+	wait_us(AGC_CMD_SETTLE_US);
+	lgw_reg_wi(ctx->reg, RADIO_SELECT, value);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* get the AGC MCU out of reset and initialize its firmware: TX gain LUT, chan_select option, RADIO_SELECT */
+int agc_init(struct lgw_ctx_s *ctx) {
+	uint8_t load_val;
+	int i;
+
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_SELECT, 0); /* MUST not be = to 1 or 2 at firmware init */
+	lgw_reg_w_ctx(ctx->reg, LGW_MCU_RST_1, 0);
+
+	DEBUG_MSG("Info: Initialising AGC firmware...\n");
+	if (agc_wait_status(ctx, 0x20) != 0) {
+		return -1;
+	}
+
+	/* Update Tx gain LUT and start AGC */
+	if (ctx->tx_lut_custom) {
+		DEBUG_MSG("Info: loading custom TX gain table\n");
+		for(i=0; i<TX_POW_LUT_SIZE; ++i) {
+			load_val = ctx->tx_lut[i].mix_gain + (16 * ctx->tx_lut[i].dac_gain) + (64 * ctx->tx_lut[i].pa_gain);
+			agc_cmd(ctx, load_val);
+			if (agc_wait_status(ctx, 0x30 + i) != 0) {
+				return -1;
+			}
+		}
+	} else {
+		agc_cmd(ctx, AGC_CMD_ABORT);
+		DEBUG_MSG("Info: TX gain LUT update skipped, using default LUT\n");
+		if (agc_wait_status(ctx, 0x30) != 0) {
+			return -1;
+		}
+	}
+
+	/*
+	Load chan_select firmware option. The firmware takes this value without
+	updating its status, so the step cannot be polled: it keeps the 1 ms waits of
+	the reference HAL, and a firmware that missed the value is detected by the
+	final status, which it only reaches after one more transaction.
+	*/
+	lgw_reg_wi(ctx->reg, RADIO_SELECT, AGC_CMD_WAIT);
+	wait_us(AGC_CMD_NOACK_US);
+	lgw_reg_wi(ctx->reg, RADIO_SELECT, 0);
+	wait_us(AGC_CMD_NOACK_US);
+
+	/* End AGC firmware init and check status */
+	agc_cmd(ctx, ctx->agc_radio_select); /* Load intended value of RADIO_SELECT */
+	DEBUG_MSG("Info: putting back original RADIO_SELECT value\n");
+	return agc_wait_status(ctx, 0x40);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* TX settings of a requested power: highest table entry not above it, and the I/Q correction of its mixer gain */
+void tx_pow_resolve(const struct lgw_ctx_s *ctx, int8_t rf_power, struct tx_pow_map_s *map) {
+	uint8_t pow_index;
+	uint8_t target_mix_gain;
+
+	for (pow_index = TX_POW_LUT_SIZE-1; pow_index > 0; pow_index--) {
+		if (ctx->tx_lut[pow_index].rf_power <= rf_power) {
+			break;
+		}
+	}
+	map->pow_index = pow_index;
+
+	/* select TX imbalance correction (written to the chip with the packet) */
+	target_mix_gain = ctx->tx_lut[pow_index].mix_gain;
+	target_mix_gain = (target_mix_gain <  8)?  8 : target_mix_gain;
+	target_mix_gain = (target_mix_gain > 15)? 15 : target_mix_gain;
+	map->offset_i[0] = ctx->cal_offset_a_i[target_mix_gain - 8];
+	map->offset_q[0] = ctx->cal_offset_a_q[target_mix_gain - 8];
+	map->offset_i[1] = ctx->cal_offset_b_i[target_mix_gain - 8];
+	map->offset_q[1] = ctx->cal_offset_b_q[target_mix_gain - 8];
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* resolve every power of the direct lookup range, after a change of TX gain table or calibration */
+void tx_pow_map_build(struct lgw_ctx_s *ctx) {
+	int i;
+
+	for (i = 0; i < TX_POW_MAP_NB; ++i) {
+		tx_pow_resolve(ctx, (int8_t)(TX_POW_MAP_MIN + i), &ctx->tx_pow_map[i]);
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* counter predicted at host time now (mx_ts held, timeline valid) */
+static uint64_t ts_predict_at(const struct lgw_ctx_s *ctx, const struct timespec *now) {
+	int64_t elapsed_us;
+
+	elapsed_us = ((int64_t)(now->tv_sec - ctx->ts_host.tv_sec) * 1000000) + ((now->tv_nsec - ctx->ts_host.tv_nsec) / 1000);
+	return ctx->ts_ext + elapsed_us;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* value with the 32 LSBs of count_us closest to the counter predicted at host time now (mx_ts held, timeline valid) */
+static uint64_t ts_extend_at(const struct lgw_ctx_s *ctx, uint32_t count_us, const struct timespec *now) {
+	uint64_t predicted;
+	uint64_t ext;
+
+	predicted = ts_predict_at(ctx, now);
+	ext = (predicted & ~(uint64_t)0xFFFFFFFF) | count_us;
+	if ((ext > predicted) && ((ext - predicted) > 0x80000000) && (ext >= 0x100000000)) {
+		ext -= 0x100000000;
+	} else if ((ext < predicted) && ((predicted - ext) > 0x80000000)) {
+		ext += 0x100000000;
+	}
+	return ext;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* extend a counter value (RX timestamp, PPS capture) to the 64-bit timeline */
+uint64_t ts_extend(struct lgw_ctx_s *ctx, uint32_t count_us) {
+	struct timespec now;
+	uint64_t ext = count_us;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	pthread_mutex_lock(&ctx->mx_ts);
+	if (ctx->ts_valid) {
+		ext = ts_extend_at(ctx, count_us, &now);
+	}
+	pthread_mutex_unlock(&ctx->mx_ts);
+	return ext;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* counter predicted from host time, false if the timeline has no live read younger than max_age_s */
+static bool ts_predict(struct lgw_ctx_s *ctx, time_t max_age_s, uint64_t *count_us64) {
+	struct timespec now;
+	bool valid;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	pthread_mutex_lock(&ctx->mx_ts);
+	valid = ctx->ts_valid && ((now.tv_sec - ctx->ts_host.tv_sec) < max_age_s);
+	if (valid) {
+		*count_us64 = ts_predict_at(ctx, &now);
+	}
+	pthread_mutex_unlock(&ctx->mx_ts);
+	return valid;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* anchor the 64-bit timeline on a live counter value read just before, restart it at lgw_start */
+void ts_anchor(struct lgw_ctx_s *ctx, uint32_t count_us, bool restart) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	pthread_mutex_lock(&ctx->mx_ts);
+	ctx->ts_ext = (restart || !ctx->ts_valid) ? count_us : ts_extend_at(ctx, count_us, &now);
+	ctx->ts_host = now;
+	ctx->ts_valid = true;
+	pthread_mutex_unlock(&ctx->mx_ts);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* read the live counter: TIMESTAMP gives the PPS capture while GPS_EN is set (a PPS during the read is missed) */
+int read_instcnt(struct lgw_ctx_s *ctx, uint32_t *count_us) {
+	int32_t val = 0;
+	int stat = LGW_REG_SUCCESS;
+
+	pthread_mutex_lock(&ctx->mx_pps);
+	stat |= lgw_reg_wi(ctx->reg, GPS_EN, 0);
+	stat |= lgw_reg_ri(ctx->reg, TIMESTAMP, &val);
+	stat |= lgw_reg_wi(ctx->reg, GPS_EN, 1);
+	pthread_mutex_unlock(&ctx->mx_pps);
+	*count_us = (uint32_t)val;
+	return (stat == LGW_REG_SUCCESS) ? 0 : -1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int start_concentrator(struct lgw_ctx_s *ctx) {
 	int i;
 	int reg_stat;
 	unsigned x;
 	uint8_t radio_select;
-	int32_t read_val;
-	uint8_t load_val;
+	int32_t read_val = 0;
 
 	uint8_t cal_cmd;
 	uint16_t cal_time;
 	uint8_t cal_status;
+	bool radio_setup[LGW_RF_CHAIN_NB]; /* radios with a valid RX frequency */
 
-	if (lgw_is_started == true) {
+	if (ctx->is_started == true) {
 		DEBUG_MSG("Note: LoRa concentrator already started, restarting it now\n");
 	}
 
-	reg_stat = lgw_connect();
+	reg_stat = lgw_connect_ctx(ctx->reg);
 	if (reg_stat == LGW_REG_ERROR) {
 		DEBUG_MSG("ERROR: FAIL TO CONNECT BOARD\n");
 		return LGW_HAL_ERROR;
 	}
 
 	/* reset the registers (also shuts the radios down) */
-	lgw_soft_reset();
+	lgw_soft_reset_ctx(ctx->reg);
 
 	/* ungate clocks (gated by default) */
-	lgw_reg_w(LGW_GLOBAL_EN, 1);
+	lgw_reg_w_ctx(ctx->reg, LGW_GLOBAL_EN, 1);
 
 	/* switch on and reset the radios (also starts the 32 MHz XTAL) */
-	lgw_reg_w(LGW_RADIO_A_EN,1);
-	lgw_reg_w(LGW_RADIO_B_EN,1);
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_A_EN,1);
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_B_EN,1);
 	wait_ms(500); /* TODO: optimize */
-	lgw_reg_w(LGW_RADIO_RST,1);
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_RST,1);
 	wait_ms(5);
-	lgw_reg_w(LGW_RADIO_RST,0);
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_RST,0);
 
-	rf_clkout[0] = true;
-	rf_clkout[1] = true;
+	ctx->rf_clkout[0] = true;
+	ctx->rf_clkout[1] = true;
 
-	rf_radio_chip_id[0] = sx125x_read(0, 7);
-	rf_radio_chip_id[1] = sx125x_read(1, 7);
+	ctx->rf_radio_chip_id[0] = sx125x_read(ctx, 0, 7);
+	ctx->rf_radio_chip_id[1] = sx125x_read(ctx, 1, 7);
 
-	if(rf_radio_chip_id[0] == ID_SX1255){
+	if(ctx->rf_radio_chip_id[0] == ID_SX1255){
 		DEBUG_MSG("CHAIN A SX1255\n");
-		rf_rx_lowfreq[0] = LGW_RF_SX1255_FREQ_MIN;
-		rf_rx_upfreq[0] = LGW_RF_SX1255_FREQ_MAX;
-		rf_tx_lowfreq[0] = LGW_RF_SX1255_FREQ_MIN;
-		rf_tx_upfreq[0] = LGW_RF_SX1255_FREQ_MAX;
-	}else if(rf_radio_chip_id[0] == ID_SX1257){
+		ctx->rf_rx_lowfreq[0] = LGW_RF_SX1255_FREQ_MIN;
+		ctx->rf_rx_upfreq[0] = LGW_RF_SX1255_FREQ_MAX;
+		ctx->rf_tx_lowfreq[0] = LGW_RF_SX1255_FREQ_MIN;
+		ctx->rf_tx_upfreq[0] = LGW_RF_SX1255_FREQ_MAX;
+	}else if(ctx->rf_radio_chip_id[0] == ID_SX1257){
 		DEBUG_MSG("CHAIN A SX1257\n");
-		rf_rx_lowfreq[0] = LGW_RF_SX1257_FREQ_MIN;
-		rf_rx_upfreq[0] = LGW_RF_SX1257_FREQ_MAX;
-		rf_tx_lowfreq[0] = LGW_RF_SX1257_FREQ_MIN;
-		rf_tx_upfreq[0] = LGW_RF_SX1257_FREQ_MAX;
+		ctx->rf_rx_lowfreq[0] = LGW_RF_SX1257_FREQ_MIN;
+		ctx->rf_rx_upfreq[0] = LGW_RF_SX1257_FREQ_MAX;
+		ctx->rf_tx_lowfreq[0] = LGW_RF_SX1257_FREQ_MIN;
+		ctx->rf_tx_upfreq[0] = LGW_RF_SX1257_FREQ_MAX;
 	}else{
 		DEBUG_MSG("CHAIN A UNKNOWN\n");
 	}
 
-	if(rf_radio_chip_id[1] == ID_SX1255){
+	if(ctx->rf_radio_chip_id[1] == ID_SX1255){
 		DEBUG_MSG("CHAIN B SX1255\n");
-		rf_rx_lowfreq[1] = LGW_RF_SX1255_FREQ_MIN;
-		rf_rx_upfreq[1] = LGW_RF_SX1255_FREQ_MAX;
-		rf_tx_lowfreq[1] = LGW_RF_SX1255_FREQ_MIN;
-		rf_tx_upfreq[1] = LGW_RF_SX1255_FREQ_MAX;
-	}else if(rf_radio_chip_id[1] == ID_SX1257){
+		ctx->rf_rx_lowfreq[1] = LGW_RF_SX1255_FREQ_MIN;
+		ctx->rf_rx_upfreq[1] = LGW_RF_SX1255_FREQ_MAX;
+		ctx->rf_tx_lowfreq[1] = LGW_RF_SX1255_FREQ_MIN;
+		ctx->rf_tx_upfreq[1] = LGW_RF_SX1255_FREQ_MAX;
+	}else if(ctx->rf_radio_chip_id[1] == ID_SX1257){
 		DEBUG_MSG("CHAIN B SX1257\n");
-		rf_rx_lowfreq[1] = LGW_RF_SX1257_FREQ_MIN;
-		rf_rx_upfreq[1] = LGW_RF_SX1257_FREQ_MAX;
-		rf_tx_lowfreq[1] = LGW_RF_SX1257_FREQ_MIN;
-		rf_tx_upfreq[1] = LGW_RF_SX1257_FREQ_MAX;
+		ctx->rf_rx_lowfreq[1] = LGW_RF_SX1257_FREQ_MIN;
+		ctx->rf_rx_upfreq[1] = LGW_RF_SX1257_FREQ_MAX;
+		ctx->rf_tx_lowfreq[1] = LGW_RF_SX1257_FREQ_MIN;
+		ctx->rf_tx_upfreq[1] = LGW_RF_SX1257_FREQ_MAX;
 	}else{
 		DEBUG_MSG("CHAIN B UNKNOWN\n");
 	}
 
-	/* setup the radios */
-	if( rf_rx_freq[0]>=rf_rx_lowfreq[0] && rf_rx_freq[0]<=rf_rx_upfreq[0] ){
-		setup_sx125x(0, rf_rx_freq[0]);
+	/* setup the radios, both at once */
+	if( ctx->rf_rx_freq[0]>=ctx->rf_rx_lowfreq[0] && ctx->rf_rx_freq[0]<=ctx->rf_rx_upfreq[0] ){
+		radio_setup[0] = true;
 	}else{
-		DEBUG_PRINTF("CHAIN A Freqeucy %d Invalid\n", rf_rx_freq[0]);
+		radio_setup[0] = false;
+		DEBUG_PRINTF("CHAIN A Freqeucy %d Invalid\n", ctx->rf_rx_freq[0]);
 		// return LGW_HAL_ERROR;
 	}
-	if( rf_rx_freq[1]>=rf_rx_lowfreq[1] && rf_rx_freq[1]<=rf_rx_upfreq[1] ){
-		setup_sx125x(1, rf_rx_freq[1]);
+	if( ctx->rf_rx_freq[1]>=ctx->rf_rx_lowfreq[1] && ctx->rf_rx_freq[1]<=ctx->rf_rx_upfreq[1] ){
+		radio_setup[1] = true;
 	}else{
-		DEBUG_PRINTF("CHAIN B Freqeucy %d Invalid\n", rf_rx_freq[1]);
+		radio_setup[1] = false;
+		DEBUG_PRINTF("CHAIN B Freqeucy %d Invalid\n", ctx->rf_rx_freq[1]);
 		// return LGW_HAL_ERROR;
 	}
+	setup_sx125x(ctx, radio_setup);
 
 #if (CFG_RADIO_AUTO != 1)
 	/* select calibration command */
 	cal_cmd = 0;
-	cal_cmd |= rf_enable[0] ? 0x01 : 0x00; /* Bit 0: Calibrate Rx IQ mismatch compensation on radio A */
-	cal_cmd |= rf_enable[1] ? 0x02 : 0x00; /* Bit 1: Calibrate Rx IQ mismatch compensation on radio B */
-	cal_cmd |= (rf_enable[0] && rf_tx_enable[0]) ? 0x04 : 0x00; /* Bit 2: Calibrate Tx DC offset on radio A */
-	cal_cmd |= (rf_enable[1] && rf_tx_enable[1]) ? 0x08 : 0x00; /* Bit 3: Calibrate Tx DC offset on radio B */
+	cal_cmd |= ctx->rf_enable[0] ? 0x01 : 0x00; /* Bit 0: Calibrate Rx IQ mismatch compensation on radio A */
+	cal_cmd |= ctx->rf_enable[1] ? 0x02 : 0x00; /* Bit 1: Calibrate Rx IQ mismatch compensation on radio B */
+	cal_cmd |= (ctx->rf_enable[0] && rf_tx_enable[0]) ? 0x04 : 0x00; /* Bit 2: Calibrate Tx DC offset on radio A */
+	cal_cmd |= (ctx->rf_enable[1] && rf_tx_enable[1]) ? 0x08 : 0x00; /* Bit 3: Calibrate Tx DC offset on radio B */
 	cal_cmd |= 0x10; /* Bit 4: 0: calibrate with DAC gain=2, 1: with DAC gain=3 (use 3) */
 
 	#if (CFG_RADIO_1257 == 1)
@@ -1078,20 +1677,23 @@ int lgw_start(void) {
 	#endif
 
 	/* Load the calibration firmware  */
-	load_firmware(MCU_AGC, cal_firmware, MCU_AGC_FW_BYTE);
-	lgw_reg_w(LGW_FORCE_HOST_RADIO_CTRL,0); /* gives to AGC MCU the control of the radios */
-	lgw_reg_w(LGW_RADIO_SELECT,cal_cmd); /* send calibration configuration word */
-	lgw_reg_w(LGW_MCU_RST_1,0);
-	lgw_reg_w(LGW_PAGE_REG,3); /* Calibration will start on this condition as soon as MCU can talk to concentrator registers */
-	lgw_reg_w(LGW_EMERGENCY_FORCE_HOST_CTRL,0); /* Give control of concentrator registers to MCU */
+	if (load_firmware(ctx, MCU_AGC, cal_firmware, MCU_AGC_FW_BYTE) != 0) {
+		DEBUG_MSG("ERROR: FAILED TO LOAD CALIBRATION FIRMWARE\n");
+		return LGW_HAL_ERROR;
+	}
+	lgw_reg_w_ctx(ctx->reg, LGW_FORCE_HOST_RADIO_CTRL,0); /* gives to AGC MCU the control of the radios */
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_SELECT,cal_cmd); /* send calibration configuration word */
+	lgw_reg_w_ctx(ctx->reg, LGW_MCU_RST_1,0);
+	lgw_reg_w_ctx(ctx->reg, LGW_PAGE_REG,3); /* Calibration will start on this condition as soon as MCU can talk to concentrator registers */
+	lgw_reg_w_ctx(ctx->reg, LGW_EMERGENCY_FORCE_HOST_CTRL,0); /* Give control of concentrator registers to MCU */
 
 	/* Wait for calibration to end */
 	DEBUG_PRINTF("Note: calibration started (time: %u ms)\n", cal_time);
 	wait_ms(cal_time); /* Wait for end of calibration */
-	lgw_reg_w(LGW_EMERGENCY_FORCE_HOST_CTRL,1); /* Take back control */
+	lgw_reg_w_ctx(ctx->reg, LGW_EMERGENCY_FORCE_HOST_CTRL,1); /* Take back control */
 
 	/* Get calibration status */
-	lgw_reg_r(LGW_MCU_AGC_STATUS, &read_val);
+	lgw_reg_r_ctx(ctx->reg, LGW_MCU_AGC_STATUS, &read_val);
 	cal_status = (uint8_t)read_val;
 	/*
 		bit 7: calibration finished
@@ -1109,39 +1711,39 @@ int lgw_start(void) {
 	} else {
 		DEBUG_PRINTF("Note: calibration finished (status = %02x)\n", cal_status);
 	}
-	if (rf_enable[0] && ((cal_status & 0x02) == 0)) {
+	if (ctx->rf_enable[0] && ((cal_status & 0x02) == 0)) {
 		DEBUG_MSG("WARNING: calibration could not access radio A\n");
 	}
-	if (rf_enable[1] && ((cal_status & 0x04) == 0)) {
+	if (ctx->rf_enable[1] && ((cal_status & 0x04) == 0)) {
 		DEBUG_MSG("WARNING: calibration could not access radio B\n");
 	}
-	if (rf_enable[0] && ((cal_status & 0x08) == 0)) {
+	if (ctx->rf_enable[0] && ((cal_status & 0x08) == 0)) {
 		DEBUG_MSG("WARNING: problem in calibration of radio A for image rejection\n");
 	}
-	if (rf_enable[1] && ((cal_status & 0x10) == 0)) {
+	if (ctx->rf_enable[1] && ((cal_status & 0x10) == 0)) {
 		DEBUG_MSG("WARNING: problem in calibration of radio B for image rejection\n");
 	}
-	if (rf_enable[0] && rf_tx_enable[0] && ((cal_status & 0x20) == 0)) {
+	if (ctx->rf_enable[0] && rf_tx_enable[0] && ((cal_status & 0x20) == 0)) {
 		DEBUG_MSG("WARNING: problem in calibration of radio A for TX imbalance\n");
 	}
-	if (rf_enable[1] && rf_tx_enable[1] && ((cal_status & 0x40) == 0)) {
+	if (ctx->rf_enable[1] && rf_tx_enable[1] && ((cal_status & 0x40) == 0)) {
 		DEBUG_MSG("WARNING: problem in calibration of radio B for TX imbalance\n");
 	}
 
 	/* Get TX DC offset values */
 	for(i=0; i<=7; ++i) {
-		lgw_reg_w(LGW_DBG_AGC_MCU_RAM_ADDR, 0xA0+i);
-		lgw_reg_r(LGW_DBG_AGC_MCU_RAM_DATA, &read_val);
-		cal_offset_a_i[i] = (int8_t)read_val;
-		lgw_reg_w(LGW_DBG_AGC_MCU_RAM_ADDR, 0xA8+i);
-		lgw_reg_r(LGW_DBG_AGC_MCU_RAM_DATA, &read_val);
-		cal_offset_a_q[i] = (int8_t)read_val;
-		lgw_reg_w(LGW_DBG_AGC_MCU_RAM_ADDR, 0xB0+i);
-		lgw_reg_r(LGW_DBG_AGC_MCU_RAM_DATA, &read_val);
-		cal_offset_b_i[i] = (int8_t)read_val;
-		lgw_reg_w(LGW_DBG_AGC_MCU_RAM_ADDR, 0xB8+i);
-		lgw_reg_r(LGW_DBG_AGC_MCU_RAM_DATA, &read_val);
-		cal_offset_b_q[i] = (int8_t)read_val;
+		lgw_reg_w_ctx(ctx->reg, LGW_DBG_AGC_MCU_RAM_ADDR, 0xA0+i);
+		lgw_reg_r_ctx(ctx->reg, LGW_DBG_AGC_MCU_RAM_DATA, &read_val);
+		ctx->cal_offset_a_i[i] = (int8_t)read_val;
+		lgw_reg_w_ctx(ctx->reg, LGW_DBG_AGC_MCU_RAM_ADDR, 0xA8+i);
+		lgw_reg_r_ctx(ctx->reg, LGW_DBG_AGC_MCU_RAM_DATA, &read_val);
+		ctx->cal_offset_a_q[i] = (int8_t)read_val;
+		lgw_reg_w_ctx(ctx->reg, LGW_DBG_AGC_MCU_RAM_ADDR, 0xB0+i);
+		lgw_reg_r_ctx(ctx->reg, LGW_DBG_AGC_MCU_RAM_DATA, &read_val);
+		ctx->cal_offset_b_i[i] = (int8_t)read_val;
+		lgw_reg_w_ctx(ctx->reg, LGW_DBG_AGC_MCU_RAM_ADDR, 0xB8+i);
+		lgw_reg_r_ctx(ctx->reg, LGW_DBG_AGC_MCU_RAM_DATA, &read_val);
+		ctx->cal_offset_b_q[i] = (int8_t)read_val;
 	}
 #else
 	cal_cmd = cal_cmd;
@@ -1151,176 +1753,129 @@ int lgw_start(void) {
 #endif /* CFG_RADIO_AUTO */
 
 	/* load adjusted parameters */
-	lgw_constant_adjust();
+	lgw_constant_adjust(ctx);
 
 	/* Freq-to-time-drift calculation */
-	x = (2 * 8192000000) / (uint64_t)(rf_rx_lowfreq[0] + rf_rx_upfreq[0]); /* 64b calculation */
+	x = (2 * 8192000000) / (uint64_t)(ctx->rf_rx_lowfreq[0] + ctx->rf_rx_upfreq[0]); /* 64b calculation */
 	if (x > 63) {
 		x = 63;
 	}
-	lgw_reg_w(LGW_FREQ_TO_TIME_DRIFT, x); /* default 9 */
-	x = (2 * 32768000000) / (uint64_t)(rf_rx_lowfreq[0] + rf_rx_upfreq[0]); /* 64b calculation */
+	lgw_reg_w_ctx(ctx->reg, LGW_FREQ_TO_TIME_DRIFT, x); /* default 9 */
+	x = (2 * 32768000000) / (uint64_t)(ctx->rf_rx_lowfreq[0] + ctx->rf_rx_upfreq[0]); /* 64b calculation */
 	if (x > 63) {
 		x = 63;
 	}
-	lgw_reg_w(LGW_MBWSSF_FREQ_TO_TIME_DRIFT, x); /* default 36 */
+	lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_FREQ_TO_TIME_DRIFT, x); /* default 36 */
 
 	/* configure LoRa 'multi' demodulators aka. LoRa 'sensor' channels (IF0-3) */
 
 	radio_select = 0; /* IF mapping to radio A/B (per bit, 0=A, 1=B) */
 	for(i=0; i<LGW_MULTI_NB; ++i) {
-		radio_select += (if_rf_chain[i] == 1 ? 1 << i : 0); /* transform bool array into binary word */
+		radio_select += (ctx->if_rf_chain[i] == 1 ? 1 << i : 0); /* transform bool array into binary word */
 	}
 	/*
-	lgw_reg_w(LGW_RADIO_SELECT, radio_select);
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_SELECT, radio_select);
 
 	LGW_RADIO_SELECT is used for communication with the firmware, "radio_select"
 	will be loaded in LGW_RADIO_SELECT at the end of start procedure.
 	*/
 
-	lgw_reg_w(LGW_IF_FREQ_0, IF_HZ_TO_REG(if_freq[0])); /* default -384 */
-	lgw_reg_w(LGW_IF_FREQ_1, IF_HZ_TO_REG(if_freq[1])); /* default -128 */
-	lgw_reg_w(LGW_IF_FREQ_2, IF_HZ_TO_REG(if_freq[2])); /* default 128 */
-	lgw_reg_w(LGW_IF_FREQ_3, IF_HZ_TO_REG(if_freq[3])); /* default 384 */
+	lgw_reg_w_ctx(ctx->reg, LGW_IF_FREQ_0, IF_HZ_TO_REG(ctx->if_freq[0])); /* default -384 */
+	lgw_reg_w_ctx(ctx->reg, LGW_IF_FREQ_1, IF_HZ_TO_REG(ctx->if_freq[1])); /* default -128 */
+	lgw_reg_w_ctx(ctx->reg, LGW_IF_FREQ_2, IF_HZ_TO_REG(ctx->if_freq[2])); /* default 128 */
+	lgw_reg_w_ctx(ctx->reg, LGW_IF_FREQ_3, IF_HZ_TO_REG(ctx->if_freq[3])); /* default 384 */
 	#if (CFG_CHIP_1301 == 1)
-	lgw_reg_w(LGW_IF_FREQ_4, IF_HZ_TO_REG(if_freq[4])); /* default -384 */
-	lgw_reg_w(LGW_IF_FREQ_5, IF_HZ_TO_REG(if_freq[5])); /* default -128 */
-	lgw_reg_w(LGW_IF_FREQ_6, IF_HZ_TO_REG(if_freq[6])); /* default 128 */
-	lgw_reg_w(LGW_IF_FREQ_7, IF_HZ_TO_REG(if_freq[7])); /* default 384 */
+	lgw_reg_w_ctx(ctx->reg, LGW_IF_FREQ_4, IF_HZ_TO_REG(ctx->if_freq[4])); /* default -384 */
+	lgw_reg_w_ctx(ctx->reg, LGW_IF_FREQ_5, IF_HZ_TO_REG(ctx->if_freq[5])); /* default -128 */
+	lgw_reg_w_ctx(ctx->reg, LGW_IF_FREQ_6, IF_HZ_TO_REG(ctx->if_freq[6])); /* default 128 */
+	lgw_reg_w_ctx(ctx->reg, LGW_IF_FREQ_7, IF_HZ_TO_REG(ctx->if_freq[7])); /* default 384 */
 	#endif
 
-	lgw_reg_w(LGW_CORR0_DETECT_EN, (if_enable[0] == true) ? lora_multi_sfmask[0] : 0); /* default 0 */
-	lgw_reg_w(LGW_CORR1_DETECT_EN, (if_enable[1] == true) ? lora_multi_sfmask[1] : 0); /* default 0 */
-	lgw_reg_w(LGW_CORR2_DETECT_EN, (if_enable[2] == true) ? lora_multi_sfmask[2] : 0); /* default 0 */
-	lgw_reg_w(LGW_CORR3_DETECT_EN, (if_enable[3] == true) ? lora_multi_sfmask[3] : 0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_CORR0_DETECT_EN, (ctx->if_enable[0] == true) ? ctx->lora_multi_sfmask[0] : 0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_CORR1_DETECT_EN, (ctx->if_enable[1] == true) ? ctx->lora_multi_sfmask[1] : 0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_CORR2_DETECT_EN, (ctx->if_enable[2] == true) ? ctx->lora_multi_sfmask[2] : 0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_CORR3_DETECT_EN, (ctx->if_enable[3] == true) ? ctx->lora_multi_sfmask[3] : 0); /* default 0 */
 	#if (CFG_CHIP_1301 == 1)
-	lgw_reg_w(LGW_CORR4_DETECT_EN, (if_enable[4] == true) ? lora_multi_sfmask[4] : 0); /* default 0 */
-	lgw_reg_w(LGW_CORR5_DETECT_EN, (if_enable[5] == true) ? lora_multi_sfmask[5] : 0); /* default 0 */
-	lgw_reg_w(LGW_CORR6_DETECT_EN, (if_enable[6] == true) ? lora_multi_sfmask[6] : 0); /* default 0 */
-	lgw_reg_w(LGW_CORR7_DETECT_EN, (if_enable[7] == true) ? lora_multi_sfmask[7] : 0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_CORR4_DETECT_EN, (ctx->if_enable[4] == true) ? ctx->lora_multi_sfmask[4] : 0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_CORR5_DETECT_EN, (ctx->if_enable[5] == true) ? ctx->lora_multi_sfmask[5] : 0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_CORR6_DETECT_EN, (ctx->if_enable[6] == true) ? ctx->lora_multi_sfmask[6] : 0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_CORR7_DETECT_EN, (ctx->if_enable[7] == true) ? ctx->lora_multi_sfmask[7] : 0); /* default 0 */
 	#endif
 
-	lgw_reg_w(LGW_PPM_OFFSET, 0x60); /* as the threshold is 16ms, use 0x60 to enable ppm_offset for SF12 and SF11 @125kHz*/
+	lgw_reg_w_ctx(ctx->reg, LGW_PPM_OFFSET, 0x60); /* as the threshold is 16ms, use 0x60 to enable ppm_offset for SF12 and SF11 @125kHz*/
 
-	lgw_reg_w(LGW_CONCENTRATOR_MODEM_ENABLE,1); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_CONCENTRATOR_MODEM_ENABLE,1); /* default 0 */
 
 	/* configure LoRa 'stand-alone' modem (IF8) */
-	lgw_reg_w(LGW_IF_FREQ_8, IF_HZ_TO_REG(if_freq[8])); /* MBWSSF modem (default 0) */
-	if (if_enable[8] == true) {
-		lgw_reg_w(LGW_MBWSSF_RADIO_SELECT, if_rf_chain[8]);
-		switch(lora_rx_bw) {
-			case BW_125KHZ: lgw_reg_w(LGW_MBWSSF_MODEM_BW,0); break;
-			case BW_250KHZ: lgw_reg_w(LGW_MBWSSF_MODEM_BW,1); break;
-			case BW_500KHZ: lgw_reg_w(LGW_MBWSSF_MODEM_BW,2); break;
+	lgw_reg_w_ctx(ctx->reg, LGW_IF_FREQ_8, IF_HZ_TO_REG(ctx->if_freq[8])); /* MBWSSF modem (default 0) */
+	if (ctx->if_enable[8] == true) {
+		lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_RADIO_SELECT, ctx->if_rf_chain[8]);
+		switch(ctx->lora_rx_bw) {
+			case BW_125KHZ: lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_MODEM_BW,0); break;
+			case BW_250KHZ: lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_MODEM_BW,1); break;
+			case BW_500KHZ: lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_MODEM_BW,2); break;
 			default:
-				DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d IN SWITCH STATEMENT\n", lora_rx_bw);
+				DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d IN SWITCH STATEMENT\n", ctx->lora_rx_bw);
 				return LGW_HAL_ERROR;
 		}
-		switch(lora_rx_sf) {
-			case DR_LORA_SF7: lgw_reg_w(LGW_MBWSSF_RATE_SF,7); break;
-			case DR_LORA_SF8: lgw_reg_w(LGW_MBWSSF_RATE_SF,8); break;
-			case DR_LORA_SF9: lgw_reg_w(LGW_MBWSSF_RATE_SF,9); break;
-			case DR_LORA_SF10: lgw_reg_w(LGW_MBWSSF_RATE_SF,10); break;
-			case DR_LORA_SF11: lgw_reg_w(LGW_MBWSSF_RATE_SF,11); break;
-			case DR_LORA_SF12: lgw_reg_w(LGW_MBWSSF_RATE_SF,12); break;
+		switch(ctx->lora_rx_sf) {
+			case DR_LORA_SF7: lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_RATE_SF,7); break;
+			case DR_LORA_SF8: lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_RATE_SF,8); break;
+			case DR_LORA_SF9: lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_RATE_SF,9); break;
+			case DR_LORA_SF10: lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_RATE_SF,10); break;
+			case DR_LORA_SF11: lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_RATE_SF,11); break;
+			case DR_LORA_SF12: lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_RATE_SF,12); break;
 			default:
-				DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d IN SWITCH STATEMENT\n", lora_rx_sf);
+				DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d IN SWITCH STATEMENT\n", ctx->lora_rx_sf);
 				return LGW_HAL_ERROR;
 		}
-		lgw_reg_w(LGW_MBWSSF_PPM_OFFSET, lora_rx_ppm_offset); /* default 0 */
-		lgw_reg_w(LGW_MBWSSF_MODEM_ENABLE, 1); /* default 0 */
+		lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_PPM_OFFSET, ctx->lora_rx_ppm_offset); /* default 0 */
+		lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_MODEM_ENABLE, 1); /* default 0 */
 	} else {
-		lgw_reg_w(LGW_MBWSSF_MODEM_ENABLE, 0);
+		lgw_reg_w_ctx(ctx->reg, LGW_MBWSSF_MODEM_ENABLE, 0);
 	}
 
 	/* configure FSK modem (IF9) */
-	lgw_reg_w(LGW_IF_FREQ_9, IF_HZ_TO_REG(if_freq[9])); /* FSK modem, default 0 */
-	if (if_enable[9] == true) {
-		lgw_reg_w(LGW_FSK_RADIO_SELECT, if_rf_chain[9]);
-		lgw_reg_w(LGW_FSK_BR_RATIO,LGW_XTAL_FREQU/fsk_rx_dr); /* setting the dividing ratio for datarate */
-		lgw_reg_w(LGW_FSK_CH_BW_EXPO,fsk_rx_bw);
-		lgw_reg_w(LGW_FSK_MODEM_ENABLE,1); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_IF_FREQ_9, IF_HZ_TO_REG(ctx->if_freq[9])); /* FSK modem, default 0 */
+	if (ctx->if_enable[9] == true) {
+		lgw_reg_w_ctx(ctx->reg, LGW_FSK_RADIO_SELECT, ctx->if_rf_chain[9]);
+		lgw_reg_w_ctx(ctx->reg, LGW_FSK_BR_RATIO,LGW_XTAL_FREQU/ctx->fsk_rx_dr); /* setting the dividing ratio for datarate */
+		lgw_reg_w_ctx(ctx->reg, LGW_FSK_CH_BW_EXPO,ctx->fsk_rx_bw);
+		lgw_reg_w_ctx(ctx->reg, LGW_FSK_MODEM_ENABLE,1); /* default 0 */
 	} else {
-		lgw_reg_w(LGW_FSK_MODEM_ENABLE,0);
+		lgw_reg_w_ctx(ctx->reg, LGW_FSK_MODEM_ENABLE,0);
 	}
 
 	/* Load firmware */
-	load_firmware(MCU_ARB, arb_firmware, MCU_ARB_FW_BYTE);
-	load_firmware(MCU_AGC, agc_firmware, MCU_AGC_FW_BYTE);
+	if ((load_firmware(ctx, MCU_ARB, arb_firmware, MCU_ARB_FW_BYTE) != 0) || (load_firmware(ctx, MCU_AGC, agc_firmware, MCU_AGC_FW_BYTE) != 0)) {
+		DEBUG_MSG("ERROR: FAILED TO LOAD FIRMWARE\n");
+		return LGW_HAL_ERROR;
+	}
 
 	/* gives the AGC MCU control over radio, RF front-end and filter gain */
-	lgw_reg_w(LGW_FORCE_HOST_RADIO_CTRL,0);
-	lgw_reg_w(LGW_FORCE_HOST_FE_CTRL,0);
-	lgw_reg_w(LGW_FORCE_DEC_FILTER_GAIN,0);
+	lgw_reg_w_ctx(ctx->reg, LGW_FORCE_HOST_RADIO_CTRL,0);
+	lgw_reg_w_ctx(ctx->reg, LGW_FORCE_HOST_FE_CTRL,0);
+	lgw_reg_w_ctx(ctx->reg, LGW_FORCE_DEC_FILTER_GAIN,0);
 
 	/* Get MCUs out of reset */
-	lgw_reg_w(LGW_RADIO_SELECT, 0); /* MUST not be = to 1 or 2 at firmware init */
-	lgw_reg_w(LGW_MCU_RST_0, 0);
-	lgw_reg_w(LGW_MCU_RST_1, 0);
-
-	DEBUG_MSG("Info: Initialising AGC firmware...\n");
-	wait_ms(1);
-
-	lgw_reg_r(LGW_MCU_AGC_STATUS, &read_val);
-	if (read_val != 0x20) {
-		DEBUG_PRINTF("ERROR: AGC FIRMWARE INITIALIZATION FAILURE, STATUS 0x%02X\n", (uint8_t)read_val);
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_SELECT, 0); /* MUST not be = to 1 or 2 at firmware init */
+	lgw_reg_w_ctx(ctx->reg, LGW_MCU_RST_0, 0);
+	ctx->agc_radio_select = radio_select;
+	if (agc_init(ctx) != 0) {
 		return LGW_HAL_ERROR;
 	}
+	tx_pow_map_build(ctx);
 
-	/* Update Tx gain LUT and start AGC */
-
-	#if (CUSTOM_TX_POW_TABLE == 1)
-		DEBUG_MSG("Info: loading custom TX gain table\n");
-		for(i=0; i<TX_POW_LUT_SIZE; ++i) {
-			lgw_reg_w(LGW_RADIO_SELECT, AGC_CMD_WAIT); /* start a transaction */
-			wait_ms(1);
-			load_val = tx_pow_table[i].mix_gain + (16 * tx_pow_table[i].dac_gain) + (64 * tx_pow_table[i].pa_gain);
-			lgw_reg_w(LGW_RADIO_SELECT, load_val);
-			wait_ms(1);
-			lgw_reg_r(LGW_MCU_AGC_STATUS, &read_val);
-			if (read_val != (0x30 + i)) {
-				DEBUG_PRINTF("ERROR: AGC FIRMWARE INITIALIZATION FAILURE, STATUS 0x%02X\n", (uint8_t)read_val);
-				return LGW_HAL_ERROR;
-			}
-		}
-	#else
-		lgw_reg_w(LGW_RADIO_SELECT, AGC_CMD_WAIT); /* start a transaction */
-		wait_ms(1);
-		load_val = AGC_CMD_ABORT;
-		lgw_reg_w(LGW_RADIO_SELECT, load_val);
-		wait_ms(1);
-		DEBUG_MSG("Info: TX gain LUT update skipped, using default LUT\n");
-		lgw_reg_r(LGW_MCU_AGC_STATUS, &read_val);
-		if (read_val != 0x30) {
-			DEBUG_PRINTF("ERROR: AGC FIRMWARE INITIALIZATION FAILURE, STATUS 0x%02X\n", (uint8_t)read_val);
-			return LGW_HAL_ERROR;
-		}
-	#endif
-
-	/* Load chan_select firmware option */
-	lgw_reg_w(LGW_RADIO_SELECT, AGC_CMD_WAIT);
-	wait_ms(1);
-	lgw_reg_w(LGW_RADIO_SELECT, 0);
-	wait_ms(1);
-
-	/* End AGC firmware init and check status */
-	lgw_reg_w(LGW_RADIO_SELECT, AGC_CMD_WAIT);
-	wait_ms(1);
-	lgw_reg_w(LGW_RADIO_SELECT, radio_select); /* Load intended value of RADIO_SELECT */
-	wait_ms(1);
-	DEBUG_MSG("Info: putting back original RADIO_SELECT value\n");
-	lgw_reg_r(LGW_MCU_AGC_STATUS, &read_val);
-	if (read_val != 0x40) {
-		DEBUG_PRINTF("ERROR: AGC FIRMWARE INITIALIZATION FAILURE, STATUS 0x%02X\n", (uint8_t)read_val);
-		return LGW_HAL_ERROR;
-	}
+	/* start the 64-bit timeline while TIMESTAMP still gives the live counter */
+	lgw_reg_ri(ctx->reg, TIMESTAMP, &read_val);
+	ts_anchor(ctx, (uint32_t)read_val, true);
 
 	/* enable GPS event capture */
-	lgw_reg_w(LGW_GPS_EN,1);
+	lgw_reg_w_ctx(ctx->reg, LGW_GPS_EN,1);
 
 	/* enable LEDs */
-	lgw_reg_w(LGW_GPIO_MODE,31);
-	// lgw_reg_w(LGW_GPIO_SELECT_OUTPUT,0); /* default 0 */
+	lgw_reg_w_ctx(ctx->reg, LGW_GPIO_MODE,31);
+	// lgw_reg_w_ctx(ctx->reg, LGW_GPIO_SELECT_OUTPUT,0); /* default 0 */
 	/* LED table :
 	DGPIO0 -> packets waiting in the RX FIFO, ready to be fetched
 	DGPIO1 -> multi-SF RX LoRa modems activity (channels 0 to 7)
@@ -1329,23 +1884,50 @@ int lgw_start(void) {
 	DGPIO4 -> TX modem active (either LoRa or FSK)
 	*/
 
-	lgw_is_started = true;
+	ctx->is_started = true;
 	return LGW_HAL_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_stop(void) {
-	lgw_soft_reset();
-	lgw_disconnect();
+int lgw_start_ctx(struct lgw_ctx_s *ctx) {
+	int stat;
+	const char *site; /* register profiler site of the caller */
+
+	CHECK_NULL(ctx);
+	pthread_mutex_lock(&ctx->mx_rx);
+	pthread_mutex_lock(&ctx->mx_tx);
+	site = lgw_reg_profile_site("lgw_start");
+	stat = start_concentrator(ctx);
+	lgw_reg_profile_site(site);
+	pthread_mutex_unlock(&ctx->mx_tx);
+	pthread_mutex_unlock(&ctx->mx_rx);
 
-	lgw_is_started = false;
+	return stat;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_stop_ctx(struct lgw_ctx_s *ctx) {
+	CHECK_NULL(ctx);
+
+	pthread_mutex_lock(&ctx->mx_rx);
+	pthread_mutex_lock(&ctx->mx_tx);
+	lgw_soft_reset_ctx(ctx->reg);
+	lgw_disconnect_ctx(ctx->reg);
+
+	ctx->is_started = false;
+	pthread_mutex_lock(&ctx->mx_ts);
+	ctx->ts_valid = false;
+	pthread_mutex_unlock(&ctx->mx_ts);
+	pthread_mutex_unlock(&ctx->mx_tx);
+	pthread_mutex_unlock(&ctx->mx_rx);
 	return LGW_HAL_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
+int lgw_receive_ctx(struct lgw_ctx_s *ctx, uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
 	int nb_pkt_fetch; /* loop variable and return value */
 	struct lgw_pkt_rx_s *p; /* pointer to the current structure in the struct array */
 	uint8_t buff[255+RX_METADATA_NB]; /* buffer to store the result of SPI read bursts */
@@ -1356,20 +1938,26 @@ int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
 	uint32_t delay_x, delay_y, delay_z; /* temporary variable for timestamp offset calculation */
 	uint32_t timestamp_correction; /* correction to account for processing delay */
 	uint32_t sf, cr, bw_pow, crc_en, ppm; /* used to calculate timestamp correction */
-
-	/* check if the concentrator is running */
-	if (lgw_is_started == false) {
-		DEBUG_MSG("ERROR: CONCENTRATOR IS NOT RUNNING, START IT BEFORE RECEIVING\n");
-		return LGW_HAL_ERROR;
-	}
+	const char *site; /* register profiler site of the caller */
 
 	/* check input variables */
+	CHECK_NULL(ctx);
 	if (max_pkt <= 0) {
 		DEBUG_PRINTF("ERROR: %d = INVALID MAX NUMBER OF PACKETS TO FETCH\n", max_pkt);
 		return LGW_HAL_ERROR;
 	}
 	CHECK_NULL(pkt_data);
 
+	pthread_mutex_lock(&ctx->mx_rx);
+
+	/* check if the concentrator is running */
+	if (ctx->is_started == false) {
+		pthread_mutex_unlock(&ctx->mx_rx);
+		DEBUG_MSG("ERROR: CONCENTRATOR IS NOT RUNNING, START IT BEFORE RECEIVING\n");
+		return LGW_HAL_ERROR;
+	}
+	site = lgw_reg_profile_site("lgw_receive");
+
 	/* iterate max_pkt times at most */
 	for (nb_pkt_fetch = 0; nb_pkt_fetch < max_pkt; ++nb_pkt_fetch) {
 
@@ -1377,7 +1965,7 @@ int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
 		p = &pkt_data[nb_pkt_fetch];
 
 		/* fetch all the RX FIFO data */
-		lgw_reg_rb(LGW_RX_PACKET_DATA_FIFO_NUM_STORED, buff, 5);
+		lgw_reg_rbi(ctx->reg, RX_PACKET_DATA_FIFO_NUM_STORED, buff, 5);
 
 		/* how many packets are in the RX buffer ? Break if zero */
 		if (buff[0] == 0) {
@@ -1391,7 +1979,7 @@ int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
 		stat_fifo = buff[3]; /* will be used later, need to save it before overwriting buff */
 
 		/* get payload + metadata */
-		lgw_reg_rb(LGW_RX_DATA_BUF_DATA, buff, sz+RX_METADATA_NB);
+		lgw_reg_rbi(ctx->reg, RX_DATA_BUF_DATA, buff, sz+RX_METADATA_NB);
 
 		/* copy payload to result struct */
 		memcpy((void *)p->payload, (void *)buff, sz);
@@ -1428,7 +2016,7 @@ int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
 			if (ifmod == IF_LORA_MULTI) {
 				p->bandwidth = BW_125KHZ; /* fixed in hardware */
 			} else {
-				p->bandwidth = lora_rx_bw; /* get the parameter from the config variable */
+				p->bandwidth = ctx->lora_rx_bw; /* get the parameter from the config variable */
 			}
 			sf = (buff[sz+1] >> 4) & 0x0F;
 			switch (sf) {
@@ -1458,7 +2046,7 @@ int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
 
 			/* timestamp correction code, base delay */
 			if (ifmod == IF_LORA_STD) { /* if packet was received on the stand-alone LoRa modem */
-				switch (lora_rx_bw) {
+				switch (ctx->lora_rx_bw) {
 					case BW_125KHZ:
 						delay_x = 64;
 						bw_pow = 1;
@@ -1513,8 +2101,8 @@ int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
 			p->snr = -128.0;
 			p->snr_min = -128.0;
 			p->snr_max = -128.0;
-			p->bandwidth = fsk_rx_bw;
-			p->datarate = fsk_rx_dr;
+			p->bandwidth = ctx->fsk_rx_bw;
+			p->datarate = ctx->fsk_rx_dr;
 			p->coderate = CR_UNDEFINED;
 			timestamp_correction = 0; // TODO: implement FSK timestamp correction
 
@@ -1537,22 +2125,25 @@ int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
 
 		raw_timestamp = (uint32_t)buff[sz+6] + ((uint32_t)buff[sz+7] << 8) + ((uint32_t)buff[sz+8] << 16) + ((uint32_t)buff[sz+9] << 24);
 		p->count_us = raw_timestamp - timestamp_correction;
+		p->count_us64 = ts_extend(ctx, p->count_us);
 		p->crc = (uint16_t)buff[sz+10] + ((uint16_t)buff[sz+11] << 8);
 
 		/* get back info from configuration so that application doesn't have to keep track of it */
-		p->rf_chain = (uint8_t)if_rf_chain[p->if_chain];
-		p->freq_hz = (uint32_t)((int32_t)rf_rx_freq[p->rf_chain] + if_freq[p->if_chain]);
+		p->rf_chain = (uint8_t)ctx->if_rf_chain[p->if_chain];
+		p->freq_hz = (uint32_t)((int32_t)ctx->rf_rx_freq[p->rf_chain] + ctx->if_freq[p->if_chain]);
 
 		/* advance packet FIFO */
-		lgw_reg_w(LGW_RX_PACKET_DATA_FIFO_NUM_STORED, 0);
+		lgw_reg_wi(ctx->reg, RX_PACKET_DATA_FIFO_NUM_STORED, 0);
 	}
 
+	lgw_reg_profile_site(site);
+	pthread_mutex_unlock(&ctx->mx_rx);
 	return nb_pkt_fetch;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_send(struct lgw_pkt_tx_s pkt_data) {
+int lgw_send_ctx(struct lgw_ctx_s *ctx, struct lgw_pkt_tx_s pkt_data) {
 	int i;
 	uint8_t buff[256+TX_METADATA_NB]; /* buffer to prepare the packet to send + metadata before SPI write burst */
 	uint32_t part_int; /* integer part for PLL register value calculation */
@@ -1560,14 +2151,10 @@ int lgw_send(struct lgw_pkt_tx_s pkt_data) {
 	uint16_t fsk_dr_div; /* divider to configure for target datarate */
 	int transfer_size = 0; /* data to transfer from host to TX databuffer */
 	int payload_offset = 0; /* start of the payload content in the databuffer */
-	uint8_t pow_index = 0; /* 4-bit value to set the firmware TX power */
-	uint8_t target_mix_gain = 0; /* used to select the proper I/Q offset correction */
+	struct tx_pow_map_s tx_pow; /* firmware TX power and I/Q offset correction */
+	const char *site; /* register profiler site of the caller */
 
-	/* check if the concentrator is running */
-	if (lgw_is_started == false) {
-		DEBUG_MSG("ERROR: CONCENTRATOR IS NOT RUNNING, START IT BEFORE SENDING\n");
-		return LGW_HAL_ERROR;
-	}
+	CHECK_NULL(ctx);
 
 	/* check input range (segfault prevention) */
 	if (pkt_data.rf_chain >= LGW_RF_CHAIN_NB) {
@@ -1580,15 +2167,15 @@ int lgw_send(struct lgw_pkt_tx_s pkt_data) {
 		DEBUG_MSG("ERROR: SELECTED RF_CHAIN IS DISABLED FOR TX ON SELECTED BOARD\n");
 		return LGW_HAL_ERROR;
 	}
-	if (rf_enable[pkt_data.rf_chain] == false) {
+	if (ctx->rf_enable[pkt_data.rf_chain] == false) {
 		DEBUG_MSG("ERROR: SELECTED RF_CHAIN IS DISABLED\n");
 		return LGW_HAL_ERROR;
 	}
-	if (pkt_data.freq_hz > rf_tx_upfreq[pkt_data.rf_chain]) {
-		DEBUG_PRINTF("ERROR: FREQUENCY %d HIGHER THAN UPPER LIMIT %d OF RF_CHAIN %d\n", pkt_data.freq_hz, rf_tx_upfreq[pkt_data.rf_chain], pkt_data.rf_chain);
+	if (pkt_data.freq_hz > ctx->rf_tx_upfreq[pkt_data.rf_chain]) {
+		DEBUG_PRINTF("ERROR: FREQUENCY %d HIGHER THAN UPPER LIMIT %d OF RF_CHAIN %d\n", pkt_data.freq_hz, ctx->rf_tx_upfreq[pkt_data.rf_chain], pkt_data.rf_chain);
 		return LGW_HAL_ERROR;
-	} else if (pkt_data.freq_hz < rf_tx_lowfreq[pkt_data.rf_chain]) {
-		DEBUG_PRINTF("ERROR: FREQUENCY %d LOWER THAN LOWER LIMIT %d OF RF_CHAIN %d\n", pkt_data.freq_hz, rf_tx_lowfreq[pkt_data.rf_chain], pkt_data.rf_chain);
+	} else if (pkt_data.freq_hz < ctx->rf_tx_lowfreq[pkt_data.rf_chain]) {
+		DEBUG_PRINTF("ERROR: FREQUENCY %d LOWER THAN LOWER LIMIT %d OF RF_CHAIN %d\n", pkt_data.freq_hz, ctx->rf_tx_lowfreq[pkt_data.rf_chain], pkt_data.rf_chain);
 		return LGW_HAL_ERROR;
 	}
 	if (!IS_TX_MODE(pkt_data.tx_mode)) {
@@ -1630,35 +2217,25 @@ int lgw_send(struct lgw_pkt_tx_s pkt_data) {
 		return LGW_HAL_ERROR;
 	}
 
-	/* interpretation of TX power */
-	for (pow_index = TX_POW_LUT_SIZE-1; pow_index > 0; pow_index--) {
-		if (tx_pow_table[pow_index].rf_power <= pkt_data.rf_power) {
-			break;
-		}
-	}
-
-	/* loading TX imbalance correction */
-	target_mix_gain = tx_pow_table[pow_index].mix_gain;
-	target_mix_gain = (target_mix_gain <  8)?  8 : target_mix_gain;
-	target_mix_gain = (target_mix_gain > 15)? 15 : target_mix_gain;
-	if (pkt_data.rf_chain == 0) { /* use radio A calibration table */
-		lgw_reg_w(LGW_TX_OFFSET_I, cal_offset_a_i[target_mix_gain - 8]);
-		lgw_reg_w(LGW_TX_OFFSET_Q, cal_offset_a_q[target_mix_gain - 8]);
-	} else { /* use radio B calibration table */
-		lgw_reg_w(LGW_TX_OFFSET_I, cal_offset_b_i[target_mix_gain - 8]);
-		lgw_reg_w(LGW_TX_OFFSET_Q, cal_offset_b_q[target_mix_gain - 8]);
+	/* interpretation of TX power, direct lookup except outside of the usual range (table can be replaced by lgw_txgain_setconf) */
+	pthread_mutex_lock(&ctx->mx_tx);
+	if ((pkt_data.rf_power >= TX_POW_MAP_MIN) && (pkt_data.rf_power <= TX_POW_MAP_MAX)) {
+		tx_pow = ctx->tx_pow_map[pkt_data.rf_power - TX_POW_MAP_MIN];
+	} else {
+		tx_pow_resolve(ctx, pkt_data.rf_power, &tx_pow);
 	}
+	pthread_mutex_unlock(&ctx->mx_tx);
 
 	/* fixed metadata, useful payload and misc metadata compositing */
 	transfer_size = TX_METADATA_NB + pkt_data.size; /*  */
 	payload_offset = TX_METADATA_NB; /* start the payload just after the metadata */
 
 #if (CFG_RADIO_AUTO == 1)
-	if(rf_radio_chip_id[pkt_data.rf_chain] == ID_SX1255){
+	if(ctx->rf_radio_chip_id[pkt_data.rf_chain] == ID_SX1255){
 		DEBUG_PRINTF("CHAIN %c SX1255\n", (pkt_data.rf_chain == 0? 'A' :'B'));
 		part_int = pkt_data.freq_hz / (SX125x_32MHz_FRAC << 7); /* integer part, gives the MSB */
 		part_frac = ((pkt_data.freq_hz % (SX125x_32MHz_FRAC << 7)) << 9) / SX125x_32MHz_FRAC; /* fractional part, gives middle part and LSB */
-	}else if(rf_radio_chip_id[pkt_data.rf_chain] == ID_SX1257){
+	}else if(ctx->rf_radio_chip_id[pkt_data.rf_chain] == ID_SX1257){
 		DEBUG_PRINTF("CHAIN %c SX1257\n", (pkt_data.rf_chain == 0? 'A' :'B'));
 		part_int = pkt_data.freq_hz / (SX125x_32MHz_FRAC << 8); /* integer part, gives the MSB */
 		part_frac = ((pkt_data.freq_hz % (SX125x_32MHz_FRAC << 8)) << 8) / SX125x_32MHz_FRAC; /* fractional part, gives middle part and LSB */
@@ -1690,7 +2267,7 @@ int lgw_send(struct lgw_pkt_tx_s pkt_data) {
 	/* parameters depending on modulation  */
 	if (pkt_data.modulation == MOD_LORA) {
 		/* metadata 7, modulation type, radio chain selection and TX power */
-		buff[7] = (0x20 & (pkt_data.rf_chain << 5)) | (0x0F & pow_index); /* bit 4 is 0 -> LoRa modulation */
+		buff[7] = (0x20 & (pkt_data.rf_chain << 5)) | (0x0F & tx_pow.pow_index); /* bit 4 is 0 -> LoRa modulation */
 
 		buff[8] = 0; /* metadata 8, not used */
 
@@ -1725,7 +2302,7 @@ int lgw_send(struct lgw_pkt_tx_s pkt_data) {
 			case BW_125KHZ: buff[11] = 0; break;
 			case BW_250KHZ: buff[11] = 1; break;
 			case BW_500KHZ: buff[11] = 2; break;
-			default: DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d IN SWITCH STATEMENT\n", pkt_data.bandwidth);
+			default: buff[11] = 0; DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d IN SWITCH STATEMENT\n", pkt_data.bandwidth);
 		}
 		if (pkt_data.no_header == true) {
 			buff[11] |= 0x04; /* set 'implicit header' bit */
@@ -1753,7 +2330,7 @@ int lgw_send(struct lgw_pkt_tx_s pkt_data) {
 
 	} else if (pkt_data.modulation == MOD_FSK) {
 		/* metadata 7, modulation type, radio chain selection and TX power */
-		buff[7] = (0x20 & (pkt_data.rf_chain << 5)) | 0x10 | (0x0F & pow_index); /* bit 4 is 1 -> FSK modulation */
+		buff[7] = (0x20 & (pkt_data.rf_chain << 5)) | 0x10 | (0x0F & tx_pow.pow_index); /* bit 4 is 1 -> FSK modulation */
 
 		buff[8] = 0; /* metadata 8, not used */
 
@@ -1796,49 +2373,73 @@ int lgw_send(struct lgw_pkt_tx_s pkt_data) {
 	/* copy payload from user struct to buffer containing metadata */
 	memcpy((void *)(buff + payload_offset), (void *)(pkt_data.payload), pkt_data.size);
 
+	/* buffer is ready, the rest is a register sequence that must not interleave with another TX */
+	pthread_mutex_lock(&ctx->mx_tx);
+
+	/* check if the concentrator is running */
+	if (ctx->is_started == false) {
+		pthread_mutex_unlock(&ctx->mx_tx);
+		DEBUG_MSG("ERROR: CONCENTRATOR IS NOT RUNNING, START IT BEFORE SENDING\n");
+		return LGW_HAL_ERROR;
+	}
+	site = lgw_reg_profile_site("lgw_send");
+
+	/* loading TX imbalance correction */
+	lgw_reg_wi(ctx->reg, TX_OFFSET_I, tx_pow.offset_i[pkt_data.rf_chain]);
+	lgw_reg_wi(ctx->reg, TX_OFFSET_Q, tx_pow.offset_q[pkt_data.rf_chain]);
+
 	/* reset TX command flags */
-	lgw_reg_w(LGW_TX_TRIG_IMMEDIATE, 0);
-	lgw_reg_w(LGW_TX_TRIG_DELAYED, 0);
-	lgw_reg_w(LGW_TX_TRIG_GPS, 0);
+	lgw_reg_wi(ctx->reg, TX_TRIG_IMMEDIATE, 0);
+	lgw_reg_wi(ctx->reg, TX_TRIG_DELAYED, 0);
+	lgw_reg_wi(ctx->reg, TX_TRIG_GPS, 0);
 
 	/* put metadata + payload in the TX data buffer */
-	lgw_reg_w(LGW_TX_DATA_BUF_ADDR, 0);
-	lgw_reg_wb(LGW_TX_DATA_BUF_DATA, buff, transfer_size);
+	lgw_reg_wi(ctx->reg, TX_DATA_BUF_ADDR, 0);
+	lgw_reg_wbi(ctx->reg, TX_DATA_BUF_DATA, buff, transfer_size);
 	DEBUG_ARRAY(i, transfer_size, buff);
 
 	/* send data */
 	switch(pkt_data.tx_mode) {
 		case IMMEDIATE:
-			lgw_reg_w(LGW_TX_TRIG_IMMEDIATE, 1);
+			lgw_reg_wi(ctx->reg, TX_TRIG_IMMEDIATE, 1);
 			break;
 
 		case TIMESTAMPED:
-			lgw_reg_w(LGW_TX_TRIG_DELAYED, 1);
+			lgw_reg_wi(ctx->reg, TX_TRIG_DELAYED, 1);
 			break;
 
 		case ON_GPS:
-			lgw_reg_w(LGW_TX_TRIG_GPS, 1);
+			lgw_reg_wi(ctx->reg, TX_TRIG_GPS, 1);
 			break;
 
 		default:
+			lgw_reg_profile_site(site);
+			pthread_mutex_unlock(&ctx->mx_tx);
 			DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d IN SWITCH STATEMENT\n", pkt_data.tx_mode);
 			return LGW_HAL_ERROR;
 	}
 
+	lgw_reg_profile_site(site);
+	pthread_mutex_unlock(&ctx->mx_tx);
 	return LGW_HAL_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_status(uint8_t select, uint8_t *code) {
-	int32_t read_value;
+int lgw_status_ctx(struct lgw_ctx_s *ctx, uint8_t select, uint8_t *code) {
+	int32_t read_value = 0;
+	const char *site; /* register profiler site of the caller */
 
 	/* check input variables */
+	CHECK_NULL(ctx);
 	CHECK_NULL(code);
 
 	if (select == TX_STATUS) {
-		lgw_reg_r(LGW_TX_STATUS, &read_value);
-		if (lgw_is_started == false) {
+		pthread_mutex_lock(&ctx->mx_tx);
+		site = lgw_reg_profile_site("lgw_status");
+		lgw_reg_ri(ctx->reg, TX_STATUS, &read_value);
+		lgw_reg_profile_site(site);
+		if (ctx->is_started == false) {
 			*code = TX_OFF;
 		} else if ((read_value & 0x10) == 0) { /* bit 4 @1: TX programmed */
 			*code = TX_FREE;
@@ -1847,6 +2448,7 @@ int lgw_status(uint8_t select, uint8_t *code) {
 		} else {
 			*code = TX_SCHEDULED;
 		}
+		pthread_mutex_unlock(&ctx->mx_tx);
 		return LGW_HAL_SUCCESS;
 
 	} else if (select == RX_STATUS) {
@@ -1862,11 +2464,18 @@ int lgw_status(uint8_t select, uint8_t *code) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_get_trigcnt(uint32_t* trig_cnt_us) {
+int lgw_get_trigcnt_ctx(struct lgw_ctx_s *ctx, uint32_t* trig_cnt_us) {
 	int i;
 	int32_t val;
-
-	i = lgw_reg_r(LGW_TIMESTAMP, &val);
+	const char *site; /* register profiler site of the caller */
+
+	CHECK_NULL(ctx);
+	CHECK_NULL(trig_cnt_us);
+	site = lgw_reg_profile_site("lgw_get_trigcnt");
+	pthread_mutex_lock(&ctx->mx_pps); /* not during a live counter read */
+	i = lgw_reg_ri(ctx->reg, TIMESTAMP, &val);
+	pthread_mutex_unlock(&ctx->mx_pps);
+	lgw_reg_profile_site(site);
 	if (i == LGW_REG_SUCCESS) {
 		*trig_cnt_us = (uint32_t)val;
 		return LGW_HAL_SUCCESS;
@@ -1877,81 +2486,149 @@ int lgw_get_trigcnt(uint32_t* trig_cnt_us) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+int lgw_get_trigcnt64_ctx(struct lgw_ctx_s *ctx, uint64_t *trig_cnt_us) {
+	uint32_t cnt;
+
+	CHECK_NULL(trig_cnt_us);
+	if (lgw_get_trigcnt_ctx(ctx, &cnt) != LGW_HAL_SUCCESS) {
+		return LGW_HAL_ERROR;
+	}
+	*trig_cnt_us = ts_extend(ctx, cnt);
+	return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_get_instcnt64_ctx(struct lgw_ctx_s *ctx, uint64_t *inst_cnt_us) {
+	uint32_t cnt;
+	const char *site; /* register profiler site of the caller */
+	int i;
+
+	CHECK_NULL(ctx);
+	CHECK_NULL(inst_cnt_us);
+	if (ctx->is_started == false) {
+		DEBUG_MSG("ERROR: CONCENTRATOR IS NOT RUNNING\n");
+		return LGW_HAL_ERROR;
+	}
+	site = lgw_reg_profile_site("lgw_get_instcnt64");
+	i = read_instcnt(ctx, &cnt);
+	lgw_reg_profile_site(site);
+	if (i != 0) {
+		return LGW_HAL_ERROR;
+	}
+	ts_anchor(ctx, cnt, false);
+	*inst_cnt_us = ts_extend(ctx, cnt);
+	return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_send_at_ctx(struct lgw_ctx_s *ctx, struct lgw_pkt_tx_s pkt_data, uint64_t count_us64) {
+	uint64_t now_us64;
+
+	CHECK_NULL(ctx);
+
+	/* counter predicted from host time, read again if the last live read is too old for the clock drift to be negligible */
+	if (ts_predict(ctx, TS_ANCHOR_MAX_AGE, &now_us64) == false) {
+		if (lgw_get_instcnt64_ctx(ctx, &now_us64) != LGW_HAL_SUCCESS) {
+			return LGW_HAL_ERROR;
+		}
+	}
+	if ((count_us64 <= now_us64) || ((count_us64 - now_us64) >= 0x80000000)) {
+		DEBUG_MSG("ERROR: TX TIMESTAMP IN THE PAST OR MORE THAN 2^31 us AHEAD\n");
+		return LGW_HAL_ERROR;
+	}
+
+	pkt_data.tx_mode = TIMESTAMPED;
+	pkt_data.count_us = (uint32_t)count_us64;
+	return lgw_send_ctx(ctx, pkt_data);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 const char* lgw_version_info() {
 	return lgw_version_string;
 }
 
 #if (CFG_RADIO_AUTO == 1)
-int lgw_auto_check(void)
+int lgw_auto_check_ctx(struct lgw_ctx_s *ctx)
 {
 	int reg_stat;
 
-	reg_stat = lgw_connect();
+	CHECK_NULL(ctx);
+	pthread_mutex_lock(&ctx->mx_rx);
+	pthread_mutex_lock(&ctx->mx_tx);
+
+	reg_stat = lgw_connect_ctx(ctx->reg);
 	if (reg_stat == LGW_REG_ERROR) {
+		pthread_mutex_unlock(&ctx->mx_tx);
+		pthread_mutex_unlock(&ctx->mx_rx);
 		DEBUG_MSG("ERROR: FAIL TO CONNECT BOARD\n");
 		return LGW_HAL_ERROR;
 	}
 
 	/* ungate clocks (gated by default) */
-	lgw_reg_w(LGW_GLOBAL_EN, 1);
+	lgw_reg_w_ctx(ctx->reg, LGW_GLOBAL_EN, 1);
 
 	/* switch on and reset the radios (also starts the 32 MHz XTAL) */
-	lgw_reg_w(LGW_RADIO_A_EN,1);
-	lgw_reg_w(LGW_RADIO_B_EN,1);
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_A_EN,1);
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_B_EN,1);
 	wait_ms(500); /* TODO: optimize */
-	lgw_reg_w(LGW_RADIO_RST,1);
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_RST,1);
 	wait_ms(5);
-	lgw_reg_w(LGW_RADIO_RST,0);
+	lgw_reg_w_ctx(ctx->reg, LGW_RADIO_RST,0);
 
-	rf_radio_chip_id[0] = sx125x_read(0, 7);
-	rf_radio_chip_id[1] = sx125x_read(1, 7);
+	ctx->rf_radio_chip_id[0] = sx125x_read(ctx, 0, 7);
+	ctx->rf_radio_chip_id[1] = sx125x_read(ctx, 1, 7);
 
-	if(rf_radio_chip_id[0] == ID_SX1255){
+	if(ctx->rf_radio_chip_id[0] == ID_SX1255){
 		DEBUG_MSG("CHAIN A SX1255\n");
-		rf_rx_lowfreq[0] = LGW_RF_SX1255_FREQ_MIN;
-		rf_rx_upfreq[0] = LGW_RF_SX1255_FREQ_MAX;
-		rf_tx_lowfreq[0] = LGW_RF_SX1255_FREQ_MIN;
-		rf_tx_upfreq[0] = LGW_RF_SX1255_FREQ_MAX;
-	}else if(rf_radio_chip_id[0] == ID_SX1257){
+		ctx->rf_rx_lowfreq[0] = LGW_RF_SX1255_FREQ_MIN;
+		ctx->rf_rx_upfreq[0] = LGW_RF_SX1255_FREQ_MAX;
+		ctx->rf_tx_lowfreq[0] = LGW_RF_SX1255_FREQ_MIN;
+		ctx->rf_tx_upfreq[0] = LGW_RF_SX1255_FREQ_MAX;
+	}else if(ctx->rf_radio_chip_id[0] == ID_SX1257){
 		DEBUG_MSG("CHAIN A SX1257\n");
-		rf_rx_lowfreq[0] = LGW_RF_SX1257_FREQ_MIN;
-		rf_rx_upfreq[0] = LGW_RF_SX1257_FREQ_MAX;
-		rf_tx_lowfreq[0] = LGW_RF_SX1257_FREQ_MIN;
-		rf_tx_upfreq[0] = LGW_RF_SX1257_FREQ_MAX;
+		ctx->rf_rx_lowfreq[0] = LGW_RF_SX1257_FREQ_MIN;
+		ctx->rf_rx_upfreq[0] = LGW_RF_SX1257_FREQ_MAX;
+		ctx->rf_tx_lowfreq[0] = LGW_RF_SX1257_FREQ_MIN;
+		ctx->rf_tx_upfreq[0] = LGW_RF_SX1257_FREQ_MAX;
 	}else{
 		DEBUG_MSG("CHAIN A UNKNOWN\n");
 	}
 
-	if(rf_radio_chip_id[1] == ID_SX1255){
+	if(ctx->rf_radio_chip_id[1] == ID_SX1255){
 		DEBUG_MSG("CHAIN B SX1255\n");
-		rf_rx_lowfreq[1] = LGW_RF_SX1255_FREQ_MIN;
-		rf_rx_upfreq[1] = LGW_RF_SX1255_FREQ_MAX;
-		rf_tx_lowfreq[1] = LGW_RF_SX1255_FREQ_MIN;
-		rf_tx_upfreq[1] = LGW_RF_SX1255_FREQ_MAX;
-	}else if(rf_radio_chip_id[1] == ID_SX1257){
+		ctx->rf_rx_lowfreq[1] = LGW_RF_SX1255_FREQ_MIN;
+		ctx->rf_rx_upfreq[1] = LGW_RF_SX1255_FREQ_MAX;
+		ctx->rf_tx_lowfreq[1] = LGW_RF_SX1255_FREQ_MIN;
+		ctx->rf_tx_upfreq[1] = LGW_RF_SX1255_FREQ_MAX;
+	}else if(ctx->rf_radio_chip_id[1] == ID_SX1257){
 		DEBUG_MSG("CHAIN B SX1257\n");
-		rf_rx_lowfreq[1] = LGW_RF_SX1257_FREQ_MIN;
-		rf_rx_upfreq[1] = LGW_RF_SX1257_FREQ_MAX;
-		rf_tx_lowfreq[1] = LGW_RF_SX1257_FREQ_MIN;
-		rf_tx_upfreq[1] = LGW_RF_SX1257_FREQ_MAX;
+		ctx->rf_rx_lowfreq[1] = LGW_RF_SX1257_FREQ_MIN;
+		ctx->rf_rx_upfreq[1] = LGW_RF_SX1257_FREQ_MAX;
+		ctx->rf_tx_lowfreq[1] = LGW_RF_SX1257_FREQ_MIN;
+		ctx->rf_tx_upfreq[1] = LGW_RF_SX1257_FREQ_MAX;
 	}else{
 		DEBUG_MSG("CHAIN B UNKNOWN\n");
 	}
 
+	pthread_mutex_unlock(&ctx->mx_tx);
+	pthread_mutex_unlock(&ctx->mx_rx);
 	return LGW_HAL_SUCCESS;
 }
 #endif
 
-int lgw_freq_validate(uint8_t rf_chain, uint32_t freq)
+int lgw_freq_validate_ctx(struct lgw_ctx_s *ctx, uint8_t rf_chain, uint32_t freq)
 {
-	if( rf_chain >= LGW_RF_CHAIN_NB ){
+	if( ctx == NULL || rf_chain >= LGW_RF_CHAIN_NB ){
 		return -1;
 	}
 
-	if(freq > rf_rx_upfreq[rf_chain] || freq < rf_rx_lowfreq[rf_chain]){
-		if(rf_radio_chip_id[rf_chain] == ID_SX1255){
+	if(freq > ctx->rf_rx_upfreq[rf_chain] || freq < ctx->rf_rx_lowfreq[rf_chain]){
+		if(ctx->rf_radio_chip_id[rf_chain] == ID_SX1255){
 			return -2;
-		}else if(rf_radio_chip_id[rf_chain] == ID_SX1257){
+		}else if(ctx->rf_radio_chip_id[rf_chain] == ID_SX1257){
 			return -3;
 		}else{
 			return -4;
@@ -1963,13 +2640,91 @@ int lgw_freq_validate(uint8_t rf_chain, uint32_t freq)
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-lgw_id_t lgw_get_radio_id(uint8_t rf_chain)
+lgw_id_t lgw_get_radio_id_ctx(struct lgw_ctx_s *ctx, uint8_t rf_chain)
 {
-	if( rf_chain >= LGW_RF_CHAIN_NB ){
+	if( ctx == NULL || rf_chain >= LGW_RF_CHAIN_NB ){
 		return ID_NULL;
 	}
 
-	return rf_radio_chip_id[rf_chain];
+	return ctx->rf_radio_chip_id[rf_chain];
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Functions acting on the default context */
+
+int lgw_spi_setconf(const char *path, uint32_t speed_hz) {
+	return lgw_spi_setconf_ctx(&ctx_default, path, speed_hz);
+}
+
+int lgw_spi_probe(uint32_t min_hz, uint32_t max_hz, uint32_t step_hz, uint32_t *speed_hz) {
+	return lgw_spi_probe_ctx(&ctx_default, min_hz, max_hz, step_hz, speed_hz);
+}
+
+int lgw_fw_setconf(struct lgw_conf_fw_s conf) {
+	return lgw_fw_setconf_ctx(&ctx_default, conf);
+}
+
+int lgw_txgain_setconf(const struct lgw_tx_gain_lut_s *conf) {
+	return lgw_txgain_setconf_ctx(&ctx_default, conf);
+}
+
+int lgw_rxrf_setconf(uint8_t rf_chain, struct lgw_conf_rxrf_s conf) {
+	return lgw_rxrf_setconf_ctx(&ctx_default, rf_chain, conf);
+}
+
+int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s conf) {
+	return lgw_rxif_setconf_ctx(&ctx_default, if_chain, conf);
+}
+
+int lgw_start(void) {
+	return lgw_start_ctx(&ctx_default);
+}
+
+int lgw_stop(void) {
+	return lgw_stop_ctx(&ctx_default);
+}
+
+int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
+	return lgw_receive_ctx(&ctx_default, max_pkt, pkt_data);
+}
+
+int lgw_send(struct lgw_pkt_tx_s pkt_data) {
+	return lgw_send_ctx(&ctx_default, pkt_data);
+}
+
+int lgw_status(uint8_t select, uint8_t *code) {
+	return lgw_status_ctx(&ctx_default, select, code);
+}
+
+int lgw_get_trigcnt(uint32_t* trig_cnt_us) {
+	return lgw_get_trigcnt_ctx(&ctx_default, trig_cnt_us);
+}
+
+int lgw_get_trigcnt64(uint64_t *trig_cnt_us) {
+	return lgw_get_trigcnt64_ctx(&ctx_default, trig_cnt_us);
+}
+
+int lgw_get_instcnt64(uint64_t *inst_cnt_us) {
+	return lgw_get_instcnt64_ctx(&ctx_default, inst_cnt_us);
+}
+
+int lgw_send_at(struct lgw_pkt_tx_s pkt_data, uint64_t count_us64) {
+	return lgw_send_at_ctx(&ctx_default, pkt_data, count_us64);
+}
+
+#if (CFG_RADIO_AUTO == 1)
+int lgw_auto_check(void) {
+	return lgw_auto_check_ctx(&ctx_default);
+}
+#endif
+
+int lgw_freq_validate(uint8_t rf_chain, uint32_t freq) {
+	return lgw_freq_validate_ctx(&ctx_default, rf_chain, freq);
+}
+
+lgw_id_t lgw_get_radio_id(uint8_t rf_chain) {
+	return lgw_get_radio_id_ctx(&ctx_default, rf_chain);
 }
 
 /* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,301 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	Correlation of the concentrator counter with the host monotonic clock.
+	Each sample brackets a live counter read between two CLOCK_MONOTONIC reads;
+	interrupted reads are rejected and the host time at the middle of the read
+	is fitted against the counter by least squares.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+	#define _XOPEN_SOURCE 600
+#else
+	#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+#include <stdio.h>		/* fprintf */
+#include <string.h>		/* memset */
+#include <time.h>		/* clock_gettime */
+#include <math.h>		/* sqrt fabs ceil llround */
+
+#include "loragw_hostclk.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#if DEBUG_GPS == 1
+	#define DEBUG_MSG(args...)			fprintf(stderr, args)
+	#define CHECK_NULL(a)				if(a==NULL){fprintf(stderr,"%s:%d: ERROR: NULL POINTER AS ARGUMENT\n", __FUNCTION__, __LINE__);return LGW_HOSTCLK_ERROR;}
+#else
+	#define DEBUG_MSG(args...)
+	#define CHECK_NULL(a)				if(a==NULL){return LGW_HOSTCLK_ERROR;}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define HOSTCLK_MIN_POINTS		3		/* samples fitted before conversions are possible */
+#define HOSTCLK_MAX_AGE_NS		600000000000LL	/* older samples are not fitted (host clock slewing) */
+#define HOSTCLK_WIN_FACTOR		2		/* reads longer than that many times the shortest one are rejected... */
+#define HOSTCLK_WIN_MARGIN_NS	20000	/* ...plus that margin, for the SPI jitter */
+#define HOSTCLK_MAX_REJECTED	8		/* successive rejected reads after which the sample is kept anyway */
+#define HOSTCLK_RESET_NS		1000000	/* a sample that far from the fit restarts the correlator */
+#define HOSTCLK_MAX_DRIFT		200E-6	/* max relative drift between the counter and the host clock */
+#define HOSTCLK_SIGMA			3.0		/* error bound, in standard deviations of the prediction */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static int64_t ts_to_ns(const struct timespec *t);
+
+static void hostclk_restart(struct lgw_hostclk_s *hc);
+
+static void hostclk_fit(struct lgw_hostclk_s *hc);
+
+static uint32_t hostclk_err(const struct lgw_hostclk_s *hc, double dx);
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static int64_t ts_to_ns(const struct timespec *t) {
+	return ((int64_t)t->tv_sec * 1000000000LL) + t->tv_nsec;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* drop all the samples, keep the counters */
+static void hostclk_restart(struct lgw_hostclk_s *hc) {
+	uint32_t nb_rejected = hc->nb_rejected;
+	uint32_t nb_restart = hc->nb_restart;
+
+	memset(hc, 0, sizeof *hc);
+	hc->nb_rejected = nb_rejected;
+	hc->nb_restart = nb_restart + 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* least squares fit of the host time against the counter, relative to the newest sample */
+static void hostclk_fit(struct lgw_hostclk_s *hc) {
+	double x[LGW_HOSTCLK_SIZE]; /* counter, in us */
+	double y[LGW_HOSTCLK_SIZE]; /* host time, in ns */
+	double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0, ssr = 0.0;
+	double mx, my, a, b, r;
+	uint32_t win_min = UINT32_MAX;
+	int newest, i, k, n;
+
+	newest = (hc->head - 1 + LGW_HOSTCLK_SIZE) % LGW_HOSTCLK_SIZE;
+	for (n = 0; n < hc->nb; ++n) {
+		k = (newest - n + LGW_HOSTCLK_SIZE) % LGW_HOSTCLK_SIZE;
+		if ((hc->host_ns[newest] - hc->host_ns[k]) > HOSTCLK_MAX_AGE_NS) {
+			break;
+		}
+		x[n] = (double)(int64_t)(hc->cnt[k] - hc->cnt[newest]);
+		y[n] = (double)(hc->host_ns[k] - hc->host_ns[newest]);
+		if (hc->win_ns[k] < win_min) {
+			win_min = hc->win_ns[k];
+		}
+	}
+	hc->nb = n; /* the older samples will not be usable again */
+
+	hc->valid = false;
+	hc->nb_fit = n;
+	hc->win_min_ns = win_min;
+	if (n < HOSTCLK_MIN_POINTS) {
+		return;
+	}
+	for (i = 0; i < n; ++i) {
+		sx += x[i];
+		sy += y[i];
+	}
+	mx = sx / n;
+	my = sy / n;
+	for (i = 0; i < n; ++i) {
+		sxx += (x[i] - mx) * (x[i] - mx);
+		sxy += (x[i] - mx) * (y[i] - my);
+	}
+	if (sxx <= 0.0) {
+		return;
+	}
+	b = sxy / sxx;
+	a = my - (b * mx);
+	for (i = 0; i < n; ++i) {
+		r = y[i] - (a + (b * x[i]));
+		ssr += r * r;
+	}
+	if (fabs((b / 1000.0) - 1.0) > HOSTCLK_MAX_DRIFT) {
+		DEBUG_MSG("Warning: counter and host clock drift apart by %.0f ppm\n", 1E6 * ((b / 1000.0) - 1.0));
+		return;
+	}
+
+	hc->ref_cnt = hc->cnt[newest];
+	hc->ref_host_ns = hc->host_ns[newest];
+	hc->off_ns = a;
+	hc->slope = b;
+	hc->mean_us = mx;
+	hc->sxx = sxx;
+	hc->jitter_ns = sqrt(ssr / (n - 2));
+	hc->valid = true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* error bound of a conversion dx us away from the newest sample */
+static uint32_t hostclk_err(const struct lgw_hostclk_s *hc, double dx) {
+	double pred_sd;
+	double err;
+
+	/* the counter is latched somewhere in the read window, plus the uncertainty of the fit at dx */
+	pred_sd = hc->jitter_ns * sqrt((1.0 / hc->nb_fit) + (((dx - hc->mean_us) * (dx - hc->mean_us)) / hc->sxx));
+	err = (0.5 * hc->win_min_ns) + (HOSTCLK_SIGMA * pred_sd);
+	return (err < (double)UINT32_MAX) ? (uint32_t)ceil(err) : UINT32_MAX;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int lgw_hostclk_sample(struct lgw_hostclk_s *hc, struct lgw_ctx_s *ctx) {
+	struct timespec before, after;
+	uint64_t cnt;
+	int i;
+
+	CHECK_NULL(hc);
+	/* serialized live counter read: a concurrent lgw_get_trigcnt never gets the live value */
+	clock_gettime(CLOCK_MONOTONIC, &before);
+	i = (ctx == NULL) ? lgw_get_instcnt64(&cnt) : lgw_get_instcnt64_ctx(ctx, &cnt);
+	clock_gettime(CLOCK_MONOTONIC, &after);
+	if (i != LGW_HAL_SUCCESS) {
+		DEBUG_MSG("ERROR: FAIL TO READ THE CONCENTRATOR COUNTER\n");
+		return LGW_HOSTCLK_ERROR;
+	}
+	return lgw_hostclk_add(hc, cnt, &before, &after);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_hostclk_add(struct lgw_hostclk_s *hc, uint64_t count_us64, const struct timespec *before, const struct timespec *after) {
+	int64_t t0, t1, host;
+	uint32_t win, win_min = UINT32_MAX;
+	double pred;
+	int newest, i, k;
+
+	CHECK_NULL(hc);
+	CHECK_NULL(before);
+	CHECK_NULL(after);
+	if ((hc->nb < 0) || (hc->nb > LGW_HOSTCLK_SIZE) || (hc->head < 0) || (hc->head >= LGW_HOSTCLK_SIZE)) {
+		memset(hc, 0, sizeof *hc);
+	}
+	t0 = ts_to_ns(before);
+	t1 = ts_to_ns(after);
+	if (t1 < t0) {
+		return LGW_HOSTCLK_ERROR;
+	}
+	win = ((t1 - t0) < (int64_t)UINT32_MAX) ? (uint32_t)(t1 - t0) : UINT32_MAX;
+	host = t0 + ((t1 - t0) / 2);
+
+	/* new counter timeline (concentrator restarted): start again */
+	newest = (hc->head - 1 + LGW_HOSTCLK_SIZE) % LGW_HOSTCLK_SIZE;
+	if ((hc->nb > 0) && ((count_us64 <= hc->cnt[newest]) || (host <= hc->host_ns[newest]))) {
+		DEBUG_MSG("Warning: counter or host clock went backwards, correlator restarted\n");
+		hostclk_restart(hc);
+	}
+
+	/* reject the interrupted reads, unless all the recent ones are */
+	for (i = 0; i < hc->nb; ++i) {
+		k = (hc->head - 1 - i + LGW_HOSTCLK_SIZE) % LGW_HOSTCLK_SIZE;
+		if (hc->win_ns[k] < win_min) {
+			win_min = hc->win_ns[k];
+		}
+	}
+	if ((hc->nb > 0) && (win > ((HOSTCLK_WIN_FACTOR * (uint64_t)win_min) + HOSTCLK_WIN_MARGIN_NS))) {
+		hc->nb_rejected += 1;
+		hc->rejected += 1;
+		if (hc->rejected < HOSTCLK_MAX_REJECTED) {
+			DEBUG_MSG("Note: sample rejected, read took %u ns\n", win);
+			return LGW_HOSTCLK_ERROR;
+		}
+	}
+	hc->rejected = 0;
+
+	/* a good read far from the fit: the counter jumped, start again */
+	if (hc->valid) {
+		pred = hc->off_ns + (hc->slope * (double)(int64_t)(count_us64 - hc->ref_cnt));
+		if (fabs((double)(host - hc->ref_host_ns) - pred) > HOSTCLK_RESET_NS) {
+			DEBUG_MSG("Warning: sample inconsistent with the fit, correlator restarted\n");
+			hostclk_restart(hc);
+		}
+	}
+
+	hc->cnt[hc->head] = count_us64;
+	hc->host_ns[hc->head] = host;
+	hc->win_ns[hc->head] = win;
+	hc->head = (hc->head + 1) % LGW_HOSTCLK_SIZE;
+	if (hc->nb < LGW_HOSTCLK_SIZE) {
+		hc->nb += 1;
+	}
+	hostclk_fit(hc);
+	return LGW_HOSTCLK_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_cnt2host(const struct lgw_hostclk_s *hc, uint64_t count_us64, struct timespec *host, uint32_t *err_ns) {
+	double dx;
+	int64_t t;
+
+	CHECK_NULL(hc);
+	CHECK_NULL(host);
+	if (!hc->valid) {
+		DEBUG_MSG("ERROR: NOT ENOUGH SAMPLES FOR CNT -> HOST CONVERSION\n");
+		return LGW_HOSTCLK_ERROR;
+	}
+	dx = (double)(int64_t)(count_us64 - hc->ref_cnt);
+	t = hc->ref_host_ns + llround(hc->off_ns + (hc->slope * dx));
+	host->tv_sec = (time_t)(t / 1000000000LL);
+	host->tv_nsec = (long)(t % 1000000000LL);
+	if (host->tv_nsec < 0) {
+		host->tv_sec -= 1;
+		host->tv_nsec += 1000000000L;
+	}
+	if (err_ns != NULL) {
+		*err_ns = hostclk_err(hc, dx);
+	}
+	return LGW_HOSTCLK_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_host2cnt(const struct lgw_hostclk_s *hc, struct timespec host, uint64_t *count_us64, uint32_t *err_ns) {
+	double dx;
+
+	CHECK_NULL(hc);
+	CHECK_NULL(count_us64);
+	if (!hc->valid) {
+		DEBUG_MSG("ERROR: NOT ENOUGH SAMPLES FOR HOST -> CNT CONVERSION\n");
+		return LGW_HOSTCLK_ERROR;
+	}
+	dx = ((double)(ts_to_ns(&host) - hc->ref_host_ns) - hc->off_ns) / hc->slope;
+	*count_us64 = hc->ref_cnt + (uint64_t)llround(dx);
+	if (err_ns != NULL) {
+		*err_ns = hostclk_err(hc, dx);
+	}
+	return LGW_HOSTCLK_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -23,9 +23,12 @@ Maintainer: Sylvain Miermont
 #include <stdint.h>		/* C99 types */
 #include <stdbool.h>	/* bool type */
 #include <stdio.h>		/* printf fprintf */
+#include <string.h>		/* strncpy */
+#include <pthread.h>	/* mutex */
 
 #include "loragw_spi.h"
 #include "loragw_reg.h"
+#include "loragw_reg_inline.h"
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS ------------------------------------------------------- */
@@ -60,6 +63,16 @@ struct lgw_reg_s {
 #define PAGE_ADDR		0x00
 #define PAGE_MASK		0x03
 
+/* SPI clock probing */
+#define PROBE_CYCLES		100	/* number of R/W of each pattern at each clock step */
+#define PROBE_BUFF_SIZE		1024 /* size of the data buffer burst pattern */
+#define PROBE_MARGIN_PCT	10	/* safety margin below the highest error-free clock */
+
+/* SX125x radio access through the SPI master of the concentrator */
+#define RADIO_NB			2	/* number of radios behind the SPI master */
+#define RADIO_SPI_OPS		6	/* CS low, address, data, CS high, CS low, read-back */
+#define RADIO_BATCH_CHUNK	(LGW_SPI_BATCH_CHUNK / RADIO_SPI_OPS) /* radio accesses per SPI batch */
+
 /*
 auto generated register mapping for C code : 11-Jul-2013 13:20:40
 this file contains autogenerated C struct used to access the LoRa register from the Primer firmware
@@ -394,61 +407,185 @@ const struct lgw_reg_s loregs[LGW_TOTALREGS] = {
 	{2,97,0,0,5,1,0}		/* DATA_MNGT_CPT_FRAME_READEN */
 };
 
+/* SPI master registers of each radio: chip select, address, data, read-back */
+static const uint16_t radio_regs[RADIO_NB][4] = {
+	{LGW_SPI_RADIO_A__CS, LGW_SPI_RADIO_A__ADDR, LGW_SPI_RADIO_A__DATA, LGW_SPI_RADIO_A__DATA_READBACK},
+	{LGW_SPI_RADIO_B__CS, LGW_SPI_RADIO_B__ADDR, LGW_SPI_RADIO_B__DATA, LGW_SPI_RADIO_B__DATA_READBACK}
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
-void *lgw_spi_target = NULL; /*! generic pointer to the SPI device */
-static int lgw_regpage = -1; /*! keep the value of the register page selected */
+/*
+Default context, used by the functions without _ctx suffix.
+The bus mutex of a context protects its SPI target, its page cache and the SPI
+link itself. It is held for the shortest span that must be atomic: a page
+switch and the register access that depends on it (including both halves of a
+read-modify-write). Callers of the lgw_reg_* functions never have to lock it.
+*/
+struct lgw_reg_ctx_s lgw_reg_ctx_default = LGW_REG_CTX_INIT;
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
 
-int page_switch(uint8_t target) {
-	lgw_regpage = PAGE_MASK & target;
-	lgw_spi_w(lgw_spi_target, PAGE_ADDR, (uint8_t)lgw_regpage);
+/* must be called with the bus mutex held, also used by the inline accessors */
+int lgw_reg_page_switch(struct lgw_reg_ctx_s *ctx, uint8_t target) {
+	ctx->regpage = PAGE_MASK & target;
+	lgw_spi_w(ctx->spi_target, PAGE_ADDR, (uint8_t)ctx->regpage);
+	return LGW_REG_SUCCESS;
+}
+
+/* pseudo-random generator for the probe patterns, keeps the rand() sequence of
+the application untouched */
+static uint32_t probe_rand(uint32_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/* same patterns as util_spi_stress: 8b register (with VERSION readbacks), 32b
+register and data buffer burst, returns LGW_REG_ERROR on the first mismatch */
+int probe_patterns(struct lgw_reg_ctx_s *ctx, uint32_t *seed) {
+	int32_t test_value, read_value, version;
+	int32_t test_addr;
+	uint8_t test_buff[PROBE_BUFF_SIZE];
+	uint8_t read_buff[PROBE_BUFF_SIZE];
+	int i, j;
+	int reg_stat = LGW_REG_SUCCESS;
+
+	for (i=0; i<PROBE_CYCLES; ++i) {
+		test_value = probe_rand(seed) & 0xFF;
+		reg_stat |= lgw_reg_w_ctx(ctx, LGW_IMPLICIT_PAYLOAD_LENGHT, test_value);
+		reg_stat |= lgw_reg_r_ctx(ctx, LGW_VERSION, &version);
+		reg_stat |= lgw_reg_r_ctx(ctx, LGW_IMPLICIT_PAYLOAD_LENGHT, &read_value);
+		if ((reg_stat != LGW_REG_SUCCESS) || (read_value != test_value) || (version != loregs[LGW_VERSION].dflt)) {
+			return LGW_REG_ERROR;
+		}
+	}
+	for (i=0; i<PROBE_CYCLES; ++i) {
+		test_value = (int32_t)probe_rand(seed);
+		reg_stat |= lgw_reg_w_ctx(ctx, LGW_FSK_REF_PATTERN_LSB, test_value);
+		reg_stat |= lgw_reg_r_ctx(ctx, LGW_FSK_REF_PATTERN_LSB, &read_value);
+		if ((reg_stat != LGW_REG_SUCCESS) || (read_value != test_value)) {
+			return LGW_REG_ERROR;
+		}
+	}
+	for (i=0; i<(PROBE_CYCLES/10); ++i) {
+		for (j=0; j<PROBE_BUFF_SIZE; ++j) {
+			test_buff[j] = probe_rand(seed) & 0xFF;
+		}
+		test_addr = probe_rand(seed) & 0xFFFF;
+		reg_stat |= lgw_reg_w_ctx(ctx, LGW_RX_DATA_BUF_ADDR, test_addr); /* write at random offset in memory */
+		reg_stat |= lgw_reg_wb_ctx(ctx, LGW_RX_DATA_BUF_DATA, test_buff, PROBE_BUFF_SIZE);
+		reg_stat |= lgw_reg_w_ctx(ctx, LGW_RX_DATA_BUF_ADDR, test_addr); /* go back to start of segment */
+		reg_stat |= lgw_reg_rb_ctx(ctx, LGW_RX_DATA_BUF_DATA, read_buff, PROBE_BUFF_SIZE);
+		if ((reg_stat != LGW_REG_SUCCESS) || (memcmp(test_buff, read_buff, PROBE_BUFF_SIZE) != 0)) {
+			return LGW_REG_ERROR;
+		}
+	}
+
 	return LGW_REG_SUCCESS;
 }
 
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
+/* Context initialization */
+int lgw_reg_ctx_init(struct lgw_reg_ctx_s *ctx) {
+	CHECK_NULL(ctx);
+	ctx->spi_target = NULL;
+	ctx->regpage = -1;
+	ctx->spi_path[0] = '\0';
+	ctx->spi_speed = 0;
+	if (pthread_mutex_init(&ctx->mx_bus, NULL) != 0) {
+		DEBUG_MSG("ERROR: FAILED TO INITIALIZE BUS MUTEX\n");
+		return LGW_REG_ERROR;
+	}
+	return LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* SPI device and clock selection */
+int lgw_reg_spi_setconf_ctx(struct lgw_reg_ctx_s *ctx, const char *path, uint32_t speed_hz) {
+	int spi_stat = LGW_SPI_SUCCESS;
+
+	/* check input parameters */
+	CHECK_NULL(ctx);
+	if ((path != NULL) && (strlen(path) >= LGW_REG_SPI_PATH_SIZE)) {
+		DEBUG_MSG("ERROR: SPI DEVICE PATH TOO LONG\n");
+		return LGW_REG_ERROR;
+	}
+
+	pthread_mutex_lock(&ctx->mx_bus);
+	if (path != NULL) {
+		strncpy(ctx->spi_path, path, LGW_REG_SPI_PATH_SIZE - 1);
+		ctx->spi_path[LGW_REG_SPI_PATH_SIZE - 1] = '\0';
+	} else {
+		ctx->spi_path[0] = '\0';
+	}
+	ctx->spi_speed = speed_hz;
+	if ((ctx->spi_target != NULL) && (speed_hz != 0)) {
+		spi_stat = lgw_spi_set_speed(ctx->spi_target, speed_hz);
+	}
+	pthread_mutex_unlock(&ctx->mx_bus);
+
+	return (spi_stat == LGW_SPI_SUCCESS) ? LGW_REG_SUCCESS : LGW_REG_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 /* Concentrator connect */
-int lgw_connect(void) {
+int lgw_connect_ctx(struct lgw_reg_ctx_s *ctx) {
 	int spi_stat = LGW_SPI_SUCCESS;
+	struct lgw_spi_opt_s spi_opt;
 	uint8_t u = 0;
 	
-	if (lgw_spi_target != NULL) {
+	CHECK_NULL(ctx);
+	
+	pthread_mutex_lock(&ctx->mx_bus);
+	if (ctx->spi_target != NULL) {
 		DEBUG_MSG("WARNING: concentrator was already connected\n");
-		lgw_spi_close(lgw_spi_target);
+		lgw_spi_close(ctx->spi_target);
+		ctx->spi_target = NULL;
 	}
 	/* open the SPI link */
-	spi_stat = lgw_spi_open(&lgw_spi_target);
+	spi_opt.path = ctx->spi_path;
+	spi_opt.speed_hz = ctx->spi_speed;
+	spi_stat = lgw_spi_open_opt(&ctx->spi_target, &spi_opt);
 	if (spi_stat != LGW_SPI_SUCCESS) {
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("ERROR CONNECTING CONCENTRATOR\n");
 		return LGW_REG_ERROR;
 	}
 	/* write 0 to the page/reset register */
-	spi_stat = lgw_spi_w(lgw_spi_target, loregs[LGW_PAGE_REG].addr, 0);
+	spi_stat = lgw_spi_w(ctx->spi_target, loregs[LGW_PAGE_REG].addr, 0);
 	if (spi_stat != LGW_SPI_SUCCESS) {
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("ERROR WRITING PAGE REGISTER\n");
 		return LGW_REG_ERROR;
 	} else {
-		lgw_regpage = 0;
+		ctx->regpage = 0;
 	}
 	/* checking the chip ID */
-	spi_stat = lgw_spi_r(lgw_spi_target, loregs[LGW_CHIP_ID].addr, &u);
+	spi_stat = lgw_spi_r(ctx->spi_target, loregs[LGW_CHIP_ID].addr, &u);
 	if (spi_stat != LGW_SPI_SUCCESS) {
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("ERROR READING CHIP_ID REGISTER\n");
 		return LGW_REG_ERROR;
 	} else if (u == 0) {
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("ERROR: CHIP_ID=0, CONCENTRATOR SEEMS DISCONNECTED\n");
 		return LGW_REG_ERROR;
 	} else if (u != loregs[LGW_CHIP_ID].dflt) {
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("ERROR: MISMATCH BETWEEN EXPECTED REG CHIP_ID AND READ REG CHIP_ID\n");
 		return LGW_REG_ERROR;
 	}
 	/* checking the version register */
-	spi_stat = lgw_spi_r(lgw_spi_target, loregs[LGW_VERSION].addr, &u);
+	spi_stat = lgw_spi_r(ctx->spi_target, loregs[LGW_VERSION].addr, &u);
+	pthread_mutex_unlock(&ctx->mx_bus);
 	if (spi_stat != LGW_SPI_SUCCESS) {
 		DEBUG_MSG("ERROR READING VERSION REGISTER\n");
 		return LGW_REG_ERROR;
@@ -466,13 +603,19 @@ int lgw_connect(void) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 /* Concentrator disconnect */
-int lgw_disconnect(void) {
-	if (lgw_spi_target != NULL) {
-		lgw_spi_close(lgw_spi_target);
-		lgw_spi_target = NULL;
+int lgw_disconnect_ctx(struct lgw_reg_ctx_s *ctx) {
+	CHECK_NULL(ctx);
+	
+	pthread_mutex_lock(&ctx->mx_bus);
+	if (ctx->spi_target != NULL) {
+		lgw_spi_close(ctx->spi_target);
+		ctx->spi_target = NULL;
+		ctx->regpage = -1;
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("Note: success disconnecting the concentrator\n");
 		return LGW_REG_SUCCESS;
 	} else {
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("WARNING: concentrator was already disconnected\n");
 		return LGW_REG_ERROR;
 	}
@@ -481,21 +624,26 @@ int lgw_disconnect(void) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 /* soft-reset function */
-int lgw_soft_reset(void) {
+int lgw_soft_reset_ctx(struct lgw_reg_ctx_s *ctx) {
+	CHECK_NULL(ctx);
+	
+	pthread_mutex_lock(&ctx->mx_bus);
 	/* check if SPI is initialised */
-	if ((lgw_spi_target == NULL) || (lgw_regpage < 0)) {
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
 		return LGW_REG_ERROR;
 	}
-	lgw_spi_w(lgw_spi_target, 0, 0x80); /* 1 -> SOFT_RESET bit */
-	lgw_regpage = 0; /* reset the paging static variable */
+	lgw_spi_w(ctx->spi_target, 0, 0x80); /* 1 -> SOFT_RESET bit */
+	ctx->regpage = 0; /* reset the paging static variable */
+	pthread_mutex_unlock(&ctx->mx_bus);
 	return LGW_REG_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 /* register verification */
-int lgw_reg_check(FILE *f) {
+int lgw_reg_check_ctx(struct lgw_reg_ctx_s *ctx, FILE *f) {
 	struct lgw_reg_s r;
 	int32_t read_value;
 	char ok_msg[] = "+++MATCH+++";
@@ -503,8 +651,10 @@ int lgw_reg_check(FILE *f) {
 	char *ptr;
 	int i;
 	
+	CHECK_NULL(ctx);
+	
 	/* check if SPI is initialised */
-	if ((lgw_spi_target == NULL) || (lgw_regpage < 0)) {
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
 		DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
 		fprintf(f, "ERROR: CONCENTRATOR UNCONNECTED\n");
 		return LGW_REG_ERROR;
@@ -513,7 +663,7 @@ int lgw_reg_check(FILE *f) {
 	fprintf(f, "Start of register verification\n");
 	for (i=0; i<LGW_TOTALREGS; ++i) {
 		r = loregs[i];
-		lgw_reg_r(i, &read_value);
+		lgw_reg_r_ctx(ctx, i, &read_value);
 		ptr = (read_value == r.dflt) ? ok_msg : notok_msg;
 		if (r.sign == true)
 			fprintf(f, "%s reg number %d read: %d (%x) default: %d (%x)\n", ptr, i, read_value, read_value, r.dflt, r.dflt);
@@ -528,32 +678,26 @@ int lgw_reg_check(FILE *f) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 /* Write to a register addressed by name */
-int lgw_reg_w(uint16_t register_id, int32_t reg_value) {
+int lgw_reg_w_ctx(struct lgw_reg_ctx_s *ctx, uint16_t register_id, int32_t reg_value) {
 	int spi_stat = LGW_SPI_SUCCESS;
 	struct lgw_reg_s r;
 	uint8_t buf[4] = "\x00\x00\x00\x00";
 	int i, size_byte;
+	enum lgw_reg_prof_e kind = LGW_REG_PROF_W;
+	bool pg = false;
 	
 	/* check input parameters */
+	CHECK_NULL(ctx);
 	if (register_id >= LGW_TOTALREGS) {
 		DEBUG_MSG("ERROR: REGISTER NUMBER OUT OF DEFINED RANGE\n");
 		return LGW_REG_ERROR;
 	}
 	
-	/* check if SPI is initialised */
-	if ((lgw_spi_target == NULL) || (lgw_regpage < 0)) {
-		DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
-		return LGW_REG_ERROR;
-	}
-	
-	/* intercept direct access to PAGE_REG & SOFT_RESET */
-	if (register_id == LGW_PAGE_REG) {
-		page_switch(reg_value);
-		return LGW_REG_SUCCESS;
-	} else if (register_id == LGW_SOFT_RESET) {
+	/* intercept direct access to SOFT_RESET (takes the bus mutex itself) */
+	if (register_id == LGW_SOFT_RESET) {
 		/* only reset if lsb is 1 */
 		if ((reg_value & 0x01) != 0)
-			lgw_soft_reset();
+			lgw_soft_reset_ctx(ctx);
 		return LGW_REG_SUCCESS;
 	}
 	
@@ -566,21 +710,39 @@ int lgw_reg_w(uint16_t register_id, int32_t reg_value) {
 		return LGW_REG_ERROR;
 	}
 	
+	pthread_mutex_lock(&ctx->mx_bus);
+	
+	/* check if SPI is initialised */
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
+		DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
+		return LGW_REG_ERROR;
+	}
+	
+	/* intercept direct access to PAGE_REG */
+	if (register_id == LGW_PAGE_REG) {
+		lgw_reg_page_switch(ctx, reg_value);
+		pthread_mutex_unlock(&ctx->mx_bus);
+		return LGW_REG_SUCCESS;
+	}
+	
 	/* select proper register page if needed */
-	if ((r.page != -1) && (r.page != lgw_regpage)) {
-		spi_stat += page_switch(r.page);
+	if ((r.page != -1) && (r.page != ctx->regpage)) {
+		spi_stat += lgw_reg_page_switch(ctx, r.page);
+		pg = true;
 	}
 	
 	if ((r.leng == 8) && (r.offs == 0)) {
 		/* direct write */
-		spi_stat += lgw_spi_w(lgw_spi_target, r.addr, (uint8_t)reg_value);
+		spi_stat += lgw_spi_w(ctx->spi_target, r.addr, (uint8_t)reg_value);
 	} else if ((r.offs + r.leng) <= 8) {
 		/* single-byte read-modify-write, offs:[0-7], leng:[1-7] */
-		spi_stat += lgw_spi_r(lgw_spi_target, r.addr, &buf[0]);
+		kind = LGW_REG_PROF_RMW;
+		spi_stat += lgw_spi_r(ctx->spi_target, r.addr, &buf[0]);
 		buf[1] = ((1 << r.leng) - 1) << r.offs; /* bit mask */
 		buf[2] = ((uint8_t)reg_value) << r.offs; /* new data offsetted */
 		buf[3] = (~buf[1] & buf[0]) | (buf[1] & buf[2]); /* mixing old & new data */
-		spi_stat += lgw_spi_w(lgw_spi_target, r.addr, buf[3]);
+		spi_stat += lgw_spi_w(ctx->spi_target, r.addr, buf[3]);
 	} else if ((r.offs == 0) && (r.leng > 0) && (r.leng <= 32)) {
 		/* multi-byte direct write routine */
 		size_byte = (r.leng + 7) / 8; /* add a byte if it's not an exact multiple of 8 */ 
@@ -590,12 +752,15 @@ int lgw_reg_w(uint16_t register_id, int32_t reg_value) {
 			buf[i] = (uint8_t)(0x000000FF & reg_value);
 			reg_value = (reg_value >> 8);
 		}
-		spi_stat += lgw_spi_wb(lgw_spi_target, r.addr, buf, size_byte); /* write the register in one burst */
+		spi_stat += lgw_spi_wb(ctx->spi_target, r.addr, buf, size_byte); /* write the register in one burst */
 	} else {
 		/* register spanning multiple memory bytes but with an offset */
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("ERROR: REGISTER SIZE AND OFFSET ARE NOT SUPPORTED\n");
 		return LGW_REG_ERROR;
 	}
+	pthread_mutex_unlock(&ctx->mx_bus);
+	lgw_reg_profile_hit(register_id, kind, 0, pg);
 	
 	if (spi_stat != LGW_SPI_SUCCESS) {
 		DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER WRITE\n");
@@ -608,38 +773,44 @@ int lgw_reg_w(uint16_t register_id, int32_t reg_value) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 /* Read to a register addressed by name */
-int lgw_reg_r(uint16_t register_id, int32_t *reg_value) {
+int lgw_reg_r_ctx(struct lgw_reg_ctx_s *ctx, uint16_t register_id, int32_t *reg_value) {
 	int spi_stat = LGW_SPI_SUCCESS;
 	struct lgw_reg_s r;
 	uint8_t bufu[4] = "\x00\x00\x00\x00";
 	int8_t *bufs = (int8_t *)bufu;
 	int i, size_byte;
 	uint32_t u = 0;
+	bool pg = false;
 	
 	/* check input parameters */
+	CHECK_NULL(ctx);
 	CHECK_NULL(reg_value);
 	if (register_id >= LGW_TOTALREGS) {
 		DEBUG_MSG("ERROR: REGISTER NUMBER OUT OF DEFINED RANGE\n");
 		return LGW_REG_ERROR;
 	}
 	
+	/* get register struct from the struct array */
+	r = loregs[register_id];
+	
+	pthread_mutex_lock(&ctx->mx_bus);
+	
 	/* check if SPI is initialised */
-	if ((lgw_spi_target == NULL) || (lgw_regpage < 0)) {
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
 		return LGW_REG_ERROR;
 	}
 	
-	/* get register struct from the struct array */
-	r = loregs[register_id];
-	
 	/* select proper register page if needed */
-	if ((r.page != -1) && (r.page != lgw_regpage)) {
-		spi_stat += page_switch(r.page);
+	if ((r.page != -1) && (r.page != ctx->regpage)) {
+		spi_stat += lgw_reg_page_switch(ctx, r.page);
+		pg = true;
 	}
 	
 	if ((r.offs + r.leng) <= 8) {
 		/* read one byte, then shift and mask bits to get reg value with sign extension if needed */
-		spi_stat += lgw_spi_r(lgw_spi_target, r.addr, &bufu[0]);
+		spi_stat += lgw_spi_r(ctx->spi_target, r.addr, &bufu[0]);
 		bufu[1] = bufu[0] << (8 - r.leng - r.offs); /* left-align the data */
 		if (r.sign == true) {
 			bufs[2] = bufs[1] >> (8 - r.leng); /* right align the data with sign extension (ARITHMETIC right shift) */
@@ -650,7 +821,7 @@ int lgw_reg_r(uint16_t register_id, int32_t *reg_value) {
 		}
 	} else if ((r.offs == 0) && (r.leng > 0) && (r.leng <= 32)) {
 		size_byte = (r.leng + 7) / 8; /* add a byte if it's not an exact multiple of 8 */ 
-		spi_stat += lgw_spi_rb(lgw_spi_target, r.addr, bufu, size_byte);
+		spi_stat += lgw_spi_rb(ctx->spi_target, r.addr, bufu, size_byte);
 		u = 0;
 		for (i=(size_byte-1); i>=0; --i) {
 			u = (uint32_t)bufu[i] + (u << 8); /* transform a 4-byte array into a 32 bit word */
@@ -663,9 +834,12 @@ int lgw_reg_r(uint16_t register_id, int32_t *reg_value) {
 		}
 	} else {
 		/* register spanning multiple memory bytes but with an offset */
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("ERROR: REGISTER SIZE AND OFFSET ARE NOT SUPPORTED\n");
 		return LGW_REG_ERROR;
 	}
+	pthread_mutex_unlock(&ctx->mx_bus);
+	lgw_reg_profile_hit(register_id, LGW_REG_PROF_R, 0, pg);
 	
 	if (spi_stat != LGW_SPI_SUCCESS) {
 		DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER WRITE\n");
@@ -678,11 +852,13 @@ int lgw_reg_r(uint16_t register_id, int32_t *reg_value) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 /* Point to a register by name and do a burst write */
-int lgw_reg_wb(uint16_t register_id, uint8_t *data, uint16_t size) {
-	int spi_stat;
+int lgw_reg_wb_ctx(struct lgw_reg_ctx_s *ctx, uint16_t register_id, uint8_t *data, uint16_t size) {
+	int spi_stat = LGW_SPI_SUCCESS;
 	struct lgw_reg_s r;
+	bool pg = false;
 	
 	/* check input parameters */
+	CHECK_NULL(ctx);
 	CHECK_NULL(data);
 	if (size == 0) {
 		DEBUG_MSG("ERROR: BURST OF NULL LENGTH\n");
@@ -693,12 +869,6 @@ int lgw_reg_wb(uint16_t register_id, uint8_t *data, uint16_t size) {
 		return LGW_REG_ERROR;
 	}
 	
-	/* check if SPI is initialised */
-	if ((lgw_spi_target == NULL) || (lgw_regpage < 0)) {
-		DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
-		return LGW_REG_ERROR;
-	}
-	
 	/* get register struct from the struct array */
 	r = loregs[register_id];
 	
@@ -708,13 +878,25 @@ int lgw_reg_wb(uint16_t register_id, uint8_t *data, uint16_t size) {
 		return LGW_REG_ERROR;
 	}
 	
+	pthread_mutex_lock(&ctx->mx_bus);
+	
+	/* check if SPI is initialised */
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
+		DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
+		return LGW_REG_ERROR;
+	}
+	
 	/* select proper register page if needed */
-	if ((r.page != -1) && (r.page != lgw_regpage)) {
-		spi_stat += page_switch(r.page);
+	if ((r.page != -1) && (r.page != ctx->regpage)) {
+		spi_stat += lgw_reg_page_switch(ctx, r.page);
+		pg = true;
 	}
 	
 	/* do the burst write */
-	spi_stat = lgw_spi_wb(lgw_spi_target, r.addr, data, size);
+	spi_stat += lgw_spi_wb(ctx->spi_target, r.addr, data, size);
+	pthread_mutex_unlock(&ctx->mx_bus);
+	lgw_reg_profile_hit(register_id, LGW_REG_PROF_WB, size, pg);
 	
 	if (spi_stat != LGW_SPI_SUCCESS) {
 		DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER BURST WRITE\n");
@@ -727,11 +909,13 @@ int lgw_reg_wb(uint16_t register_id, uint8_t *data, uint16_t size) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 /* Point to a register by name and do a burst read */
-int lgw_reg_rb(uint16_t register_id, uint8_t *data, uint16_t size) {
-	int spi_stat;
+int lgw_reg_rb_ctx(struct lgw_reg_ctx_s *ctx, uint16_t register_id, uint8_t *data, uint16_t size) {
+	int spi_stat = LGW_SPI_SUCCESS;
 	struct lgw_reg_s r;
+	bool pg = false;
 	
 	/* check input parameters */
+	CHECK_NULL(ctx);
 	CHECK_NULL(data);
 	if (size == 0) {
 		DEBUG_MSG("ERROR: BURST OF NULL LENGTH\n");
@@ -742,22 +926,28 @@ int lgw_reg_rb(uint16_t register_id, uint8_t *data, uint16_t size) {
 		return LGW_REG_ERROR;
 	}
 	
+	/* get register struct from the struct array */
+	r = loregs[register_id];
+	
+	pthread_mutex_lock(&ctx->mx_bus);
+	
 	/* check if SPI is initialised */
-	if ((lgw_spi_target == NULL) || (lgw_regpage < 0)) {
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
 		DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
 		return LGW_REG_ERROR;
 	}
 	
-	/* get register struct from the struct array */
-	r = loregs[register_id];
-	
 	/* select proper register page if needed */
-	if ((r.page != -1) && (r.page != lgw_regpage)) {
-		spi_stat += page_switch(r.page);
+	if ((r.page != -1) && (r.page != ctx->regpage)) {
+		spi_stat += lgw_reg_page_switch(ctx, r.page);
+		pg = true;
 	}
 	
 	/* do the burst read */
-	spi_stat = lgw_spi_rb(lgw_spi_target, r.addr, data, size);
+	spi_stat += lgw_spi_rb(ctx->spi_target, r.addr, data, size);
+	pthread_mutex_unlock(&ctx->mx_bus);
+	lgw_reg_profile_hit(register_id, LGW_REG_PROF_RB, size, pg);
 	
 	if (spi_stat != LGW_SPI_SUCCESS) {
 		DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER BURST READ\n");
@@ -767,4 +957,236 @@ int lgw_reg_rb(uint16_t register_id, uint8_t *data, uint16_t size) {
 	}
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Batch of SX125x radio register accesses */
+int lgw_reg_radio_batch_ctx(struct lgw_reg_ctx_s *ctx, struct lgw_reg_radio_op_s *ops, uint16_t nb) {
+	int spi_stat = LGW_SPI_SUCCESS;
+	struct lgw_spi_op_s spi_ops[RADIO_BATCH_CHUNK * RADIO_SPI_OPS];
+	struct lgw_reg_s cs, ad, da, rb;
+	uint8_t cs_idle[RADIO_NB] = {0, 0}; /* chip select byte with the chip select bit cleared */
+	uint8_t cs_mask;
+	bool used[RADIO_NB] = {false, false};
+	bool pg = false;
+	int8_t page;
+	uint16_t done, chunk, i, j, n;
+	int r;
+	
+	/* check input parameters */
+	CHECK_NULL(ctx);
+	CHECK_NULL(ops);
+	for (i = 0; i < nb; ++i) {
+		if (ops[i].radio >= RADIO_NB) {
+			DEBUG_MSG("ERROR: INVALID RADIO\n");
+			return LGW_REG_ERROR;
+		}
+		if (ops[i].addr >= 0x7F) {
+			DEBUG_MSG("ERROR: RADIO ADDRESS OUT OF RANGE\n");
+			return LGW_REG_ERROR;
+		}
+		used[ops[i].radio] = true;
+	}
+	if (nb == 0) {
+		return LGW_REG_SUCCESS;
+	}
+	
+	/* all the SPI master registers are single-byte registers of the same page */
+	page = loregs[radio_regs[0][0]].page;
+	
+	pthread_mutex_lock(&ctx->mx_bus);
+	
+	/* check if SPI is initialised */
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
+		DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
+		return LGW_REG_ERROR;
+	}
+	
+	/* select proper register page if needed */
+	if ((page != -1) && (page != ctx->regpage)) {
+		spi_stat += lgw_reg_page_switch(ctx, page);
+		pg = true;
+	}
+	
+	/* read the chip select bytes once, so the toggles below are plain writes instead of read-modify-writes */
+	for (r = 0; r < RADIO_NB; ++r) {
+		if (used[r]) {
+			cs = loregs[radio_regs[r][0]];
+			spi_stat += lgw_spi_r(ctx->spi_target, cs.addr, &cs_idle[r]);
+			cs_idle[r] &= (uint8_t)~(1 << cs.offs);
+		}
+	}
+	
+	for (done = 0; done < nb; done += chunk) {
+		chunk = ((nb - done) < RADIO_BATCH_CHUNK) ? (nb - done) : RADIO_BATCH_CHUNK;
+		
+		/* precompute the chip select/address/data sequence of the chunk */
+		for (i = 0, n = 0; i < chunk; ++i) {
+			r = ops[done+i].radio;
+			cs = loregs[radio_regs[r][0]];
+			ad = loregs[radio_regs[r][1]];
+			da = loregs[radio_regs[r][2]];
+			rb = loregs[radio_regs[r][3]];
+			cs_mask = (uint8_t)(1 << cs.offs);
+			spi_ops[n].address = cs.addr;
+			spi_ops[n].data = cs_idle[r];
+			spi_ops[n++].read = false;
+			spi_ops[n].address = ad.addr;
+			spi_ops[n].data = ops[done+i].read ? ops[done+i].addr : (0x80 | ops[done+i].addr); /* MSB at 1 for write operation */
+			spi_ops[n++].read = false;
+			spi_ops[n].address = da.addr;
+			spi_ops[n].data = ops[done+i].read ? 0 : ops[done+i].data;
+			spi_ops[n++].read = false;
+			spi_ops[n].address = cs.addr;
+			spi_ops[n].data = cs_idle[r] | cs_mask;
+			spi_ops[n++].read = false;
+			spi_ops[n].address = cs.addr;
+			spi_ops[n].data = cs_idle[r];
+			spi_ops[n++].read = false;
+			if (ops[done+i].read) {
+				/* read-back only where the data is needed */
+				spi_ops[n].address = rb.addr;
+				spi_ops[n].data = 0;
+				spi_ops[n++].read = true;
+			}
+		}
+		spi_stat += lgw_spi_batch(ctx->spi_target, spi_ops, n);
+		
+		/* fetch the read data */
+		for (i = 0, j = 0; i < chunk; ++i) {
+			j += RADIO_SPI_OPS - 1;
+			if (ops[done+i].read) {
+				ops[done+i].data = spi_ops[j++].data;
+			}
+		}
+	}
+	pthread_mutex_unlock(&ctx->mx_bus);
+	
+	/* account the accesses as the equivalent register accesses */
+	for (i = 0; i < nb; ++i) {
+		r = ops[i].radio;
+		lgw_reg_profile_hit(radio_regs[r][0], LGW_REG_PROF_W, 0, pg && (i == 0));
+		lgw_reg_profile_hit(radio_regs[r][1], LGW_REG_PROF_W, 0, false);
+		lgw_reg_profile_hit(radio_regs[r][2], LGW_REG_PROF_W, 0, false);
+		lgw_reg_profile_hit(radio_regs[r][0], LGW_REG_PROF_W, 0, false);
+		lgw_reg_profile_hit(radio_regs[r][0], LGW_REG_PROF_W, 0, false);
+		if (ops[i].read) {
+			lgw_reg_profile_hit(radio_regs[r][3], LGW_REG_PROF_R, 0, false);
+		}
+	}
+	
+	if (spi_stat != LGW_SPI_SUCCESS) {
+		DEBUG_MSG("ERROR: SPI ERROR DURING RADIO BATCH\n");
+		return LGW_REG_ERROR;
+	} else {
+		return LGW_REG_SUCCESS;
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* SPI clock probing */
+int lgw_reg_spi_probe_ctx(struct lgw_reg_ctx_s *ctx, uint32_t min_hz, uint32_t max_hz, uint32_t step_hz, uint32_t *speed_hz) {
+	uint32_t seed = 0x12345678;
+	uint32_t initial_hz = 0;
+	uint32_t best_hz = 0;
+	uint32_t f;
+	int spi_stat;
+
+	/* check input parameters */
+	CHECK_NULL(ctx);
+	CHECK_NULL(speed_hz);
+	if ((min_hz == 0) || (min_hz > max_hz) || (step_hz == 0)) {
+		DEBUG_MSG("ERROR: INVALID SPI PROBE RANGE\n");
+		return LGW_REG_ERROR;
+	}
+
+	/* check if SPI is initialised */
+	pthread_mutex_lock(&ctx->mx_bus);
+	if ((ctx->spi_target == NULL) || (ctx->regpage < 0)) {
+		pthread_mutex_unlock(&ctx->mx_bus);
+		DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
+		return LGW_REG_ERROR;
+	}
+	lgw_spi_get_speed(ctx->spi_target, &initial_hz);
+	pthread_mutex_unlock(&ctx->mx_bus);
+
+	/* step the clock up until the first error */
+	for (f = min_hz; f <= max_hz; f += step_hz) {
+		pthread_mutex_lock(&ctx->mx_bus);
+		spi_stat = lgw_spi_set_speed(ctx->spi_target, f);
+		pthread_mutex_unlock(&ctx->mx_bus);
+		if ((spi_stat != LGW_SPI_SUCCESS) || (probe_patterns(ctx, &seed) != LGW_REG_SUCCESS)) {
+			DEBUG_PRINTF("Note: SPI probe, error at %u Hz\n", f);
+			break;
+		}
+		DEBUG_PRINTF("Note: SPI probe, no error at %u Hz\n", f);
+		best_hz = f;
+		if (f > (UINT32_MAX - step_hz)) {
+			break; /* prevent wrap-around */
+		}
+	}
+
+	pthread_mutex_lock(&ctx->mx_bus);
+	if (best_hz == 0) {
+		/* not even the lowest clock worked, restore the initial one */
+		lgw_spi_set_speed(ctx->spi_target, initial_hz);
+		pthread_mutex_unlock(&ctx->mx_bus);
+		DEBUG_MSG("ERROR: NO ERROR-FREE SPI CLOCK FOUND\n");
+		return LGW_REG_ERROR;
+	}
+	best_hz -= (uint32_t)(((uint64_t)best_hz * PROBE_MARGIN_PCT) / 100);
+	best_hz = (best_hz < min_hz) ? min_hz : best_hz;
+	spi_stat = lgw_spi_set_speed(ctx->spi_target, best_hz);
+	ctx->spi_speed = best_hz; /* keep it for the next connections */
+	pthread_mutex_unlock(&ctx->mx_bus);
+
+	*speed_hz = best_hz;
+	return (spi_stat == LGW_SPI_SUCCESS) ? LGW_REG_SUCCESS : LGW_REG_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Functions acting on the default context */
+
+int lgw_connect(void) {
+	return lgw_connect_ctx(&lgw_reg_ctx_default);
+}
+
+int lgw_disconnect(void) {
+	return lgw_disconnect_ctx(&lgw_reg_ctx_default);
+}
+
+int lgw_soft_reset(void) {
+	return lgw_soft_reset_ctx(&lgw_reg_ctx_default);
+}
+
+int lgw_reg_check(FILE *f) {
+	return lgw_reg_check_ctx(&lgw_reg_ctx_default, f);
+}
+
+int lgw_reg_w(uint16_t register_id, int32_t reg_value) {
+	return lgw_reg_w_ctx(&lgw_reg_ctx_default, register_id, reg_value);
+}
+
+int lgw_reg_r(uint16_t register_id, int32_t *reg_value) {
+	return lgw_reg_r_ctx(&lgw_reg_ctx_default, register_id, reg_value);
+}
+
+int lgw_reg_wb(uint16_t register_id, uint8_t *data, uint16_t size) {
+	return lgw_reg_wb_ctx(&lgw_reg_ctx_default, register_id, data, size);
+}
+
+int lgw_reg_rb(uint16_t register_id, uint8_t *data, uint16_t size) {
+	return lgw_reg_rb_ctx(&lgw_reg_ctx_default, register_id, data, size);
+}
+
+int lgw_reg_radio_batch(struct lgw_reg_radio_op_s *ops, uint16_t nb) {
+	return lgw_reg_radio_batch_ctx(&lgw_reg_ctx_default, ops, nb);
+}
+
+int lgw_reg_spi_probe(uint32_t min_hz, uint32_t max_hz, uint32_t step_hz, uint32_t *speed_hz) {
+	return lgw_reg_spi_probe_ctx(&lgw_reg_ctx_default, min_hz, max_hz, step_hz, speed_hz);
+}
+
 /* --- EOF ------------------------------------------------------------------ */
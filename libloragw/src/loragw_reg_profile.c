@@ -0,0 +1,271 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	Register access profiler.
+	Counts reads, writes, read-modify-write read-backs, burst bytes and page
+	switches per register and per calling site (set by the HAL entry points
+	with lgw_reg_profile_site), and dumps a report sorted by SPI cost.
+	Disabled by default, costs one atomic load per register access when
+	disabled.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+#include <stdio.h>		/* fprintf */
+#include <stdlib.h>		/* calloc qsort */
+#include <string.h>		/* memset strcmp */
+#include <pthread.h>	/* mutex */
+
+#include "loragw_reg.h"
+#include "loragw_reg_map.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define ATOMIC_LOAD(p)		__atomic_load_n((p), __ATOMIC_RELAXED)
+#define ATOMIC_STORE(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define ATOMIC_ADD(p, v)	__atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define PROF_SITES		16	/* max number of calling sites, site 0 collects untagged accesses */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct prof_cnt_s {
+	uint64_t	cnt[LGW_REG_PROF_NB];	/* number of accesses of each kind */
+	uint64_t	bytes;					/* bytes transferred by bursts */
+	uint64_t	pages;					/* page switches caused by the accesses */
+};
+
+/* one line of the report */
+struct prof_line_s {
+	int			site;
+	uint16_t	reg;
+	uint64_t	spi;	/* number of SPI transactions */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static const char *reg_names[LGW_TOTALREGS] = { LGW_REG_MAP_NAMES };
+
+static int prof_enabled = 0;
+static struct prof_cnt_s (*prof_cnt)[LGW_TOTALREGS] = NULL; /* [PROF_SITES][LGW_TOTALREGS], allocated at first enable */
+
+static const char *prof_sites[PROF_SITES] = { "(untagged)" }; /* appended under mx_prof, read lock-free */
+static int prof_nb_sites = 1;
+static pthread_mutex_t mx_prof = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread const char *thread_site = NULL;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+/* number of SPI transactions of a counter set */
+static uint64_t prof_spi_cost(const struct prof_cnt_s *c) {
+	return c->cnt[LGW_REG_PROF_R] + c->cnt[LGW_REG_PROF_W] + (2 * c->cnt[LGW_REG_PROF_RMW]) + c->cnt[LGW_REG_PROF_RB] + c->cnt[LGW_REG_PROF_WB] + c->pages;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* index of a site, registered at its first use */
+static int prof_site_index(const char *site) {
+	int i, n;
+	
+	if (site == NULL) {
+		return 0;
+	}
+	n = __atomic_load_n(&prof_nb_sites, __ATOMIC_ACQUIRE);
+	for (i = 1; i < n; ++i) {
+		if (prof_sites[i] == site) {
+			return i;
+		}
+	}
+	
+	/* unknown pointer, compare names and append under the lock */
+	pthread_mutex_lock(&mx_prof);
+	n = prof_nb_sites;
+	for (i = 1; i < n; ++i) {
+		if (strcmp(prof_sites[i], site) == 0) {
+			break;
+		}
+	}
+	if ((i == n) && (n < PROF_SITES)) {
+		prof_sites[n] = site;
+		__atomic_store_n(&prof_nb_sites, n + 1, __ATOMIC_RELEASE);
+	} else if (i == n) {
+		i = 0; /* table full, count as untagged */
+	}
+	pthread_mutex_unlock(&mx_prof);
+	return i;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* descending SPI cost, then register ID */
+static int prof_line_cmp(const void *a, const void *b) {
+	const struct prof_line_s *la = a;
+	const struct prof_line_s *lb = b;
+	
+	if (la->spi != lb->spi) {
+		return (la->spi < lb->spi) ? 1 : -1;
+	}
+	if (la->site != lb->site) {
+		return la->site - lb->site;
+	}
+	return (int)la->reg - (int)lb->reg;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void lgw_reg_profile_enable(bool enable) {
+	void *p;
+	
+	if (enable) {
+		pthread_mutex_lock(&mx_prof);
+		if (__atomic_load_n(&prof_cnt, __ATOMIC_ACQUIRE) == NULL) {
+			p = calloc(PROF_SITES, sizeof *prof_cnt);
+			if (p == NULL) {
+				pthread_mutex_unlock(&mx_prof);
+				return;
+			}
+			__atomic_store_n(&prof_cnt, p, __ATOMIC_RELEASE);
+		}
+		pthread_mutex_unlock(&mx_prof);
+	}
+	ATOMIC_STORE(&prof_enabled, enable ? 1 : 0);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_reg_profile_reset(void) {
+	struct prof_cnt_s (*c)[LGW_TOTALREGS];
+	int s, r, k;
+	
+	c = __atomic_load_n(&prof_cnt, __ATOMIC_ACQUIRE);
+	if (c == NULL) {
+		return;
+	}
+	for (s = 0; s < PROF_SITES; ++s) {
+		for (r = 0; r < LGW_TOTALREGS; ++r) {
+			for (k = 0; k < LGW_REG_PROF_NB; ++k) {
+				ATOMIC_STORE(&c[s][r].cnt[k], 0);
+			}
+			ATOMIC_STORE(&c[s][r].bytes, 0);
+			ATOMIC_STORE(&c[s][r].pages, 0);
+		}
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+const char *lgw_reg_profile_site(const char *site) {
+	const char *prev = thread_site;
+	
+	thread_site = site;
+	return prev;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_reg_profile_hit(uint16_t register_id, enum lgw_reg_prof_e kind, uint16_t size, bool page_switch) {
+	struct prof_cnt_s (*c)[LGW_TOTALREGS];
+	struct prof_cnt_s *p;
+	
+	if ((ATOMIC_LOAD(&prof_enabled) == 0) || (register_id >= LGW_TOTALREGS) || ((unsigned)kind >= LGW_REG_PROF_NB)) {
+		return;
+	}
+	c = __atomic_load_n(&prof_cnt, __ATOMIC_ACQUIRE);
+	p = &c[prof_site_index(thread_site)][register_id];
+	ATOMIC_ADD(&p->cnt[kind], 1);
+	if ((kind == LGW_REG_PROF_RB) || (kind == LGW_REG_PROF_WB)) {
+		ATOMIC_ADD(&p->bytes, size);
+	}
+	if (page_switch) {
+		ATOMIC_ADD(&p->pages, 1);
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_reg_profile_dump(FILE *f) {
+	struct prof_cnt_s (*c)[LGW_TOTALREGS];
+	struct prof_cnt_s snap;
+	struct prof_line_s *lines;
+	uint64_t total = 0;
+	int nb_sites, nb_lines = 0;
+	int s, r, k, i;
+	
+	if (f == NULL) {
+		return LGW_REG_ERROR;
+	}
+	c = __atomic_load_n(&prof_cnt, __ATOMIC_ACQUIRE);
+	if (c == NULL) {
+		fprintf(f, "register profile: never enabled\n");
+		return LGW_REG_SUCCESS;
+	}
+	lines = malloc(PROF_SITES * LGW_TOTALREGS * sizeof *lines);
+	if (lines == NULL) {
+		return LGW_REG_ERROR;
+	}
+	
+	/* collect the registers that were accessed, sort them by SPI cost */
+	nb_sites = __atomic_load_n(&prof_nb_sites, __ATOMIC_ACQUIRE);
+	for (s = 0; s < nb_sites; ++s) {
+		for (r = 0; r < LGW_TOTALREGS; ++r) {
+			for (k = 0; k < LGW_REG_PROF_NB; ++k) {
+				snap.cnt[k] = ATOMIC_LOAD(&c[s][r].cnt[k]);
+			}
+			snap.pages = ATOMIC_LOAD(&c[s][r].pages);
+			if (prof_spi_cost(&snap) == 0) {
+				continue;
+			}
+			lines[nb_lines].site = s;
+			lines[nb_lines].reg = (uint16_t)r;
+			lines[nb_lines].spi = prof_spi_cost(&snap);
+			total += lines[nb_lines].spi;
+			++nb_lines;
+		}
+	}
+	qsort(lines, nb_lines, sizeof *lines, prof_line_cmp);
+	
+	fprintf(f, "register profile: %llu SPI transactions, %s\n", (unsigned long long)total, ATOMIC_LOAD(&prof_enabled) ? "running" : "stopped");
+	fprintf(f, "%-20s %-36s %10s %10s %10s %10s %10s %12s %10s %10s %6s\n", "site", "register", "reads", "writes", "rmw", "b.reads", "b.writes", "b.bytes", "pages", "spi", "%");
+	for (i = 0; i < nb_lines; ++i) {
+		s = lines[i].site;
+		r = lines[i].reg;
+		fprintf(f, "%-20s %-36s %10llu %10llu %10llu %10llu %10llu %12llu %10llu %10llu %6.2f\n",
+			prof_sites[s], reg_names[r],
+			(unsigned long long)ATOMIC_LOAD(&c[s][r].cnt[LGW_REG_PROF_R]),
+			(unsigned long long)ATOMIC_LOAD(&c[s][r].cnt[LGW_REG_PROF_W]),
+			(unsigned long long)ATOMIC_LOAD(&c[s][r].cnt[LGW_REG_PROF_RMW]),
+			(unsigned long long)ATOMIC_LOAD(&c[s][r].cnt[LGW_REG_PROF_RB]),
+			(unsigned long long)ATOMIC_LOAD(&c[s][r].cnt[LGW_REG_PROF_WB]),
+			(unsigned long long)ATOMIC_LOAD(&c[s][r].bytes),
+			(unsigned long long)ATOMIC_LOAD(&c[s][r].pages),
+			(unsigned long long)lines[i].spi,
+			(100.0 * lines[i].spi) / total);
+	}
+	
+	free(lines);
+	return LGW_REG_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -53,20 +53,40 @@ Maintainer: Sylvain Miermont
 /* parameters for a FT2232H */
 #define VID		0x0403
 #define PID		0x6010
+#define SPI_SPEED	SIX_MHZ
 
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
-/* SPI initialization and configuration */
+/* SPI initialization and configuration, with default options */
 int lgw_spi_open(void **spi_target_ptr) {
+	return lgw_spi_open_opt(spi_target_ptr, NULL);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* SPI initialization and configuration */
+int lgw_spi_open_opt(void **spi_target_ptr, const struct lgw_spi_opt_s *opt) {
 	struct mpsse_context *mpsse = NULL;
+	const char *env;
+	uint32_t speed = 0;
 	int a, b;
 	
 	/* check input variables */
 	CHECK_NULL(spi_target_ptr); /* cannot be null, must point on a void pointer (*spi_target_ptr can be null) */
 	
+	/* resolve clock option: explicit option, then environment, then default */
+	if (opt != NULL) {
+		speed = opt->speed_hz;
+	}
+	if (speed == 0) {
+		env = getenv(LGW_SPI_ENV_SPEED);
+		speed = (env != NULL) ? (uint32_t)strtoul(env, NULL, 0) : 0;
+		speed = (speed != 0) ? speed : SPI_SPEED;
+	}
+	
 	/* try to open the first available FTDI device matching VID/PID parameters */
-	mpsse = OpenIndex(VID,PID,SPI0, SIX_MHZ, MSB, IFACE_A, NULL, NULL, 0);
+	mpsse = OpenIndex(VID,PID,SPI0, speed, MSB, IFACE_A, NULL, NULL, 0);
 	if (mpsse == NULL) {
 		DEBUG_MSG("ERROR: MPSSE OPEN FUNCTION RETURNED NULL\n");
 		return LGW_SPI_ERROR;
@@ -107,11 +127,46 @@ int lgw_spi_close(void *spi_target) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+/* SPI clock change */
+int lgw_spi_set_speed(void *spi_target, uint32_t speed_hz) {
+	struct mpsse_context *mpsse = spi_target;
+	
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	if (speed_hz == 0) {
+		DEBUG_MSG("ERROR: INVALID SPI SPEED\n");
+		return LGW_SPI_ERROR;
+	}
+	
+	if (SetClock(mpsse, speed_hz) != MPSSE_OK) {
+		DEBUG_MSG("ERROR: MPSSE FAIL TO SET CLOCK\n");
+		return LGW_SPI_ERROR;
+	}
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* SPI clock query */
+int lgw_spi_get_speed(void *spi_target, uint32_t *speed_hz) {
+	struct mpsse_context *mpsse = spi_target;
+	
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	CHECK_NULL(speed_hz);
+	
+	*speed_hz = (uint32_t)GetClock(mpsse); /* actual clock, after divider rounding */
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 /* Simple write */
 /* transaction time: .6 to 1 ms typically */
 int lgw_spi_w(void *spi_target, uint8_t address, uint8_t data) {
 	struct mpsse_context *mpsse = spi_target;
 	uint8_t out_buf[2];
+	uint64_t t0;
 	int a, b, c;
 	
 	/* check input variables */
@@ -125,9 +180,11 @@ int lgw_spi_w(void *spi_target, uint8_t address, uint8_t data) {
 	out_buf[1] = data;
 	
 	/* MPSSE transaction */
+	t0 = lgw_spi_stats_begin();
 	a = Start(mpsse);
 	b = FastWrite(mpsse, (char *)out_buf, 2);
 	c = Stop(mpsse);
+	lgw_spi_stats_end(LGW_SPI_STAT_W, address, &data, 1, t0, ((a == MPSSE_OK) && (b == MPSSE_OK) && (c == MPSSE_OK)) ? LGW_SPI_SUCCESS : LGW_SPI_ERROR);
 	
 	/* determine return code */
 	if ((a != MPSSE_OK) || (b != MPSSE_OK) || (c != MPSSE_OK)) {
@@ -147,6 +204,7 @@ int lgw_spi_r(void *spi_target, uint8_t address, uint8_t *data) {
 	struct mpsse_context *mpsse = spi_target;
 	uint8_t out_buf[2];
 	uint8_t *in_buf = NULL;
+	uint64_t t0;
 	int a, b;
 	
 	/* check input variables */
@@ -161,9 +219,11 @@ int lgw_spi_r(void *spi_target, uint8_t address, uint8_t *data) {
 	out_buf[1] = 0x00;
 	
 	/* MPSSE transaction */
+	t0 = lgw_spi_stats_begin();
 	a = Start(mpsse);
 	in_buf = (uint8_t *)Transfer(mpsse, (char *)out_buf, 2);
 	b = Stop(mpsse);
+	lgw_spi_stats_end(LGW_SPI_STAT_R, address, (in_buf != NULL) ? &in_buf[1] : NULL, 1, t0, ((in_buf != NULL) && (a == MPSSE_OK) && (b == MPSSE_OK)) ? LGW_SPI_SUCCESS : LGW_SPI_ERROR);
 	
 	/* determine return code */
 	if ((in_buf == NULL) || (a != MPSSE_OK) || (b != MPSSE_OK)) {
@@ -190,6 +250,7 @@ int lgw_spi_wb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 	uint8_t command;
 	uint8_t *out_buf = NULL;
 	int size_to_do, buf_size, chunk_size, offset;
+	uint64_t t0;
 	int a=0, b=0, c=0;
 	int i;
 	
@@ -217,6 +278,7 @@ int lgw_spi_wb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 	}
 	
 	/* start MPSSE transaction */
+	t0 = lgw_spi_stats_begin();
 	a = Start(mpsse);
 	for (i=0; size_to_do > 0; ++i) {
 		chunk_size = (size_to_do < LGW_BURST_CHUNK) ? size_to_do : LGW_BURST_CHUNK;
@@ -233,6 +295,7 @@ int lgw_spi_wb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 		size_to_do -= chunk_size; /* subtract the quantity of data already transferred */
 	}
 	c = Stop(mpsse);
+	lgw_spi_stats_end(LGW_SPI_STAT_WB, address, data, size, t0, ((a == MPSSE_OK) && (b == MPSSE_OK) && (c == MPSSE_OK)) ? LGW_SPI_SUCCESS : LGW_SPI_ERROR);
 	
 	/* deallocate data buffer */
 	free(out_buf);
@@ -256,6 +319,7 @@ int lgw_spi_rb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 	struct mpsse_context *mpsse = spi_target;
 	uint8_t command;
 	int size_to_do, chunk_size, offset;
+	uint64_t t0;
 	int a=0, b=0, c=0, d=0;
 	int i;
 	
@@ -275,6 +339,7 @@ int lgw_spi_rb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 	size_to_do = size;
 	
 	/* start MPSSE transaction */
+	t0 = lgw_spi_stats_begin();
 	a = Start(mpsse);
 	b = FastWrite(mpsse, (char *)&command, 1);
 	for (i=0; size_to_do > 0; ++i) {
@@ -284,6 +349,7 @@ int lgw_spi_rb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 		size_to_do -= chunk_size; /* subtract the quantity of data already transferred */
 	}
 	d = Stop(mpsse);
+	lgw_spi_stats_end(LGW_SPI_STAT_RB, address, data, size, t0, ((a == MPSSE_OK) && (b == MPSSE_OK) && (c == MPSSE_OK) && (d == MPSSE_OK)) ? LGW_SPI_SUCCESS : LGW_SPI_ERROR);
 	
 	/* determine return code (only the last FastRead is checked) */
 	if ((a != MPSSE_OK) || (b != MPSSE_OK) || (c != MPSSE_OK) || (d != MPSSE_OK)) {
@@ -295,4 +361,26 @@ int lgw_spi_rb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 	}
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Batch of single-byte accesses, one MPSSE transaction each */
+int lgw_spi_batch(void *spi_target, struct lgw_spi_op_s *ops, uint16_t nb) {
+	int spi_stat = LGW_SPI_SUCCESS;
+	uint16_t i;
+	
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	CHECK_NULL(ops);
+	
+	for (i = 0; i < nb; ++i) {
+		if (ops[i].read) {
+			spi_stat += lgw_spi_r(spi_target, ops[i].address, &ops[i].data);
+		} else {
+			spi_stat += lgw_spi_w(spi_target, ops[i].address, ops[i].data);
+		}
+	}
+	
+	return (spi_stat != LGW_SPI_SUCCESS) ? LGW_SPI_ERROR : LGW_SPI_SUCCESS;
+}
+
 /* --- EOF ------------------------------------------------------------------ */
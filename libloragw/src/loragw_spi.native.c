@@ -55,13 +55,56 @@ Maintainer: Sylvain Miermont
 #define SPI_SPEED		8000000
 //#define SPI_DEV_PATH	"/dev/spidev0.0"
 #define SPI_DEV_PATH	"/dev/spidev32766.0"
+#define SPI_BUFSIZ_PATH	"/sys/module/spidev/parameters/bufsiz" /* max bytes per spidev message */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct spi_device_s {
+	int			fd;			/* file descriptor of the spidev device */
+	uint32_t	speed_hz;	/* SPI clock used for every transfer */
+	int			burst_chunk; /* max data bytes per burst message (command byte excluded) */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+/* largest burst chunk accepted by the spidev driver in a single message */
+static int get_burst_chunk(void) {
+	FILE *f;
+	int bufsiz = 0;
+	
+	f = fopen(SPI_BUFSIZ_PATH, "r");
+	if (f != NULL) {
+		if (fscanf(f, "%d", &bufsiz) != 1) {
+			bufsiz = 0;
+		}
+		fclose(f);
+	}
+	/* spidev rejects messages larger than bufsiz, and the command byte is part of the message */
+	if (bufsiz <= 1) {
+		DEBUG_PRINTF("WARNING: FAIL TO READ %s, USING DEFAULT BURST CHUNK\n", SPI_BUFSIZ_PATH);
+		return LGW_BURST_CHUNK;
+	}
+	return bufsiz - 1;
+}
 
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
-/* SPI initialization and configuration */
+/* SPI initialization and configuration, with default options */
 int lgw_spi_open(void **spi_target_ptr) {
-	int *spi_device = NULL;
+	return lgw_spi_open_opt(spi_target_ptr, NULL);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* SPI initialization and configuration */
+int lgw_spi_open_opt(void **spi_target_ptr, const struct lgw_spi_opt_s *opt) {
+	struct spi_device_s *spi_device = NULL;
+	const char *path = NULL;
+	const char *env;
+	uint32_t speed = 0;
 	int dev;
 	int a=0, b=0;
 	int i;
@@ -69,17 +112,33 @@ int lgw_spi_open(void **spi_target_ptr) {
 	/* check input variables */
 	CHECK_NULL(spi_target_ptr); /* cannot be null, must point on a void pointer (*spi_target_ptr can be null) */
 	
+	/* resolve options: explicit option, then environment, then default */
+	if (opt != NULL) {
+		path = opt->path;
+		speed = opt->speed_hz;
+	}
+	if ((path == NULL) || (path[0] == '\0')) {
+		env = getenv(LGW_SPI_ENV_PATH);
+		path = ((env != NULL) && (env[0] != '\0')) ? env : SPI_DEV_PATH;
+	}
+	if (speed == 0) {
+		env = getenv(LGW_SPI_ENV_SPEED);
+		speed = (env != NULL) ? (uint32_t)strtoul(env, NULL, 0) : 0;
+		speed = (speed != 0) ? speed : SPI_SPEED;
+	}
+	
 	/* allocate memory for the device descriptor */
-	spi_device = malloc(sizeof(int));
+	spi_device = malloc(sizeof(struct spi_device_s));
 	if (spi_device == NULL) {
 		DEBUG_MSG("ERROR: MALLOC FAIL\n");
 		return LGW_SPI_ERROR;
 	}
 	
 	/* open SPI device */
-	dev = open(SPI_DEV_PATH, O_RDWR);
+	dev = open(path, O_RDWR);
 	if (dev < 0) {
-		DEBUG_MSG("SPI port fail to open\n");
+		DEBUG_PRINTF("SPI port %s fail to open\n", path);
+		free(spi_device);
 		return LGW_SPI_ERROR;
 	}
 	
@@ -95,7 +154,7 @@ int lgw_spi_open(void **spi_target_ptr) {
 	}
 	
 	/* setting SPI max clk (in Hz) */
-	i = SPI_SPEED;
+	i = speed;
 	a = ioctl(dev, SPI_IOC_WR_MAX_SPEED_HZ, &i);
 	b = ioctl(dev, SPI_IOC_RD_MAX_SPEED_HZ, &i);
 	if ((a < 0) || (b < 0)) {
@@ -123,12 +182,15 @@ int lgw_spi_open(void **spi_target_ptr) {
 	if ((a < 0) || (b < 0)) {
 		DEBUG_MSG("ERROR: SPI PORT FAIL TO SET 8 BITS-PER-WORD\n");
 		close(dev);
+		free(spi_device);
 		return LGW_SPI_ERROR;
 	}
 	
-	*spi_device = dev;
+	spi_device->fd = dev;
+	spi_device->speed_hz = speed;
+	spi_device->burst_chunk = get_burst_chunk();
 	*spi_target_ptr = (void *)spi_device;
-	DEBUG_MSG("Note: SPI port opened and configured ok\n");	
+	DEBUG_PRINTF("Note: SPI port %s opened and configured ok, %u Hz, burst chunk %d bytes\n", path, speed, spi_device->burst_chunk);
 	return LGW_SPI_SUCCESS;
 }
 
@@ -136,15 +198,14 @@ int lgw_spi_open(void **spi_target_ptr) {
 
 /* SPI release */
 int lgw_spi_close(void *spi_target) {
-	int spi_device;
+	struct spi_device_s *spi_device = spi_target;
 	int a;
 	
 	/* check input variables */
 	CHECK_NULL(spi_target);
 	
 	/* close file & deallocate file descriptor */
-	spi_device = *(int *)spi_target; /* must check that spi_target is not null beforehand */
-	a = close(spi_device);
+	a = close(spi_device->fd);
 	free(spi_target);
 	
 	/* determine return code */
@@ -159,11 +220,50 @@ int lgw_spi_close(void *spi_target) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+/* SPI clock change */
+int lgw_spi_set_speed(void *spi_target, uint32_t speed_hz) {
+	struct spi_device_s *spi_device = spi_target;
+	int a, b;
+	int i;
+	
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	if (speed_hz == 0) {
+		DEBUG_MSG("ERROR: INVALID SPI SPEED\n");
+		return LGW_SPI_ERROR;
+	}
+	
+	i = speed_hz;
+	a = ioctl(spi_device->fd, SPI_IOC_WR_MAX_SPEED_HZ, &i);
+	b = ioctl(spi_device->fd, SPI_IOC_RD_MAX_SPEED_HZ, &i);
+	if ((a < 0) || (b < 0)) {
+		DEBUG_MSG("ERROR: SPI PORT FAIL TO SET MAX SPEED\n");
+		return LGW_SPI_ERROR;
+	}
+	spi_device->speed_hz = speed_hz;
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* SPI clock query */
+int lgw_spi_get_speed(void *spi_target, uint32_t *speed_hz) {
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	CHECK_NULL(speed_hz);
+	
+	*speed_hz = ((struct spi_device_s *)spi_target)->speed_hz;
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 /* Simple write */
 int lgw_spi_w(void *spi_target, uint8_t address, uint8_t data) {
-	int spi_device;
+	struct spi_device_s *spi_device = spi_target;
 	uint8_t out_buf[2];
 	struct spi_ioc_transfer k;
+	uint64_t t0;
 	int a;
 	
 	/* check input variables */
@@ -172,8 +272,6 @@ int lgw_spi_w(void *spi_target, uint8_t address, uint8_t data) {
 		DEBUG_MSG("WARNING: SPI address > 127\n");
 	}
 	
-	spi_device = *(int *)spi_target; /* must check that spi_target is not null beforehand */
-	
 	/* prepare frame to be sent */
 	out_buf[0] = WRITE_ACCESS | (address & 0x7F);
 	out_buf[1] = data;
@@ -182,10 +280,12 @@ int lgw_spi_w(void *spi_target, uint8_t address, uint8_t data) {
 	memset(&k, 0, sizeof(k)); /* clear k */
 	k.tx_buf = (unsigned long) out_buf;
 	k.len = ARRAY_SIZE(out_buf);
-	k.speed_hz = SPI_SPEED;
+	k.speed_hz = spi_device->speed_hz;
 	k.cs_change = 1;
 	k.bits_per_word = 8;
-	a = ioctl(spi_device, SPI_IOC_MESSAGE(1), &k);
+	t0 = lgw_spi_stats_begin();
+	a = ioctl(spi_device->fd, SPI_IOC_MESSAGE(1), &k);
+	lgw_spi_stats_end(LGW_SPI_STAT_W, address, &data, 1, t0, (a == 2) ? LGW_SPI_SUCCESS : LGW_SPI_ERROR);
 	
 	/* determine return code */
 	if (a != 2) {
@@ -201,10 +301,11 @@ int lgw_spi_w(void *spi_target, uint8_t address, uint8_t data) {
 
 /* Simple read */
 int lgw_spi_r(void *spi_target, uint8_t address, uint8_t *data) {
-	int spi_device;
+	struct spi_device_s *spi_device = spi_target;
 	uint8_t out_buf[2];
 	uint8_t in_buf[ARRAY_SIZE(out_buf)];
 	struct spi_ioc_transfer k;
+	uint64_t t0;
 	int a;
 	
 	/* check input variables */
@@ -214,8 +315,6 @@ int lgw_spi_r(void *spi_target, uint8_t address, uint8_t *data) {
 	}
 	CHECK_NULL(data);
 	
-	spi_device = *(int *)spi_target; /* must check that spi_target is not null beforehand */
-	
 	/* prepare frame to be sent */
 	out_buf[0] = READ_ACCESS | (address & 0x7F);
 	out_buf[1] = 0x00;
@@ -225,8 +324,11 @@ int lgw_spi_r(void *spi_target, uint8_t address, uint8_t *data) {
 	k.tx_buf = (unsigned long) out_buf;
 	k.rx_buf = (unsigned long) in_buf;
 	k.len = ARRAY_SIZE(out_buf);
+	k.speed_hz = spi_device->speed_hz;
 	k.cs_change = 1;
-	a = ioctl(spi_device, SPI_IOC_MESSAGE(1), &k);
+	t0 = lgw_spi_stats_begin();
+	a = ioctl(spi_device->fd, SPI_IOC_MESSAGE(1), &k);
+	lgw_spi_stats_end(LGW_SPI_STAT_R, address, &in_buf[1], 1, t0, (a == 2) ? LGW_SPI_SUCCESS : LGW_SPI_ERROR);
 	
 	/* determine return code */
 	if (a != 2) {
@@ -243,11 +345,12 @@ int lgw_spi_r(void *spi_target, uint8_t address, uint8_t *data) {
 
 /* Burst (multiple-byte) write */
 int lgw_spi_wb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size) {
-	int spi_device;
+	struct spi_device_s *spi_device = spi_target;
 	uint8_t command;
 	struct spi_ioc_transfer k[2];
 	int size_to_do, chunk_size, offset;
 	int byte_transfered = 0;
+	uint64_t t0;
 	int i;
 	
 	/* check input parameters */
@@ -261,8 +364,6 @@ int lgw_spi_wb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 		return LGW_SPI_ERROR;
 	}
 	
-	spi_device = *(int *)spi_target; /* must check that spi_target is not null beforehand */
-	
 	/* prepare command byte */
 	command = WRITE_ACCESS | (address & 0x7F);
 	size_to_do = size;
@@ -271,17 +372,21 @@ int lgw_spi_wb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 	memset(&k, 0, sizeof(k)); /* clear k */
 	k[0].tx_buf = (unsigned long) &command;
 	k[0].len = 1;
+	k[0].speed_hz = spi_device->speed_hz;
 	k[0].cs_change = 0;
+	k[1].speed_hz = spi_device->speed_hz;
 	k[1].cs_change = 1;
+	t0 = lgw_spi_stats_begin();
 	for (i=0; size_to_do > 0; ++i) {
-		chunk_size = (size_to_do < LGW_BURST_CHUNK) ? size_to_do : LGW_BURST_CHUNK;
-		offset = i * LGW_BURST_CHUNK;
+		chunk_size = (size_to_do < spi_device->burst_chunk) ? size_to_do : spi_device->burst_chunk;
+		offset = i * spi_device->burst_chunk;
 		k[1].tx_buf = (unsigned long)(data + offset);
 		k[1].len = chunk_size;
-		byte_transfered += (ioctl(spi_device, SPI_IOC_MESSAGE(2), &k) - 1 );
+		byte_transfered += (ioctl(spi_device->fd, SPI_IOC_MESSAGE(2), &k) - 1 );
 		DEBUG_PRINTF("BURST WRITE: to trans %d # chunk %d # transferred %d \n", size_to_do, chunk_size, byte_transfered);
 		size_to_do -= chunk_size; /* subtract the quantity of data already transferred */
 	}
+	lgw_spi_stats_end(LGW_SPI_STAT_WB, address, data, size, t0, (byte_transfered == size) ? LGW_SPI_SUCCESS : LGW_SPI_ERROR);
 	
 	/* determine return code */
 	if (byte_transfered != size) {
@@ -297,11 +402,12 @@ int lgw_spi_wb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 
 /* Burst (multiple-byte) read */
 int lgw_spi_rb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size) {
-	int spi_device;
+	struct spi_device_s *spi_device = spi_target;
 	uint8_t command;
 	struct spi_ioc_transfer k[2];
 	int size_to_do, chunk_size, offset;
 	int byte_transfered = 0;
+	uint64_t t0;
 	int i;
 	
 	/* check input parameters */
@@ -315,8 +421,6 @@ int lgw_spi_rb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 		return LGW_SPI_ERROR;
 	}
 	
-	spi_device = *(int *)spi_target; /* must check that spi_target is not null beforehand */
-	
 	/* prepare command byte */
 	command = READ_ACCESS | (address & 0x7F);
 	size_to_do = size;
@@ -325,17 +429,21 @@ int lgw_spi_rb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 	memset(&k, 0, sizeof(k)); /* clear k */
 	k[0].tx_buf = (unsigned long) &command;
 	k[0].len = 1;
+	k[0].speed_hz = spi_device->speed_hz;
 	k[0].cs_change = 0;
+	k[1].speed_hz = spi_device->speed_hz;
 	k[1].cs_change = 1;
+	t0 = lgw_spi_stats_begin();
 	for (i=0; size_to_do > 0; ++i) {
-		chunk_size = (size_to_do < LGW_BURST_CHUNK) ? size_to_do : LGW_BURST_CHUNK;
-		offset = i * LGW_BURST_CHUNK;
+		chunk_size = (size_to_do < spi_device->burst_chunk) ? size_to_do : spi_device->burst_chunk;
+		offset = i * spi_device->burst_chunk;
 		k[1].rx_buf = (unsigned long)(data + offset);
 		k[1].len = chunk_size;
-		byte_transfered += (ioctl(spi_device, SPI_IOC_MESSAGE(2), &k) - 1 );
+		byte_transfered += (ioctl(spi_device->fd, SPI_IOC_MESSAGE(2), &k) - 1 );
 		DEBUG_PRINTF("BURST READ: to trans %d # chunk %d # transferred %d \n", size_to_do, chunk_size, byte_transfered);
 		size_to_do -= chunk_size;  /* subtract the quantity of data already transferred */
 	}
+	lgw_spi_stats_end(LGW_SPI_STAT_RB, address, data, size, t0, (byte_transfered == size) ? LGW_SPI_SUCCESS : LGW_SPI_ERROR);
 	
 	/* determine return code */
 	if (byte_transfered != size) {
@@ -347,4 +455,65 @@ int lgw_spi_rb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size)
 	}
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Batch of single-byte accesses, one spidev message per chunk */
+int lgw_spi_batch(void *spi_target, struct lgw_spi_op_s *ops, uint16_t nb) {
+	struct spi_device_s *spi_device = spi_target;
+	uint8_t out_buf[LGW_SPI_BATCH_CHUNK][2];
+	uint8_t in_buf[LGW_SPI_BATCH_CHUNK][2];
+	struct spi_ioc_transfer k[LGW_SPI_BATCH_CHUNK];
+	uint16_t done, chunk, i;
+	uint64_t t0, t1, lat;
+	int a, status;
+	
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	CHECK_NULL(ops);
+	
+	for (done = 0; done < nb; done += chunk) {
+		chunk = ((nb - done) < LGW_SPI_BATCH_CHUNK) ? (nb - done) : LGW_SPI_BATCH_CHUNK;
+		
+		/* prepare one frame per access, chip select released between frames */
+		memset(k, 0, chunk * sizeof k[0]);
+		for (i = 0; i < chunk; ++i) {
+			if (ops[done+i].read) {
+				out_buf[i][0] = READ_ACCESS | (ops[done+i].address & 0x7F);
+				out_buf[i][1] = 0x00;
+			} else {
+				out_buf[i][0] = WRITE_ACCESS | (ops[done+i].address & 0x7F);
+				out_buf[i][1] = ops[done+i].data;
+			}
+			k[i].tx_buf = (unsigned long) out_buf[i];
+			k[i].rx_buf = (unsigned long) in_buf[i];
+			k[i].len = 2;
+			k[i].speed_hz = spi_device->speed_hz;
+			k[i].cs_change = 1;
+		}
+		
+		/* I/O transaction */
+		t0 = lgw_spi_stats_begin();
+		a = ioctl(spi_device->fd, SPI_IOC_MESSAGE(chunk), k);
+		status = (a == (2 * chunk)) ? LGW_SPI_SUCCESS : LGW_SPI_ERROR;
+		/* one system call for the chunk: each access is accounted a share of its duration, back to back */
+		t1 = lgw_spi_stats_begin(); /* 0 if disabled meanwhile */
+		lat = ((t0 != 0) && (t1 > t0)) ? (t1 - t0) / chunk : 0;
+		for (i = 0; i < chunk; ++i) {
+			if (ops[done+i].read) {
+				ops[done+i].data = in_buf[i][1];
+				lgw_spi_stats_end_lat(LGW_SPI_STAT_R, ops[done+i].address, &in_buf[i][1], 1, t0 + (i * lat), lat, status);
+			} else {
+				lgw_spi_stats_end_lat(LGW_SPI_STAT_W, ops[done+i].address, &out_buf[i][1], 1, t0 + (i * lat), lat, status);
+			}
+		}
+		if (status != LGW_SPI_SUCCESS) {
+			DEBUG_MSG("ERROR: SPI BATCH FAILURE\n");
+			return LGW_SPI_ERROR;
+		}
+	}
+	
+	DEBUG_MSG("Note: SPI batch success\n");
+	return LGW_SPI_SUCCESS;
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,454 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	SPI backend replaying a trace recorded with lgw_spi_trace_start, no
+	hardware needed.
+	Reads are served from the trace: each transaction is matched against the
+	next records of the trace (same kind, page, address and length), so a HAL
+	that drops or adds a few transactions stays in step. Unmatched reads are
+	served from a shadow of the last values written.
+	Bus timing is emulated from the recorded durations, so the latency impact
+	of a HAL change can be measured with lgw_spi_get_stats.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+	#define _XOPEN_SOURCE 600
+#else
+	#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+#include <stdio.h>		/* printf fprintf fopen fread */
+#include <stdlib.h>		/* malloc free getenv strtoul */
+#include <string.h>		/* memcmp memcpy memset */
+#include <time.h>		/* clock_gettime */
+
+#include "loragw_spi.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#if DEBUG_SPI == 1
+	#define DEBUG_MSG(str)				fprintf(stderr, str)
+	#define DEBUG_PRINTF(fmt, args...)	fprintf(stderr,"%s:%d: "fmt, __FUNCTION__, __LINE__, args)
+	#define CHECK_NULL(a)				if(a==NULL){fprintf(stderr,"%s:%d: ERROR: NULL POINTER AS ARGUMENT\n", __FUNCTION__, __LINE__);return LGW_SPI_ERROR;}
+#else
+	#define DEBUG_MSG(str)
+	#define DEBUG_PRINTF(fmt, args...)
+	#define CHECK_NULL(a)				if(a==NULL){return LGW_SPI_ERROR;}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define SPI_SPEED			8000000
+#define TRACE_PATH			"spi_trace.bin"	/* default trace file, overridden by the SPI path option */
+#define REPLAY_ENV_TIMING	"LGW_SPI_REPLAY_TIMING"	/* set to 0 to replay as fast as possible */
+#define REPLAY_WINDOW		4096	/* max number of records skipped to match a transaction */
+#define REPLAY_OVH_NS		20000	/* per-transaction overhead when the trace has no single-byte access */
+#define PAGE_ADDR			0x00
+#define PAGE_MASK			0x03
+#define PAGE_NB				(PAGE_MASK + 1)
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct replay_rec_s {
+	uint8_t			type;		/* lgw_spi_stat_type_e */
+	uint8_t			address;
+	uint8_t			page;		/* register page selected when the record was captured */
+	uint16_t		size;
+	uint32_t		dur_ns;		/* recorded transaction duration */
+	const uint8_t	*data;		/* points inside the trace buffer */
+};
+
+struct spi_device_s {
+	uint8_t				*buf;		/* trace file content */
+	struct replay_rec_s	*rec;		/* records of the trace */
+	long				nb_rec;
+	long				cursor;		/* next record to be matched */
+	uint8_t				page;		/* register page currently selected by the HAL */
+	uint8_t				shadow[PAGE_NB][128]; /* last values written, served for unmatched reads */
+	uint32_t			speed_hz;
+	bool				timing;		/* emulate the recorded bus timing */
+	uint32_t			ovh_ns;		/* overhead of an unmatched transaction */
+	unsigned long		matched;	/* transactions matched against the trace */
+	unsigned long		missed;		/* transactions not found in the trace */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static uint16_t get_le16(const uint8_t *b) {
+	return (uint16_t)(b[0] | (b[1] << 8));
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint32_t get_le32(const uint8_t *b) {
+	return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* load a trace file and index its records, return the number of records or -1 */
+static long load_trace(struct spi_device_s *dev, const char *path) {
+	FILE *f;
+	long size, pos, n;
+	uint64_t single_ns = 0;
+	long single_nb = 0;
+	uint8_t page = 0;
+	uint16_t len;
+	int pass;
+	
+	f = fopen(path, "rb");
+	if (f == NULL) {
+		DEBUG_PRINTF("ERROR: FAIL TO OPEN SPI TRACE %s\n", path);
+		return -1;
+	}
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (size < LGW_SPI_TRACE_HDR_SIZE) {
+		DEBUG_MSG("ERROR: SPI TRACE TOO SHORT\n");
+		fclose(f);
+		return -1;
+	}
+	dev->buf = malloc(size);
+	if ((dev->buf == NULL) || (fread(dev->buf, 1, size, f) != (size_t)size)) {
+		DEBUG_MSG("ERROR: FAIL TO READ SPI TRACE\n");
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	if ((memcmp(dev->buf, LGW_SPI_TRACE_MAGIC, 8) != 0) || (get_le32(dev->buf + 8) != LGW_SPI_TRACE_VERSION)) {
+		DEBUG_MSG("ERROR: NOT A SPI TRACE OR UNSUPPORTED VERSION\n");
+		return -1;
+	}
+	
+	/* first pass counts the records, second pass indexes them */
+	for (pass = 0; pass < 2; ++pass) {
+		n = 0;
+		page = 0;
+		for (pos = LGW_SPI_TRACE_HDR_SIZE; (pos + LGW_SPI_TRACE_REC_SIZE) <= size; pos += LGW_SPI_TRACE_REC_SIZE + len) {
+			len = get_le16(dev->buf + pos + 2);
+			if ((pos + LGW_SPI_TRACE_REC_SIZE + len) > size) {
+				DEBUG_MSG("WARNING: SPI TRACE TRUNCATED, LAST RECORD IGNORED\n");
+				break;
+			}
+			if (pass == 1) {
+				dev->rec[n].type = dev->buf[pos] & ~LGW_SPI_TRACE_ERR_FLAG;
+				dev->rec[n].address = dev->buf[pos + 1] & 0x7F;
+				dev->rec[n].page = page;
+				dev->rec[n].size = len;
+				dev->rec[n].dur_ns = get_le32(dev->buf + pos + 8);
+				dev->rec[n].data = dev->buf + pos + LGW_SPI_TRACE_REC_SIZE;
+				if ((dev->rec[n].type == LGW_SPI_STAT_W) && (dev->rec[n].address == PAGE_ADDR) && (len > 0)) {
+					page = dev->rec[n].data[0] & PAGE_MASK;
+				}
+				if ((dev->rec[n].type == LGW_SPI_STAT_W) || (dev->rec[n].type == LGW_SPI_STAT_R)) {
+					single_ns += dev->rec[n].dur_ns;
+					++single_nb;
+				}
+			}
+			++n;
+		}
+		if (pass == 0) {
+			dev->rec = malloc((n > 0 ? n : 1) * sizeof(struct replay_rec_s));
+			if (dev->rec == NULL) {
+				DEBUG_MSG("ERROR: MALLOC FAIL\n");
+				return -1;
+			}
+		}
+	}
+	dev->ovh_ns = (single_nb > 0) ? (uint32_t)(single_ns / single_nb) : REPLAY_OVH_NS;
+	return n;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void free_device(struct spi_device_s *dev) {
+	free(dev->rec);
+	free(dev->buf);
+	free(dev);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* find the next record matching a transaction, return its index or -1 */
+static long match(struct spi_device_s *dev, enum lgw_spi_stat_type_e type, uint8_t address, uint16_t size) {
+	struct replay_rec_s *r;
+	long end;
+	long i;
+	
+	end = dev->cursor + REPLAY_WINDOW;
+	end = (end < dev->nb_rec) ? end : dev->nb_rec;
+	for (i = dev->cursor; i < end; ++i) {
+		r = &dev->rec[i];
+		if ((r->type == type) && (r->address == address) && (r->size == size) && (r->page == dev->page)) {
+			dev->cursor = i + 1;
+			++dev->matched;
+			return i;
+		}
+	}
+	++dev->missed;
+	DEBUG_PRINTF("Note: no SPI trace record for type %d, page %u, address 0x%02X, size %u\n", type, dev->page, address, size);
+	return -1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* busy-wait for the bus time of a transaction, recorded or estimated */
+static void emulate(struct spi_device_s *dev, long idx, uint16_t size) {
+	struct timespec t;
+	uint64_t start, now, dur;
+	
+	if (!dev->timing) {
+		return;
+	}
+	if (idx >= 0) {
+		dur = dev->rec[idx].dur_ns;
+	} else {
+		dur = dev->ovh_ns + ((uint64_t)(size - 1) * 8000000000ULL) / dev->speed_hz;
+	}
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+	start = ((uint64_t)t.tv_sec * 1000000000ULL) + (uint64_t)t.tv_nsec;
+	do {
+		clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+		now = ((uint64_t)t.tv_sec * 1000000000ULL) + (uint64_t)t.tv_nsec;
+	} while ((now - start) < dur);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* serve or absorb a transaction */
+static void replay(struct spi_device_s *dev, enum lgw_spi_stat_type_e type, uint8_t address, uint8_t *data, uint16_t size) {
+	long idx;
+	int i;
+	
+	address &= 0x7F;
+	idx = match(dev, type, address, size);
+	if ((type == LGW_SPI_STAT_W) || (type == LGW_SPI_STAT_WB)) {
+		for (i = 0; i < size; ++i) {
+			dev->shadow[dev->page][(address + i) & 0x7F] = data[i];
+		}
+		if ((type == LGW_SPI_STAT_W) && (address == PAGE_ADDR)) {
+			dev->page = data[0] & PAGE_MASK;
+		}
+	} else if (idx >= 0) {
+		memcpy(data, dev->rec[idx].data, size);
+	} else {
+		for (i = 0; i < size; ++i) {
+			data[i] = dev->shadow[dev->page][(address + i) & 0x7F];
+		}
+	}
+	emulate(dev, idx, size);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+/* SPI initialization and configuration, with default options */
+int lgw_spi_open(void **spi_target_ptr) {
+	return lgw_spi_open_opt(spi_target_ptr, NULL);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* open the trace file given as SPI device path */
+int lgw_spi_open_opt(void **spi_target_ptr, const struct lgw_spi_opt_s *opt) {
+	struct spi_device_s *dev;
+	const char *path = NULL;
+	const char *env;
+	uint32_t speed = 0;
+	
+	/* check input variables */
+	CHECK_NULL(spi_target_ptr); /* cannot be null, must point on a void pointer (*spi_target_ptr can be null) */
+	
+	/* resolve options: explicit option, then environment, then default */
+	if (opt != NULL) {
+		path = opt->path;
+		speed = opt->speed_hz;
+	}
+	if ((path == NULL) || (path[0] == '\0')) {
+		env = getenv(LGW_SPI_ENV_PATH);
+		path = ((env != NULL) && (env[0] != '\0')) ? env : TRACE_PATH;
+	}
+	if (speed == 0) {
+		env = getenv(LGW_SPI_ENV_SPEED);
+		speed = (env != NULL) ? (uint32_t)strtoul(env, NULL, 0) : 0;
+		speed = (speed != 0) ? speed : SPI_SPEED;
+	}
+	
+	/* allocate memory for the device descriptor */
+	dev = malloc(sizeof(struct spi_device_s));
+	if (dev == NULL) {
+		DEBUG_MSG("ERROR: MALLOC FAIL\n");
+		return LGW_SPI_ERROR;
+	}
+	memset(dev, 0, sizeof(struct spi_device_s));
+	
+	dev->nb_rec = load_trace(dev, path);
+	if (dev->nb_rec < 0) {
+		free_device(dev);
+		return LGW_SPI_ERROR;
+	}
+	env = getenv(REPLAY_ENV_TIMING);
+	dev->timing = (env == NULL) || (strtoul(env, NULL, 0) != 0);
+	dev->speed_hz = speed;
+	
+	*spi_target_ptr = (void *)dev;
+	DEBUG_PRINTF("Note: SPI trace %s loaded, %ld records, timing emulation %s\n", path, dev->nb_rec, dev->timing ? "on" : "off");
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* SPI release */
+int lgw_spi_close(void *spi_target) {
+	struct spi_device_s *dev = spi_target;
+	
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	
+	DEBUG_PRINTF("Note: SPI replay, %lu transactions matched, %lu not in trace, %ld/%ld records consumed\n", dev->matched, dev->missed, dev->cursor, dev->nb_rec);
+	free_device(dev);
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* SPI clock change, only affects the timing of unmatched transactions */
+int lgw_spi_set_speed(void *spi_target, uint32_t speed_hz) {
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	if (speed_hz == 0) {
+		DEBUG_MSG("ERROR: INVALID SPI SPEED\n");
+		return LGW_SPI_ERROR;
+	}
+	
+	((struct spi_device_s *)spi_target)->speed_hz = speed_hz;
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* SPI clock query */
+int lgw_spi_get_speed(void *spi_target, uint32_t *speed_hz) {
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	CHECK_NULL(speed_hz);
+	
+	*speed_hz = ((struct spi_device_s *)spi_target)->speed_hz;
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Simple write */
+int lgw_spi_w(void *spi_target, uint8_t address, uint8_t data) {
+	uint64_t t0;
+	
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	
+	t0 = lgw_spi_stats_begin();
+	replay(spi_target, LGW_SPI_STAT_W, address, &data, 1);
+	lgw_spi_stats_end(LGW_SPI_STAT_W, address, &data, 1, t0, LGW_SPI_SUCCESS);
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Simple read */
+int lgw_spi_r(void *spi_target, uint8_t address, uint8_t *data) {
+	uint64_t t0;
+	
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	CHECK_NULL(data);
+	
+	t0 = lgw_spi_stats_begin();
+	replay(spi_target, LGW_SPI_STAT_R, address, data, 1);
+	lgw_spi_stats_end(LGW_SPI_STAT_R, address, data, 1, t0, LGW_SPI_SUCCESS);
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Burst (multiple-byte) write */
+int lgw_spi_wb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size) {
+	uint64_t t0;
+	
+	/* check input parameters */
+	CHECK_NULL(spi_target);
+	CHECK_NULL(data);
+	if (size == 0) {
+		DEBUG_MSG("ERROR: BURST OF NULL LENGTH\n");
+		return LGW_SPI_ERROR;
+	}
+	
+	t0 = lgw_spi_stats_begin();
+	replay(spi_target, LGW_SPI_STAT_WB, address, data, size);
+	lgw_spi_stats_end(LGW_SPI_STAT_WB, address, data, size, t0, LGW_SPI_SUCCESS);
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Burst (multiple-byte) read */
+int lgw_spi_rb(void *spi_target, uint8_t address, uint8_t *data, uint16_t size) {
+	uint64_t t0;
+	
+	/* check input parameters */
+	CHECK_NULL(spi_target);
+	CHECK_NULL(data);
+	if (size == 0) {
+		DEBUG_MSG("ERROR: BURST OF NULL LENGTH\n");
+		return LGW_SPI_ERROR;
+	}
+	
+	t0 = lgw_spi_stats_begin();
+	replay(spi_target, LGW_SPI_STAT_RB, address, data, size);
+	lgw_spi_stats_end(LGW_SPI_STAT_RB, address, data, size, t0, LGW_SPI_SUCCESS);
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Batch of single-byte accesses, matched one by one against the trace */
+int lgw_spi_batch(void *spi_target, struct lgw_spi_op_s *ops, uint16_t nb) {
+	int spi_stat = LGW_SPI_SUCCESS;
+	uint16_t i;
+	
+	/* check input variables */
+	CHECK_NULL(spi_target);
+	CHECK_NULL(ops);
+	
+	for (i = 0; i < nb; ++i) {
+		if (ops[i].read) {
+			spi_stat += lgw_spi_r(spi_target, ops[i].address, &ops[i].data);
+		} else {
+			spi_stat += lgw_spi_w(spi_target, ops[i].address, ops[i].data);
+		}
+	}
+	
+	return (spi_stat != LGW_SPI_SUCCESS) ? LGW_SPI_ERROR : LGW_SPI_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,356 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	Runtime statistics and trace recording of the SPI transactions, shared by
+	all SPI backends.
+	Counts transactions and bytes per kind and keeps log2 latency histograms.
+	Records every transaction to a binary trace file that the replay backend
+	can serve back.
+	Both are disabled by default and cost two atomic loads per transaction when
+	disabled.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+	#define _XOPEN_SOURCE 600
+#else
+	#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+#include <stdio.h>		/* printf fprintf fopen fwrite */
+#include <stdlib.h>		/* getenv */
+#include <string.h>		/* memcpy */
+#include <time.h>		/* clock_gettime */
+#include <pthread.h>	/* pthread_mutex_t pthread_once */
+
+#include "loragw_spi.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#if DEBUG_SPI == 1
+	#define DEBUG_MSG(str)				fprintf(stderr, str)
+	#define DEBUG_PRINTF(fmt, args...)	fprintf(stderr,"%s:%d: "fmt, __FUNCTION__, __LINE__, args)
+	#define CHECK_NULL(a)				if(a==NULL){fprintf(stderr,"%s:%d: ERROR: NULL POINTER AS ARGUMENT\n", __FUNCTION__, __LINE__);return LGW_SPI_ERROR;}
+#else
+	#define DEBUG_MSG(str)
+	#define DEBUG_PRINTF(fmt, args...)
+	#define CHECK_NULL(a)				if(a==NULL){return LGW_SPI_ERROR;}
+#endif
+
+#define ATOMIC_LOAD(p)		__atomic_load_n((p), __ATOMIC_RELAXED)
+#define ATOMIC_STORE(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define ATOMIC_ADD(p, v)	__atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static int stats_enabled = 0;
+static struct lgw_spi_stat_s stats[LGW_SPI_STAT_NB]; /* updated lock-free from any thread */
+
+static int trace_enabled = 0;
+static FILE *trace_file = NULL; /* protected by mx_trace */
+static uint64_t trace_last_ns = 0; /* start of the previous record, 0 before the first one */
+static pthread_mutex_t mx_trace = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t trace_env_once = PTHREAD_ONCE_INIT;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static uint64_t now_ns(void) {
+	struct timespec t;
+	
+	/* raw monotonic clock: not slewed by NTP, so latencies are not distorted */
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+	return ((uint64_t)t.tv_sec * 1000000000ULL) + (uint64_t)t.tv_nsec;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* index of the log2 bucket of a latency */
+static int hist_bucket(uint64_t lat_ns) {
+	int i;
+	
+	if (lat_ns == 0) {
+		return 0;
+	}
+	i = 63 - __builtin_clzll(lat_ns);
+	return (i < LGW_SPI_STAT_HIST_SIZE) ? i : (LGW_SPI_STAT_HIST_SIZE - 1);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void put_le16(uint8_t *b, uint16_t v) {
+	b[0] = (uint8_t)v;
+	b[1] = (uint8_t)(v >> 8);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void put_le32(uint8_t *b, uint32_t v) {
+	b[0] = (uint8_t)v;
+	b[1] = (uint8_t)(v >> 8);
+	b[2] = (uint8_t)(v >> 16);
+	b[3] = (uint8_t)(v >> 24);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* start recording if requested by the environment, run once before the first transaction */
+static void trace_env_start(void) {
+	const char *path;
+	
+	path = getenv(LGW_SPI_ENV_TRACE);
+	if ((path != NULL) && (path[0] != '\0')) {
+		lgw_spi_trace_start(path);
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* append one transaction to the trace file */
+static void trace_record(enum lgw_spi_stat_type_e type, uint8_t address, const uint8_t *data, uint16_t size, uint64_t t0, uint64_t lat, int status) {
+	static const uint8_t zero[64];
+	uint8_t rec[LGW_SPI_TRACE_REC_SIZE];
+	uint64_t delta_us;
+	uint16_t i, n;
+	
+	pthread_mutex_lock(&mx_trace);
+	if (trace_file == NULL) {
+		pthread_mutex_unlock(&mx_trace);
+		return;
+	}
+	delta_us = ((trace_last_ns == 0) || (t0 < trace_last_ns)) ? 0 : (t0 - trace_last_ns) / 1000;
+	trace_last_ns = t0;
+	
+	rec[0] = (uint8_t)type | ((status != LGW_SPI_SUCCESS) ? LGW_SPI_TRACE_ERR_FLAG : 0);
+	rec[1] = address & 0x7F;
+	put_le16(&rec[2], size);
+	put_le32(&rec[4], (delta_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)delta_us);
+	put_le32(&rec[8], (lat > UINT32_MAX) ? UINT32_MAX : (uint32_t)lat);
+	fwrite(rec, sizeof rec, 1, trace_file);
+	if (data != NULL) {
+		fwrite(data, 1, size, trace_file);
+	} else {
+		/* failed read without data, keep the record size consistent */
+		for (i = 0; i < size; i += n) {
+			n = ((size - i) < (uint16_t)sizeof zero) ? (size - i) : (uint16_t)sizeof zero;
+			fwrite(zero, 1, n, trace_file);
+		}
+	}
+	pthread_mutex_unlock(&mx_trace);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void lgw_spi_stats_enable(bool enable) {
+	ATOMIC_STORE(&stats_enabled, enable ? 1 : 0);
+	DEBUG_PRINTF("Note: SPI statistics %s\n", enable ? "enabled" : "disabled");
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_spi_get_stats(struct lgw_spi_stats_s *s) {
+	int i, j;
+	
+	/* check input variables */
+	CHECK_NULL(s);
+	
+	/* each counter is read atomically, the snapshot as a whole is not */
+	s->enabled = (ATOMIC_LOAD(&stats_enabled) != 0);
+	for (i = 0; i < LGW_SPI_STAT_NB; ++i) {
+		s->type[i].count = ATOMIC_LOAD(&stats[i].count);
+		s->type[i].errors = ATOMIC_LOAD(&stats[i].errors);
+		s->type[i].bytes = ATOMIC_LOAD(&stats[i].bytes);
+		s->type[i].lat_sum_ns = ATOMIC_LOAD(&stats[i].lat_sum_ns);
+		s->type[i].lat_max_ns = ATOMIC_LOAD(&stats[i].lat_max_ns);
+		for (j = 0; j < LGW_SPI_STAT_HIST_SIZE; ++j) {
+			s->type[i].hist[j] = ATOMIC_LOAD(&stats[i].hist[j]);
+		}
+	}
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_spi_reset_stats(void) {
+	int i, j;
+	
+	for (i = 0; i < LGW_SPI_STAT_NB; ++i) {
+		ATOMIC_STORE(&stats[i].count, 0);
+		ATOMIC_STORE(&stats[i].errors, 0);
+		ATOMIC_STORE(&stats[i].bytes, 0);
+		ATOMIC_STORE(&stats[i].lat_sum_ns, 0);
+		ATOMIC_STORE(&stats[i].lat_max_ns, 0);
+		for (j = 0; j < LGW_SPI_STAT_HIST_SIZE; ++j) {
+			ATOMIC_STORE(&stats[i].hist[j], 0);
+		}
+	}
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint64_t lgw_spi_stats_percentile(const struct lgw_spi_stat_s *stat, double pct) {
+	uint64_t total = 0;
+	uint64_t rank;
+	uint64_t acc = 0;
+	int i;
+	
+	if (stat == NULL) {
+		return 0;
+	}
+	for (i = 0; i < LGW_SPI_STAT_HIST_SIZE; ++i) {
+		total += stat->hist[i];
+	}
+	if (total == 0) {
+		return 0;
+	}
+	
+	/* rank of the requested sample, 1-based */
+	if (pct < 0.0) {
+		pct = 0.0;
+	} else if (pct > 100.0) {
+		pct = 100.0;
+	}
+	rank = (uint64_t)((pct / 100.0) * (double)total + 0.5);
+	rank = (rank < 1) ? 1 : rank;
+	
+	for (i = 0; i < LGW_SPI_STAT_HIST_SIZE; ++i) {
+		acc += stat->hist[i];
+		if (acc >= rank) {
+			break;
+		}
+	}
+	
+	/* bucket upper bound, never above the worst latency observed (the last bucket is open-ended) */
+	if ((i >= (LGW_SPI_STAT_HIST_SIZE - 1)) || (((2ULL << i) - 1) > stat->lat_max_ns)) {
+		return stat->lat_max_ns;
+	}
+	return (2ULL << i) - 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_spi_trace_start(const char *path) {
+	uint8_t hdr[LGW_SPI_TRACE_HDR_SIZE];
+	FILE *f;
+	
+	/* check input variables */
+	CHECK_NULL(path);
+	
+	f = fopen(path, "wb");
+	if (f == NULL) {
+		DEBUG_PRINTF("ERROR: FAIL TO OPEN SPI TRACE FILE %s\n", path);
+		return LGW_SPI_ERROR;
+	}
+	memcpy(hdr, LGW_SPI_TRACE_MAGIC, 8);
+	put_le32(&hdr[8], LGW_SPI_TRACE_VERSION);
+	if (fwrite(hdr, sizeof hdr, 1, f) != 1) {
+		DEBUG_MSG("ERROR: FAIL TO WRITE SPI TRACE HEADER\n");
+		fclose(f);
+		return LGW_SPI_ERROR;
+	}
+	
+	/* replace the current trace, if any */
+	pthread_mutex_lock(&mx_trace);
+	if (trace_file != NULL) {
+		fclose(trace_file);
+	}
+	trace_file = f;
+	trace_last_ns = 0;
+	ATOMIC_STORE(&trace_enabled, 1);
+	pthread_mutex_unlock(&mx_trace);
+	DEBUG_PRINTF("Note: recording SPI trace to %s\n", path);
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_spi_trace_stop(void) {
+	int x = 0;
+	
+	pthread_mutex_lock(&mx_trace);
+	ATOMIC_STORE(&trace_enabled, 0);
+	if (trace_file != NULL) {
+		x = fclose(trace_file);
+		trace_file = NULL;
+	}
+	pthread_mutex_unlock(&mx_trace);
+	
+	if (x != 0) {
+		DEBUG_MSG("ERROR: FAIL TO CLOSE SPI TRACE FILE\n");
+		return LGW_SPI_ERROR;
+	}
+	return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint64_t lgw_spi_stats_begin(void) {
+	pthread_once(&trace_env_once, trace_env_start);
+	if ((ATOMIC_LOAD(&stats_enabled) == 0) && (ATOMIC_LOAD(&trace_enabled) == 0)) {
+		return 0;
+	}
+	return now_ns();
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_spi_stats_end(enum lgw_spi_stat_type_e type, uint8_t address, const uint8_t *data, uint16_t size, uint64_t t0, int status) {
+	/* t0 is 0 when statistics and trace were disabled at the start of the transaction */
+	if (t0 == 0) {
+		return;
+	}
+	lgw_spi_stats_end_lat(type, address, data, size, t0, now_ns() - t0, status);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_spi_stats_end_lat(enum lgw_spi_stat_type_e type, uint8_t address, const uint8_t *data, uint16_t size, uint64_t t0, uint64_t lat, int status) {
+	struct lgw_spi_stat_s *s;
+	uint64_t max;
+	
+	if ((t0 == 0) || ((unsigned)type >= LGW_SPI_STAT_NB)) {
+		return;
+	}
+	
+	if (ATOMIC_LOAD(&trace_enabled) != 0) {
+		trace_record(type, address, data, size, t0, lat, status);
+	}
+	if (ATOMIC_LOAD(&stats_enabled) == 0) {
+		return;
+	}
+	s = &stats[type];
+	
+	ATOMIC_ADD(&s->count, 1);
+	if (status != LGW_SPI_SUCCESS) {
+		ATOMIC_ADD(&s->errors, 1);
+	}
+	ATOMIC_ADD(&s->bytes, size);
+	ATOMIC_ADD(&s->lat_sum_ns, lat);
+	ATOMIC_ADD(&s->hist[hist_bucket(lat)], 1);
+	
+	/* lock-free maximum */
+	max = ATOMIC_LOAD(&s->lat_max_ns);
+	while ((lat > max) && !__atomic_compare_exchange_n(&s->lat_max_ns, &max, lat, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		/* max was refreshed by the failed exchange, retry */
+	}
+}
+
+/* --- EOF ------------------------------------------------------------------ */
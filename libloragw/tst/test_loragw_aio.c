@@ -0,0 +1,130 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	Minimum test program for the loragw_aio module
+	Submits register accesses to the I/O thread and checks the completions.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "loragw_reg.h"
+#include "loragw_aio.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define NB_ROUNDS		1000	/* number of write/read pairs submitted */
+#define BURST_SIZE		256
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main()
+{
+	struct lgw_aio_s *aio;
+	struct lgw_aio_conf_s conf;
+	struct lgw_aio_req_s req;
+	struct lgw_aio_req_s cpl[16];
+	uint8_t burst_out[BURST_SIZE];
+	uint8_t burst_in[BURST_SIZE];
+	int submitted = 0, completed = 0, errors = 0;
+	int32_t expected = 0;
+	int i, n;
+
+	printf("Beginning of test for loragw_aio.c\n");
+
+	if (lgw_connect() != LGW_REG_SUCCESS) {
+		printf("ERROR: failed to connect to the concentrator\n");
+		return -1;
+	}
+
+	memset(&conf, 0, sizeof conf);
+	conf.cpu = -1;
+	conf.eventfd = true;
+	aio = lgw_aio_create(NULL, &conf);
+	if (aio == NULL) {
+		printf("ERROR: failed to create the I/O engine\n");
+		lgw_disconnect();
+		return -1;
+	}
+
+	/* --- REGISTER WRITE/READ PAIRS, COMPLETED IN ORDER --- */
+
+	while (completed < 2 * NB_ROUNDS) {
+		if (submitted < 2 * NB_ROUNDS) {
+			memset(&req, 0, sizeof req);
+			req.register_id = LGW_IMPLICIT_PAYLOAD_LENGHT;
+			req.value = (submitted / 2) & 0xFF;
+			req.op = ((submitted % 2) == 0) ? LGW_AIO_REG_W : LGW_AIO_REG_R;
+			if (lgw_aio_submit(aio, &req) == LGW_AIO_SUCCESS) {
+				++submitted;
+				continue;
+			}
+		}
+		lgw_aio_wait(aio, 100);
+		n = lgw_aio_reap(aio, cpl, 16);
+		for (i = 0; i < n; ++i) {
+			if (cpl[i].status != LGW_REG_SUCCESS) {
+				++errors;
+			} else if ((cpl[i].op == LGW_AIO_REG_R) && (cpl[i].value != expected)) {
+				printf("read %d, expected %d\n", cpl[i].value, expected);
+				++errors;
+			}
+			if (cpl[i].op == LGW_AIO_REG_R) {
+				expected = (expected + 1) & 0xFF;
+			}
+			++completed;
+		}
+	}
+	printf("%d register operations completed, %d errors\n", completed, errors);
+
+	/* --- BURST WRITE/READ --- */
+
+	for (i = 0; i < BURST_SIZE; ++i) {
+		burst_out[i] = (uint8_t)i;
+		burst_in[i] = 0;
+	}
+	memset(&req, 0, sizeof req);
+	req.op = LGW_AIO_REG_W;
+	req.register_id = LGW_RX_DATA_BUF_ADDR;
+	lgw_aio_submit(aio, &req);
+	req.op = LGW_AIO_REG_WB;
+	req.register_id = LGW_RX_DATA_BUF_DATA;
+	req.data = burst_out;
+	req.size = BURST_SIZE;
+	lgw_aio_submit(aio, &req);
+	req.op = LGW_AIO_REG_W;
+	req.register_id = LGW_RX_DATA_BUF_ADDR;
+	lgw_aio_submit(aio, &req);
+	req.op = LGW_AIO_REG_RB;
+	req.register_id = LGW_RX_DATA_BUF_DATA;
+	req.data = burst_in;
+	lgw_aio_submit(aio, &req);
+	for (n = 0; n < 4; n += lgw_aio_reap(aio, cpl, 16)) {
+		lgw_aio_wait(aio, 100);
+	}
+	printf("burst read back %s\n", (memcmp(burst_out, burst_in, BURST_SIZE) == 0) ? "OK" : "FAILED");
+
+	lgw_aio_destroy(aio);
+	lgw_disconnect();
+	printf("End of test for loragw_aio.c\n");
+
+	return 0;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
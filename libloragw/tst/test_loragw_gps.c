@@ -8,6 +8,7 @@
 
 Description:
 	Minimum test program for the loragw_gps 'library'
+	Usage: test_loragw_gps [gps_familly] (eg. ubx7 to switch the receiver to UBX)
 
 License: Revised BSD License, see LICENSE.TXT file include in the project
 Maintainer: Sylvain Miermont
@@ -31,11 +32,17 @@ Maintainer: Sylvain Miermont
 #include <signal.h>		/* sigaction */
 #include <stdlib.h>		/* exit */
 #include <unistd.h>		/* read */
+#include <math.h>		/* NAN */
 
 #include "loragw_hal.h"
 #include "loragw_gps.h"
 #include "loragw_aux.h"
 
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define CALIB_PATH		"gps_calib.bin"	/* clock calibration kept between runs */
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
@@ -61,7 +68,7 @@ static void sig_handler(int sigio) {
 /* -------------------------------------------------------------------------- */
 /* --- MAIN FUNCTION -------------------------------------------------------- */
 
-int main()
+int main(int argc, char **argv)
 {
 	struct sigaction sigact; /* SIGQUIT&SIGINT&SIGTERM signal handling */
 	
@@ -71,6 +78,7 @@ int main()
 	/* serial variables */
 	char serial_buff[128]; /* buffer to receive GPS data */
 	ssize_t nb_char;
+	int nb_parsed; /* characters of serial_buff already parsed */
 	int gps_tty_dev; /* file descriptor to the serial port of the GNSS module */
 	
 	/* NMEA variables */
@@ -80,6 +88,8 @@ int main()
 	uint32_t ppm_tstamp;
 	struct timespec ppm_utc;
 	struct tref ppm_ref;
+	struct tref snap_ref; /* published copy, as used by other threads */
+	struct tref_est_s ppm_est; /* clock drift estimator */
 	
 	/* variables for timestamp <-> UTC conversions */
 	uint32_t x, z;
@@ -98,7 +108,7 @@ int main()
 	printf("*** Library version information ***\n%s\n***\n", lgw_version_info());
 	
 	/* Open and configure GPS */
-	i = lgw_gps_enable("/dev/ttyACM0", NULL, 0, &gps_tty_dev);
+	i = lgw_gps_enable("/dev/ttyACM0", (argc > 1) ? argv[1] : NULL, 0, &gps_tty_dev);
 	if (i != LGW_GPS_SUCCESS) {
 		printf("ERROR: IMPOSSIBLE TO ENABLE GPS\n");
 		exit(EXIT_FAILURE);
@@ -110,24 +120,26 @@ int main()
 	/* initialize some variables before loop */
 	memset(serial_buff, 0, sizeof serial_buff);
 	memset(&ppm_ref, 0, sizeof ppm_ref);
+	memset(&ppm_est, 0, sizeof ppm_est);
+	if (lgw_gps_calib_load(CALIB_PATH, NAN, &ppm_ref, &ppm_est) == LGW_GPS_SUCCESS) {
+		printf("Clock error %.9f loaded from %s (+/- %.3f ppm)\n", ppm_ref.xtal_err, CALIB_PATH, 1E6 * ppm_est.prior_sd);
+	}
 	
 	/* loop until user action */
 	while ((quit_sig != 1) && (exit_sig != 1)) {
-		/* blocking canonical read on serial port */
-		nb_char = read(gps_tty_dev, serial_buff, sizeof(serial_buff)-1);
+		/* blocking read on serial port, parse the received NMEA sentence by sentence */
+		nb_char = read(gps_tty_dev, serial_buff, sizeof(serial_buff));
 		if (nb_char <= 0) {
 			printf("Warning: read() returned value <= 0\n");
 			continue;
-		} else {
-			serial_buff[nb_char] = 0;
 		}
-		
-		/* parse the received NMEA */
-		latest_msg = lgw_parse_nmea(serial_buff, sizeof(serial_buff));
-		
-		if (latest_msg == NMEA_RMC) {
+		for (nb_parsed = 0; nb_parsed < nb_char; ) {
+			nb_parsed += lgw_gps_feed(serial_buff + nb_parsed, nb_char - nb_parsed, &latest_msg);
+			if ((latest_msg != NMEA_RMC) && (latest_msg != UBX_TIME)) {
+				continue;
+			}
 			
-			printf("\n~~ RMC NMEA sentence, triggering synchronization attempt ~~\n");
+			printf("\n~~ %s, triggering synchronization attempt ~~\n", (latest_msg == NMEA_RMC) ? "RMC NMEA sentence" : "NAV-TIMEUTC UBX frame");
 			
 			/* get UTC time for synchronization */
 			i = lgw_gps_get(&ppm_utc, NULL, NULL);
@@ -142,7 +154,7 @@ int main()
 				continue;
 			}
 			/* try to update synchronize time reference with the new UTC & timestamp */
-			i = lgw_gps_sync(&ppm_ref, ppm_tstamp, ppm_utc);
+			i = lgw_gps_sync_est(&ppm_est, &ppm_ref, ppm_tstamp, ppm_utc);
 			if (i != LGW_GPS_SUCCESS) {
 				printf("    Synchronization error.\n");
 				continue;
@@ -152,20 +164,29 @@ int main()
 			strftime(tmp_str, sizeof(tmp_str), "%F %T", gmtime(&(ppm_ref.utc.tv_sec)));
 			printf("    UTC reference time: %s.%09ldZ\n", tmp_str, ppm_ref.utc.tv_nsec);
 			printf("    Internal counter reference value: %u\n", ppm_ref.count_us);
-			printf("    Clock error: %.9f\n", ppm_ref.xtal_err);
+			printf("    Clock error: %.9f (+/- %.3f ppm, %d points, jitter %.2f us)\n", ppm_ref.xtal_err, 1E6 * ppm_est.xtal_err_sd, ppm_est.nb, ppm_est.jitter_us);
+			
+			lgw_gps_publish(&ppm_ref);
 			
 			x = ppm_tstamp + 500000;
 			printf("    * Test of timestamp counter <-> UTC value conversion *\n");
 			printf("    Test value: %u\n", x);
-			lgw_cnt2utc(ppm_ref, x, &y);
+			if (lgw_gps_snapshot(&snap_ref) != LGW_GPS_SUCCESS) {
+				printf("    No published time reference.\n");
+				continue;
+			}
+			lgw_cnt2utc(snap_ref, x, &y);
 			strftime(tmp_str, sizeof(tmp_str), "%F %T", gmtime(&(y.tv_sec)));
 			printf("    Conversion to UTC: %s.%09ldZ\n", tmp_str, y.tv_nsec);
-			lgw_utc2cnt(ppm_ref, y, &z);
+			lgw_utc2cnt(snap_ref, y, &z);
 			printf("    Converted back: %u\n", z);
 		}
 	}
 	
 	/* clean up before leaving */
+	if (lgw_gps_calib_save(CALIB_PATH, &ppm_ref, &ppm_est, NAN) == LGW_GPS_SUCCESS) {
+		printf("\nClock error saved to %s\n", CALIB_PATH);
+	}
 	if (exit_sig == 1) {
 		lgw_stop();
 	}
@@ -0,0 +1,476 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2013 Semtech-Cycleo
+
+Description:
+	Replay of a GPS byte stream (NMEA and/or UBX) through the parser and the
+	synchronization pipeline, without GPS receiver nor concentrator.
+	The stream is read from a recording (eg. `cat /dev/ttyACM0 > gps.log`) or
+	generated, cut in fragments of random size, optionally corrupted, and the
+	program reports the parsed messages, the parser throughput, the memory
+	allocations done by the library and the xtal_err trajectory obtained with
+	a simulated concentrator counter. The fitted clock error is then saved to
+	check that a single PPS gives a valid reference only once it is loaded.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+Maintainer: Sylvain Miermont
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+	#define _XOPEN_SOURCE 600
+#else
+	#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>		/* C99 types */
+#include <stdbool.h>	/* bool type */
+#include <stdio.h>		/* printf fopen fread */
+#include <stdlib.h>		/* malloc atoi rand */
+#include <string.h>		/* memset memcpy */
+#include <unistd.h>		/* getopt */
+#include <time.h>		/* clock_gettime timegm */
+#include <math.h>		/* llround */
+
+#include "loragw_gps.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define MAX_STREAM_SIZE		(64 * 1024 * 1024)	/* max size of a recording */
+#define LINE_SIZE			128		/* max length of a sentence in line mode */
+#define GEN_START			1711195200	/* 2024-03-23T12:00:00Z, start of the generated stream */
+#define CNT_START			123456789	/* simulated counter at the first PPS */
+#define CALIB_PATH			"gps_replay_calib.bin"	/* calibration file of the first PPS check */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+/* allocations done by the library while parsing (the program is linked with --wrap=malloc,calloc,realloc) */
+static bool count_alloc = false;
+static unsigned long nb_alloc = 0;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+static void usage(void);
+
+static size_t nmea_add(char *buff, size_t pos, const char *body);
+
+static char *generate(int seconds, size_t *size);
+
+static char *load(const char *path, size_t *size);
+
+static char *corrupt(const char *in, size_t in_size, int rate, size_t *size);
+
+static double elapsed(const struct timespec *start);
+
+static bool check_first_pps(const struct tref *fit_ref, const struct tref_est_s *fit_est);
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+void *__wrap_malloc(size_t size) {
+	if (count_alloc) {
+		++nb_alloc;
+	}
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+	if (count_alloc) {
+		++nb_alloc;
+	}
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	if (count_alloc) {
+		++nb_alloc;
+	}
+	return __real_realloc(ptr, size);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void usage(void) {
+	printf("Available options:\n");
+	printf(" -h print this help\n");
+	printf(" -f <path> replay a recorded GPS stream (default: generated NMEA stream)\n");
+	printf(" -n <int> number of seconds of generated stream, default 3600\n");
+	printf(" -m <int> max size of the fragments given to the parser, default 64\n");
+	printf(" -c <int> corrupt one byte in N (flipped or dropped), default 0 (none)\n");
+	printf(" -r <int> number of replays for the throughput measurement, default 10\n");
+	printf(" -x <float> simulated clock error of the concentrator in ppm, default 3.0\n");
+	printf(" -j <int> simulated jitter of the PPS capture in us, default 1\n");
+	printf(" -s parse line by line with lgw_parse_nmea instead of lgw_gps_feed (NMEA only)\n");
+	printf(" -q do not print the xtal_err trajectory\n");
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* append a NMEA sentence with its checksum, return the new position */
+static size_t nmea_add(char *buff, size_t pos, const char *body) {
+	uint8_t cs = 0;
+	const char *p;
+
+	for (p = body; *p != '\0'; ++p) {
+		cs ^= (uint8_t)*p;
+	}
+	return pos + (size_t)sprintf(buff + pos, "$%s*%02X\r\n", body, cs);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* one second of a typical receiver output: time, position, and sentences the parser ignores */
+static char *generate(int seconds, size_t *size) {
+	char body[LINE_SIZE];
+	char *buff;
+	size_t pos = 0;
+	time_t t;
+	struct tm tm;
+	int i;
+
+	buff = malloc((size_t)seconds * 512 + 1);
+	if (buff == NULL) {
+		return NULL;
+	}
+	for (i = 0; i < seconds; ++i) {
+		t = GEN_START + i;
+		gmtime_r(&t, &tm);
+		sprintf(body, "GPRMC,%02d%02d%02d.00,A,4807.038,N,01131.000,E,000.0,000.0,%02d%02d%02d,,,A", tm.tm_hour, tm.tm_min, tm.tm_sec, tm.tm_mday, tm.tm_mon + 1, tm.tm_year % 100);
+		pos = nmea_add(buff, pos, body);
+		sprintf(body, "GPGGA,%02d%02d%02d.00,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,", tm.tm_hour, tm.tm_min, tm.tm_sec);
+		pos = nmea_add(buff, pos, body);
+		pos = nmea_add(buff, pos, "GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+		pos = nmea_add(buff, pos, "GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45");
+		sprintf(body, "GPZDA,%02d%02d%02d.00,%02d,%02d,%04d,00,00", tm.tm_hour, tm.tm_min, tm.tm_sec, tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
+		pos = nmea_add(buff, pos, body);
+	}
+	*size = pos;
+	return buff;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static char *load(const char *path, size_t *size) {
+	FILE *f;
+	char *buff;
+
+	f = fopen(path, "rb");
+	if (f == NULL) {
+		printf("ERROR: cannot open %s\n", path);
+		return NULL;
+	}
+	buff = malloc(MAX_STREAM_SIZE);
+	if (buff != NULL) {
+		*size = fread(buff, 1, MAX_STREAM_SIZE, f);
+	}
+	fclose(f);
+	return buff;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* copy of the stream with one byte in rate flipped (bad checksum) or dropped (missing field, truncated sentence) */
+static char *corrupt(const char *in, size_t in_size, int rate, size_t *size) {
+	char *out;
+	size_t i, j;
+
+	out = malloc(in_size + 1);
+	if (out == NULL) {
+		return NULL;
+	}
+	for (i = 0, j = 0; i < in_size; ++i) {
+		if ((rate > 0) && ((rand() % rate) == 0)) {
+			if ((rand() % 2) == 0) {
+				continue; /* dropped */
+			}
+			out[j++] = in[i] ^ 0x04; /* flipped */
+		} else {
+			out[j++] = in[i];
+		}
+	}
+	*size = j;
+	return out;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static double elapsed(const struct timespec *start) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)(now.tv_sec - start->tv_sec) + (1E-9 * (double)(now.tv_nsec - start->tv_nsec));
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* a single PPS gives a valid reference only with a loaded calibration, for lgw_gps_sync_est and lgw_gps_sync */
+static bool check_first_pps(const struct tref *fit_ref, const struct tref_est_s *fit_est) {
+	struct tref ref;
+	struct tref_est_s est;
+	struct timespec utc, conv;
+	uint32_t cnt;
+	bool valid, ok = true;
+	int i;
+
+	if (lgw_gps_calib_save(CALIB_PATH, fit_ref, fit_est, NAN) != LGW_GPS_SUCCESS) {
+		printf("ERROR: fitted clock error not saved\n");
+		return false;
+	}
+	/* next PPS after the end of the replay */
+	cnt = fit_ref->count_us + (uint32_t)lround(1E6 * fit_ref->xtal_err);
+	utc.tv_sec = fit_ref->utc.tv_sec + 1;
+	utc.tv_nsec = fit_ref->utc.tv_nsec;
+
+	for (i = 0; i < 4; ++i) {
+		memset(&ref, 0, sizeof ref);
+		memset(&est, 0, sizeof est);
+		if ((i >= 2) && (lgw_gps_calib_load(CALIB_PATH, NAN, &ref, ((i % 2) == 0) ? &est : NULL) != LGW_GPS_SUCCESS)) {
+			printf("ERROR: calibration not loaded\n");
+			ok = false;
+			continue;
+		}
+		if ((i % 2) == 0) {
+			valid = (lgw_gps_sync_est(&est, &ref, cnt, utc) == LGW_GPS_SUCCESS);
+		} else {
+			valid = (lgw_gps_sync(&ref, cnt, utc) == LGW_GPS_SUCCESS);
+		}
+		valid = valid && (lgw_cnt2utc(ref, cnt + 500000, &conv) == LGW_GPS_SUCCESS);
+		printf("first PPS, %s, %s: %s\n", ((i % 2) == 0) ? "lgw_gps_sync_est" : "lgw_gps_sync", (i >= 2) ? "calibration loaded" : "no calibration", valid ? "valid reference" : "no reference");
+		if (valid != (i >= 2)) {
+			printf("ERROR: unexpected result\n");
+			ok = false;
+		}
+	}
+	remove(CALIB_PATH);
+	return ok;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+	int i, x;
+
+	/* options */
+	const char *path = NULL;
+	int seconds = 3600;
+	int max_frag = 64;
+	int corrupt_rate = 0;
+	int replays = 10;
+	double xtal_ppm = 3.0;
+	int jitter_us = 1;
+	bool line_mode = false;
+	bool quiet = false;
+
+	/* stream */
+	char *raw, *stream;
+	size_t raw_size = 0, size = 0;
+	size_t pos, end;
+	char line[LINE_SIZE];
+
+	/* parser results */
+	enum gps_msg msg;
+	unsigned long nb_msg[UBX_TIMEPULSE + 1];
+	unsigned long nb_total = 0, nb_bytes = 0;
+	struct timespec start;
+	double t_first, t_replay = 0.0;
+
+	/* simulated synchronization */
+	struct timespec utc, utc_anchor;
+	struct tref ref;
+	struct tref_est_s est;
+	uint32_t cnt;
+	double dt, t_anchor = 0.0, t_pps = 0.0; /* true time of the PPS pulses, in s since the first one */
+	int nb_sync = 0, nb_sync_err = 0;
+	bool has_anchor = false;
+	bool calib_ok;
+
+	static const char *msg_names[UBX_TIMEPULSE + 1] = {
+		"UNKNOWN", "IGNORED", "INVALID", "NMEA_RMC", "NMEA_GGA", "NMEA_GNS", "NMEA_ZDA", "NMEA_GBS", "NMEA_GST", "NMEA_GSA", "NMEA_GSV", "NMEA_GLL", "NMEA_TXT", "NMEA_VTG", "UBX_POSITION", "UBX_TIME", "UBX_TIMEPULSE"
+	};
+
+	/* parse command line options */
+	while ((i = getopt(argc, argv, "hf:n:m:c:r:x:j:sq")) != -1) {
+		switch (i) {
+			case 'h': usage(); return EXIT_SUCCESS;
+			case 'f': path = optarg; break;
+			case 'n': seconds = atoi(optarg); break;
+			case 'm': max_frag = atoi(optarg); break;
+			case 'c': corrupt_rate = atoi(optarg); break;
+			case 'r': replays = atoi(optarg); break;
+			case 'x': xtal_ppm = atof(optarg); break;
+			case 'j': jitter_us = atoi(optarg); break;
+			case 's': line_mode = true; break;
+			case 'q': quiet = true; break;
+			default: usage(); return EXIT_FAILURE;
+		}
+	}
+	if ((seconds < 1) || (max_frag < 1) || (corrupt_rate < 0) || (replays < 0) || (jitter_us < 0)) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	printf("Beginning of test for loragw_gps.c (replay)\n");
+
+	/* --- STREAM --- */
+
+	srand(1); /* same fragments and corruption for each run */
+	raw = (path != NULL) ? load(path, &raw_size) : generate(seconds, &raw_size);
+	if (raw == NULL) {
+		printf("ERROR: no GPS stream\n");
+		return EXIT_FAILURE;
+	}
+	stream = corrupt(raw, raw_size, corrupt_rate, &size);
+	free(raw);
+	if (stream == NULL) {
+		return EXIT_FAILURE;
+	}
+	printf("%s: %lu bytes, fragments of 1 to %d bytes, %s\n", (path != NULL) ? path : "generated stream", (unsigned long)size, max_frag, line_mode ? "lgw_parse_nmea" : "lgw_gps_feed");
+
+	/* --- FIRST PASS: PARSING AND SYNCHRONIZATION --- */
+
+	memset(nb_msg, 0, sizeof nb_msg);
+	memset(&ref, 0, sizeof ref);
+	memset(&est, 0, sizeof est);
+	count_alloc = true;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (pos = 0; pos < size; ) {
+		if (line_mode) {
+			/* one sentence per call, as cut by a canonical tty */
+			for (end = pos; (end < size) && (stream[end] != '\n'); ++end);
+			x = ((end - pos) < (LINE_SIZE - 1)) ? (int)(end - pos) : (LINE_SIZE - 1);
+			memcpy(line, stream + pos, x);
+			line[x] = '\0';
+			msg = lgw_parse_nmea(line, x + 1);
+			pos = (end < size) ? end + 1 : size;
+		} else {
+			x = 1 + (rand() % max_frag);
+			if ((size_t)x > (size - pos)) {
+				x = (int)(size - pos);
+			}
+			x = lgw_gps_feed(stream + pos, x, &msg);
+			if (x <= 0) {
+				printf("ERROR: parser did not consume any byte at offset %lu\n", (unsigned long)pos);
+				return EXIT_FAILURE;
+			}
+			pos += x;
+			if (msg == UNKNOWN) {
+				continue; /* no message completed yet */
+			}
+		}
+		nb_msg[msg] += 1;
+		nb_total += 1;
+		if ((msg != NMEA_RMC) && (msg != UBX_TIME)) {
+			continue;
+		}
+
+		/* PPS captured by a concentrator with a clock error of xtal_ppm */
+		if (lgw_gps_get(&utc, NULL, NULL) != LGW_GPS_SUCCESS) {
+			continue;
+		}
+		if (!has_anchor) {
+			utc_anchor = utc;
+			has_anchor = true;
+		}
+		/* the counter runs on its own: it follows the UTC time only when it is plausible (a corrupted sentence
+		can still pass the checksum), otherwise the message is taken as the next PPS */
+		dt = (double)(utc.tv_sec - utc_anchor.tv_sec) + (1E-9 * (double)(utc.tv_nsec - utc_anchor.tv_nsec));
+		if ((dt > 0.0) && (dt <= 60.0)) {
+			t_pps = t_anchor + dt;
+			t_anchor = t_pps;
+			utc_anchor = utc;
+		} else if (nb_sync + nb_sync_err > 0) {
+			t_pps += 1.0;
+		}
+		cnt = CNT_START + (uint32_t)(int64_t)llround(t_pps * 1E6 * (1.0 + (1E-6 * xtal_ppm)));
+		if (jitter_us > 0) {
+			cnt += (uint32_t)((rand() % ((2 * jitter_us) + 1)) - jitter_us);
+		}
+		if (lgw_gps_sync_est(&est, &ref, cnt, utc) != LGW_GPS_SUCCESS) {
+			++nb_sync_err;
+			continue;
+		}
+		++nb_sync;
+		if (!quiet) {
+			printf("sync %6d: UTC %ld.%09ld, xtal_err %.9f (%+.3f ppm), +/- %.4f ppm, jitter %.2f us\n", nb_sync, (long)utc.tv_sec, utc.tv_nsec, ref.xtal_err, 1E6 * (ref.xtal_err - 1.0), 1E6 * est.xtal_err_sd, est.jitter_us);
+		}
+	}
+	t_first = elapsed(&start);
+	count_alloc = false;
+	nb_bytes = size;
+
+	printf("\n--- parsed messages ---\n");
+	for (i = 0; i <= UBX_TIMEPULSE; ++i) {
+		if (nb_msg[i] > 0) {
+			printf("%-14s %10lu\n", msg_names[i], nb_msg[i]);
+		}
+	}
+	printf("\n--- synchronization ---\n");
+	printf("%d points accepted, %d rejected\n", nb_sync, nb_sync_err);
+	if (nb_sync > 0) {
+		printf("final xtal_err %.9f (%+.3f ppm, simulated %+.3f ppm), +/- %.4f ppm\n", ref.xtal_err, 1E6 * (ref.xtal_err - 1.0), xtal_ppm, 1E6 * est.xtal_err_sd);
+	}
+	if ((ref.systime != 0) && (est.nb >= 3)) {
+		calib_ok = check_first_pps(&ref, &est);
+	} else {
+		printf("no fit at the end of the stream, first PPS check skipped\n");
+		calib_ok = (path != NULL); /* a generated stream always ends with a fit */
+	}
+
+	/* --- NEXT PASSES: PARSER THROUGHPUT --- */
+
+	count_alloc = true;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < replays; ++i) {
+		for (pos = 0; pos < size; ) {
+			if (line_mode) {
+				for (end = pos; (end < size) && (stream[end] != '\n'); ++end);
+				x = ((end - pos) < (LINE_SIZE - 1)) ? (int)(end - pos) : (LINE_SIZE - 1);
+				memcpy(line, stream + pos, x);
+				line[x] = '\0';
+				lgw_parse_nmea(line, x + 1);
+				pos = (end < size) ? end + 1 : size;
+			} else {
+				x = 1 + (rand() % max_frag);
+				if ((size_t)x > (size - pos)) {
+					x = (int)(size - pos);
+				}
+				pos += lgw_gps_feed(stream + pos, x, &msg);
+			}
+		}
+	}
+	t_replay = elapsed(&start);
+	count_alloc = false;
+
+	printf("\n--- performance ---\n");
+	printf("first pass (with synchronization): %.3f s, %.0f messages/s\n", t_first, nb_total / t_first);
+	if ((replays > 0) && (t_replay > 0.0)) {
+		printf("%d replays (parser only): %.3f s, %.0f messages/s, %.1f MB/s\n", replays, t_replay, (double)nb_total * replays / t_replay, (double)nb_bytes * replays / t_replay / 1E6);
+	}
+	printf("memory allocations while parsing: %lu\n", nb_alloc);
+
+	free(stream);
+	printf("\nEnd of test for loragw_gps.c (replay)\n");
+	return ((nb_alloc == 0) && calib_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -36,11 +36,14 @@ Maintainer: Sylvain Miermont
 
 #include "parson.h"
 #include "loragw_hal.h"
+#include "loragw_reg.h"	/* register access profiler */
+#include "loragw_hostclk.h"	/* counter to host clock correlation */
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS ------------------------------------------------------- */
 
 #define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+#define TS_NS(t)		(((long long)(t).tv_sec * 1000000000LL) + (t).tv_nsec)
 #define MSG(args...)	fprintf(stderr,"loragw_pkt_logger: " args) /* message that is destined to the user */
 
 /* -------------------------------------------------------------------------- */
@@ -50,6 +53,7 @@ Maintainer: Sylvain Miermont
 struct sigaction sigact; /* SIGQUIT&SIGINT&SIGTERM signal handling */
 static int exit_sig = 0; /* 1 -> application terminates cleanly (shut down hardware, close open files, etc) */
 static int quit_sig = 0; /* 1 -> application terminates without shutting down the hardware */
+static volatile sig_atomic_t profile_sig = 0; /* 1 -> print the register access profile */
 
 /* configuration variables needed by the application  */
 uint64_t lgwm = 0; /* LoRa gateway MAC address */
@@ -82,6 +86,8 @@ static void sig_handler(int sigio) {
 		quit_sig = 1;;
 	} else if ((sigio == SIGINT) || (sigio == SIGTERM)) {
 		exit_sig = 1;
+	} else if (sigio == SIGUSR1) {
+		profile_sig = 1;
 	}
 }
 
@@ -314,6 +320,7 @@ void usage(void) {
 	printf( "Available options:\n");
 	printf( " -h print this help\n");
 	printf( " -r <int> rotate log file every N seconds (-1 disable log rotation)\n");
+	printf( " -p profile register accesses, report printed on SIGUSR1 and at exit\n");
 }
 
 /* -------------------------------------------------------------------------- */
@@ -328,6 +335,7 @@ int main(int argc, char **argv)
 	int log_rotate_interval = 3600; /* by default, rotation every hour */
 	int time_check = 0; /* variable used to limit the number of calls to time() function */
 	unsigned long pkt_in_log = 0; /* count the number of packet written in each log file */
+	bool profile = false; /* register access profiling */
 	
 	/* configuration file related */
 	const char global_conf_fname[] = "global_conf.json"; /* contain global (typ. network-wide) configuration */
@@ -344,8 +352,16 @@ int main(int argc, char **argv)
 	char fetch_timestamp[30];
 	struct tm * x;
 	
+	/* packet timestamps from the concentrator counter, correlated with the host clock every second */
+	struct lgw_hostclk_s hostclk;
+	struct timespec mono_time, real_time, pkt_time;
+	time_t next_sample = 0; /* monotonic time of the next counter sample */
+	long long real_offset_ns = 0; /* CLOCK_REALTIME - CLOCK_MONOTONIC */
+	char pkt_timestamp[30];
+	long long t;
+	
 	/* parse command line options */
-	while ((i = getopt (argc, argv, "hr:")) != -1) {
+	while ((i = getopt (argc, argv, "hr:p")) != -1) {
 		switch (i) {
 			case 'h':
 				usage();
@@ -360,6 +376,10 @@ int main(int argc, char **argv)
 				}
 				break;
 			
+			case 'p':
+				profile = true;
+				break;
+			
 			default:
 				MSG("ERROR: argument parsing use -h option for help\n");
 				usage();
@@ -374,6 +394,11 @@ int main(int argc, char **argv)
 	sigaction(SIGQUIT, &sigact, NULL);
 	sigaction(SIGINT, &sigact, NULL);
 	sigaction(SIGTERM, &sigact, NULL);
+	sigaction(SIGUSR1, &sigact, NULL);
+	
+	if (profile) {
+		lgw_reg_profile_enable(true);
+	}
 	
 	/* configuration files management */
 	if (access(debug_conf_fname, R_OK) == 0) {
@@ -417,8 +442,20 @@ int main(int argc, char **argv)
 	time(&now_time);
 	open_log();
 	
+	memset(&hostclk, 0, sizeof hostclk);
+	
 	/* main loop */
 	while ((quit_sig != 1) && (exit_sig != 1)) {
+		/* sample the concentrator counter once per second */
+		clock_gettime(CLOCK_MONOTONIC, &mono_time);
+		if (mono_time.tv_sec >= next_sample) {
+			next_sample = mono_time.tv_sec + 1;
+			lgw_hostclk_sample(&hostclk, NULL);
+			clock_gettime(CLOCK_REALTIME, &real_time);
+			clock_gettime(CLOCK_MONOTONIC, &mono_time);
+			real_offset_ns = TS_NS(real_time) - TS_NS(mono_time);
+		}
+		
 		/* fetch packets */
 		nb_pkt = lgw_receive(ARRAY_SIZE(rxpkt), rxpkt);
 		if (nb_pkt == LGW_HAL_ERROR) {
@@ -443,8 +480,16 @@ int main(int argc, char **argv)
 			/* writing node MAC address */
 			fputs("\"\",", log_file); // TODO: need to parse payload
 			
-			/* writing UTC timestamp*/
-			fprintf(log_file, "\"%s\",", fetch_timestamp);
+			/* writing UTC timestamp, from the packet counter value once it is correlated with the host clock */
+			if (lgw_cnt2host(&hostclk, p->count_us64, &pkt_time, NULL) == LGW_HOSTCLK_SUCCESS) {
+				t = TS_NS(pkt_time) + real_offset_ns;
+				pkt_time.tv_sec = (time_t)(t / 1000000000LL);
+				pkt_time.tv_nsec = (long)(t % 1000000000LL);
+				strftime(pkt_timestamp, ARRAY_SIZE(pkt_timestamp), "%Y-%m-%d %H:%M:%S", gmtime(&(pkt_time.tv_sec)));
+				fprintf(log_file, "\"%s.%06liZ\",", pkt_timestamp, (pkt_time.tv_nsec)/1000); /* ISO 8601 format */
+			} else {
+				fprintf(log_file, "\"%s\",", fetch_timestamp);
+			}
 			// TODO: replace with GPS time when available
 			
 			/* writing internal clock */
@@ -537,6 +582,12 @@ int main(int argc, char **argv)
 			++pkt_in_log;
 		}
 		
+		/* print the register access profile on request */
+		if (profile_sig == 1) {
+			profile_sig = 0;
+			lgw_reg_profile_dump(stdout);
+		}
+		
 		/* check time and rotate log file if necessary */
 		++time_check;
 		if (time_check >= 8) {
@@ -551,6 +602,10 @@ int main(int argc, char **argv)
 		}
 	}
 	
+	if (profile) {
+		lgw_reg_profile_dump(stdout);
+	}
+	
 	if (exit_sig == 1) {
 		/* clean up before leaving */
 		i = lgw_stop();
@@ -32,7 +32,9 @@ Maintainer: Sylvain Miermont
 #include <unistd.h>		/* getopt access */
 #include <stdlib.h>		/* rand */
 
+#include "loragw_hal.h"
 #include "loragw_reg.h"
+#include "loragw_spi.h"
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS ------------------------------------------------------- */
@@ -47,6 +49,10 @@ Maintainer: Sylvain Miermont
 #define		READS_WHEN_ERROR	16 /* number of times a read is repeated if there is a read error */
 #define		BUFF_SIZE			1024
 
+#define		PROBE_MIN_HZ		1000000 /* SPI clock probing range and step */
+#define		PROBE_MAX_HZ		20000000
+#define		PROBE_STEP_HZ		1000000
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
 
@@ -62,6 +68,8 @@ static void sig_handler(int sigio);
 
 void usage (void);
 
+static void print_spi_stats(void);
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
@@ -78,6 +86,31 @@ void usage(void) {
 	MSG( "Available options:\n");
 	MSG( " -h print this help\n");
 	MSG( " -t <int> specify which test you want to run (1-4)\n");
+	MSG( " -d <path> SPI device to use (default from LGW_SPI_PATH or compiled-in)\n");
+	MSG( " -s <int> SPI clock in Hz (default from LGW_SPI_SPEED or compiled-in)\n");
+	MSG( " -p probe the fastest reliable SPI clock (%u to %u Hz) before running the test\n", PROBE_MIN_HZ, PROBE_MAX_HZ);
+	MSG( " -l collect SPI latency statistics and display them on exit\n");
+}
+
+/* display the SPI transaction statistics collected since start-up */
+static void print_spi_stats(void) {
+	static const char *name[LGW_SPI_STAT_NB] = {"write", "read", "burst write", "burst read"};
+	struct lgw_spi_stats_s stats;
+	struct lgw_spi_stat_s *s;
+	int i;
+	
+	if (lgw_spi_get_stats(&stats) != LGW_SPI_SUCCESS) {
+		return;
+	}
+	MSG("INFO: SPI latency statistics (us):\n");
+	MSG("%12s %10s %8s %12s %8s %8s %8s %8s\n", "type", "count", "errors", "bytes", "mean", "p50", "p99", "max");
+	for (i=0; i<LGW_SPI_STAT_NB; ++i) {
+		s = &stats.type[i];
+		if (s->count == 0) {
+			continue;
+		}
+		MSG("%12s %10llu %8llu %12llu %8.1f %8.1f %8.1f %8.1f\n", name[i], (unsigned long long)s->count, (unsigned long long)s->errors, (unsigned long long)s->bytes, (double)s->lat_sum_ns / s->count / 1e3, lgw_spi_stats_percentile(s, 50) / 1e3, lgw_spi_stats_percentile(s, 99) / 1e3, s->lat_max_ns / 1e3);
+	}
 }
 
 /* -------------------------------------------------------------------------- */
@@ -93,6 +126,10 @@ int main(int argc, char **argv)
 	int cycle_number = 0;
 	int repeats_per_cycle = 1000;
 	bool error = false;
+	char *spi_path = NULL;
+	uint32_t spi_speed = 0;
+	bool probe = false;
+	bool spi_stats = false;
 	
 	/* in/out variables */
 	int32_t test_value;
@@ -105,7 +142,7 @@ int main(int argc, char **argv)
 	uint8_t read_buff[BUFF_SIZE];
 	
 	/* parse command line options */
-	while ((i = getopt (argc, argv, "ht:")) != -1) {
+	while ((i = getopt (argc, argv, "ht:d:s:pl")) != -1) {
 		switch (i) {
 			case 'h':
 				usage();
@@ -122,6 +159,26 @@ int main(int argc, char **argv)
 				}
 				break;
 			
+			case 'd':
+				spi_path = optarg;
+				break;
+			
+			case 's':
+				i = sscanf(optarg, "%u", &spi_speed);
+				if ((i != 1) || (spi_speed == 0)) {
+					MSG("ERROR: invalid SPI clock\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			
+			case 'p':
+				probe = true;
+				break;
+			
+			case 'l':
+				spi_stats = true;
+				break;
+			
 			default:
 				MSG("ERROR: argument parsing use -h option for help\n");
 				usage();
@@ -139,12 +196,24 @@ int main(int argc, char **argv)
 	sigaction(SIGTERM, &sigact, NULL);
 	
 	/* start SPI link */
+	lgw_spi_stats_enable(spi_stats);
+	lgw_spi_setconf(spi_path, spi_speed);
 	i = lgw_connect();
 	if (i != LGW_REG_SUCCESS) {
 		MSG("ERROR: lgw_connect() did not return SUCCESS");
 		return EXIT_FAILURE;
 	}
 	
+	if (probe) {
+		i = lgw_reg_spi_probe(PROBE_MIN_HZ, PROBE_MAX_HZ, PROBE_STEP_HZ, &spi_speed);
+		if (i != LGW_REG_SUCCESS) {
+			MSG("ERROR: no reliable SPI clock found\n");
+			lgw_disconnect();
+			return EXIT_FAILURE;
+		}
+		MSG("INFO: SPI clock set to %u Hz\n", spi_speed);
+	}
+	
 	if (test_number == 1) {
 		/* single 8b register R/W stress test */
 		while ((quit_sig != 1) && (exit_sig != 1)) {
@@ -276,6 +345,10 @@ int main(int argc, char **argv)
 		usage();
 	}
 	
+	if (spi_stats) {
+		print_spi_stats();
+	}
+	
 	/* close SPI link */
 	i = lgw_disconnect();
 	if (i != LGW_REG_SUCCESS) {
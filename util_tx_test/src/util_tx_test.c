@@ -93,6 +93,7 @@ void usage(void) {
 	printf( " -t <uint> pause between packets (ms)\n");
 	printf( " -x <int> numbers of times the sequence is repeated (-1 for continuous)\n");
 	printf( " -i send packet using inverted modulation polarity \n");
+	printf( " -g <path> TX gain profile replacing the table of the board\n");
 }
 
 /* -------------------------------------------------------------------------- */
@@ -119,6 +120,8 @@ int main(int argc, char **argv)
 	int delay = 1000; /* 1 second between packets by default */
 	int repeat = -1; /* by default, repeat until stopped */
 	bool invert = false;
+	const char *gain_profile = NULL; /* by default, TX gain table of the board */
+	struct lgw_tx_gain_lut_s txlut;
 	
 	/* RF configuration (TX fail if RF chain is not enabled) */
 	const struct lgw_conf_rxrf_s rfconf = {true, lowfreq[RF_CHAIN]};
@@ -130,7 +133,7 @@ int main(int argc, char **argv)
 	uint16_t cycle_count = 0;
 	
 	/* parse command line options */
-	while ((i = getopt (argc, argv, "hf:s:b:p:r:z:t:x:i")) != -1) {
+	while ((i = getopt (argc, argv, "hf:s:b:p:r:z:t:x:ig:")) != -1) {
 		switch (i) {
 			case 'h':
 				usage();
@@ -229,6 +232,10 @@ int main(int argc, char **argv)
 				invert = true;
 				break;
 			
+			case 'g': /* -g <path> TX gain profile */
+				gain_profile = optarg;
+				break;
+			
 			default:
 				MSG("ERROR: argument parsing\n");
 				usage();
@@ -256,6 +263,13 @@ int main(int argc, char **argv)
 	/* starting the concentrator */
 	lgw_rxrf_setconf(RF_CHAIN0, rfconf);
 	lgw_rxrf_setconf(RF_CHAIN1, rfconf);
+	if (gain_profile != NULL) {
+		if ((lgw_txgain_load(gain_profile, &txlut) != LGW_HAL_SUCCESS) || (lgw_txgain_setconf(&txlut) != LGW_HAL_SUCCESS)) {
+			MSG("ERROR: invalid TX gain profile %s\n", gain_profile);
+			return EXIT_FAILURE;
+		}
+		MSG("INFO: TX gain table loaded from %s\n", gain_profile);
+	}
 
 	i = lgw_start();
 	if (i == LGW_HAL_SUCCESS) {